@@ -16,6 +16,13 @@
 #include "Audio.h"
 #include "mp3_decoder.h"
 #include "aac_decoder.h"
+#include "flac_decoder.h"
+#include "resampler.h"
+#include "http_parser.h"
+#include "recorder.h"
+#include "mem_place.h"
+#include "lwip/sockets.h"
+#include "lwip/dns.h"
 // added HN for computing IIR filter coefficients based on sampling rate
 // and transmitting the coefficients to the FPGA
 #include "tas5753md.h"
@@ -26,28 +33,22 @@ AudioBuffer::AudioBuffer(){ ;
 }
 
 AudioBuffer::~AudioBuffer(){
-    if(m_buffer) free(m_buffer);
+    MemFree(m_buffer);
     m_buffer = NULL;
 }
 
 size_t AudioBuffer::init(){
-    if(psramInit()){
-        // PSRAM found, AudioBuffer will be allocated in PSRAM
-        m_buffSize = m_buffSizePSRAM;
-        if(m_buffer == NULL){
-            m_buffer = (uint8_t*)ps_calloc(m_buffSize, sizeof(uint8_t));
-            m_buffSize = m_buffSizePSRAM - m_resBuffSize;
-            if(m_buffer == NULL){
-                // not enough space in PSRAM, use ESP32 Flash Memory instead
-                m_buffer = (uint8_t*)calloc(m_buffSize, sizeof(uint8_t));
-                m_buffSize = m_buffSizeRAM - m_resBuffSize;
-            }
+    psramInit();
+    if(m_buffer == NULL){
+        // bulk data, the large buffer if the placement policy puts it into PSRAM, else the small one in internal RAM
+        size_t size = (MemPlacement(MEM_BULK) == MEM_PSRAM) ? m_buffSizePSRAM : m_buffSizeRAM;
+        m_buffer = (uint8_t*)MemAlloc(MEM_BULK, size, "InBuff");
+        if(m_buffer == NULL && size == m_buffSizePSRAM){
+            // not enough space in PSRAM
+            size = m_buffSizeRAM;
+            m_buffer = (uint8_t*)MemAlloc(MEM_BULK, size, "InBuff");
         }
-    }
-    else{  // no PSRAM available, use ESP32 Flash Memory"
-        m_buffSize = m_buffSizeRAM;
-        m_buffer = (uint8_t*)calloc(m_buffSize, sizeof(uint8_t));
-        m_buffSize = m_buffSizeRAM - m_resBuffSize;
+        m_buffSize = size - m_resBuffSize;
     }
     if(!m_buffer) return 0;
     resetBuffer();
@@ -129,6 +130,94 @@ uint32_t AudioBuffer::getWritePos(){
 uint32_t AudioBuffer::getReadPos(){
     return m_readPtr - m_buffer;
 }
+//---------------------------------------------------------------------------------------------------------------------
+void MP3FrameIndex::reset(){
+    m_count = 0;
+    m_shift = 4;
+}
+
+void MP3FrameIndex::add(uint32_t frame, uint32_t pos){
+    if(frame & ((1 << m_shift) - 1)) return;     // not on the grid
+    if((frame >> m_shift) != m_count) return;    // not the next entry
+    if(m_count == m_maxEntries){                 // table is full, keep every second entry
+        for(uint16_t i = 0; i < m_maxEntries / 2; i++) m_pos[i] = m_pos[2 * i];
+        m_count = m_maxEntries / 2;
+        m_shift++;
+        if(frame & ((1 << m_shift) - 1)) return;
+    }
+    m_pos[m_count++] = pos;
+}
+
+bool MP3FrameIndex::lookup(uint32_t frame, uint32_t *idxFrame, uint32_t *pos){
+    uint32_t i = frame >> m_shift;
+    if(i >= m_count) return false;               // not scanned yet
+    *idxFrame = i << m_shift;
+    *pos = m_pos[i];
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void JitterBuffer::reset(uint32_t now, bool large){
+    m_t0 = now;
+    m_minFloor = large ? m_minMsLarge : m_minMs;
+    m_last = 0;
+    m_mean = m_dev = m_peak = 0;
+    m_peakTime = m_floorTime = m_rateTime = now;
+    m_floor = m_minFloor;
+    m_rate = m_rateBytes = 0;
+    m_latency = 0;
+    m_underruns = 0;
+}
+
+void JitterBuffer::arrival(uint32_t bytes, uint32_t now){
+    if(bytes == 0){                              // nothing was asked for, the time since m_last is no gap
+        if(m_last) m_last = now;
+        return;
+    }
+    if(m_last){
+        uint32_t gap = now - m_last;
+        int32_t  err = (int32_t)(gap << 4) - (int32_t)m_mean;   // m_mean and m_dev in 1/16 ms
+        m_mean += err / 8;
+        m_dev  += ((err < 0 ? -err : err) - (int32_t)m_dev) / 4;
+        if(gap > m_peak){
+            m_peak = gap;
+            m_peakTime = now;
+        }
+    }
+    m_last = now;
+    if(now - m_peakTime > 10000){                // the longest gap fades out
+        m_peak /= 2;
+        m_peakTime = now;
+    }
+    if(m_floor > m_minFloor && now - m_floorTime > 60000){
+        m_floor = max(m_minFloor, m_floor * 3 / 4);
+        m_floorTime = now;
+    }
+    m_rateBytes += bytes;
+    if(now - m_rateTime >= 1000){
+        uint32_t r = (uint64_t)m_rateBytes * 1000 / (now - m_rateTime);
+        m_rate = m_rate ? (m_rate * 3 + r) / 4 : r;
+        m_rateBytes = 0;
+        m_rateTime = now;
+    }
+}
+
+void JitterBuffer::underrun(uint32_t now){
+    m_underruns++;
+    m_floor = min((uint32_t)m_maxMs, max(m_floor * 3 / 2, jitterMs()));
+    m_floorTime = now;
+}
+
+void JitterBuffer::started(uint32_t now){
+    if(!m_latency) m_latency = max((uint32_t)1, now - m_t0);
+}
+
+uint32_t JitterBuffer::target(uint32_t byteRate, uint32_t limit){
+    uint32_t ms = min((uint32_t)m_maxMs, max(m_floor, jitterMs()));
+    uint32_t rate = byteRate ? byteRate : m_rate ? m_rate : 16000;  // 128 kbit/s until something is known
+    uint32_t bytes = m_reserve + (uint64_t)rate * ms / 1000;
+    if(bytes > limit) bytes = limit;
+    return bytes;
+}
 
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -137,11 +226,19 @@ Audio::Audio() {
     m_i2s_num = I2S_NUM_0; // i2s port number
     m_i2s_config.mode                 = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX);
     m_i2s_config.sample_rate          = 16000;
+#ifdef I2S_32BIT
+    m_i2s_config.bits_per_sample      = I2S_BITS_PER_SAMPLE_32BIT; // 16 bit samples are sent in the upper half
+#else
     m_i2s_config.bits_per_sample      = I2S_BITS_PER_SAMPLE_16BIT;
+#endif
     m_i2s_config.channel_format       = I2S_CHANNEL_FMT_RIGHT_LEFT;
     m_i2s_config.communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB);
     m_i2s_config.intr_alloc_flags     = ESP_INTR_FLAG_LEVEL1; // high interrupt priority
+#ifdef I2S_32BIT
+    m_i2s_config.dma_buf_count        = 4;      // twice the bytes per frame, keep 32KB of DMA buffers
+#else
     m_i2s_config.dma_buf_count        = 8;      // max buffers
+#endif
     m_i2s_config.dma_buf_len          = 1024;   // max value
     m_i2s_config.use_apll             = APLL_ENABLE;
     m_i2s_config.tx_desc_auto_clear   = true;   // new in V1.0.1
@@ -156,15 +253,16 @@ Audio::Audio() {
 
     size_t size = InBuff.init();
     if(size == m_buffSizeRAM   - m_resBuffSize){
-        sprintf(chbuf, "PSRAM not found, inputBufferSize = %u bytes", size -1);
+        sprintf(chbuf, "PSRAM not found, inputBufferSize = %u bytes", (uint32_t)size -1);
         if(audio_info) audio_info(chbuf);
         m_f_psram = false;
     }
     if(size == m_buffSizePSRAM - m_resBuffSize){
-        sprintf(chbuf, "PSRAM found, inputBufferSize = %u bytes", size -1);
+        sprintf(chbuf, "PSRAM found, inputBufferSize = %u bytes", (uint32_t)size -1);
         if(audio_info) audio_info(chbuf);
         m_f_psram = true;
     }
+    MemReport(audio_info, true);
 
 }
 
@@ -180,6 +278,8 @@ esp_err_t Audio::I2Sstop(uint8_t i2s_num) {
 Audio::~Audio() {
     I2Sstop(m_i2s_num);
     InBuff.~AudioBuffer();
+    MemFree(m_xfBuff);
+    RecStop();
 }
 //---------------------------------------------------------------------------------------------------------------------
 void Audio::reset(){
@@ -189,17 +289,24 @@ void Audio::reset(){
     InBuff.resetBuffer();
     MP3Decoder_FreeBuffers();
     AACDecoder_FreeBuffers();
+    FLACDecoder_FreeBuffers();
     client.stop(); client.flush(); // release memory
     clientsecure.stop(); clientsecure.flush();
+    if(m_netFd >= 0) close(m_netFd);                        // connect in progress
+    m_netFd = -1;
+    m_netState = NET_IDLE;
+    if(m_nextfile) m_nextfile.close();
 
     sprintf(chbuf, "buffers freed, free Heap: %u bytes", ESP.getFreeHeap());
     if(audio_info) audio_info(chbuf);
 
     m_f_chunked=false;                                      // Assume not chunked
     m_f_ctseen=false;                                       // Contents type not seen yet
-    m_f_firstmetabyte=false;
+    m_ctseen=false;
     m_f_firststream_ready=false;
     m_f_localfile=false;                                    // SPIFFS or SD? (onnecttoFS)
+    m_f_nextFile=false;                                     // no file queued (connecttoFSNext)
+    m_f_preroll=false;
     m_f_playing=false;
     m_f_ssl=false;
     m_f_stream=false;
@@ -208,21 +315,31 @@ void Audio::reset(){
     m_f_webstream=false;
 
     m_audioCurrentTime=0;                                   // Reset playtimer
+    m_samplesDecoded=0;                                     // position in samples per channel
     m_audioFileDuration = 0;
     m_avr_bitrate=0;                                        // the same as m_bitrate if CBR, median if VBR
     m_bitRate=0;                                            // Bitrate still unknown
     m_bytesNotDecoded=0;                                    // counts all not decodable bytes
-    m_chunkcount=0;                                         // for chunked streams
     m_codec = CODEC_NONE;
     m_contentlength=0;                                      // If Content-Length is known, count it
     m_curSample=0;
     m_icyname="";                                           // No StationName yet
     m_metaCount=0;                                          // count bytes between metadata
     m_metaint=0;                                            // No metaint yet
-    m_metaline="";                                          // No metadata yet
-    m_LFcount=0;                                            // For end of header detection
+    m_webPos=0;                                             // nothing read from the client yet
+    m_webLen=0;
+    m_webRaw=0;
+    HTTPParserReset(&m_http);                               // no partial header line or metadata block
     m_st_remember="";                                       // Delete the last streamtitle
     m_totalcount=0;                                         // Reset totalcount
+    m_f_encDelay=false;                                     // no gapless info yet
+    m_encDelay=0;
+    m_encPadding=0;
+    m_encSamples=0;
+    m_trimStart=0;
+    m_trimEnd=0;
+    m_xfState=XF_OFF;                                       // no crossfade running, the ring stays allocated
+    m_xfFill=0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -232,6 +349,9 @@ bool Audio::connecttohost(String host){
         return false;
     }
     reset();
+    m_jitter.reset(millis(), m_f_psram);
+    m_jbTarget = 0;
+    m_jbOwed = 0;
 
     if(m_lastHost!=host){                                 // New host or reconnection?
         m_lastHost=host;                                  // Remember the current host
@@ -280,45 +400,180 @@ bool Audio::connecttohost(String host){
     if(audio_info) audio_info(chbuf);
     if(audio_showstreaminfo) audio_showstreaminfo(chbuf);
 
-    String resp=String("GET ") + extension +
+    m_netRequest = String("GET ") + extension +
                 String(" HTTP/1.1\r\n") +
                 String("Host: ") + hostwoext +
                 String("\r\n") +
                 String("Icy-MetaData:1\r\n") +
                 String("Connection: close\r\n\r\n");
+    m_netHost = hostwoext;
+    m_netPort = port;
+    m_netTries = 0;
+    m_f_netPlayed = false;
+    m_f_running = true;                                     // loop() runs the connection, see processConnection()
+    netStart();
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+// DNS answers arrive in the lwIP thread, a lookup that has been given up is recognized by its number
+static volatile uint32_t s_dnsIP = 0;
+static volatile uint32_t s_dnsSeq = 0;
+static volatile int8_t   s_dnsResult = 0;                   // 0 = pending, 1 = found, -1 = not found
+
+static void dnsFound(const char *, const ip_addr_t *ipaddr, void *arg){
+    if((uint32_t)(uintptr_t)arg != s_dnsSeq) return;       // stale
+    if(ipaddr) s_dnsIP = ip4_addr_get_u32(ip_2_ip4(ipaddr));
+    s_dnsResult = ipaddr ? 1 : -1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::netStart(){
+    // starts the name lookup of m_netHost, the next steps follow in processConnection()
+    ip_addr_t ip;
+    err_t err;
+
+    s_dnsSeq++;
+    s_dnsResult = 0;
+    err = dns_gethostbyname(m_netHost.c_str(), &ip, dnsFound, (void*)(uintptr_t)s_dnsSeq);
+    if(err == ERR_OK){                                      // IP address or cached
+        s_dnsIP = ip4_addr_get_u32(ip_2_ip4(&ip));
+        s_dnsResult = 1;
+    }
+    else if(err != ERR_INPROGRESS){
+        s_dnsResult = -1;
+    }
+    m_netState = NET_DNS;
+    m_netTime = millis();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::netRetry(const char *why){
+    // closes the connection attempt or the lost connection, the next one starts at once, then after a
+    // backoff of 0.5, 1, 2 ... 30 s. A stream that never played gives up after NET_MAX_TRIES
+    if(m_netFd >= 0) close(m_netFd);
+    m_netFd = -1;
+    client.stop();
+    clientsecure.stop();
+    m_netTries++;
+    if(!m_f_netPlayed && m_netTries >= NET_MAX_TRIES){
+        sprintf(chbuf, "Request %s failed! (%s)", m_lastHost.c_str(), why);
+        if(audio_info) audio_info(chbuf);
+        if(audio_showstation) audio_showstation("");
+        if(audio_showstreamtitle) audio_showstreamtitle("");
+        if(audio_showstreaminfo) audio_showstreaminfo("");
+        m_netState = NET_IDLE;
+        m_f_running = false;
+        return;
+    }
+    m_netBackoff = min((uint32_t)NET_BACKOFF_MAX, (uint32_t)125 << min(m_netTries, (uint8_t)8));
+    if(m_netTries == 1) m_netBackoff = 0;                   // the first try follows at once
+    sprintf(chbuf, "%s, next try in %u ms", why, m_netBackoff);
+    if(audio_info) audio_info(chbuf);
+    m_netState = NET_BACKOFF;
+    m_netTime = millis();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::netReconnect(const char *why){
+    // the stream is lost, a new connection is made while the input buffer plays on. The decoder, the
+    // input buffer and the jitter buffer stay, everything that belongs to the HTTP response is reset
+    m_f_chunked = false;
+    m_f_ctseen = false;
+    m_ctseen = false;
+    m_f_swm = true;
+    m_metaCount = 0;
+    m_metaint = 0;
+    m_webPos = m_webLen = m_webRaw = 0;
+    HTTPParserReset(&m_http);
+    m_datamode = AUDIO_HEADER;
+    netRetry(why);                                          // m_netTries is 0 if the header came through
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::processConnection(){
+    // one step of DNS, TCP connect or backoff per loop(), nothing here waits. Audio that is already in the
+    // input buffer (a reconnect) keeps playing. TLS: only the name lookup is asynchronous, the handshake of
+    // WiFiClientSecure blocks
+    if(!m_f_running){                                       // stopSong()
+        if(m_netFd >= 0) close(m_netFd);
+        m_netFd = -1;
+        m_netState = NET_IDLE;
+        return;
+    }
+    if(m_f_stream) playWebBuffer();
 
-    if(m_f_ssl==false){
-        if(client.connect(hostwoext.c_str(), port)){
-            if(audio_info) audio_info("Connected to server");
-            client.print(resp);
-            m_f_running=true;
-            return true;
-        }
+    if(m_netState == NET_BACKOFF){
+        if(millis() - m_netTime >= m_netBackoff) netStart();
+        return;
     }
-    if(m_f_ssl==true){
-        if(clientsecure.connect(hostwoext.c_str(), port)){
+    if(m_netState == NET_DNS){
+        if(s_dnsResult == 0){
+            if(millis() - m_netTime > NET_TIMEOUT) netRetry("DNS timeout");
+            return;
+        }
+        if(s_dnsResult < 0){
+            netRetry("DNS lookup failed");
+            return;
+        }
+        if(m_f_ssl){
+            if(!clientsecure.connect(m_netHost.c_str(), m_netPort)){
+                netRetry("SSL/TLS connect failed");
+                return;
+            }
             if(audio_info) audio_info("SSL/TLS Connected to server");
-            clientsecure.print(resp);
+            clientsecure.print(m_netRequest);
             sprintf(chbuf, "SSL has been established, free Heap: %u bytes", ESP.getFreeHeap());
             if(audio_info) audio_info(chbuf);
-            m_f_running=true;
-            return true;
+            m_netState = NET_UP;
+            m_netLastData = millis();
+            return;
+        }
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(m_netPort);
+        addr.sin_addr.s_addr = s_dnsIP;
+        m_netFd = socket(AF_INET, SOCK_STREAM, 0);
+        if(m_netFd < 0){
+            netRetry("no socket");
+            return;
         }
+        fcntl(m_netFd, F_SETFL, fcntl(m_netFd, F_GETFL, 0) | O_NONBLOCK);
+        if(connect(m_netFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS){
+            netRetry("connect failed");
+            return;
+        }
+        m_netState = NET_CONNECT;
+        m_netTime = millis();
+        return;
+    }
+    if(m_netState == NET_CONNECT){
+        fd_set wfds;
+        struct timeval tv = {0, 0};
+        int err = 0;
+        socklen_t len = sizeof(err);
+        FD_ZERO(&wfds);
+        FD_SET(m_netFd, &wfds);
+        if(select(m_netFd + 1, NULL, &wfds, NULL, &tv) <= 0){
+            if(millis() - m_netTime > NET_TIMEOUT) netRetry("connect timeout");
+            return;
+        }
+        getsockopt(m_netFd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if(err){
+            netRetry("connection refused");
+            return;
+        }
+        fcntl(m_netFd, F_SETFL, fcntl(m_netFd, F_GETFL, 0) & ~O_NONBLOCK);  // WiFiClient expects a blocking socket
+        client = WiFiClient(m_netFd);                       // the client owns the socket now
+        m_netFd = -1;
+        if(audio_info) audio_info("Connected to server");
+        client.print(m_netRequest);
+        m_netState = NET_UP;
+        m_netLastData = millis();
     }
-    log_i("freeHeap after %i", ESP.getFreeHeap());
-    sprintf(chbuf, "Request %s failed!", host.c_str());
-    if(audio_info) audio_info(chbuf);
-    if(audio_showstation) audio_showstation("");
-    if(audio_showstreamtitle) audio_showstreamtitle("");
-    if(audio_showstreaminfo) audio_showstreaminfo("");
-    return false;
 }
 //-----------------------------------------------------------------------------------------------------------------------------------
 bool Audio::connecttoSD(String sdfile){
     return connecttoFS(SD, sdfile);
 }
 //-----------------------------------------------------------------------------------------------------------------------------------
-bool Audio::connecttoFS(fs::FS &fs, String file){
+void Audio::utf8toASCII(char *dst, String file){
     const uint8_t ascii[60]={
           //196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207, 208, 209, 210, 211, 212, 213, 214, 215,   ISO
             142, 143, 146, 128, 000, 144, 000, 000, 000, 000, 000, 000, 000, 165, 000, 000, 000, 000, 153, 000, //ASCII
@@ -327,20 +582,25 @@ bool Audio::connecttoFS(fs::FS &fs, String file){
           //236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255    ISO
             000, 161, 140, 139, 000, 164, 000, 162, 147, 000, 148, 000, 000, 000, 163, 150, 129, 000, 000, 152};//ASCII
 
+    uint16_t i=0, s=0;
+    while(file[i] != 0){                                    //convert UTF8 to ASCII
+        dst[i]=file[i];
+        if(dst[i] > 195){
+            s=ascii[dst[i]-196];
+            if(s!=0) dst[i]=s;                              // found a related ASCII sign
+        } i++;
+    }
+    dst[i]=0;
+}
+//-----------------------------------------------------------------------------------------------------------------------------------
+bool Audio::connecttoFS(fs::FS &fs, String file){
+
     reset(); // free buffers an ser defaults
 
-    uint16_t i=0, s=0;
     m_f_localfile = true;
 
     if(!file.startsWith("/")) file="/"+file;
-    while(file[i] != 0){                                    //convert UTF8 to ASCII
-        path[i]=file[i];
-        if(path[i] > 195){
-            s=ascii[path[i]-196];
-            if(s!=0) path[i]=s;                             // found a related ASCII sign
-        } i++;
-    }
-    path[i]=0;
+    utf8toASCII(path, file);
     m_audioName=file.substring(file.lastIndexOf('/') + 1, file.length());
     sprintf(chbuf, "Reading file: %s", m_audioName.c_str());
     if(audio_info) audio_info(chbuf);
@@ -349,15 +609,48 @@ bool Audio::connecttoFS(fs::FS &fs, String file){
         if(audio_info) audio_info("Failed to open file for reading");
         return false;
     }
+    bool ret = openLocalFile(fs);
+    if(m_f_preScan && m_codec == CODEC_MP3 && !m_vbrFrames){ // not for connecttoFSNext(), the DMA plays meanwhile
+        while(m_scanfile && !m_f_scanComplete) scanMP3Frames(); // closes m_scanfile when done or on free format
+    }
+    return ret;
+}
+//-----------------------------------------------------------------------------------------------------------------------------------
+bool Audio::connecttoFSNext(fs::FS &fs, String file){
+    if(!m_f_localfile || !m_f_running) return false;        // nothing to follow, use connecttoFS()
+    if(m_nextfile) m_nextfile.close();
+    m_f_nextFile = false;
+
+    if(!file.startsWith("/")) file="/"+file;
+    utf8toASCII(m_nextPath, file);
+    m_nextName=file.substring(file.lastIndexOf('/') + 1, file.length());
+    m_nextfile=fs.open(m_nextPath);                         // the directory lookup is done now, not at the change
+    if(!m_nextfile){
+        if(audio_info) audio_info("Failed to open next file for reading");
+        return false;
+    }
+    m_nextFS = &fs;
+    m_f_nextFile = true;
+    sprintf(chbuf, "Next file: %s", m_nextName.c_str());
+    if(audio_info) audio_info(chbuf);
+    if(m_xfState == XF_OFF) xfadeStart();                   // hold back the end of this file from now on
+    return true;
+}
+//-----------------------------------------------------------------------------------------------------------------------------------
+bool Audio::openLocalFile(fs::FS &fs){
+    // audiofile is open, read the headers and prepare the decoder
     String afn = (String)audiofile.name();  //audioFileName
     if(afn.endsWith(".mp3") || afn.endsWith(".MP3")) { // MP3 section
         m_codec = CODEC_MP3;
         MP3Decoder_AllocateBuffers();
         sprintf(chbuf, "MP3Decoder has been initialized, free Heap: %u bytes", ESP.getFreeHeap());
         if(audio_info) audio_info(chbuf);
+        MemReport(audio_info, false);
         audiofile.readBytes(chbuf, 10);
         if ((chbuf[0] != 'I') || (chbuf[1] != 'D') || (chbuf[2] != '3')) {
             if(audio_info) audio_info("file has no mp3 tag, skip metadata");
+            m_audioDataStart = 0;
+            initMP3Scan(fs);
             setFilePos(0);
             m_f_running=true;
             return false;
@@ -386,6 +679,8 @@ bool Audio::connecttoFS(fs::FS &fs, String file){
         sprintf(chbuf,"ID3 framesSize=%i", m_id3Size);
         if(audio_info) audio_info(chbuf);
         readID3Metadata();
+        m_audioDataStart = m_id3Size + 10;
+        initMP3Scan(fs);
         m_f_running=true;
         return true;
     } // end MP3 section
@@ -440,11 +735,6 @@ bool Audio::connecttoFS(fs::FS &fs, String file){
             sprintf(chbuf, "DataRate=%u", dr);        audio_info(chbuf);
             sprintf(chbuf, "DataBlockSize=%u", dbs); audio_info(chbuf);
             sprintf(chbuf, "BitsPerSample=%u", bps); audio_info(chbuf);
-            if (sr != 0 && sr != m_sampleRate) {
-                  tas5753md_mute();
-                  biquad_loadCoeffs_LR((double)sr);
-                  tas5753md_unmute();
-                  }            
         }
 
         if(fc != 1){
@@ -457,15 +747,23 @@ bool Audio::connecttoFS(fs::FS &fs, String file){
             return false;
         }
 
+#ifdef I2S_32BIT
+        if(bps != 8 && bps != 16 && bps != 24 && bps != 32){
+            if(audio_info) audio_info("bits per sample must be 8, 16, 24 or 32");
+            return false;
+        }
+#else
         if(bps != 8 && bps !=16){
             if(audio_info) audio_info("bits per sample must be 8 or 16");
             return false;
         }
+#endif
         setBitsPerSample(bps);
         setChannels(nic);
         setSampleRate(sr);
         m_bitRate = nic * sr * bps;
-        if(audio_info) sprintf(chbuf, "BitRate=%u", m_bitRate); audio_info(chbuf);
+        sprintf(chbuf, "BitRate=%u", m_bitRate);
+        if(audio_info) audio_info(chbuf);
 
         audiofile.readBytes(chbuf, bts); // skip to data
         uint32_t s = getFilePos();
@@ -484,7 +782,68 @@ bool Audio::connecttoFS(fs::FS &fs, String file){
         m_f_running=true;
         return true;
     } // end WAVE section
-    if(audio_info) audio_info("Neither wave nor mp3 format found");
+
+    if(afn.endsWith(".flac") || afn.endsWith(".FLAC")) { // FLAC section
+        m_codec = CODEC_FLAC;
+        if(!FLACDecoder_AllocateBuffers()) return false;
+        sprintf(chbuf, "FLACDecoder has been initialized, free Heap: %u bytes", ESP.getFreeHeap());
+        if(audio_info) audio_info(chbuf);
+        MemReport(audio_info, false);
+        audiofile.readBytes(chbuf, 4);
+        if ((chbuf[0] != 'f') || (chbuf[1] != 'L') || (chbuf[2] != 'a') || (chbuf[3] != 'C')){
+            if(audio_info) audio_info("file has no fLaC tag");
+            return false;
+        }
+        bool lastBlock = false, streamInfo = false;
+        while(!lastBlock){ // metadata blocks, STREAMINFO is the first one
+            if(audiofile.readBytes(chbuf, 4) != 4) return false;
+            lastBlock = chbuf[0] & 0x80;
+            uint8_t  bt = chbuf[0] & 0x7f; // block type
+            uint32_t bl = ((uint8_t)chbuf[1] << 16) + ((uint8_t)chbuf[2] << 8) + (uint8_t)chbuf[3];
+            uint32_t next = getFilePos() + bl;
+            if(bt == 0 && bl >= 34){ // STREAMINFO
+                audiofile.readBytes(chbuf, 34);
+                int ret = FLACParseStreamInfo((uint8_t*)chbuf, 34);
+                if(ret){
+                    printDecodeError(ret);
+                    return false;
+                }
+                streamInfo = true;
+            }
+            if(bt == 4 && audio_id3data){ // VORBIS_COMMENT, "TITLE=..." etc., little endian lengths
+                audiofile.readBytes(chbuf, 4); // vendor string
+                setFilePos(getFilePos() + (uint8_t)chbuf[0] + ((uint8_t)chbuf[1] << 8) + ((uint8_t)chbuf[2] << 16) + ((uint8_t)chbuf[3] << 24));
+                audiofile.readBytes(chbuf, 4);
+                uint32_t n = (uint8_t)chbuf[0] + ((uint8_t)chbuf[1] << 8) + ((uint8_t)chbuf[2] << 16) + ((uint8_t)chbuf[3] << 24);
+                while(n-- && getFilePos() + 4 <= next){
+                    audiofile.readBytes(chbuf, 4);
+                    uint32_t len = (uint8_t)chbuf[0] + ((uint8_t)chbuf[1] << 8) + ((uint8_t)chbuf[2] << 16) + ((uint8_t)chbuf[3] << 24);
+                    uint32_t pos = getFilePos() + len;
+                    if(pos > next) break;
+                    if(len > sizeof(chbuf) - 1) len = sizeof(chbuf) - 1;
+                    audiofile.readBytes(chbuf, len); chbuf[len] = 0;
+                    audio_id3data(chbuf);
+                    setFilePos(pos);
+                }
+            }
+            setFilePos(next); // skip SEEKTABLE, PICTURE, PADDING ...
+        }
+        if(!streamInfo){
+            printDecodeError(ERR_FLAC_NO_STREAMINFO);
+            return false;
+        }
+        m_audioDataStart = getFilePos();
+        sprintf(chbuf, "SampleRate=%u, Channels=%u, BitsPerSample=%u", FLACGetSampRate(), FLACGetChannels(), FLACGetBitsPerSample());
+        if(audio_info) audio_info(chbuf);
+        if(FLACGetTotalSamples()){
+            m_audioFileDuration = FLACGetTotalSamples() / FLACGetSampRate();
+            sprintf(chbuf, "Duration=%u s", m_audioFileDuration);
+            if(audio_info) audio_info(chbuf);
+        }
+        m_f_running=true;
+        return true;
+    } // end FLAC section
+    if(audio_info) audio_info("Neither wave, mp3 nor flac format found");
     return false;
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -600,6 +959,7 @@ bool Audio::connecttospeech(String speech, String lang){
     MP3Decoder_AllocateBuffers();
     sprintf(chbuf, "MP3Decoder has been initialized, free Heap: %u bytes", ESP.getFreeHeap());
     if(audio_info) audio_info(chbuf);
+    MemReport(audio_info, false);
 
     while(!playI2Sremains()){;}
     while(clientsecure.available()==0){;}
@@ -805,6 +1165,14 @@ void Audio::readID3Metadata(){
             chbuf[0]=0; j=0; k=0;
             while(j<i){if(value[j]>0x19){value[k]=value[j]; k++;}else{i--;} j++;} //remove non printables
             value[i]=0; // new termination
+            if((tag=="COMM" || tag=="COM") && strstr(value, "iTunSMPB")){ // iTunes gapless info: 0, delay, padding, length (hex)
+                char *p = strstr(value, "iTunSMPB") + 8;
+                strtoul(p, &p, 16);
+                m_encDelay   = strtoul(p, &p, 16);
+                m_encPadding = strtoul(p, &p, 16);
+                m_encSamples = strtoull(p, &p, 16);
+                m_f_encDelay = true;
+            }
             // Revision 2
             if(tag=="CNT") sprintf(chbuf, "Play counter: %s", value);
             if(tag=="COM") sprintf(chbuf, "Comments: %s", value);
@@ -905,8 +1273,13 @@ void Audio::stopSong(){
         m_f_running = false;
         audiofile.close();
     }
+    if(m_scanfile) m_scanfile.close();
     memset(m_outBuff, 0, sizeof(m_outBuff));     //Clear OutputBuffer
     i2s_zero_dma_buffer((i2s_port_t)m_i2s_num);
+    m_xfState = XF_OFF;
+    m_xfFill = 0;
+    m_srcN = m_srcIdx = 0;
+    SRCClearHistory();
 }
 //---------------------------------------------------------------------------------------------------------------------
 bool Audio::playI2Sremains(){ // returns true if all dma_buffs flushed
@@ -999,7 +1372,32 @@ bool Audio::playChunk(){
         m_curSample=0;
         return true;
     }
-    log_e("BitsPer Sample must be 8 or 16!");
+#ifdef I2S_32BIT
+    if(getBitsPerSample()==24 || getBitsPerSample()==32){
+        int32_t sample[2];
+        if(m_channels==1){
+            while (m_validSamples) {
+                sample[LEFTCHANNEL]  = m_outBuff32[m_curSample];
+                sample[RIGHTCHANNEL] = m_outBuff32[m_curSample];
+                if (!playSample32(sample)) {return false;} // Can't send
+                m_validSamples--;
+                m_curSample++;
+            }
+        }
+        if(m_channels==2){
+            while (m_validSamples) {
+                sample[LEFTCHANNEL]  = m_outBuff32[m_curSample * 2];
+                sample[RIGHTCHANNEL] = m_outBuff32[m_curSample * 2 + 1];
+                if (!playSample32(sample)) {return false;} // Can't send
+                m_validSamples--;
+                m_curSample++;
+            }
+        }
+        m_curSample=0;
+        return true;
+    }
+#endif
+    log_e("BitsPer Sample must be 8, 16, 24 or 32!");
     return false;
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -1013,7 +1411,8 @@ void Audio::loop()
     // - webstream - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     if(m_f_webstream)
     {                                      // Playing file from URL?
-        processWebStream();
+        if(m_netState == NET_UP) processWebStream();
+        else processConnection();
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -1030,6 +1429,12 @@ void Audio::processLocalFile()
         bytesAddedToBuffer = audiofile.read(InBuff.writePtr(), bytesCanBeWritten);
 
         if(bytesAddedToBuffer > 0) InBuff.bytesWritten(bytesAddedToBuffer);
+        if(!m_f_preroll && (getFilePos() >= getFileSize() ||    // the rest of the file is in InBuff
+           (m_xfMs && getAudioFileDuration() &&                  // or the crossfade needs the next file early
+            getAudioCurrentTime() + 2 * m_xfMs / 1000 + 2 >= getAudioFileDuration()))){
+            m_f_preroll = true;
+            if(audio_preroll) audio_preroll(m_audioName.c_str());
+        }
         bytesCanBeRead = InBuff.bufferFilled();
         if(bytesCanBeRead > 1600) bytesCanBeRead = 1600;
         if(bytesCanBeRead == 1600){ // mp3 or aac frame complete?
@@ -1040,10 +1445,16 @@ void Audio::processLocalFile()
             }
             bytesDecoded = sendBytes(InBuff.readPtr(), bytesCanBeRead);
             if(bytesDecoded > 0) InBuff.bytesWasRead(bytesDecoded);
+            if(m_scanfile) scanMP3Frames(); // build the seek index while playing
             lastChunk = false;
             return;
         }
         if(!bytesAddedToBuffer){  // eof
+            if(m_codec == CODEC_FLAC && m_f_playing && (bytesCanBeRead || FLACGetBufferedBytes() || FLACGetPendingSamps())){
+                bytesDecoded = sendBytes(InBuff.readPtr(), bytesCanBeRead); // 0 bytes flush the last buffered frame
+                if(bytesDecoded > 0) InBuff.bytesWasRead(bytesDecoded);
+                return;
+            }
             if(lastChunk == false){
                 if(bytesCanBeRead){
                     bytesDecoded = sendBytes(InBuff.readPtr(), bytesCanBeRead); // play last chunk(s)
@@ -1057,11 +1468,21 @@ void Audio::processLocalFile()
                 lastChunk = true;
                 return; // release the thread, continue on the next pass
             }
+            if(m_f_nextFile && nextLocalFile()){ // gapless, the DMA still plays the end of this file
+                lastChunk = false;
+                return;
+            }
+            if(m_xfFill) xfadeFlush(m_xfState == XF_MIX); // the held back end of this file
             if(!playI2Sremains()) return;
             stopSong();
             m_f_stream=false;
             m_f_localfile=false;
+            if(m_codec == CODEC_MP3 && m_audioCurrentTime >= 1){
+                sprintf(chbuf, "MP3 main data copied: %u bytes/s", (uint32_t)(MP3GetMainDataBytesCopied() / m_audioCurrentTime));
+                if(audio_info) audio_info(chbuf);
+            }
             MP3Decoder_FreeBuffers();
+            FLACDecoder_FreeBuffers();
             sprintf(chbuf,"End of file %s", m_audioName.c_str());
             if(audio_info) audio_info(chbuf);
             if(audio_eof_mp3) audio_eof_mp3(m_audioName.c_str());
@@ -1069,20 +1490,94 @@ void Audio::processLocalFile()
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
+bool Audio::nextLocalFile(){
+    // change to the queued file without reset(): I2S is neither flushed nor restarted, the decoder buffers stay
+    // allocated if the codec is the same. Returns false if the next file can't be played, audiofile is not changed then
+    File   lastFile = audiofile;
+    String lastName = m_audioName;
+
+    if(m_xfState == XF_MIX) xfadeFlush(true);              // the file before is still fading, shorter than the crossfade
+    m_f_nextFile = false;
+    audiofile = m_nextfile;
+    m_nextfile = File();
+    strcpy(path, m_nextPath);
+    m_audioName = m_nextName;
+    sprintf(chbuf, "Reading file: %s", m_audioName.c_str());
+    if(audio_info) audio_info(chbuf);
+
+    m_f_running = false;                                    // set by openLocalFile() if the file is playable
+    m_f_preroll = false;
+    m_f_encDelay = false;
+    m_encDelay = 0;
+    m_encPadding = 0;
+    m_encSamples = 0;
+    m_trimStart = 0;
+    m_trimEnd = 0;
+    m_id3Size = 0;
+    m_audioCurrentTime = 0;
+    m_samplesDecoded = 0;
+    m_audioFileDuration = 0;
+    m_avr_bitrate = 0;
+    m_bitRate = 0;
+    m_bytesNotDecoded = 0;
+    openLocalFile(*m_nextFS);
+    if(!m_f_running){
+        audiofile.close();
+        audiofile = lastFile;                               // end as if no file was queued
+        m_audioName = lastName;
+        m_f_running = true;
+        return false;
+    }
+    lastFile.close();
+    if(m_codec != CODEC_MP3)  MP3Decoder_FreeBuffers();
+    if(m_codec != CODEC_FLAC) FLACDecoder_FreeBuffers();
+    InBuff.resetBuffer();                                   // the remains of the last file are no frame
+    m_f_playing = false;                                    // sendBytes() looks for the first frame
+    if(m_xfState == XF_FILL){                               // the held back end of the last file fades out
+        if(m_xfFill){
+            m_xfState = XF_MIX;
+            m_xfLen = m_xfFill;
+            m_xfPhase = 0;
+            m_xfStep = (256u << 16) / m_xfLen;
+        }
+        else m_xfState = XF_OFF;
+    }
+    sprintf(chbuf,"End of file %s", lastName.c_str());
+    if(audio_info) audio_info(chbuf);
+    if(audio_eof_mp3) audio_eof_mp3(lastName.c_str());
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::playWebBuffer() {
+    // decodes one frame of the input buffer of a web stream, an empty buffer is an underrun
+    int bytesdecoded;
+    if((InBuff.bufferFilled() >1600) && (m_f_stream == true)){ // fill > framesize?
+        bytesdecoded = sendBytes(InBuff.readPtr(), InBuff.bufferFilled());
+        if (bytesdecoded < 0) {  // no syncword found or decode error, try next chunk
+            InBuff.bytesWasRead(200); // try next chunk
+            m_bytesNotDecoded += 200;
+        }
+        else {
+            InBuff.bytesWasRead(bytesdecoded);
+        }
+    }
+    else{ // InBuff almost empty, contains no complete mp3/aac frame
+        if(m_f_stream == true && !(m_f_webfile && m_bytectr >= m_contentlength - 10)){
+            m_f_stream = false;                    // underrun, rebuffer up to the raised watermark
+            m_jitter.underrun(millis());
+            m_jbTarget = m_jitter.target(m_bitRate / 8, (InBuff.bufferFilled() + InBuff.freeSpace()) * 3 / 4);
+            sprintf(chbuf, "slow stream, underrun %u, rebuffering to %u bytes", m_jitter.underruns(), m_jbTarget);
+            if (audio_info) audio_info(chbuf);
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
 void Audio::processWebStream() {
     if (m_f_running && m_f_webstream) {
         uint32_t bytesCanBeWritten = 0;
         int16_t bytesAddedToBuffer = 0;
-        static uint32_t chunksize = 0;      // Chunkcount read from stream
         int32_t availableBytes = 0;         // Available bytes in stream
-        static int bytesdecoded = 0;
         static uint32_t cnt0 = 0;
-        static uint32_t tmr_1s = 0;   // timer 1 sec
-        bool f_tmr_1s = false;
-        if((tmr_1s + 1000) < millis()){
-            f_tmr_1s = true;                // flag will be set every second for one loop only
-            tmr_1s = millis();
-        }
 
         if (m_f_ssl == false)
             availableBytes = client.available();         // Available from stream
@@ -1097,36 +1592,48 @@ void Audio::processWebStream() {
         if (((m_datamode == AUDIO_DATA) || (m_datamode == AUDIO_SWM)) && (m_metaCount > 0)) {
             bytesCanBeWritten = InBuff.writeSpace();
             uint32_t x = min(m_metaCount, uint32_t(bytesCanBeWritten));
-            if ((m_f_chunked) && (x > m_chunkcount)) {
-                x = m_chunkcount;
-            }
 
-            if (m_f_ssl == false) {
-                bytesAddedToBuffer = client.read(InBuff.writePtr(), x);
+            if (m_webPos < m_webLen) {
+                // left over from the header or the metadata
+                bytesAddedToBuffer = webRead(InBuff.writePtr(), x);
             }
+            else {
+                if (m_f_ssl == false) {
+                    bytesAddedToBuffer = client.read(InBuff.writePtr(), x);
+                }
 
-            if (m_f_ssl == true) {
-                bytesAddedToBuffer = clientsecure.read(InBuff.writePtr(), x);
+                if (m_f_ssl == true) {
+                    bytesAddedToBuffer = clientsecure.read(InBuff.writePtr(), x);
+                }
+                if (m_f_chunked && bytesAddedToBuffer > 0) {
+                    bytesAddedToBuffer = dechunk(InBuff.writePtr(), bytesAddedToBuffer);  // payload <= x
+                }
             }
             if (bytesAddedToBuffer > 0) {
                 if (m_f_webfile) {
                     m_bytectr += bytesAddedToBuffer;  // Pull request #42
                 }
                 m_metaCount -= bytesAddedToBuffer;
-                if (m_f_chunked) {
-                    m_chunkcount -= bytesAddedToBuffer;
+                if (RecActive()) {
+                    RecWrite(InBuff.writePtr(), bytesAddedToBuffer);  // tee to SD, metadata is not in InBuff
                 }
                 InBuff.bytesWritten(bytesAddedToBuffer);
+                m_jitter.arrival(bytesAddedToBuffer, millis());
+            }
+            else if (x == 0) {
+                m_jitter.arrival(0, millis());         // input buffer full, not waiting for the stream
             }
 
-            // waiting for buffer filled, set tresholds before the stream is starting
-            if ((InBuff.bufferFilled() > 6000 && !m_f_psram) || (InBuff.bufferFilled() > 80000 && m_f_psram)){
+            // start and resume watermark from the arrival jitter and the bitrate, at most 3/4 of the buffer
+            m_jbTarget = m_jitter.target(m_bitRate / 8, (InBuff.bufferFilled() + InBuff.freeSpace()) * 3 / 4);
+            if (InBuff.bufferFilled() >= m_jbTarget){
                 if (m_f_stream == false) {
                     m_f_stream = true;
                     cnt0=0;
                     uint16_t filltime = millis()-m_t0;
+                    m_jitter.started(millis());
                     if (audio_info) audio_info("stream ready");
-                    sprintf(chbuf,"buffer filled in %d ms", filltime);
+                    sprintf(chbuf,"buffer filled in %d ms, watermark %u bytes", filltime, m_jbTarget);
                     if (audio_info) audio_info(chbuf);
                 }
             }
@@ -1140,66 +1647,29 @@ void Audio::processWebStream() {
                 }
             }
 
-            if((InBuff.bufferFilled() >1600) && (m_f_stream == true)){ // fill > framesize?
-                bytesdecoded = sendBytes(InBuff.readPtr(), InBuff.bufferFilled());
-                if (bytesdecoded < 0) {  // no syncword found or decode error, try next chunk
-                    InBuff.bytesWasRead(200); // try next chunk
-                    m_bytesNotDecoded += 200;
-                    return;
-                }
-                else {
-                    InBuff.bytesWasRead(bytesdecoded);
-                }
-            }
-            else{ // InBuff almost empty, contains no complete mp3/aac frame
-                if(m_f_stream == true){
-                    static boolean f_once = true;
-                    if(f_once){
-                        if (audio_info) audio_info("slow stream, dropouts are possible");
-                        f_once = false;
-                    }
-                    if(f_tmr_1s){
-                        f_once = true;
-                    }
-                }
-            }
+            playWebBuffer();
 
             if (m_metaCount == 0) {
                 if (m_datamode == AUDIO_SWM) {
                     m_metaCount = 16000; //mms has no metadata
                 } else {
                     m_datamode = AUDIO_METADATA;
-                    m_f_firstmetabyte = true;
                 }
             }
         }
         else{ //!=DATA
+            if (m_f_stream) playWebBuffer();           // a reconnect, the audio of the lost connection plays on
             if (m_datamode == AUDIO_PLAYLISTDATA) {
                 if (m_t0 + 49 < millis()) {
-                    handlebyte('\n');                       // send LF
+                    parseText((const uint8_t*)"\n", 1);    // send LF, the last line may have none
                 }
             }
-            int16_t x = 0;
-            if (m_f_chunked && (m_datamode != AUDIO_HEADER)) {
-                if (m_chunkcount > 0) {
-                    if (m_f_ssl == false)
-                        x = client.read();
-                    else
-                        x = clientsecure.read();
-
-                    if (x >= 0) {
-                        handlebyte(x);
-                        m_chunkcount--;
-                    }
-                }
-            } else {
-                if (m_f_ssl == false)
-                    x = client.read();
-                else
-                    x = clientsecure.read();
-                if (x >= 0) {
-                    handlebyte(x);
-                }
+            // header, metadata and playlist lines are parsed from the whole read window, the bytes behind
+            // the end of the header stay in m_webBuf for the data path
+            uint32_t n;
+            while (m_f_running && m_netState == NET_UP && m_datamode != AUDIO_DATA && m_datamode != AUDIO_SWM &&
+                   (n = webAvailable()) > 0) {
+                webConsume(parseText(m_webBuf + m_webPos, n));
             }
             if (m_datamode == AUDIO_DATA) {
                 m_metaCount = m_metaint;
@@ -1212,415 +1682,392 @@ void Audio::processWebStream() {
             }
         }
 
-        if (m_f_firststream_ready == true) {
-            static uint32_t loopCnt = 0;      // Count loops if clientbuffer is empty
-            if (availableBytes == 0) {   // empty buffer, broken stream or bad bitrate?
-                loopCnt++;
-                if (loopCnt > 200000) {  // wait several seconds
-                    loopCnt = 0;
-                    if (audio_info)
-                        audio_info("Stream lost -> try new connection");
-                    connecttohost(m_lastHost); // try a new connection
-                }
-                if (m_f_webfile) // stream from fileserver with known content-length
-                {
-                    if ((uint32_t) m_bytectr >= (uint32_t) m_contentlength - 10) {
-                        sprintf(chbuf, "End of webstream: %s", m_lastHost.c_str());
-                        if (audio_info)
-                            audio_info(chbuf);
-                        if (audio_eof_stream)
-                            audio_eof_stream(m_lastHost.c_str());
-                        m_f_running = false;
-                    }
-                }
-            } else {
-                loopCnt = 0;
-            }
+        if (m_netState != NET_UP) {
+            return;                            // redirect or playlist entry, connecttohost() has started anew
         }
-
-        if (m_f_chunked) {
-            if (m_datamode == AUDIO_HEADER)
-                return;
-
-            if (m_chunkcount == 0) {             // Expecting a new chunkcount?
-                int b;
-                if (m_f_ssl == false) {
-                    b = client.read();
-                }
-                if (m_f_ssl == true) {
-                    b = clientsecure.read();
-                }
-                if (b < 1)
-                    return;
-
-                if (b == '\r') {
-                } else if (b == '\n') {
-                    m_chunkcount = chunksize;
-                    chunksize = 0;
-                } else {
-                    // We have received a hexadecimal character.  Decode it and add to the result.
-                    b = toupper(b) - '0';                         // Be sure we have uppercase
-
-                    if (b > 9)
-                        b = b - 7;                        // Translate A..F to 10..15
-
-                    chunksize = (chunksize << 4) + b;
-                }
+        if (availableBytes > 0) {
+            m_netLastData = millis();
+        }
+        else if (m_f_firststream_ready == true && m_f_webfile &&     // stream from fileserver with known content-length
+                 (uint32_t) m_bytectr >= (uint32_t) m_contentlength - 10) {
+            sprintf(chbuf, "End of webstream: %s", m_lastHost.c_str());
+            if (audio_info)
+                audio_info(chbuf);
+            if (audio_eof_stream)
+                audio_eof_stream(m_lastHost.c_str());
+            m_f_running = false;
+        }
+        else if (millis() - m_netLastData > NET_STALL) {          // broken stream, the time covers DNS, connect and header
+            if (audio_info)
+                audio_info("Stream lost -> try new connection");
+            if (m_f_webfile) connecttohost(m_lastHost);             // a file starts again
+            else netReconnect("no data");
+        }
+        else if ((m_datamode == AUDIO_HEADER || m_datamode == AUDIO_DATA || m_datamode == AUDIO_SWM ||
+                  m_datamode == AUDIO_METADATA) &&
+                 m_webPos >= m_webLen && !(m_f_ssl ? clientsecure.connected() : client.connected())) {
+            if (m_f_webfile) {
+                if (audio_info) audio_info("Stream lost -> try new connection");
+                connecttohost(m_lastHost);
             }
+            else netReconnect("connection closed by the server");
         }
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
-void Audio::handlebyte(uint8_t b){
-    static uint16_t playlistcnt;                                // Counter to find right entry in playlist
-    String lcml;                                                // Lower case metaline
-    static String ct;                                           // Contents type
-    static String host;
-    int inx;                                                    // Pointer in metaline
-    static boolean f_entry=false;                               // entryflag for asx playlist
-
-    if(m_datamode == AUDIO_HEADER){                             // Handle next byte of MP3 header
-        if((b>0x7F)||(b=='\r')||(b =='\0')){                    // Ignore unprintable characters, ignore CR, ignore NULL
-           ;                                                    // Yes, ignore
-        }
-        else if(b == '\n'){                                     // Linefeed ?
-            m_LFcount++;                                        // Count linefeeds
-            if(chkhdrline(m_metaline.c_str())){                 // Reasonable input?
-                lcml=m_metaline;                                // Use lower case for compare
-                lcml.toLowerCase();
-                lcml.trim();
-                if(lcml.indexOf("content-type:") >= 0){         // Line with "Content-Type: xxxx/yyy"
-                    if(lcml.indexOf("audio") >= 0){             // Is ct audio?
-                        m_ctseen=true;                          // Yes, remember seeing this
-                        ct=m_metaline.substring(13);            // Set contentstype. Not used yet
-                        ct.trim();
-                        sprintf(chbuf, "%s seen.", ct.c_str());
-                        if(audio_info) audio_info(chbuf);
-                        if(ct.indexOf("mpeg")>=0){
-                            m_codec = CODEC_MP3;
-                            if(audio_info) audio_info("format is mp3"); //ok is likely mp3
-                            MP3Decoder_AllocateBuffers();
-                            sprintf(chbuf, "MP3Decoder has been initialized, free Heap: %u bytes", ESP.getFreeHeap());
-                            if(audio_info) audio_info(chbuf);
-                        }
-                        else if(ct.indexOf("aac")>=0){
-                            m_codec = CODEC_AAC;
-//                            stopSong(); // if no aac decoder available
-                            if(audio_info) audio_info("format is aac");
-                            AACDecoder_AllocateBuffers();
-                            sprintf(chbuf, "AACDecoder has been initialized, free Heap: %u bytes", ESP.getFreeHeap());
-                            if(audio_info) audio_info(chbuf);
-
-                        }
-                        else if(ct.indexOf("mp4")>=0){
-                            m_codec = CODEC_AAC;
-//                            stopSong(); // if no aac decoder available
-                            if(audio_info) audio_info("format is aac");
-                            AACDecoder_AllocateBuffers();
-                            sprintf(chbuf, "AACDecoder has been initialized, free Heap: %u bytes", ESP.getFreeHeap());
-                            if(audio_info) audio_info(chbuf);
-                        }
-                        else if(ct.indexOf("ogg")>=0){
-                            m_f_running=false;
-                            if(audio_info) audio_info("can't play ogg");
-                            stopSong();
-                        }
-                        else{
-                            m_f_running=false;
-                            if(audio_info) audio_info("unknown audio format");
-                        }
-                    }
-                    if(lcml.indexOf("ogg") >= 0){               // Is ct ogg?
-                        m_f_running=false;
-                        m_ctseen=true;                          // Yes, remember seeing this
-                        ct=m_metaline.substring(13);
-                        ct.trim();
-                        sprintf(chbuf, "%s seen.", ct.c_str());
-                        if(audio_info) audio_info(chbuf);
-                        if(audio_info) audio_info("no ogg decoder implemented");
-                        stopSong();
-//                        m_metaint=0;                          // has no metadata
-//                        m_bitrate=0;
-//                        m_icyname=="";
-//                        m_f_swm=true;
-                    }
-                }
-                else if(lcml.startsWith("location:")){
-                    host=m_metaline.substring(lcml.indexOf("http"),lcml.length()); // use metaline instead lcml
-                    //if(host.indexOf("&")>0)host=host.substring(0,host.indexOf("&")); // remove parameter
-                    sprintf(chbuf, "redirect to new host %s", host.c_str());
-                    if(audio_info) audio_info(chbuf);
-                    connecttohost(host);
-                }
-                else if(lcml.startsWith("icy-br:")){
-                    m_bitRate=m_metaline.substring(7).toInt();  // Found bitrate tag, read the bitrate in Kbit
-                    m_bitRate = m_bitRate * 1000;
-                    sprintf(chbuf,"%d", m_bitRate);
-                    if(audio_bitrate) audio_bitrate(chbuf);
-                }
-                else if(lcml.startsWith("icy-metaint:")){
-                    m_metaint=m_metaline.substring(12).toInt(); // Found metaint tag, read the value
-                    if(m_metaint>0) m_f_swm=false;              // Multimediastream
-                }
-                else if(lcml.startsWith("icy-name:")){
-                    m_icyname=m_metaline.substring(9);          // Get station name
-                    m_icyname.trim();                           // Remove leading and trailing spaces
-                    if(m_icyname!=""){
-                        if(audio_showstation) audio_showstation(m_icyname.c_str());
-                    }
-                }
-                else if(lcml.startsWith("content-length:")){
-                    //log_i("%s",lcml.c_str());
-                    m_contentlength= m_metaline.substring(15).toInt();
-                    m_f_webfile=true; // Stream comes from a fileserver
-                    sprintf(chbuf, "Contnent-Length: %i", m_contentlength);
-                    if(audio_info) audio_info(chbuf);
-                }
-                else if(lcml.startsWith("transfer-encoding:")){ // Station provides chunked transfer
-                    if(m_metaline.endsWith("chunked")){
-                        m_f_chunked=true;
-                        if(audio_info) audio_info("chunked data transfer");
-                        m_chunkcount=0;                         // Expect chunkcount in DATA
-                    }
-                }
-                else if(lcml.startsWith("icy-url:")){
-                    m_icyurl=m_metaline.substring(8);           // Get the URL
-                    m_icyurl.trim();
-                    if(audio_icyurl) audio_icyurl(m_icyurl.c_str());
-                }
-                else{                                           // all other
+uint32_t Audio::webAvailable(){
+    // payload bytes at m_webBuf + m_webPos, the window is refilled from the client with one read() when it is
+    // used up, the chunk framing is stripped in place once the header is through
+    if(m_webPos == m_webLen){
+        int n;
+        if(m_f_ssl == false) n = client.read(m_webBuf, sizeof(m_webBuf));
+        else                 n = clientsecure.read(m_webBuf, sizeof(m_webBuf));
+        m_webPos = 0;
+        m_webLen = n > 0 ? n : 0;
+        m_webRaw = 0;
+    }
+    if(m_datamode == AUDIO_HEADER || m_webRaw < m_webPos){
+        m_webRaw = m_webPos;                                    // the header itself is not chunked
+    }
+    if(m_datamode != AUDIO_HEADER && m_f_chunked && m_webRaw < m_webLen){
+        m_webLen = m_webRaw + dechunk(m_webBuf + m_webRaw, m_webLen - m_webRaw);
+        m_webRaw = m_webLen;
+    }
+    return m_webLen - m_webPos;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::webConsume(uint32_t n){
+    if(n > uint32_t(m_webLen - m_webPos)) n = m_webLen - m_webPos;  // reset() by a redirect in the parser
+    m_webPos += n;
+}
+//---------------------------------------------------------------------------------------------------------------------
+int Audio::webRead(uint8_t *buf, uint32_t len){
+    uint32_t n = min(webAvailable(), len);
+    memcpy(buf, m_webBuf + m_webPos, n);
+    webConsume(n);
+    return n;
+}
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t Audio::dechunk(uint8_t *buf, uint32_t len){
+    // chunked transfer: the size lines are removed in place, returns the payload left in buf
+    bool last = m_http.lastChunk;
+    uint32_t n = HTTPDechunk(&m_http, buf, len);
+    if(!last && m_http.lastChunk && audio_info) audio_info("chunked data transfer: last chunk");
+    return n;
+}
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t Audio::parseText(const uint8_t *buf, uint32_t len){
+    // feeds the parser of the current datamode, returns the bytes it has taken, a complete line or metadata
+    // block is handled at once, the datamode may change then and the rest is left for the next state
+    uint32_t n = 0;
 
-                    sprintf(chbuf, "%s", m_metaline.c_str());
-                    if(audio_info) audio_info(chbuf);
-                }
-            }
-            m_metaline="";                                      // Reset this line
-            if((m_LFcount == 2) && m_ctseen){                   // Some data seen and a double LF?
-                if(m_icyname==""){if(audio_showstation) audio_showstation("");} // no icyname available
-                if(m_bitRate==0){if(audio_bitrate) audio_bitrate("");} // no bitrate received
-                if(m_f_swm==true){ // stream without metadata
-                    m_datamode=AUDIO_SWM;                      // Overwrite m_datamode
-                    sprintf(chbuf, "Switch to SWM, bitrate is %d, metaint is %d", m_bitRate, m_metaint); // Show bitrate and metaint
-                    if(audio_info) audio_info(chbuf);
-                    String lasthost=m_lastHost;
-                    uint idx=lasthost.indexOf('?');
-                    if(idx>0) lasthost=lasthost.substring(0, idx);
-                    if(audio_lasthost) audio_lasthost(lasthost.c_str());
-                    m_f_swm=false;
-                }
-                else{
-                    m_datamode=AUDIO_DATA;                      // Expecting data now
-                    sprintf(chbuf, "Switch to DATA, bitrate is %d, metaint is %d", m_bitRate, m_metaint); // Show bitrate and metaint
-                    if(audio_info) audio_info(chbuf);
-                    String lasthost=m_lastHost;
-                    uint idx=lasthost.indexOf('?');
-                    if(idx>0) lasthost=lasthost.substring(0, idx);
-                    if(audio_lasthost) audio_lasthost(lasthost.c_str());
-                }
-                delay(1000);
-            }
+    if(m_datamode == AUDIO_PLAYLISTINIT){                       // Initialize for receive .m3u file
+        // We are going to use metadata to read the lines from the .m3u file
+        // Sometimes this will only contain a single line
+        m_f_asxEntry=false;                                     // no entry found yet (asx playlist)
+        HTTPParserReset(&m_http);                               // Prepare for new line
+        m_datamode=AUDIO_PLAYLISTHEADER;                        // Handle playlist data
+        m_playlistCnt=1;                                        // Reset for compare
+        m_totalcount=0;                                         // Reset totalcount
+        if(audio_info) audio_info("Read from playlist");
+    }
+    switch(m_datamode){
+        case AUDIO_HEADER:
+            n = HTTPParseLine(&m_http, buf, len);
+            if(m_http.complete) parseHeaderLine(m_http.arena);
+            break;
+        case AUDIO_METADATA:
+            n = HTTPParseMeta(&m_http, buf, len);
+            if(m_http.complete) parseMetadata(m_http.arena, m_http.metaLen);
+            break;
+        case AUDIO_PLAYLISTHEADER:
+            n = HTTPParseLine(&m_http, buf, len);
+            if(m_http.complete) parsePlaylistHeader(m_http.arena);
+            break;
+        case AUDIO_PLAYLISTDATA:
+            m_t0=millis();
+            n = HTTPParseLine(&m_http, buf, len);
+            if(m_http.complete) parsePlaylistData(m_http.arena);
+            break;
+        default:
+            n = len;                                            // not expected, skip
+    }
+    return n;
+}
+//---------------------------------------------------------------------------------------------------------------------
+static const char* hdrValue(const char *line, const char *name){
+    // value of "name: value" (name lower case, compared case insensitive), leading blanks skipped, NULL if other
+    size_t n = strlen(name);
+    while(*line == ' ') line++;
+    if(strncasecmp(line, name, n)) return NULL;
+    line += n;
+    while(*line == ' ') line++;
+    return line;
+}
+static const char* findText(const char *s, const char *t){
+    // case insensitive strstr, t lower case
+    size_t n = strlen(t);
+    for(; *s; s++) if(tolower((uint8_t)*s) == t[0] && !strncasecmp(s, t, n)) return s;
+    return NULL;
+}
+static void trimRight(char *s){
+    size_t n = strlen(s);
+    while(n && s[n - 1] == ' ') s[--n] = 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::parseHeaderLine(char *line){
+    const char *v;
+
+    if(line[0] == 0){                                           // empty line, end of the header
+        if(!m_ctseen) return;                                   // Some data seen and a double LF?
+        if(m_icyname==""){if(audio_showstation) audio_showstation("");} // no icyname available
+        if(m_bitRate==0){if(audio_bitrate) audio_bitrate("");} // no bitrate received
+        if(m_f_swm==true){ // stream without metadata
+            m_datamode=AUDIO_SWM;                               // Overwrite m_datamode
+            sprintf(chbuf, "Switch to SWM, bitrate is %d, metaint is %d", m_bitRate, m_metaint); // Show bitrate and metaint
+            if(audio_info) audio_info(chbuf);
+            m_f_swm=false;
         }
         else{
-            m_metaline+=(char)b;                                // Normal character, put new char in metaline
-            m_LFcount=0;                                        // Reset double CRLF detection
+            m_datamode=AUDIO_DATA;                              // Expecting data now
+            sprintf(chbuf, "Switch to DATA, bitrate is %d, metaint is %d", m_bitRate, m_metaint); // Show bitrate and metaint
+            if(audio_info) audio_info(chbuf);
         }
+        String lasthost=m_lastHost;
+        uint idx=lasthost.indexOf('?');
+        if(idx>0) lasthost=lasthost.substring(0, idx);
+        if(audio_lasthost) audio_lasthost(lasthost.c_str());
+        if(!m_f_netPlayed && RecActive()) recordSplit(m_icyname.c_str()); // new station, new file
+        m_netTries = 0;                                         // the server answers, backoff starts again at 0.5 s
+        m_f_netPlayed = true;                                   // from now on a lost connection is tried again and again
         return;
-    } // end AUDIO_HEADER
-    if(m_datamode == AUDIO_METADATA){                           // Handle next byte of metadata
-        if(m_f_firstmetabyte){                                  // First byte of metadata?
-            m_f_firstmetabyte=false;                            // Not the first anymore
-            m_metalen=b*16+1;                                 // New count for metadata including length byte
-            if(m_metalen > 1){
-                sprintf(chbuf, "Metacount=%d bytes",            // Most of the time there are zero bytes of metadata
-                        m_metalen-1);
+    }
+    if(!chkhdrline(line)) return;                               // Reasonable input?
+    trimRight(line);
+    if((v = findText(line, "content-type:")) != NULL){          // Line with "Content-Type: xxxx/yyy"
+        v += 13;
+        while(*v == ' ') v++;
+        if(findText(line, "audio")){                            // Is ct audio?
+            m_ctseen=true;                                      // Yes, remember seeing this
+            snprintf(chbuf, sizeof(chbuf), "%s seen.", v);
+            if(audio_info) audio_info(chbuf);
+            if(findText(v, "mpeg")){
+                if(m_f_netPlayed && m_codec == CODEC_MP3) return;   // reconnect, the decoder plays on
+                m_codec = CODEC_MP3;
+                if(audio_info) audio_info("format is mp3"); //ok is likely mp3
+                MP3Decoder_AllocateBuffers();
+                sprintf(chbuf, "MP3Decoder has been initialized, free Heap: %u bytes", ESP.getFreeHeap());
                 if(audio_info) audio_info(chbuf);
+                MemReport(audio_info, false);
             }
-            m_metaline="";                                      // Set to empty
-        }
-        else{
-            m_metaline+=(char)b;                                // Normal character, put new char in metaline
-        }
-        if(--m_metalen == 0){
-            if(m_metaline.length() > 1500){                     // Unlikely metaline length?
-                if(audio_info) audio_info("Metadata block to long! Skipping all Metadata from now on.");
-                m_metaint=16000;                                // Probably no metadata
-                m_metaline="";                                  // Do not waste memory on this
-                m_datamode=AUDIO_SWM;                           // expect stream without metadata
+            else if(findText(v, "aac") || findText(v, "mp4")){
+                if(m_f_netPlayed && m_codec == CODEC_AAC) return;
+                m_codec = CODEC_AAC;
+                if(audio_info) audio_info("format is aac");
+                AACDecoder_AllocateBuffers();
+                sprintf(chbuf, "AACDecoder has been initialized, free Heap: %u bytes", ESP.getFreeHeap());
+                if(audio_info) audio_info(chbuf);
+                MemReport(audio_info, false);
+            }
+            else if(findText(v, "ogg")){
+                m_f_running=false;
+                if(audio_info) audio_info("can't play ogg");
+                stopSong();
             }
             else{
-                m_datamode=AUDIO_DATA;                          // Expecting data
-            }
-            if(m_metaline.length()){                            // Any info present?
-                // metaline contains artist and song name.  For example:
-                // "StreamTitle='Don McLean - American Pie';StreamUrl='';"
-                // Sometimes it is just other info like:
-                // "StreamTitle='60s 03 05 Magic60s';StreamUrl='';"
-                // Isolate the StreamTitle, remove leading and trailing quotes if present.
-                //log_i("ST %s", m_metaline.c_str());
-
-                int pos = m_metaline.indexOf("song_spot"); // remove some irrelevant infos
-                if(pos>3){                                 // e.g. https://stream.revma.ihrhls.com/zc4422
-                    m_metaline=m_metaline.substring(0, pos);
-                    pos = m_metaline.indexOf("text=");
-                    if(pos>3) m_metaline.remove(pos, 5);
-                }
-
-                if( !m_f_localfile) showstreamtitle(m_metaline.c_str(), true);  // Show artist and title if present in metadata
+                m_f_running=false;
+                if(audio_info) audio_info("unknown audio format");
             }
         }
+        else if(findText(v, "ogg")){                            // Is ct ogg?
+            m_f_running=false;
+            m_ctseen=true;                                      // Yes, remember seeing this
+            snprintf(chbuf, sizeof(chbuf), "%s seen.", v);
+            if(audio_info) audio_info(chbuf);
+            if(audio_info) audio_info("no ogg decoder implemented");
+            stopSong();
+        }
     }
-    if(m_datamode == AUDIO_PLAYLISTINIT)                       // Initialize for receive .m3u file
-    {
-        // We are going to use metadata to read the lines from the .m3u file
-        // Sometimes this will only contain a single line
-        f_entry=false;                                          // no entry found yet (asx playlist)
-        m_metaline="";                                          // Prepare for new line
-        m_LFcount=0;                                            // For detection end of header
-        m_datamode=AUDIO_PLAYLISTHEADER;                        // Handle playlist data
-        playlistcnt=1;                                          // Reset for compare
-        m_totalcount=0;                                         // Reset totalcount
-        if(audio_info) audio_info("Read from playlist");
+    else if((v = hdrValue(line, "location:")) != NULL){
+        const char *url = findText(v, "http");
+        snprintf(chbuf, sizeof(chbuf), "redirect to new host %s", url ? url : v);
+        if(audio_info) audio_info(chbuf);
+        connecttohost(String(url ? url : v));                   // reset(), line is gone
     }
-    if(m_datamode == AUDIO_PLAYLISTHEADER){                     // Read header
-        if((b>0x7F)||(b=='\r')||(b == '\0')){                   // Ignore unprintable characters, ignore CR, ignore NULL                                                  // Ignore CR
-            ;                                                   // Yes, ignore
-        }
-        else if(b == '\n'){                                     // Linefeed ?
-            m_LFcount++;                                        // Count linefeeds
-            sprintf(chbuf, "Playlistheader: %s", m_metaline.c_str());  // Show playlistheader
-            if(audio_info) audio_info(chbuf);
-            lcml=m_metaline;                                    // Use lower case for compare
-            lcml.toLowerCase();
-            lcml.trim();
-            if(lcml.startsWith("location:")){
-                host=m_metaline.substring(lcml.indexOf("http"),lcml.length()); // use metaline instead lcml
-                if(host.indexOf("&")>0)host=host.substring(0,host.indexOf("&")); // remove parameter
-                sprintf(chbuf, "redirect to new host %s", host.c_str());
-                if(audio_info) audio_info(chbuf);
-                connecttohost(host);
-            }
-            m_metaline="";                                      // Ready for next line
-            if(m_LFcount == 2)
-                    {
-                if(audio_info) audio_info("Switch to PLAYLISTDATA");
-                m_datamode=AUDIO_PLAYLISTDATA;                 // Expecting data now
-                m_t0=millis();
-                return;
-            }
+    else if((v = hdrValue(line, "icy-br:")) != NULL){
+        m_bitRate = atoi(v) * 1000;                             // Found bitrate tag, read the bitrate in Kbit
+        sprintf(chbuf,"%d", m_bitRate);
+        if(audio_bitrate) audio_bitrate(chbuf);
+    }
+    else if((v = hdrValue(line, "icy-metaint:")) != NULL){
+        m_metaint = atoi(v);                                    // Found metaint tag, read the value
+        if(m_metaint>0) m_f_swm=false;                          // Multimediastream
+    }
+    else if((v = hdrValue(line, "icy-name:")) != NULL){
+        m_icyname = v;                                          // Get station name
+        if(m_icyname!=""){
+            if(audio_showstation) audio_showstation(m_icyname.c_str());
         }
-        else{
-            m_metaline+=(char)b;                                // Normal character, put new char in metaline
-            m_LFcount=0;                                        // Reset double CRLF detection
+    }
+    else if((v = hdrValue(line, "content-length:")) != NULL){
+        m_contentlength = atoi(v);
+        m_f_webfile=true; // Stream comes from a fileserver
+        sprintf(chbuf, "Contnent-Length: %i", m_contentlength);
+        if(audio_info) audio_info(chbuf);
+    }
+    else if((v = hdrValue(line, "transfer-encoding:")) != NULL){ // Station provides chunked transfer
+        if(findText(v, "chunked")){
+            m_f_chunked=true;
+            if(audio_info) audio_info("chunked data transfer");
         }
     }
-    if(m_datamode == AUDIO_PLAYLISTDATA){                       // Read next byte of .m3u file data
+    else if((v = hdrValue(line, "icy-url:")) != NULL){
+        m_icyurl = v;                                           // Get the URL
+        if(audio_icyurl) audio_icyurl(m_icyurl.c_str());
+    }
+    else{                                                       // all other
+        if(audio_info) audio_info(line);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::parseMetadata(char *meta, uint16_t len){
+    // a complete metadata block, most of the time there are zero bytes of metadata
+    char *pos;
+
+    if(len > 0){
+        sprintf(chbuf, "Metacount=%d bytes", len);
+        if(audio_info) audio_info(chbuf);
+    }
+    if(len > 1500){                                             // Unlikely metaline length?
+        if(audio_info) audio_info("Metadata block to long! Skipping all Metadata from now on.");
+        m_metaint=16000;                                        // Probably no metadata
+        m_datamode=AUDIO_SWM;                                   // expect stream without metadata
+        return;
+    }
+    m_datamode=AUDIO_DATA;                                      // Expecting data
+    if(!meta[0]) return;                                        // Any info present?
+    // meta contains artist and song name.  For example:
+    // "StreamTitle='Don McLean - American Pie';StreamUrl='';"
+    // Sometimes it is just other info like:
+    // "StreamTitle='60s 03 05 Magic60s';StreamUrl='';"
+    pos = strstr(meta, "song_spot");                            // remove some irrelevant infos
+    if(pos && pos - meta > 3){                                  // e.g. https://stream.revma.ihrhls.com/zc4422
+        *pos = 0;
+        pos = strstr(meta, "text=");
+        if(pos && pos - meta > 3) memmove(pos, pos + 5, strlen(pos + 5) + 1);
+    }
+    if(!m_f_localfile) showstreamtitle(meta, true);             // Show artist and title if present in metadata
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::parsePlaylistHeader(char *line){
+    const char *v;
+
+    snprintf(chbuf, sizeof(chbuf), "Playlistheader: %s", line); // Show playlistheader
+    if(audio_info) audio_info(chbuf);
+    if(line[0] == 0){                                           // empty line, end of the header
+        if(audio_info) audio_info("Switch to PLAYLISTDATA");
+        m_datamode=AUDIO_PLAYLISTDATA;                          // Expecting data now
         m_t0=millis();
-        if((b > 0x7F) ||                                        // Ignore unprintable characters
-                (b == '\r') ||                                  // Ignore CR
-                (b == '\0'))                                    // Ignore NULL
-                { /* Yes, ignore */ }
+        return;
+    }
+    if((v = hdrValue(line, "location:")) != NULL){
+        char *url = (char*)findText(v, "http");
+        char *amp;
+        if(!url) url = (char*)v;
+        amp = strchr(url, '&');
+        if(amp && amp > url) *amp = 0;                          // remove parameter
+        snprintf(chbuf, sizeof(chbuf), "redirect to new host %s", url);
+        if(audio_info) audio_info(chbuf);
+        connecttohost(String(url));
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::parsePlaylistData(char *line){
+    // one line of the .m3u, .pls or .asx file, connecttohost() as soon as the entry is known
+    char *p, *q;
 
-        else if(b == '\n'){                                     // Linefeed or end of string?
-            sprintf(chbuf, "Playlistdata: %s", m_metaline.c_str());  // Show playlistdata
+    snprintf(chbuf, sizeof(chbuf), "Playlistdata: %s", line);  // Show playlistdata
+    if(audio_info) audio_info(chbuf);
+    if(m_playlist.endsWith("m3u")){
+        if(strlen(line) < 5) return;                            // Skip short lines
+        if(strstr(line, "#EXTINF:")){                           // Info?
+            if(m_playlist_num == m_playlistCnt){                // Info for this entry?
+                p = strchr(line, ',');                          // Comma in this line?
+                if(p && p > line){
+                    // Show artist and title if present in metadata
+                    if(audio_info) audio_info(p + 1);
+                }
+            }
+        }
+        if(line[0] == '#') return;                              // Ignore commentlines
+        // Now we have an URL for a .mp3 file or stream.  Is it the rigth one?
+        snprintf(chbuf, sizeof(chbuf), "Entry %d in playlist found: %s", m_playlistCnt, line);
+        if(audio_info) audio_info(chbuf);
+        p = strchr(line, '&');
+        if(p && p > line) *p = 0;
+        if(m_playlist_num == m_playlistCnt){
+            p = strstr(line, "http://");                        // Search for "http://"
+            connecttohost(String(p ? p + 7 : line));            // Connect to it, without "http://"
+            return;
+        }
+        m_playlistCnt++;                                        // Next entry in playlist
+        return;
+    }
+    if(m_playlist.endsWith("pls")){
+        if(!strncmp(line, "File1", 5)){
+            p = strstr(line, "http://");                        // Search for "http://"
+            if(p){                                              // Does URL contain "http://"?
+                p += 7;                                         // Yes, remove it
+                q = strchr(p, '&');
+                if(q && q > p) *q = 0;                          // remove parameter
+                m_plsURL = p;                                   // Now we have an URL for a .mp3 file or stream in host.
+                m_f_plsFile=true;
+            }
+        }
+        if(!strncmp(line, "Title1", 6)){
+            m_plsStationName = line + 7;
+            if(audio_showstation) audio_showstation(m_plsStationName.c_str());
+            sprintf(chbuf, "StationName: %s", m_plsStationName.c_str());
             if(audio_info) audio_info(chbuf);
-            if(m_playlist.endsWith("m3u")){
-                if(m_metaline.length() < 5) {                   // Skip short lines
-                    m_metaline="";                              // Flush line
-                    return;}
-                if(m_metaline.indexOf("#EXTINF:") >= 0){        // Info?
-                    if(m_playlist_num == playlistcnt){          // Info for this entry?
-                        inx=m_metaline.indexOf(",");            // Comma in this line?
-                        if(inx > 0){
-                            // Show artist and title if present in metadata
-                            //if(vs1053_showstation) vs1053_showstation(m_metaline.substring(inx + 1).c_str());
-                            if(audio_info) audio_info(m_metaline.substring(inx + 1).c_str());
-                        }
-                    }
+            m_f_plsTitle=true;
+        }
+        if(!strncmp(line, "Length1", 7)) m_f_plsTitle=true;    // if no Title is available
+        if(m_f_plsFile && line[0] == 0) m_f_plsTitle=true;
+        if(m_f_plsFile && m_f_plsTitle){                        // we have both StationName and StationURL
+            m_f_plsFile=false; m_f_plsTitle=false;
+            connecttohost(m_plsURL);                            // Connect to it
+        }
+        return;
+    }
+    if(m_playlist.endsWith("asx")){
+        if(findText(line, "<entry>")) m_f_asxEntry=true;       // found entry tag
+        if(m_f_asxEntry){
+            p = (char*)findText(line, "ref href");
+            if(p && p > line){
+                p = (char*)findText(line, "http://");
+                if(p && p > line){
+                    p += 7;                                     // Yes, remove it
+                    q = strchr(p, '"');
+                    if(q && q > p) *q = 0;                      // remove rest
+                    m_plsURL = p;                               // Now we have an URL for a stream in host.
+                    m_f_plsFile=true;
                 }
-                if(m_metaline.startsWith("#")){                 // Commentline?
-                    m_metaline="";
-                    return;}                                    // Ignore commentlines
-                // Now we have an URL for a .mp3 file or stream.  Is it the rigth one?
-                //if(metaline.indexOf("&")>0)metaline=host.substring(0,metaline.indexOf("&"));
-                sprintf(chbuf, "Entry %d in playlist found: %s", playlistcnt, m_metaline.c_str());
+            }
+            if(findText(line, "<title>")){
+                p = line + 7;
+                q = strchr(p, '<');
+                if(q && q > p) *q = 0;                          // remove "</title>"
+                m_plsStationName = p;
+                if(audio_showstation) audio_showstation(m_plsStationName.c_str());
+                snprintf(chbuf, sizeof(chbuf), "StationName: %s", m_plsStationName.c_str());
                 if(audio_info) audio_info(chbuf);
-                if(m_metaline.indexOf("&")){
-                    m_metaline=m_metaline.substring(0, m_metaline.indexOf("&"));}
-                if(m_playlist_num == playlistcnt){
-                    inx=m_metaline.indexOf("http://");          // Search for "http://"
-                    if(inx >= 0){                               // Does URL contain "http://"?
-                        host=m_metaline.substring(inx + 7);}    // Yes, remove it and set host
-                    else{
-                        host=m_metaline;}                       // Yes, set new host
-                    //log_i("connecttohost %s", host.c_str());
-                    connecttohost(host);                        // Connect to it
-                }
-                m_metaline="";
-                host=m_playlist;                                // Back to the .m3u host
-                playlistcnt++;                                  // Next entry in playlist
-            } //m3u
-            if(m_playlist.endsWith("pls")){
-                if(m_metaline.startsWith("File1")){
-                    inx=m_metaline.indexOf("http://");          // Search for "http://"
-                    if(inx >= 0){                               // Does URL contain "http://"?
-                        m_plsURL=m_metaline.substring(inx + 7); // Yes, remove it
-                        if(m_plsURL.indexOf("&")>0)m_plsURL=m_plsURL.substring(0,m_plsURL.indexOf("&")); // remove parameter
-                        // Now we have an URL for a .mp3 file or stream in host.
-
-                        m_f_plsFile=true;
-                    }
-                }
-                if(m_metaline.startsWith("Title1")){
-                    m_plsStationName=m_metaline.substring(7);
-                    if(audio_showstation) audio_showstation(m_plsStationName.c_str());
-                    sprintf(chbuf, "StationName: %s", m_plsStationName.c_str());
-                    if(audio_info) audio_info(chbuf);
-                    m_f_plsTitle=true;
-                }
-                if(m_metaline.startsWith("Length1")) m_f_plsTitle=true; // if no Title is available
-                if((m_f_plsFile==true)&&(m_metaline.length()==0)) m_f_plsTitle=true;
-                m_metaline="";
-                if(m_f_plsFile && m_f_plsTitle){    //we have both StationName and StationURL
-                    m_f_plsFile=false; m_f_plsTitle=false;
-                    //log_i("connecttohost %s", m_plsURL.c_str());
-                    connecttohost(m_plsURL);        // Connect to it
-                }
-            }//pls
-            if(m_playlist.endsWith("asx")){
-                String ml=m_metaline;
-                ml.toLowerCase();                               // use lowercase
-                if(ml.indexOf("<entry>")>=0) f_entry=true;      // found entry tag (returns -1 if not found)
-                if(f_entry){
-                    if(ml.indexOf("ref href")>0){
-                        inx=ml.indexOf("http://");
-                        if(inx>0){
-                            m_plsURL=m_metaline.substring(inx + 7); // Yes, remove it
-                            if(m_plsURL.indexOf('"')>0)m_plsURL=m_plsURL.substring(0,m_plsURL.indexOf('"')); // remove rest
-                            // Now we have an URL for a stream in host.
-                            m_f_plsFile=true;
-                        }
-                    }
-                    if(ml.indexOf("<title>")>=0){
-                        m_plsStationName=m_metaline.substring(7);
-                        if(m_plsURL.indexOf('<')>0)m_plsURL=m_plsURL.substring(0,m_plsURL.indexOf('<')); // remove rest
-                        if(audio_showstation) audio_showstation(m_plsStationName.c_str());
-                        sprintf(chbuf, "StationName: %s", m_plsStationName.c_str());
-                        if(audio_info) audio_info(chbuf);
-                        m_f_plsTitle=true;
-                    }
-                }//entry
-                m_metaline="";
-                if(m_f_plsFile && m_f_plsTitle){   //we have both StationName and StationURL
-                    m_f_plsFile=false; m_f_plsTitle=false;
-                    //log_i("connecttohost %s", host.c_str());
-                    connecttohost(m_plsURL);        // Connect to it
-                }
-            }//asx
+                m_f_plsTitle=true;
+            }
         }
-        else{
-            m_metaline+=(char)b;                    // Normal character, add it to metaline
+        if(m_f_plsFile && m_f_plsTitle){                        // we have both StationName and StationURL
+            m_f_plsFile=false; m_f_plsTitle=false;
+            connecttohost(m_plsURL);                            // Connect to it
         }
-        return;
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -1689,6 +2136,7 @@ void Audio::showstreamtitle(const char *ml, bool full){
 
         if(m_st_remember!=st){ // show only changes
             if(audio_showstreamtitle) audio_showstreamtitle(st.c_str());
+            if(RecActive()) recordSplit(st.c_str());        // new title, new file
         }
 
         m_st_remember=st;
@@ -1763,6 +2211,10 @@ int Audio::sendBytes(uint8_t *data, size_t len) {
         if(m_codec == CODEC_WAV){ m_f_playing = true; return 0;}
         if(m_codec == CODEC_MP3) nextSync = MP3FindSyncWord(data, len);
         if(m_codec == CODEC_AAC) nextSync = AACFindSyncWord(data, len);
+        if(m_codec == CODEC_FLAC){
+            FLACDecoder_ClearBuffer(); // the frame buffer has to start with the frame found here
+            nextSync = FLACFindSyncWord(data, len);
+        }
 
         if(nextSync==-1) {
             swnf++; // syncword not found counter, can be multimediadata
@@ -1792,17 +2244,61 @@ int Audio::sendBytes(uint8_t *data, size_t len) {
     int ret = 0;
     int bytesDecoded = 0;
     if(m_codec == CODEC_WAV){ //copy len data in outbuff and set validsamples and bytesdecoded=len
-        memmove(m_outBuff, data , len);
-        if(getBitsPerSample() == 16) m_validSamples = len / (2 * getChannels());
-        if(getBitsPerSample() == 8 ) m_validSamples = len / 2;
-        m_bytesLeft = 0;
-    }
+        if(getBitsPerSample() <= 16){
+            memmove(m_outBuff, data , len);
+            if(getBitsPerSample() == 16) m_validSamples = len / (2 * getChannels());
+            if(getBitsPerSample() == 8 ) m_validSamples = len / 2;
+            m_bytesLeft = 0;
+        }
+#ifdef I2S_32BIT
+        if(getBitsPerSample() == 24){ // packed little endian, whole sample frames only, to Q28
+            m_validSamples = len / (3 * getChannels());
+            for(int i = 0; i < m_validSamples * getChannels(); i++)
+                m_outBuff32[i] = (int32_t)((data[3*i] << 8) | (data[3*i + 1] << 16) | ((uint32_t)data[3*i + 2] << 24)) >> 3;
+            m_bytesLeft = len - m_validSamples * 3 * getChannels();
+        }
+        if(getBitsPerSample() == 32){
+            m_validSamples = len / (4 * getChannels());
+            memcpy(m_outBuff32, data, m_validSamples * 4 * getChannels());
+            for(int i = 0; i < m_validSamples * getChannels(); i++) m_outBuff32[i] >>= 3; // to Q28
+            m_bytesLeft = len - m_validSamples * 4 * getChannels();
+        }
+#endif
+    }
+#ifdef AUDIO_DECODE_PROFILE
+    static uint32_t profCycles = 0, profSamples = 0, profCalls = 0, profMax = 0;
+    static uint64_t profSquares = 0;                        // spread of the calls, stands in for the cache misses
+    uint32_t profStart = ESP.getCycleCount();
+#endif
+    uint32_t xfStart = ESP.getCycleCount();
+#ifdef I2S_32BIT
+    if(m_codec == CODEC_MP3) ret = MP3Decode32(data, &m_bytesLeft, m_outBuff32, 0); // Q28, not clipped to 16 bit
+    if(m_codec == CODEC_AAC) ret = AACDecode32(data, &m_bytesLeft, m_outBuff32);
+#else
     if(m_codec == CODEC_MP3) ret = MP3Decode(data, &m_bytesLeft, m_outBuff, 0);
     if(m_codec == CODEC_AAC) ret = AACDecode(data, &m_bytesLeft, m_outBuff);
+#endif
+    if(m_codec == CODEC_FLAC){
+#ifdef I2S_32BIT
+        if(FLACGetBitsPerSample() > 16) ret = FLACDecode32(data, &m_bytesLeft, m_outBuff32);
+        else                            ret = FLACDecode(data, &m_bytesLeft, m_outBuff);
+#else
+        ret = FLACDecode(data, &m_bytesLeft, m_outBuff);
+#endif
+        if(ret == ERR_FLAC_INDATA_UNDERFLOW) ret = 0; // input buffered, frame not complete yet
+    }
+#ifdef AUDIO_DECODE_PROFILE
+    profStart = ESP.getCycleCount() - profStart;
+    profCycles += profStart;
+    profSquares += (uint64_t)profStart * profStart;
+    if(profStart > profMax) profMax = profStart;
+    profCalls++;
+#endif
+    if(m_xfState) m_xfDecCycles += ESP.getCycleCount() - xfStart; // CPU budget of the crossfade window
     if(ret==0) lastRet=0;
     bytesDecoded=len-m_bytesLeft;
     // log_i("bytesDecoded %i", bytesDecoded);
-    if(bytesDecoded==0){ // unlikely framesize
+    if(bytesDecoded==0 && m_codec != CODEC_FLAC){ // unlikely framesize, FLAC returns buffered samples without input
         if(audio_info) audio_info("framesize is 0, start decoding again");
         m_f_playing=false; // seek for new syncword
         
@@ -1832,11 +2328,6 @@ int Audio::sendBytes(uint8_t *data, size_t len) {
                 if(audio_info) audio_info(chbuf);
             }
             if ((uint32_t)MP3GetSampRate() != m_sampleRate) {
-                if ((uint32_t) MP3GetSampRate() != 0) {
-                  tas5753md_mute();
-                  biquad_loadCoeffs_LR((double)MP3GetSampRate());
-                  tas5753md_unmute();
-                  }
                 setSampleRate(MP3GetSampRate());
                 lastSampleRate = MP3GetSampRate();
                 sprintf(chbuf,"SampleRate=%i",MP3GetSampRate());
@@ -1849,7 +2340,11 @@ int Audio::sendBytes(uint8_t *data, size_t len) {
             }
             if(MP3GetBitsPerSample() != lastBitsPerSeconds){
                 lastBitsPerSeconds = MP3GetBitsPerSample();
+#ifdef I2S_32BIT
+                setBitsPerSample(32); // MP3Decode32()
+#else
                 setBitsPerSample(MP3GetBitsPerSample());
+#endif
                 sprintf(chbuf,"BitsPerSample=%i", MP3GetBitsPerSample());
                 if(audio_info) audio_info(chbuf);
             }
@@ -1871,11 +2366,6 @@ int Audio::sendBytes(uint8_t *data, size_t len) {
                 if(audio_info) audio_info(chbuf);
             }
             if (AACGetSampRate() != lastSampleRate) {
-                if ((int) AACGetSampRate() != 0) {
-                  tas5753md_mute();
-                  biquad_loadCoeffs_LR((double)AACGetSampRate());
-                  tas5753md_unmute();
-                  }              
                 setSampleRate(AACGetSampRate());
                 lastSampleRate = AACGetSampRate();
                 sprintf(chbuf,"AAC SampleRate=%i",AACGetSampRate() * getChannels());
@@ -1888,7 +2378,11 @@ int Audio::sendBytes(uint8_t *data, size_t len) {
             }
             if (AACGetBitsPerSample() != lastBitsPerSeconds){
                 lastBitsPerSeconds = AACGetBitsPerSample();
+#ifdef I2S_32BIT
+                setBitsPerSample(32); // AACDecode32()
+#else
                 setBitsPerSample(AACGetBitsPerSample());
+#endif
                 sprintf(chbuf,"AAC BitsPerSample=%i", AACGetBitsPerSample());
                 if(audio_info) audio_info(chbuf);
             }
@@ -1906,16 +2400,86 @@ int Audio::sendBytes(uint8_t *data, size_t len) {
                     lastBitRate = m_bitRate;
             }
             m_validSamples = AACGetOutputSamps() / lastChannels;
+#ifdef AAC_KERNEL_PROFILE
+            AACKernelStats_t *ks = AACGetKernelStats();
+            if(ks->calls >= 2000){
+                sprintf(chbuf, "AAC DCT4 cycles/call: pre %u, bitrev %u, first pass %u, R4 core %u, post %u",
+                        ks->preMultiply / ks->calls, ks->bitReverse / ks->calls, ks->firstPass / ks->calls,
+                        ks->r4Core / ks->calls, ks->postMultiply / ks->calls);
+                if(audio_info) audio_info(chbuf);
+                sprintf(chbuf, "AAC window overlap-add cycles/frame: %u, noiseless decoding cycles/frame: %u",
+                        ks->windowOverlap / ks->frames, ks->noiseless / ks->frames);
+                if(audio_info) audio_info(chbuf);
+                sprintf(chbuf, "AAC stereo processing cycles/frame: %u, PNS + TNS cycles/frame: %u",
+                        ks->stereo / ks->frames, ks->pnsTns / ks->frames);
+                if(audio_info) audio_info(chbuf);
+                memset(ks, 0, sizeof(AACKernelStats_t));
+            }
+#endif
+        }
+        if(m_codec == CODEC_FLAC){
+            if(FLACGetChannels() != (int)lastChannels){
+                setChannels(FLACGetChannels());
+                lastChannels = FLACGetChannels();
+                sprintf(chbuf,"FLAC Channels=%i", FLACGetChannels());
+                if(audio_info) audio_info(chbuf);
+            }
+            if((uint32_t)FLACGetSampRate() != lastSampleRate){
+                setSampleRate(FLACGetSampRate());
+                lastSampleRate = FLACGetSampRate();
+                sprintf(chbuf,"FLAC SampleRate=%i", FLACGetSampRate());
+                if(audio_info) audio_info(chbuf);
+            }
+            if((uint32_t)FLACGetBitsPerSample() != lastBitsPerSeconds){ // FLACDecode() delivers 16 bit, FLACDecode32() 32 bit
+                lastBitsPerSeconds = FLACGetBitsPerSample();
+#ifdef I2S_32BIT
+                setBitsPerSample(FLACGetBitsPerSample() > 16 ? 24 : 16);
+#else
+                setBitsPerSample(16);
+#endif
+                sprintf(chbuf,"FLAC BitsPerSample=%i", FLACGetBitsPerSample());
+                if(audio_info) audio_info(chbuf);
+            }
+            if(FLACGetBitRate()) m_bitRate = FLACGetBitRate();
+            if(m_bitRate && !lastBitRate){
+                sprintf(chbuf,"FLAC BitRate=%u", m_bitRate);
+                if(audio_info) audio_info(chbuf);
+                lastBitRate = m_bitRate;
+            }
+            m_validSamples = FLACGetOutputSamps() / lastChannels;
         }
     }
-    compute_audioCurrentTime(bytesDecoded);
+#ifdef AUDIO_DECODE_PROFILE
+    profSamples += m_validSamples;
+    if(m_sampleRate && profSamples >= 10 * m_sampleRate){
+        uint32_t cps = (uint64_t)profCycles * m_sampleRate / profSamples; // cycles per second of audio
+        float mean = (float)profCycles / profCalls;
+        float sd = sqrtf(fmaxf(0.0f, (float)profSquares / profCalls - mean * mean));
+        sprintf(chbuf, "decoder load: %u cycles per second of audio, %u.%u%% of the CPU, hot memory in %s",
+                cps, cps / (ESP.getCpuFreqMHz() * 10000), (cps / (ESP.getCpuFreqMHz() * 1000)) % 10,
+                MemPlacement(MEM_HOT) == MEM_PSRAM ? "PSRAM" : "internal RAM");
+        if(audio_info) audio_info(chbuf);
+#ifdef MEM_TABLES_DRAM
+        const char *tables = "internal RAM";
+#else
+        const char *tables = "flash";
+#endif
+        sprintf(chbuf, "decoder calls: %u cycles mean, %u standard deviation, %u max, hot tables in %s",
+                (uint32_t)mean, (uint32_t)sd, profMax, tables);
+        if(audio_info) audio_info(chbuf);
+        profCycles = 0; profSamples = 0; profCalls = 0; profMax = 0; profSquares = 0;
+    }
+#endif
+    if(m_trimStart || m_trimEnd) trimGapless();
+    compute_audioCurrentTime();
+    if(m_f_webstream && m_jbTarget) jitterStretch();
     while(m_validSamples) {
         playChunk();
     }
     return bytesDecoded;
 }
 //---------------------------------------------------------------------------------------------------------------------
-void Audio::compute_audioCurrentTime(int bd){
+void Audio::compute_audioCurrentTime(){
     static uint16_t bitrate_counter=0;
     static int      old_bitrate = 0;
     static uint32_t sum_bitrate = 0;
@@ -1946,7 +2510,135 @@ void Audio::compute_audioCurrentTime(int bd){
             m_avr_bitrate = m_bitRate; // if CBR set m_avr_bitrate only once
         }
         f_firstFrame = false;
-        m_audioCurrentTime += (float) bd * 8 / m_bitRate;
+    }
+    // position from the decoded samples, a float sum of bd * 8 / m_bitRate drifts on VBR files
+    m_samplesDecoded += m_validSamples;
+    if(m_sampleRate) m_audioCurrentTime = (float)m_samplesDecoded / m_sampleRate;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::trimGapless(){
+    // drop the encoder delay at the start and the padding at the end of a mp3 file (iTunSMPB or LAME tag),
+    // m_samplesDecoded is the decoder output position of m_outBuff[0]
+    uint32_t pos = m_samplesDecoded, n;
+    if(pos < m_trimStart){
+        n = m_trimStart - pos;
+        if(n > (uint32_t)m_validSamples) n = m_validSamples;
+        m_curSample += n;                                   // playChunk() starts here
+        m_validSamples -= n;
+        m_samplesDecoded += n;
+        pos += n;
+    }
+    if(m_trimEnd && pos + m_validSamples > m_trimEnd){
+        n = (pos < m_trimEnd) ? m_trimEnd - pos : 0;
+        m_samplesDecoded += m_validSamples - n;
+        m_validSamples = n;
+    }
+    if(!m_validSamples) m_curSample = 0;                   // nothing to play from this frame
+}
+//---------------------------------------------------------------------------------------------------------------------
+template <typename pcm_t>
+static int16_t monoAt(const pcm_t *b, int i, int ch, int shift){
+    // mid of frame i at 16 bit full scale, saturated
+    int32_t v = (ch == 2 ? (int32_t)b[2 * i] + b[2 * i + 1] : 2 * (int32_t)b[i]) >> shift;
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : v;
+}
+
+static float periodMatch(const int16_t *x, int p, int step){
+    // normalized correlation of x[0 .. p) and x[p .. 2p), every step-th sample
+    int64_t c = 0, e1 = 0, e2 = 0;
+    for(int i = 0; i < p; i += step){
+        c  += (int64_t)x[i] * x[i + p];
+        e1 += (int64_t)x[i] * x[i];
+        e2 += (int64_t)x[i + p] * x[i + p];
+    }
+    return (float)c / sqrtf((float)e1 * (float)e2 + 1.0f);
+}
+
+template <typename pcm_t>
+static int stretchPeriod(pcm_t *b, int n, int ch, int pMin, int pMax){
+    // lengthens the block by one period p of its start (pitch synchronous overlap-add, WSOLA with a single
+    // segment): frames p .. 2p-1 become a crossfade from frame p + i, the continuation, to frame i, the period
+    // before, which ends in frame p - 1 again, and the block goes on from frame p. The pitch stays, the sound
+    // lasts p frames longer. p is the best match of the first two periods of the mid signal, searched on every
+    // 4th lag and sample, then refined around it. Needs 2 * pMax <= n and room for pMax more frames, returns p
+    int16_t x[1024];                                    // mid of the first 2 * pMax frames
+    int shift = sizeof(pcm_t) == 2 ? 1 : 14, np = min(2 * pMax, 1024), best = pMin, i, c;
+    float bestMatch = -2.0f, m;
+
+    pMax = np / 2;
+    for(i = 0; i < np; i++) x[i] = monoAt(b, i, ch, shift);
+    for(int p = pMin & ~3; p <= pMax; p += 4){          // coarse, every 4th lag and sample
+        if(p < pMin) continue;
+        m = periodMatch(x, p, 4);
+        if(m > bestMatch){ bestMatch = m; best = p; }
+    }
+    int lo = max(pMin, best - 3), hi = min(pMax, best + 3);
+    bestMatch = -2.0f;
+    for(int p = lo; p <= hi; p++){
+        m = periodMatch(x, p, 1);
+        if(m > bestMatch){ bestMatch = m; best = p; }
+    }
+
+    int p = best;
+    memmove(&b[2 * p * ch], &b[p * ch], (n - p) * ch * sizeof(pcm_t));
+    for(i = 0; i < p; i++){                             // frame p + i is at 2p + i now
+        for(c = 0; c < ch; c++){
+            int64_t out = b[(2 * p + i) * ch + c], in = b[i * ch + c];
+            b[(p + i) * ch + c] = (pcm_t)((out * (p - i) + in * i) / p);
+        }
+    }
+    return p;
+}
+
+template <typename pcm_t>
+static int dropSilence(pcm_t *b, int n, int ch, int32_t thr, int maxDrop){
+    // removes up to maxDrop frames whose samples are all below thr, returns the frames left
+    int w = 0, i, c;
+    for(i = 0; i < n; i++){
+        bool quiet = maxDrop > 0;
+        for(c = 0; c < ch && quiet; c++) if(b[i * ch + c] >= thr || b[i * ch + c] <= -thr) quiet = false;
+        if(quiet){ maxDrop--; continue; }
+        if(w != i) for(c = 0; c < ch; c++) b[w * ch + c] = b[i * ch + c];
+        w++;
+    }
+    return w;
+}
+
+void Audio::jitterStretch(){
+    // a web stream plays on while the input buffer refills: below the watermark 1/64 of the decoded frames is owed
+    // and a block gets a period stretched in while the frames owed are positive, paid back by the next blocks
+    // (1.6 % slower, the cushion grows by 16 ms per second, the pitch stays). In the last eighth of the buffer and
+    // more than four times the watermark ahead (the server clock runs faster) up to 1/16 of the frames are dropped
+    // if silent
+    uint32_t fill = InBuff.bufferFilled();
+    uint32_t size = fill + InBuff.freeSpace();
+    uint32_t rate = getSampleRate();
+    int      n = m_validSamples, ch = m_channels;
+    bool     b32 = false;
+#ifdef I2S_32BIT
+    b32 = getBitsPerSample() > 16;
+#endif
+    if(getBitsPerSample() < 16 || n < 64 || ch < 1 || ch > 2 || !rate) return;
+    if(fill < m_jbTarget){
+        int pMin = rate / 400, pMax = min((int)(rate * 3 / 200), n / 2);     // 2.5 ms .. 15 ms, 67 Hz
+        pMax = min(pMax, 2048 - m_curSample - n);           // room in m_outBuff
+        m_jbOwed = min(m_jbOwed + n / 64, (int)(rate * 3 / 200));
+        if(pMax < pMin || m_jbOwed <= 0) return;
+#ifdef I2S_32BIT
+        if(b32) n += stretchPeriod(&m_outBuff32[m_curSample * ch], n, ch, pMin, pMax);
+        else
+#endif
+        n += stretchPeriod(&m_outBuff[m_curSample * ch], n, ch, pMin, pMax);
+        m_jbOwed -= n - m_validSamples;
+        m_validSamples = n;
+        return;
+    }
+    if(fill > size - size / 8 && fill / 4 > m_jbTarget){
+#ifdef I2S_32BIT
+        if(b32) m_validSamples = dropSilence(&m_outBuff32[m_curSample * ch], n, ch, 64 << 13, n / 16); // Q28
+        else
+#endif
+        m_validSamples = dropSilence(&m_outBuff[m_curSample * ch], n, ch, 64, n / 16);     // -54 dBFS
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -1996,6 +2688,24 @@ void Audio::printDecodeError(int r){
         sprintf(chbuf, "AAC decode error %d : %s", r, e.c_str());
         if(audio_info) audio_info(chbuf);
     }
+    if(m_codec == CODEC_FLAC){
+        switch(r){
+            case ERR_FLAC_NONE:                 e="NONE";                 break;
+            case ERR_FLAC_INDATA_UNDERFLOW:     e="INDATA_UNDERFLOW";     break;
+            case ERR_FLAC_OUT_OF_MEMORY:        e="OUT_OF_MEMORY";        break;
+            case ERR_FLAC_NO_STREAMINFO:        e="NO_STREAMINFO";        break;
+            case ERR_FLAC_INVALID_FRAMEHEADER:  e="INVALID_FRAMEHEADER";  break;
+            case ERR_FLAC_UNSUPPORTED_FORMAT:   e="UNSUPPORTED_FORMAT";   break;
+            case ERR_FLAC_BLOCKSIZE_TOO_BIG:    e="BLOCKSIZE_TOO_BIG";    break;
+            case ERR_FLAC_NCHANS_TOO_HIGH:      e="NCHANS_TOO_HIGH";      break;
+            case ERR_FLAC_INVALID_SUBFRAME:     e="INVALID_SUBFRAME";     break;
+            case ERR_FLAC_INVALID_RESIDUAL:     e="INVALID_RESIDUAL";     break;
+            case ERR_FLAC_FRAME_CRC:            e="FRAME_CRC";            break;
+            default: e="ERR_UNKNOWN";
+        }
+        sprintf(chbuf, "FLAC decode error %d : %s", r, e.c_str());
+        if(audio_info) audio_info(chbuf);
+    }
 }
 //---------------------------------------------------------------------------------------------------------------------
 bool Audio::setPinout(uint8_t BCLK, uint8_t LRC, uint8_t DOUT, int8_t DIN){
@@ -2028,6 +2738,24 @@ uint32_t Audio::getAudioFileDuration(){
     if(m_f_localfile){
         if (!audiofile) return 0;
 
+        if(m_codec == CODEC_MP3 && m_trimEnd && m_frameSamprate){
+            return (m_trimEnd - m_trimStart) / m_frameSamprate; // exact, from the gapless info
+        }
+        if(m_codec == CODEC_MP3 && m_frameSamples){
+            // frames * samples per frame is exact if the header scan is complete or a VBR tag is present,
+            // otherwise the frames are extrapolated from the scanned part and the result improves while playing
+            uint32_t frames = 0;
+            if(m_f_scanComplete) frames = m_scanFrames - (m_f_vbrTag ? 1 : 0);
+            else if(m_vbrFrames) frames = m_vbrFrames;
+            else if(m_scanPos > m_audioDataStart){
+                frames = (uint64_t)m_scanFrames * (getFileSize() - m_audioDataStart) / (m_scanPos - m_audioDataStart);
+                if(m_f_vbrTag && frames) frames--; // an Info tag without frame count, its frame is not audio
+            }
+            if(frames) return (uint64_t)frames * m_frameSamples / m_frameSamprate;
+        }
+        if(m_codec == CODEC_FLAC && FLACGetTotalSamples() && FLACGetSampRate()){
+            return FLACGetTotalSamples() / FLACGetSampRate(); // exact, from the STREAMINFO
+        }
         if ( 0 == m_audioFileDuration ) // calculate only once per file
         {
             uint32_t fileSize = getFileSize();
@@ -2066,6 +2794,11 @@ bool Audio::audioFileSeek(const int8_t speed) {
             // fast-rewind faster than fast-forward because we still playing
             steps = steps * 2;
         }
+        if(m_codec == CODEC_MP3 && m_frameSamples) {
+            int32_t sec = (int32_t)m_audioCurrentTime + steps / 20;
+            if(sec < 0) sec = 0;
+            return seekMP3Frame((uint64_t)sec * m_frameSamprate / m_frameSamples);
+        }
         uint32_t newPos = audiofile.position() + steps * MP3GetBitsPerSample();
         newPos = (newPos < m_id3Size) ? m_id3Size : newPos;
         newPos = (newPos >= audiofile.size()) ? audiofile.size() - 1 : newPos;
@@ -2076,17 +2809,247 @@ bool Audio::audioFileSeek(const int8_t speed) {
     return retVal;
 }
 //---------------------------------------------------------------------------------------------------------------------
+bool Audio::setAudioPlayPosition(uint16_t sec){
+    if(!audiofile || m_codec != CODEC_MP3 || !m_frameSamples) return false;
+    return seekMP3Frame((uint64_t)sec * m_frameSamprate / m_frameSamples);
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::setMP3PreScan(bool on){
+    m_f_preScan = on;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::initMP3Scan(fs::FS &fs){
+    // find the first frame behind the ID3 tag and read the Xing/Info or VBRI tag, if any
+    uint8_t  buf[512];
+    uint32_t pos = m_audioDataStart;
+    int      n = 0, sync = -1;
+    MP3FrameHeaderInfo_t fhi;
+    MP3VBRTag_t tag;
+
+    m_frameIndex.reset();
+    m_scanFrames = 0;
+    m_scanMicros = 0;
+    m_f_scanComplete = false;
+    m_f_vbrTag = false;
+    m_frameSamprate = 0;
+    m_frameSamples = 0;
+    m_vbrFrames = 0;
+    m_vbrBytes = 0;
+    m_f_vbrToc = false;
+    if(m_scanfile) m_scanfile.close();
+    m_scanfile = fs.open(path);
+    if(!m_scanfile) return;
+
+    while(pos < m_audioDataStart + 65536){ // skip padding and junk, but not the whole file
+        m_scanfile.seek(pos);
+        n = m_scanfile.read(buf, sizeof(buf));
+        if(n < 4) break;
+        sync = MP3FindSyncWord(buf, n);
+        if(sync >= 0 && sync <= n - 4) break;
+        sync = -1;
+        pos += n - 3;
+    }
+    if(sync < 0){
+        if(audio_info) audio_info("no mp3 frame found, seek index not available");
+        m_scanfile.close();
+        return;
+    }
+    pos += sync;
+    m_scanfile.seek(pos);
+    n = m_scanfile.read(buf, sizeof(buf));
+    MP3ParseFrameHeader(buf, &fhi);
+    m_audioDataStart = pos;
+    m_scanPos = pos;
+    m_frameSamprate = fhi.samprate;
+    m_frameSamples = fhi.samplesPerFrame;
+
+    if(MP3ParseVBRTag(buf, n, &tag)){
+        m_f_vbrTag = true;      // the tag frame is decoded as silence, but it is not part of the playtime
+        m_vbrFrames = tag.frames;
+        m_vbrBytes = tag.bytes;
+        m_f_vbrToc = tag.hasToc;
+        memcpy(m_vbrToc, tag.toc, sizeof(m_vbrToc));
+        sprintf(chbuf, "VBR tag found: %u frames, %u bytes%s", m_vbrFrames, m_vbrBytes, m_f_vbrToc ? ", TOC" : "");
+        if(audio_info) audio_info(chbuf);
+        if(tag.hasLame && !m_f_encDelay){ // iTunSMPB from the ID3 tag has priority, it holds the exact length
+            m_encDelay = tag.encDelay;
+            m_encPadding = tag.encPadding;
+            m_f_encDelay = true;
+        }
+    }
+    if(m_f_encDelay){ // positions in the decoder output, the tag frame is decoded as silence (see trimGapless)
+        m_trimStart = (m_f_vbrTag ? m_frameSamples : 0) + m_encDelay + m_DECODER_DELAY;
+        if(m_encSamples)
+            m_trimEnd = m_trimStart + m_encSamples;
+        else if((uint64_t)m_vbrFrames * m_frameSamples > (uint32_t)m_encDelay + m_encPadding)
+            m_trimEnd = m_trimStart + m_vbrFrames * m_frameSamples - m_encDelay - m_encPadding;
+        sprintf(chbuf, "Gapless: encoder delay %u, padding %u samples", m_encDelay, m_encPadding);
+        if(audio_info) audio_info(chbuf);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::scanMP3Frames(){
+    // reads only the frame headers (nothing is decoded) and stores every interval frames the position
+    // in m_frameIndex, a few frames per call so that the audio output is not disturbed
+    uint8_t  buf[256];
+    uint32_t fileSize = m_scanfile.size();
+    uint32_t t0 = micros();
+    bool     f_end = false;
+    int      n, sync;
+    MP3FrameHeaderInfo_t fhi;
+
+    for(uint8_t i = 0; i < 32; i++){
+        m_scanfile.seek(m_scanPos);
+        if(m_scanPos + 4 > fileSize || m_scanfile.read(buf, 4) != 4){f_end = true; break;}
+        if(MP3ParseFrameHeader(buf, &fhi) == 0){
+            if(!fhi.frameBytes){ // free format, frame size is unknown
+                if(audio_info) audio_info("MP3 free format, seek index not available");
+                m_scanfile.close();
+                return;
+            }
+            m_frameIndex.add(m_scanFrames, m_scanPos);
+            m_scanPos += fhi.frameBytes;
+            m_scanFrames++;
+            continue;
+        }
+        // lost sync (damaged frame or ID3v1 tag), search the next frame header
+        m_scanfile.seek(m_scanPos + 1);
+        n = m_scanfile.read(buf, sizeof(buf));
+        if(n < 4){f_end = true; break;}
+        sync = MP3FindSyncWord(buf, n);
+        if(sync >= 0 && sync <= n - 4) m_scanPos += 1 + sync;
+        else                           m_scanPos += n - 3;
+    }
+    m_scanMicros += micros() - t0;
+    if(f_end){
+        uint32_t bytes = m_scanPos - m_audioDataStart;
+        uint32_t us = m_scanMicros ? m_scanMicros : 1;
+        m_f_scanComplete = true;
+        sprintf(chbuf, "MP3 seek index complete: %u frames, %u entries", m_scanFrames, m_frameIndex.entries());
+        if(audio_info) audio_info(chbuf);
+        sprintf(chbuf, "MP3 header scan: %u bytes in %u ms, %u.%02u MB/s", bytes, us / 1000,
+                bytes / us, (uint32_t)((uint64_t)bytes * 100 / us) % 100);
+        if(audio_info) audio_info(chbuf);
+        m_scanfile.close();
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool Audio::seekMP3Frame(uint32_t frame){
+    uint32_t idxFrame = 0, pos = 0;
+    uint8_t  hdr[4];
+    MP3FrameHeaderInfo_t fhi;
+
+    if(!m_frameSamprate) return false;
+    if(m_f_scanComplete && frame >= m_scanFrames) return false; // behind the last frame
+
+    if(m_frameIndex.lookup(frame, &idxFrame, &pos)){
+        // scanned part: walk the frame headers from the index entry to the wanted frame, less than one index
+        // interval, that grows with the length of the file
+        while(idxFrame < frame){
+            audiofile.seek(pos);
+            if(audiofile.read(hdr, 4) != 4 || MP3ParseFrameHeader(hdr, &fhi) || !fhi.frameBytes) return false;
+            pos += fhi.frameBytes;
+            idxFrame++;
+        }
+    }
+    else if(m_f_vbrToc && frame < m_vbrFrames){
+        // not scanned yet, the Xing table of contents gives an approximate position
+        float    pct = 100.0f * frame / m_vbrFrames;
+        uint8_t  i   = (uint8_t)pct;
+        float    a   = m_vbrToc[i];
+        float    b   = (i < 99) ? m_vbrToc[i + 1] : 256;
+        pos = m_audioDataStart + (uint32_t)((a + (b - a) * (pct - i)) * m_vbrBytes / 256);
+        idxFrame = frame;
+    }
+    else if(m_scanFrames){
+        // not scanned yet, extrapolate from the average frame size of the scanned part
+        pos = m_audioDataStart + (uint64_t)(m_scanPos - m_audioDataStart) * frame / m_scanFrames;
+        idxFrame = frame;
+    }
+    else return false;
+
+    if(pos >= audiofile.size()) return false;
+    if(!audiofile.seek(pos)) return false;
+    InBuff.resetBuffer();
+    MP3ResetReservoir();          // main data of the frames before pos is gone
+    m_f_playing = false;          // sendBytes() looks for the next sync word, that is pos if it was found by index
+    i2s_zero_dma_buffer((i2s_port_t)m_i2s_num);
+    xfadeDrop();                  // the held back frames are from before pos
+    SRCClearHistory();
+    m_srcN = m_srcIdx = 0;
+    m_samplesDecoded = idxFrame * m_frameSamples;
+    m_audioCurrentTime = (float)m_samplesDecoded / m_frameSamprate;
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
 bool Audio::setSampleRate(uint32_t sampRate) {
-    i2s_set_sample_rates((i2s_port_t)m_i2s_num, sampRate);
+    // sample rate of the decoder output, I2S and the crossover run at m_srcRate if the resampler can convert it
+    uint32_t i2sRate = sampRate;
+
+    if(sampRate == m_sampleRate) return true;
+    while(m_srcIdx < m_srcN){                       // resampled frames of the last file
+        if(srcFrame(&m_srcOut[2 * m_srcIdx])) m_srcIdx++;
+    }
+    if(m_srcRate){
+        m_f_src = sampRate != m_srcRate && SRCInit(sampRate, m_srcRate, m_srcQuality);
+        if(m_f_src || sampRate == m_srcRate) i2sRate = m_srcRate;
+        if(m_f_src) sprintf(chbuf, "Resampler: %u -> %u Hz, L/M %i/%i, %i taps", sampRate, m_srcRate,
+                            SRCGetL(), SRCGetM(), SRCGetTaps());
+        else if(sampRate != m_srcRate) sprintf(chbuf, "Resampler: %u Hz not supported, I2S follows the file", sampRate);
+        if(audio_info && sampRate != m_srcRate) audio_info(chbuf);
+    }
     m_sampleRate = sampRate;
+    setCrossoverRate(i2sRate);
+    if(i2sRate == m_i2sRate) return true;           // i2s_set_sample_rates() restarts I2S, a click between tracks
+    if(m_xfFill) xfadeFlush(true);                  // no crossfade over a rate change, the last file fades out
+    i2s_set_sample_rates((i2s_port_t)m_i2s_num, i2sRate);
+    m_i2sRate = i2sRate;
     return true;
 }
+//---------------------------------------------------------------------------------------------------------------------
+bool Audio::setResampler(uint32_t outRate, uint8_t quality){
+    uint32_t sr = m_sampleRate;
+
+    if(quality > SRC_HIGH) quality = SRC_HIGH;
+    m_srcRate = outRate;
+    m_srcQuality = quality;
+    m_f_src = false;
+    m_srcN = m_srcIdx = 0;
+    if(!outRate){
+        SRCFree();
+        if(audio_info) audio_info("Resampler: off");
+    }
+    m_sampleRate = 0;                               // set up again for the current file
+    if(sr) setSampleRate(sr);
+    return !outRate || m_f_src || sr == outRate || !sr;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::setCrossoverRate(uint32_t sampRate) {
+    // the FPGA biquads are designed for one sample rate, the amplifier is muted while they are reloaded,
+    // so this happens only if the rate really changes (not at every track or resync)
+    if(sampRate == 0 || sampRate == m_crossoverRate) return;
+    if(m_xfFill) xfadeFlush(true);                  // the end of the last file with its own rate and filters
+    tas5753md_mute();
+    biquad_loadCoeffs_LR((double)sampRate);
+    tas5753md_unmute();
+    m_crossoverRate = sampRate;
+}
+void Audio::setCrossoverLoaded(uint32_t sampRate) {
+    m_crossoverRate = sampRate;
+}
+uint32_t Audio::getFirstSampleTime(){
+    return m_firstSample;
+}
 uint32_t Audio::getSampleRate(){
     return m_sampleRate;
 }
 //---------------------------------------------------------------------------------------------------------------------
-bool Audio::setBitsPerSample(int bits) {
+bool Audio::setBitsPerSample(int bits) { // 24 and 32: Q28 samples in m_outBuff32
+#ifdef I2S_32BIT
+    if ( (bits != 16) && (bits != 8) && (bits != 24) && (bits != 32) ) return false;
+#else
     if ( (bits != 16) && (bits != 8) ) return false;
+#endif
     m_bitsPerSample = bits;
     return true;
 }
@@ -2108,20 +3071,241 @@ bool Audio::playSample(int16_t sample[2]) {
       sample[LEFTCHANNEL]  = ((sample[LEFTCHANNEL]  & 0xff) -128) << 8;
       sample[RIGHTCHANNEL] = ((sample[RIGHTCHANNEL] & 0xff) -128) << 8;
     }
+#ifdef I2S_32BIT
+    int32_t s32[2] = {sample[LEFTCHANNEL] << 13, sample[RIGHTCHANNEL] << 13}; // Q28
+    return playSample32(s32);
+#else
+    if(m_f_src){
+        int32_t s32[2] = {sample[LEFTCHANNEL], sample[RIGHTCHANNEL]};
+        return srcSample(s32);
+    }
+    if(m_xfState) return xfadeSample(sample);
+    return writeFrame(sample, true);
+#endif
+}
+//---------------------------------------------------------------------------------------------------------------------
+#ifdef I2S_32BIT
+bool Audio::playSample32(int32_t sample[2]) {
+    if(m_f_src) return srcSample(sample);
+    if(m_xfState) return xfadeSample(sample);
+    return writeFrame(sample, true);
+}
+#endif
+//---------------------------------------------------------------------------------------------------------------------
+bool Audio::srcSample(int32_t sample[2]){
+    // one frame at the file rate in, 0 ... SRC_MAX_OUT frames at m_srcRate out. The input frame is taken
+    // (true) only after the frames of the previous one are written, the rest is written with the next call
+    while(m_srcIdx < m_srcN){
+        if(!srcFrame(&m_srcOut[2 * m_srcIdx])) return false;
+        m_srcIdx++;
+    }
+    m_srcN = SRCProcess(sample, m_srcOut);
+    m_srcIdx = 0;
+    while(m_srcIdx < m_srcN){
+        if(!srcFrame(&m_srcOut[2 * m_srcIdx])) break;
+        m_srcIdx++;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool Audio::srcFrame(int32_t sample[2]){
+#ifdef I2S_32BIT
+    xfade_t *f = sample;                            // Q28, Gain32() clips
+#else
+    xfade_t f[2];
+    for(int i = 0; i < 2; i++) f[i] = sample[i] > 32767 ? 32767 : sample[i] < -32768 ? -32768 : sample[i];
+#endif
+    if(m_xfState) return xfadeSample(f);
+    return writeFrame(f, true);
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool Audio::writeFrame(xfade_t sample[2], bool wait) {
+    // one frame to I2S, with wait = false only if there is room in the DMA buffers (always a whole frame then)
+#ifdef I2S_32BIT
+    int32_t s32[2];
+    s32[0] = Gain32(sample[RIGHTCHANNEL]); // same slot order as the 16 bit frames, right word first
+    s32[1] = Gain32(sample[LEFTCHANNEL]);
+    esp_err_t err=i2s_write((i2s_port_t)m_i2s_num, (const char*)s32, sizeof(s32), &m_i2s_bytesWritten, wait ? 1000 : 0);
+#else
     uint32_t s32;
     s32 = ((Gain(sample[RIGHTCHANNEL]))<<16) | (Gain(sample[LEFTCHANNEL]) & 0xffff); // volume
-    esp_err_t err=i2s_write((i2s_port_t)m_i2s_num, (const char*)&s32, sizeof(uint32_t), &m_i2s_bytesWritten, 1000);
+    esp_err_t err=i2s_write((i2s_port_t)m_i2s_num, (const char*)&s32, sizeof(s32), &m_i2s_bytesWritten, wait ? 1000 : 0);
+#endif
     if(err!=ESP_OK){
         log_e("ESP32 Errorcode %i", err);
         return false;
     }
-    if(m_i2s_bytesWritten<4){
-        log_e("Can't stuff any more in I2S..."); // increase waitingtime or outputbuffer
+    if(m_i2s_bytesWritten<sizeof(s32)){
+        if(wait) log_e("Can't stuff any more in I2S..."); // increase waitingtime or outputbuffer
+        return false;
+    }
+    if(!m_firstSample) m_firstSample = millis();
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+static inline int32_t xfadeGain(const int16_t *sinTab, uint32_t phase){ // phase 16.16 in [0, 256], sin(phase / 256 * pi/2) Q15
+    uint32_t i = phase >> 16;
+    if(i >= 256) return sinTab[256];
+    int32_t f = (phase >> 1) & 0x7fff;
+    return sinTab[i] + (((sinTab[i + 1] - sinTab[i]) * f) >> 15);
+}
+static inline xfade_t xfadeMix(xfade_t a, int32_t ga, xfade_t b, int32_t gb){ // a * ga + b * gb, gains Q15
+#ifdef I2S_32BIT
+    return (int32_t)(((int64_t)a * ga + (int64_t)b * gb) >> 15); // Q28 has guard bits, Gain32() clips
+#else
+    int32_t v = (a * ga + b * gb) >> 15;                         // equal power sums to 1.41 at most
+    if(v >  32767) v =  32767;
+    if(v < -32768) v = -32768;
+    return v;
+#endif
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool Audio::setCrossfade(uint16_t ms){
+    if(ms > 10000) ms = 10000;
+    xfadeDrop();
+    m_xfState = XF_OFF;
+    MemFree(m_xfBuff);
+    m_xfBuff = NULL;
+    m_xfSize = 0;
+    m_xfMs = 0;
+    if(!ms) return true;
+
+    uint32_t frames = (uint32_t)ms * 48;                    // ms at 48 kHz, shorter fades at higher rates
+    m_xfBuff = (xfade_t*)MemAlloc(MEM_BULK, frames * 2 * sizeof(xfade_t), "crossfade");
+    if(!m_xfBuff){
+        sprintf(chbuf, "Crossfade: %u bytes not available", frames * 2 * (uint32_t)sizeof(xfade_t));
+        if(audio_info) audio_info(chbuf);
         return false;
     }
+    for(int i = 0; i <= 256; i++) m_xfSin[i] = (int16_t)lrintf(32767.0f * sinf((float)M_PI / 2 * i / 256));
+    m_xfSize = frames;
+    m_xfMs = ms;
+    sprintf(chbuf, "Crossfade: %u ms, %u bytes", ms, frames * 2 * (uint32_t)sizeof(xfade_t));
+    if(audio_info) audio_info(chbuf);
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::xfadeStart(){
+    // from now on every frame of the current file passes the ring, up to m_xfTarget frames are held back
+    if(!m_xfMs || !m_i2sRate) return;
+    m_xfTarget = (uint32_t)m_xfMs * m_i2sRate / 1000;
+    if(m_xfTarget > m_xfSize) m_xfTarget = m_xfSize;
+    m_xfRead = 0;
+    m_xfFill = 0;
+    m_xfFrames = 0;
+    m_xfDecCycles = 0;
+    m_xfMixCycles = 0;
+    m_xfState = XF_FILL;
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool Audio::xfadeSample(xfade_t sample[2]){
+    // output stage while a crossfade is prepared or running, a frame is consumed only if true is returned
+    uint32_t t0 = ESP.getCycleCount();
+    xfade_t *a, out[2];
+    uint32_t w;
+
+    if(m_xfState == XF_FILL){
+        // the ring grows while the DMA buffers are full, that is as fast as the decoder is faster than real time
+        if(m_xfFill >= m_xfTarget){
+            m_xfMixCycles += ESP.getCycleCount() - t0;
+            if(!writeFrame(&m_xfBuff[2 * m_xfRead], true)) return false;
+            if(++m_xfRead == m_xfSize) m_xfRead = 0;
+            m_xfFill--;
+            t0 = ESP.getCycleCount();
+        }
+        w = m_xfRead + m_xfFill;
+        if(w >= m_xfSize) w -= m_xfSize;
+        m_xfBuff[2 * w]     = sample[LEFTCHANNEL];
+        m_xfBuff[2 * w + 1] = sample[RIGHTCHANNEL];
+        m_xfFill++;
+        if(m_xfFill < m_xfTarget && writeFrame(&m_xfBuff[2 * m_xfRead], false)){
+            if(++m_xfRead == m_xfSize) m_xfRead = 0;
+            m_xfFill--;
+        }
+        m_xfMixCycles += ESP.getCycleCount() - t0;
+        m_xfFrames++;
+        return true;
+    }
+    if(m_xfState == XF_FADEIN && !m_xfLen){                 // after a rate change, the length at the new rate
+        m_xfLen = (uint32_t)m_xfMs * m_i2sRate / 4000;
+        if(!m_xfLen) m_xfLen = 1;
+        m_xfPhase = 0;
+        m_xfStep = (256u << 16) / m_xfLen;
+    }
+    int32_t gIn = xfadeGain(m_xfSin, m_xfPhase);
+    if(m_xfState == XF_MIX){
+        int32_t gOut = xfadeGain(m_xfSin, (256u << 16) - m_xfPhase);
+        a = &m_xfBuff[2 * m_xfRead];
+        out[LEFTCHANNEL]  = xfadeMix(a[LEFTCHANNEL],  gOut, sample[LEFTCHANNEL],  gIn);
+        out[RIGHTCHANNEL] = xfadeMix(a[RIGHTCHANNEL], gOut, sample[RIGHTCHANNEL], gIn);
+    }
+    else{
+        out[LEFTCHANNEL]  = xfadeMix(0, 0, sample[LEFTCHANNEL],  gIn);
+        out[RIGHTCHANNEL] = xfadeMix(0, 0, sample[RIGHTCHANNEL], gIn);
+    }
+    m_xfMixCycles += ESP.getCycleCount() - t0;
+    if(!writeFrame(out, true)) return false;
+    m_xfPhase += m_xfStep;
+    m_xfFrames++;
+    if(m_xfState == XF_MIX){
+        if(++m_xfRead == m_xfSize) m_xfRead = 0;
+        if(--m_xfFill == 0) xfadeDone();
+    }
+    else if(--m_xfLen == 0) xfadeDone();
     return true;
 }
 //---------------------------------------------------------------------------------------------------------------------
+void Audio::xfadeFlush(bool fade){
+    // play the held back frames now, with fade = true the last ms / 4 of them fade out and the next file fades in
+    uint32_t n = fade ? (uint32_t)m_xfMs * m_i2sRate / 4000 : 0;
+    uint32_t step = 0;
+    xfade_t out[2];
+
+    if(n > m_xfFill) n = m_xfFill;
+    if(n) step = (256u << 16) / n;
+    while(m_xfFill){
+        xfade_t *a = &m_xfBuff[2 * m_xfRead];
+        if(m_xfFill <= n){
+            int32_t g = xfadeGain(m_xfSin, (256u << 16) - (n - m_xfFill) * step); // cos, 1 ... 0
+            out[LEFTCHANNEL]  = xfadeMix(a[LEFTCHANNEL],  g, 0, 0);
+            out[RIGHTCHANNEL] = xfadeMix(a[RIGHTCHANNEL], g, 0, 0);
+            a = out;
+        }
+        while(!writeFrame(a, true)){;}
+        if(++m_xfRead == m_xfSize) m_xfRead = 0;
+        m_xfFill--;
+    }
+    if(fade){
+        if(audio_info) audio_info("Crossfade: sample rate changes, fade out and in");
+        m_xfState = XF_FADEIN;
+        m_xfLen = 0;                                        // set with the first frame of the next file
+    }
+    else m_xfState = XF_OFF;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::xfadeDone(){
+    // report the CPU budget of the window: decoder and mixing per second of audio, the I2S wait not counted
+    uint32_t rate = m_i2sRate ? m_i2sRate : 44100;
+    uint64_t cpu  = (uint64_t)m_xfFrames * ESP.getCpuFreqMHz() * 1000;   // cycles of the window / 1000
+    if(cpu){
+        uint32_t dec = (uint64_t)m_xfDecCycles * rate / cpu;               // per mille
+        uint32_t mix = (uint64_t)m_xfMixCycles * rate / cpu;
+        sprintf(chbuf, "Crossfade: %u ms, %u ms of audio, decoder %u.%u%% + crossfade %u.%u%% of the CPU",
+                m_xfState == XF_MIX ? m_xfLen * 1000 / rate : m_xfMs / 4, m_xfFrames * 1000 / rate,
+                dec / 10, dec % 10, mix / 10, mix % 10);
+        if(audio_info) audio_info(chbuf);
+    }
+    m_xfState = XF_OFF;
+    if(m_f_nextFile) xfadeStart();                          // queued while the fade was running
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::xfadeDrop(){
+    // forget the held back frames (seek), a fill in progress starts over
+    m_xfRead = 0;
+    m_xfFill = 0;
+    if(m_xfState != XF_FILL) m_xfState = XF_OFF;
+}
+//---------------------------------------------------------------------------------------------------------------------
 void Audio::setVolume(uint8_t vol){ // vol 22 steps, 0...21
     if(vol>21) vol=21;
     m_vol=volumetable[vol];
@@ -2140,6 +3324,54 @@ int16_t Audio::Gain(int16_t s) {
     v= (s * m_vol)>>6;
     return (int16_t)(v&0xffff);
 }
+#ifdef I2S_32BIT
+int32_t Audio::Gain32(int32_t s) { // Q28 in, the guard bits keep overshoots until after the volume
+    int32_t v;
+    v = (int32_t)(((int64_t)s * m_vol) >> 6);
+    if(v >  0x0FFFFFFF) v =  0x0FFFFFFF; // clip to full scale and left-justify, the FPGA takes the upper 24 bits
+    if(v < -0x10000000) v = -0x10000000;
+    return v << 3;
+}
+#endif
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t Audio::getStartLatency(){
+    return m_f_webstream ? m_jitter.startLatency() : 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+uint16_t Audio::getUnderruns(){
+    return m_jitter.underruns();
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool Audio::startRecording(fs::FS &fs, const char *dir){
+    if(!RecStart(fs, dir)){
+        if(audio_info) audio_info("recorder: no memory or the card hangs");
+        return false;
+    }
+    recordSplit(m_st_remember.length() ? m_st_remember.c_str() : m_icyname.c_str());
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::stopRecording(){
+    if(!RecActive()) return;
+    RecStop();
+    recordReport();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::recordSplit(const char *title){
+    // the file so far is closed behind the bytes recorded until now, the stream goes on in a new one
+    RecStats_t rs;
+    RecGetStats(&rs);
+    if(rs.files) recordReport();                                // statistics up to here
+    RecSplit(title, m_codec == CODEC_AAC ? "aac" : "mp3");
+}
+//---------------------------------------------------------------------------------------------------------------------
+void Audio::recordReport(){
+    RecStats_t rs;
+    RecGetStats(&rs);
+    sprintf(chbuf, "recorder: %u files, %u KB, card %u KB/s busy %u%%, longest write %u ms, longest tee %u us, %u bytes dropped",
+            rs.files, rs.bytes / 1024, rs.writeKBps, rs.cardLoad, rs.maxWriteUs / 1000, rs.maxTeeUs, rs.dropped);
+    if(audio_info) audio_info(chbuf);
+}
 //---------------------------------------------------------------------------------------------------------------------
 uint32_t Audio::inBufferFilled(){
     return InBuff.bufferFilled();
@@ -15,10 +15,13 @@
 #include "FS.h"
 #include "WiFiClientSecure.h"
 #include "driver/i2s.h"
+#include "config.h"                 // I2S_32BIT
+#include "http_parser.h"
 
 extern __attribute__((weak)) void audio_info(const char*);
 extern __attribute__((weak)) void audio_id3data(const char*); //ID3 metadata
 extern __attribute__((weak)) void audio_eof_mp3(const char*); //end of mp3 file
+extern __attribute__((weak)) void audio_preroll(const char*); //file read completely, the next one can be queued (connecttoFSNext)
 extern __attribute__((weak)) void audio_showstreamtitle(const char*);
 extern __attribute__((weak)) void audio_showstation(const char*);
 extern __attribute__((weak)) void audio_showstreaminfo(const char*);
@@ -37,6 +40,14 @@ extern __attribute__((weak)) void audio_eof_stream(const char*); // The webstrea
 #define AUDIO_PLAYLISTDATA   64
 #define AUDIO_SWM           128
 
+//#define AUDIO_DECODE_PROFILE  /* sendBytes() prints the decoder CPU load every 10 s of audio and where the hot memory is, one placement per build */
+
+#ifdef I2S_32BIT
+typedef int32_t xfade_t;        // samples of the crossfade ring, Q28 like m_outBuff32
+#else
+typedef int16_t xfade_t;
+#endif
+
 //----------------------------------------------------------------------------------------------------------------------
 
 class AudioBuffer{
@@ -97,6 +108,79 @@ protected:
 };
 //----------------------------------------------------------------------------------------------------------------------
 
+class MP3FrameIndex{
+// sparse frame number -> file position table of a mp3 file, filled while the file plays (see Audio::scanMP3Frames)
+// entry i holds the position of frame i * interval, so a lookup is a single division. If the table is full
+// every second entry is dropped and the interval doubles, a file of any length fits in m_maxEntries
+//
+//     frame:   0        16       32       48             (interval 16, ~0.4s at 44.1kHz)
+//              ▼        ▼        ▼        ▼
+// ---------------------------------------------------------------------------------------------------------------
+// |ID3 tag|  frame  |  frame  |  ...  |  frame  |  ...  |  frame  |  ...
+// ---------------------------------------------------------------------------------------------------------------
+
+public:
+    void     reset();                                   // remove all entries
+    void     add(uint32_t frame, uint32_t pos);         // frames must be added in ascending order, gapless
+    bool     lookup(uint32_t frame, uint32_t *idxFrame, uint32_t *pos); // nearest entry at or before frame
+    uint16_t entries(){return m_count;}
+
+protected:
+    static const uint16_t m_maxEntries = 512;
+    uint32_t     m_pos[m_maxEntries];
+    uint16_t     m_count         = 0;
+    uint8_t      m_shift         = 4;  // interval = 1 << m_shift frames
+};
+//----------------------------------------------------------------------------------------------------------------------
+
+class JitterBuffer{
+// start and resume watermark of the input buffer of a web stream, from the way the data arrives
+//
+// every read that returns data is an arrival, the gaps between arrivals are averaged like a TCP round trip time
+// (mean and mean deviation, RFC 6298) and the longest recent gap is held, it halves every 10 s. The input buffer
+// has to bridge such a gap: watermark = 1600 + byte rate * (peak gap + 4 * deviation, at least the floor), the
+// 1600 bytes (one mp3 frame) stay in the buffer for the decoder. The floor starts at m_minMs, with PSRAM at
+// m_minMsLarge, every underrun raises it by half, a minute without underrun lowers it by a quarter. Below the
+// watermark playback is stretched, so a fast start builds up its cushion while it plays
+//
+//     fill:  0         1600     start/resume = watermark                                 m_buffSize
+//            |<-decoder->|<-------- stretch -------->|                         |<-drop silence->|
+//            ▼           ▼                           ▼                         ▼                ▼
+// ---------------------------------------------------------------------------------------------------------------
+
+public:
+    void     reset(uint32_t now, bool large);           // new connection, the start latency is measured from now,
+                                                        // large: the input buffer is in PSRAM
+    void     arrival(uint32_t bytes, uint32_t now);     // bytes read, 0 = not waiting (input buffer full)
+    void     underrun(uint32_t now);                    // the decoder ran dry while playing
+    void     started(uint32_t now);                     // playback (re)starts
+    uint32_t target(uint32_t byteRate, uint32_t limit); // watermark in bytes, byteRate 0 = measured rate
+    uint32_t startLatency(){return m_latency;}
+    uint16_t underruns(){return m_underruns;}
+    uint32_t jitterMs(){return m_peak + m_dev / 4;}        // peak gap + 4 * deviation (1/16 ms)
+
+protected:
+    static const uint16_t m_minMs     = 250;            // floor of the watermark on a good link
+    static const uint16_t m_minMsLarge = 2000;          // the same with PSRAM, there is room for a cushion
+    static const uint16_t m_maxMs     = 10000;
+    static const uint16_t m_reserve   = 1600;           // the decoder is called with more than this only
+    uint32_t     m_t0            = 0;                   // reset()
+    uint32_t     m_last          = 0;                   // last arrival
+    uint32_t     m_mean          = 0;                   // gap between arrivals, ms
+    uint32_t     m_dev           = 0;                   // mean deviation of the gap, ms
+    uint32_t     m_peak          = 0;                   // longest recent gap, ms
+    uint32_t     m_peakTime      = 0;
+    uint32_t     m_minFloor      = m_minMs;             // m_minMs or m_minMsLarge
+    uint32_t     m_floor         = m_minMs;             // lower bound of the watermark, ms
+    uint32_t     m_floorTime     = 0;                   // last change of m_floor
+    uint32_t     m_rate          = 0;                   // measured bytes per second
+    uint32_t     m_rateBytes     = 0;
+    uint32_t     m_rateTime      = 0;
+    uint32_t     m_latency       = 0;                   // ms from reset() to the first start, 0 while buffering
+    uint16_t     m_underruns     = 0;
+};
+//----------------------------------------------------------------------------------------------------------------------
+
 class Audio : private AudioBuffer{
 
     AudioBuffer InBuff; // instance of input buffer
@@ -106,6 +190,35 @@ public:
     ~Audio();
     bool connecttoFS(fs::FS &fs, String file);
     bool connecttoSD(String sdfile);
+    /**
+     * @brief connecttoFSNext queues a file that follows the current one without a gap
+     *
+     * The file is opened at once, at the end of the current file its headers are read and the decoder
+     * continues with it, I2S is not flushed. audio_eof_mp3() is called as usual, isRunning() is true then.
+     * Call it from audio_preroll(), before that the current file is still being read.
+     * @return true if a local file is playing and the next one could be opened
+     */
+    bool connecttoFSNext(fs::FS &fs, String file);
+    /**
+     * @brief setCrossfade overlaps the end of a file with the start of the one queued by connecttoFSNext()
+     *
+     * The last ms of the current file are held back in a ring buffer (PSRAM if found) and mixed with
+     * equal power into the start of the next file. If the I2S rate changes (sample rates differ and no
+     * setResampler()) both are faded in ms / 4.
+     * @param[in] ms crossfade length, 0 = gapless only, the buffer is sized for 48 kHz
+     * @return true if the ring buffer could be allocated
+     */
+    bool setCrossfade(uint16_t ms);
+    /**
+     * @brief setResampler converts every file to one output rate, I2S and the FPGA crossover are not reprogrammed
+     *
+     * Polyphase FIR, rational ratios with at most 6 output frames per input frame, a file whose rate can not
+     * be converted plays at its own rate. The coefficients (up to 80 KB) are computed when the rate changes.
+     * @param[in] outRate I2S rate, e.g. 48000, 0 = off
+     * @param[in] quality SRC_LOW (24 taps), SRC_MEDIUM (48 taps) or SRC_HIGH (64 taps), see resampler.h
+     * @return true if the current file (if any) is converted or already at outRate
+     */
+    bool setResampler(uint32_t outRate, uint8_t quality);
     bool connecttohost(String host);
     bool connecttospeech(String speech, String lang);
     void loop();
@@ -134,9 +247,27 @@ public:
      * @param[in] speed
      *      speed > 0 : fast-forward
      *      speed < 0 : fast-rewind
+     *      mp3 files are seeked by speed seconds to a frame boundary, other files by 320 * speed bytes
      * @return true if audio file active and speed is valid, otherwise false
      */
     bool audioFileSeek(const int8_t speed);
+    /**
+     * @brief setAudioPlayPosition jumps to a position of the current mp3 file
+     *
+     * @param[in] sec playtime in seconds
+     * @return true if a mp3 file is active and the position is inside the file
+     */
+    bool setAudioPlayPosition(uint16_t sec);
+    /**
+     * @brief setMP3PreScan reads all frame headers of a mp3 file before it starts
+     *
+     * Only for files without a frame count in a Xing/Info or VBRI tag. connecttoFS() returns after the
+     * whole file has been scanned, getAudioFileDuration() is exact from the start and every position can
+     * be seeked by the index. Off (default), and for files queued by connecttoFSNext(): the scan runs in
+     * the background while the file plays.
+     * @param[in] on
+     */
+    void setMP3PreScan(bool on);
     bool setPinout(uint8_t BCLK, uint8_t LRC, uint8_t DOUT, int8_t DIN=I2S_PIN_NO_CHANGE);
     void stopSong();
     /**
@@ -152,15 +283,72 @@ public:
     inline void setDatamode(uint8_t dm){m_datamode=dm;}
     inline uint32_t streamavail() {if(m_f_ssl==false) return client.available(); else return clientsecure.available();}
     bool isRunning() {return m_f_running;}
+    /**
+     * @brief getStartLatency time from connecttohost() until the web stream started to play
+     *
+     * The stream starts as soon as the input buffer holds the watermark of the jitter buffer, 250 ms of audio
+     * on a good link, more if the data arrives in bursts.
+     * @return ms, 0 while the first buffering is going on or if no web stream is active
+     */
+    uint32_t getStartLatency();
+    /**
+     * @brief getUnderruns counts how often the input buffer of the current web stream ran dry while playing
+     *
+     * After an underrun playback resumes at a raised watermark.
+     * @return number of underruns since connecttohost()
+     */
+    uint16_t getUnderruns();
+    /**
+     * @brief setCrossoverLoaded marks the FPGA crossover coefficients of a rate as loaded, for a boot that loads them
+     * in parallel with the rest of setup()
+     *
+     * A file at this rate starts without muting the amplifiers and reloading the coefficients.
+     * @param[in] sampRate rate biquad_loadCoeffs_LR() was called with
+     */
+    void setCrossoverLoaded(uint32_t sampRate);
+    /**
+     * @brief getFirstSampleTime time of the first frame written to I2S since reset
+     *
+     * @return millis() of the first frame, 0 before
+     */
+    uint32_t getFirstSampleTime();
+    /**
+     * @brief startRecording tees the web stream into files, one per StreamTitle, "001 Artist - Title.mp3"
+     *
+     * The compressed audio is stored as received, without ICY metadata. A task on core 0 writes it to the card,
+     * a card that can not keep up loses data but never stalls the playback. Throughput and the time added to
+     * loop() are reported by audio_info() at each new file, see recorder.h.
+     * @param[in] fs  SD, SD_MMC ...
+     * @param[in] dir directory, created if it does not exist
+     * @return false if the 16 KB of buffers could not be allocated
+     */
+    bool startRecording(fs::FS &fs, const char *dir);
+    void stopRecording();
     uint32_t inBufferFilled(); // returns the number of stored bytes in the inputbuffer
     uint32_t inBufferFree();   // returns the number of free bytes in the inputbuffer
 
 private:
     void reset(); // free buffers and set defaults
+    void utf8toASCII(char *dst, String file);
+    bool openLocalFile(fs::FS &fs);
+    bool nextLocalFile();
     void processLocalFile();
     void processWebStream();
+    void processConnection();
+    void playWebBuffer();
+    void netStart();
+    void netRetry(const char *why);
+    void netReconnect(const char *why);
+    void recordSplit(const char *title);
+    void recordReport();
     int  sendBytes(uint8_t *data, size_t len);
-    void compute_audioCurrentTime(int bd);
+    void compute_audioCurrentTime();
+    void trimGapless();
+    void jitterStretch();
+    void setCrossoverRate(uint32_t sampRate);
+    void initMP3Scan(fs::FS &fs);
+    void scanMP3Frames();
+    bool seekMP3Frame(uint32_t frame);
     void printDecodeError(int r);
     void readID3Metadata();
     bool setSampleRate(uint32_t hz);
@@ -170,10 +358,30 @@ private:
     bool playSample(int16_t sample[2]) ;
     bool playI2Sremains();
     int16_t Gain(int16_t s);
+#ifdef I2S_32BIT
+    bool playSample32(int32_t sample[2]);
+    int32_t Gain32(int32_t s);
+#endif
+    bool srcSample(int32_t sample[2]);
+    bool srcFrame(int32_t sample[2]);
+    bool writeFrame(xfade_t sample[2], bool wait);
+    bool xfadeSample(xfade_t sample[2]);
+    void xfadeStart();
+    void xfadeFlush(bool fade);
+    void xfadeDone();
+    void xfadeDrop();
     bool fill_InputBuf();
     void showstreamtitle(const char *ml, bool full);
     bool chkhdrline(const char* str);
-    void handlebyte(uint8_t b);
+    uint32_t webAvailable();
+    void webConsume(uint32_t n);
+    int  webRead(uint8_t *buf, uint32_t len);
+    uint32_t dechunk(uint8_t *buf, uint32_t len);
+    uint32_t parseText(const uint8_t *buf, uint32_t len);
+    void parseHeaderLine(char *line);
+    void parseMetadata(char *meta, uint16_t len);
+    void parsePlaylistHeader(char *line);
+    void parsePlaylistData(char *line);
     esp_err_t I2Sstart(uint8_t i2s_num);
     esp_err_t I2Sstop(uint8_t i2s_num);
     char* lltoa(long long val, int base);
@@ -185,6 +393,10 @@ private:
     enum : int { EXTERNAL_I2S = 0, INTERNAL_DAC = 1, INTERNAL_PDM = 2 };
     enum : int { CODEC_NONE = 0, CODEC_WAV = 1, CODEC_MP3 = 2, CODEC_AAC = 4, CODEC_FLAC = 5};
     typedef enum { LEFTCHANNEL=0, RIGHTCHANNEL=1 } SampleIndex;
+    enum : uint8_t { XF_OFF = 0, XF_FILL = 1, XF_MIX = 2, XF_FADEIN = 3 }; // crossfade state
+    enum : uint8_t { NET_IDLE = 0, NET_DNS = 1, NET_CONNECT = 2, NET_UP = 3, NET_BACKOFF = 4 }; // connection state
+    enum : uint16_t { NET_TIMEOUT = 5000, NET_STALL = 8000, NET_BACKOFF_MAX = 30000 };       // ms
+    enum : uint8_t { NET_MAX_TRIES = 4 };                   // a stream that never played gives up
 
     const uint8_t volumetable[22]={   0,  1,  2,  3,  4 , 6 , 8, 10, 12, 14, 17,
                                      20, 23, 27, 30 ,34, 38, 43 ,48, 52, 58, 64}; //22 elements
@@ -192,19 +404,23 @@ private:
 
 
     File              audiofile;    // @suppress("Abstract class cannot be instantiated")
+    File              m_scanfile;   // second handle of audiofile, used by the mp3 frame scanner
+    File              m_nextfile;   // queued by connecttoFSNext(), follows audiofile without a gap
+    fs::FS*           m_nextFS=NULL;
+    MP3FrameIndex     m_frameIndex; // frame -> file position of the current mp3 file
+    JitterBuffer      m_jitter;     // watermarks of the input buffer of a web stream
     WiFiClient        client;       // @suppress("Abstract class cannot be instantiated")
     WiFiClientSecure  clientsecure; // @suppress("Abstract class cannot be instantiated")
     i2s_config_t      m_i2s_config; // stores values for I2S driver
     char            chbuf[256];
     char            path[256];
+    char            m_nextPath[256];                // path of m_nextfile
     int             m_id3Size=0;                    // length id3 tag
-    int             m_LFcount;                      // Detection of end of header
     uint32_t        m_sampleRate=16000;
     int             m_bytesLeft=0;
     uint32_t        m_bitRate=0;                    // current bitrate given fom decoder
     uint32_t        m_avr_bitrate;                  // average bitrate, median computed by VBR
     int             m_readbytes=0;                  // bytes read
-    int             m_metalen=0;                    // Number of bytes in metadata
     int8_t          m_playlist_num = 0 ;            // Nonzero for selection from playlist
     uint8_t         m_rev=0;                        // revision
     uint8_t         m_BCLK=0;                       // Bit Clock
@@ -217,7 +433,14 @@ private:
     uint8_t         m_i2s_num= I2S_NUM_0;           // I2S_NUM_0 or I2S_NUM_1
     int16_t         m_buffValid;
     int16_t         m_lastFrameEnd;
-    int16_t         m_outBuff[2048*2];              //[1152 * 2];          // Interleaved L/R
+#ifdef I2S_32BIT
+    union {
+    int16_t         m_outBuff[2048*2] __attribute__((aligned(4))); // Interleaved L/R, aligned for 32-bit L/R stores
+    int32_t         m_outBuff32[2048*2];            // Interleaved L/R, Q28 (16 bit full scale = 1<<28), used if m_bitsPerSample is 24 or 32
+    };
+#else
+    int16_t         m_outBuff[2048*2] __attribute__((aligned(4))); // Interleaved L/R, aligned for 32-bit L/R stores
+#endif
     int16_t         m_validSamples = 0;
     int16_t         m_curSample;
     int16_t         m_Sample[2];
@@ -226,16 +449,21 @@ private:
     uint16_t        m_datamode=0;                   // Statemaschine
     uint32_t        m_metaint = 0;                  // Number of databytes between metadata
     uint32_t        m_totalcount = 0;               // Counter mp3 data
-    uint32_t        m_chunkcount = 0 ;              // Counter for chunked transfer
     uint32_t        m_t0;                           // store millis(), is needed for a small delay
     uint32_t        m_metaCount=0;                  // Bytecounter between metadata
     uint32_t        m_contentlength = 0;            // Stores the length if the stream comes from fileserver
     uint32_t        m_bytectr = 0;                  // count received data
     uint32_t        m_bytesNotDecoded=0;            // pictures or something else that comes with the stream
+    uint8_t         m_webBuf[1024];                 // read window of the client for header, metadata and chunk sizes
+    uint16_t        m_webPos=0;                     // next byte in m_webBuf
+    uint16_t        m_webLen=0;                     // bytes in m_webBuf
+    uint16_t        m_webRaw=0;                     // m_webBuf from here on still carries the chunk framing
+    uint16_t        m_playlistCnt=1;                // Counter to find right entry in playlist
+    HTTPParser_t    m_http;                         // header line or metadata block being collected
     String          m_audioName="";                 // the name of the file
+    String          m_nextName="";                  // the name of m_nextfile
     String          m_playlist ;                    // The URL of the specified playlist
     String          m_lastHost="";                  // Store the last URL to a webstream
-    String          m_metaline ;                    // Readable line in metadata
     String          m_icyname ;                     // Icecast station name
     String          m_st_remember="";               // Save the last streamtitle
     String          m_icyurl="";                    // Store ie icy-url if received
@@ -253,18 +481,75 @@ private:
     bool            m_f_chunked = false ;           // Station provides chunked transfer
     bool            m_f_filled;                     // outputBuffer
     bool            m_f_swm=false;
-    bool            m_f_firstmetabyte=false;        // True if first metabyte (counter)
     bool            m_f_plsFile=false;              // Set if URL is known
     bool            m_f_plsTitle=false;             // Set if StationName is known
+    bool            m_f_asxEntry=false;             // <entry> seen in the asx playlist
     bool            m_ctseen=false;                 // First line of header seen or not
     bool            m_f_stream=false;               // Set false if stream is lost
+    uint32_t        m_jbTarget=0;                   // watermark of m_jitter for the current fill, bytes
+    int             m_jbOwed=0;                     // frames jitterStretch() owes, < 0 stretched in ahead
+    String          m_netHost;                      // host of the current connection, without port and extension
+    String          m_netRequest;                   // GET request, sent again by a reconnect
+    uint16_t        m_netPort=80;
+    uint8_t         m_netState=NET_IDLE;            // see processConnection()
+    uint8_t         m_netTries=0;                   // failed tries in a row
+    int             m_netFd=-1;                     // socket while the TCP connect is in progress
+    uint32_t        m_netTime=0;                    // millis() when the state was entered
+    uint32_t        m_netBackoff=0;                 // ms to wait in NET_BACKOFF
+    uint32_t        m_netLastData=0;                // millis() of the last byte from the server
+    bool            m_f_netPlayed=false;            // the server has answered once, reconnect without limit
     uint8_t         m_codec = CODEC_NONE;           //
     bool            m_f_playing = false;            // valid mp3 stream recognized
     bool            m_f_webfile= false;             // assume it's a radiostream, not a podcast
     bool            m_f_psram = false;              // set if PSRAM is availabe
     size_t          m_i2s_bytesWritten=0;           // set in i2s_write() but not used
+    uint32_t        m_audioDataStart=0;             // file position of the first mp3 frame
+    uint32_t        m_scanPos=0;                    // next frame header to be read by scanMP3Frames()
+    uint32_t        m_scanFrames=0;                 // frames found by scanMP3Frames()
+    uint32_t        m_scanMicros=0;                 // time spent in scanMP3Frames()
+    bool            m_f_scanComplete=false;         // m_scanFrames is the number of frames in the file
+    bool            m_f_vbrTag=false;               // first frame holds a Xing/Info or VBRI tag
+    bool            m_f_preScan=false;              // scan the frame headers in initMP3Scan(), see setMP3PreScan()
+    uint32_t        m_frameSamprate=0;              // sample rate and samples per frame from the first mp3 frame
+    uint16_t        m_frameSamples=0;
+    uint32_t        m_vbrFrames=0;                  // from Xing/Info/VBRI tag, 0 if not present
+    uint32_t        m_vbrBytes=0;
+    uint8_t         m_vbrToc[100];                  // Xing table of contents, valid if m_f_vbrToc
+    bool            m_f_vbrToc=false;
     uint32_t        m_audioFileDuration=0;
     float           m_audioCurrentTime=0;
+    uint32_t        m_samplesDecoded=0;             // samples per channel since the start of the file
+    bool            m_f_nextFile=false;             // m_nextfile is queued
+    bool            m_f_preroll=false;              // audio_preroll() has been called for the current file
+    bool            m_f_encDelay=false;             // encoder delay and padding known (iTunSMPB or LAME tag)
+    uint16_t        m_encDelay=0;                   // samples added by the mp3 encoder at the start
+    uint16_t        m_encPadding=0;                 // samples added by the mp3 encoder at the end
+    uint32_t        m_encSamples=0;                 // length without delay and padding, from iTunSMPB, 0 if unknown
+    uint32_t        m_trimStart=0;                  // first decoded sample (m_samplesDecoded) that is played
+    uint32_t        m_trimEnd=0;                    // first decoded sample behind the end of the track, 0 if unknown
+    uint32_t        m_crossoverRate=0;              // sample rate the FPGA crossover coefficients are loaded for
+    uint32_t        m_firstSample=0;                // millis() of the first frame written to I2S, 0 before
+    xfade_t*        m_xfBuff=NULL;                  // crossfade ring, stereo frames of the outgoing file
+    uint32_t        m_xfSize=0;                     // capacity in frames
+    uint32_t        m_xfRead=0;                     // oldest frame
+    uint32_t        m_xfFill=0;                     // frames in the ring
+    uint32_t        m_xfTarget=0;                   // frames to hold back, crossfade length at the current rate
+    uint32_t        m_xfLen=0;                      // length of the running fade in frames
+    uint32_t        m_xfPhase=0;                    // position in m_xfSin, 16.16
+    uint32_t        m_xfStep=0;
+    uint32_t        m_xfFrames=0;                   // frames through xfadeSample() since xfadeStart(), for the CPU budget
+    uint32_t        m_xfDecCycles=0;                // decoder cycles since xfadeStart()
+    uint32_t        m_xfMixCycles=0;                // ring and mix cycles since xfadeStart(), without the I2S wait
+    uint16_t        m_xfMs=0;                       // set by setCrossfade(), 0 = off
+    uint8_t         m_xfState=XF_OFF;
+    int16_t         m_xfSin[257];                   // sin(0...pi/2), Q15, fade in = sin, fade out = cos
+    uint32_t        m_i2sRate=16000;                // rate I2S is set to, m_srcRate or m_sampleRate
+    uint32_t        m_srcRate=0;                    // set by setResampler(), 0 = off
+    uint8_t         m_srcQuality=0;
+    bool            m_f_src=false;                  // the current file is resampled
+    uint8_t         m_srcN=0;                       // frames in m_srcOut
+    uint8_t         m_srcIdx=0;                     // next frame of m_srcOut to write
+    int32_t         m_srcOut[2 * 6];                // resampler output of one input frame, SRC_MAX_OUT stereo frames
 };
 
 #endif /* AUDIO_H_ */
@@ -7,6 +7,7 @@
  ************************************************************************************/
 
 #include "aac_decoder.h"
+#include "mem_place.h"
 
 const uint32_t SQRTHALF            = 0x5a82799a;    /* sqrt(0.5), format = Q31 */
 const uint32_t Q28_2               = 0x20000000;    /* Q28: 2.0 */
@@ -34,10 +35,12 @@ const uint8_t  MAX_NCHANS_ELEM     = 2;             /* max number of channels in
 const uint8_t  MAX_NUM_PCE_ADIF    = 16;
 const uint8_t  ADIF_COPYID_SIZE    = 9;
 const uint8_t  HUFFTAB_SPEC_OFFSET = 1;
+const uint8_t  HUFFLUT_ROOT_BITS   = 7;             /* bits indexing the first level of the spectral Huffman lookup tables */
 const uint8_t  FBITS_OUT_DQ_OFF    = 20 - 15;       /* (FBITS_OUT_DQ - SF_DQ_OFFSET) number of fraction bits out of dequant, including 2^15 bias */
 const uint8_t  GBITS_IN_DCT4       = 4;                                      /* min guard bits in for DCT4 */
 const uint8_t  FBITS_LOST_DCT4     = 1;             /* number of fraction bits lost (>> out) in DCT-IV */
 const uint8_t  FBITS_OUT_IMDCT     = 3;
+const uint8_t  FBITS_OUT_PCM32     = 13;            /* fraction bits below the 16-bit LSB in the int32 output (Q28, 3 guard bits) */
 const uint8_t  NUM_IMDCT_SIZES     = 2;
 const uint8_t  FBITS_LPC_COEFS     = 20;
 const uint8_t  NUM_ITER_INVSQRT    = 4;
@@ -53,9 +56,23 @@ ADIFHeader_t            m_fhADIF;
 ProgConfigElement_t     *m_pce[16];
 PulseInfo_t             m_pulseInfo[2]; // [MAX_NCHANS_ELEM]
 aac_BitStreamInfo_t     m_aac_BitStreamInfo;
+uint16_t               *m_huffTabSpecLUT;           /* spectral Huffman lookup tables, built from huffTabSpecInfo */
+uint16_t                m_huffTabSpecLUTOffset[11]; /* start of the table for each codebook in m_huffTabSpecLUT */
+uint8_t                 m_stereoWinPending;         /* channel 0 of the current CPE is left for DecWindowOverlapStereo() */
 
 uint8_t m_fillBuf[269]; // [FILL_BUF_SIZE]
 uint16_t m_fillCount = 0;
+AACKernelStats_t        m_kernelStats;
+
+#ifdef AAC_KERNEL_PROFILE
+#define KERNEL_TIME_START()    uint32_t kt0 = ESP.getCycleCount(), kt1
+#define KERNEL_TIME_RESTART()  kt0 = ESP.getCycleCount()
+#define KERNEL_TIME(field)     {kt1 = ESP.getCycleCount(); m_kernelStats.field += kt1 - kt0; kt0 = kt1;}
+#else
+#define KERNEL_TIME_START()
+#define KERNEL_TIME_RESTART()
+#define KERNEL_TIME(field)
+#endif
 
 
 
@@ -94,6 +111,26 @@ inline short CLIPTOSHORT(int x){
     return (short)x;
 }
 
+inline int CLIPTOQ28(int x, int fracBits){
+    int sign, shift;
+    /* x has fracBits fraction bits below the 16-bit LSB, clip to [-8.0, 8.0) and scale to Q28 */
+    shift = FBITS_OUT_PCM32 - fracBits;
+    sign = x >> 31;
+    if (sign != (x >> (31 - shift)))
+        x = sign ^ ((1 << (31 - shift)) - 1);
+    return x << shift;
+}
+
+/* PCM output of the window/overlap-add, x has fracBits fraction bits:
+ * rounded and clipped to 16 bit, or kept in Q28 with 3 guard bits for int32 output */
+inline void StorePCM(short *pcm, int x, int fracBits){
+    *pcm = CLIPTOSHORT((x + (1 << (fracBits - 1))) >> fracBits);
+}
+
+inline void StorePCM(int32_t *pcm, int x, int fracBits){
+    *pcm = CLIPTOQ28(x, fracBits);
+}
+
 const uint16_t nmdctTab[2]             PROGMEM = {128, 1024};
 const uint8_t  postSkip[2]             PROGMEM = {15, 1};
 const uint16_t nfftTab[2]              PROGMEM = {64, 512};
@@ -1181,6 +1218,25 @@ static const uint32_t invQuant4[16] PROGMEM = {
 static const int8_t sgnMask[3] = {0x02,  0x04,  0x08};
 static const int8_t negMask[3] = {~0x03, ~0x07, ~0x0f};
 
+/* the tables read for every sample or codeword, through pointers that MemTablesLoad() may redirect to DRAM */
+static const uint32_t *m_cos4sin4tab      = cos4sin4tab;
+static const uint32_t *m_sinWindow        = sinWindow;
+static const uint32_t *m_kbdWindow        = kbdWindow;
+static const uint32_t *m_twidTabOdd       = twidTabOdd;
+static const uint32_t *m_twidTabEven      = twidTabEven;
+static const int16_t  *m_huffTabSpec      = huffTabSpec;
+static const int16_t  *m_huffTabScaleFact = huffTabScaleFact;
+
+static const MemTable_t m_hotTables[] = {
+    {(const void**)&m_cos4sin4tab,      cos4sin4tab,      sizeof(cos4sin4tab),      "cos4sin4tab"},
+    {(const void**)&m_sinWindow,        sinWindow,        sizeof(sinWindow),        "sinWindow"},
+    {(const void**)&m_kbdWindow,        kbdWindow,        sizeof(kbdWindow),        "kbdWindow"},
+    {(const void**)&m_twidTabOdd,       twidTabOdd,       sizeof(twidTabOdd),       "twidTabOdd"},
+    {(const void**)&m_twidTabEven,      twidTabEven,      sizeof(twidTabEven),      "twidTabEven"},
+    {(const void**)&m_huffTabSpec,      huffTabSpec,      sizeof(huffTabSpec),      "huffTabSpec"},
+    {(const void**)&m_huffTabScaleFact, huffTabScaleFact, sizeof(huffTabScaleFact), "huffTabScaleFact"},
+};
+
 /***********************************************************************************************************************
  * Function:    AACDecoder_AllocateBuffers
  *
@@ -1194,11 +1250,13 @@ static const int8_t negMask[3] = {~0x03, ~0x07, ~0x0f};
  *
  **********************************************************************************************************************/
 bool AACDecoder_AllocateBuffers(void){
-    if(!m_AACDecInfo)      {m_AACDecInfo   = (AACDecInfo_t*)           malloc(sizeof(AACDecInfo_t));}
-    if(!m_PSInfoBase)      {m_PSInfoBase   = (PSInfoBase_t*)           malloc(sizeof(PSInfoBase_t));}
-    if(!m_pce[0])          {m_pce[0]       = (ProgConfigElement_t*)    malloc(sizeof(ProgConfigElement_t)*16);}
+    if(!m_AACDecInfo)      {m_AACDecInfo   = (AACDecInfo_t*)           MemAlloc(MEM_STATE, sizeof(AACDecInfo_t), "AACDecInfo");}
+    if(!m_PSInfoBase)      {m_PSInfoBase   = (PSInfoBase_t*)           MemAlloc(MEM_HOT, sizeof(PSInfoBase_t), "PSInfoBase");}
+    if(!m_pce[0])          {m_pce[0]       = (ProgConfigElement_t*)    MemAlloc(MEM_STATE, sizeof(ProgConfigElement_t)*16, "ProgConfigElement");}
+    if(!m_huffTabSpecLUT)  {m_huffTabSpecLUT = (uint16_t*)            MemAlloc(MEM_HOT, sizeof(uint16_t) * BuildHuffTabSpecLUT(NULL), "huffTabSpecLUT");
+                            if(m_huffTabSpecLUT) BuildHuffTabSpecLUT(m_huffTabSpecLUT);}
 
-    if(!m_AACDecInfo || !m_PSInfoBase) {
+    if(!m_AACDecInfo || !m_PSInfoBase || !m_huffTabSpecLUT) {
             log_e("not enough memory to allocate aacdecoder buffers");
             return false;
     }
@@ -1220,6 +1278,7 @@ bool AACDecoder_AllocateBuffers(void){
     m_AACDecInfo->adtsBlocksLeft = 0;
     m_AACDecInfo->tnsUsed = 0;
     m_AACDecInfo->pnsUsed = 0;
+    MemTablesLoad(m_hotTables, sizeof(m_hotTables) / sizeof(m_hotTables[0]));
 
     return true;
 }
@@ -1240,9 +1299,11 @@ void AACDecoder_FreeBuffers(void){
 
 //    uint32_t i = ESP.getFreeHeap();
 
-    if(m_AACDecInfo)                         {free(m_AACDecInfo);    m_AACDecInfo=NULL;}
-    if(m_PSInfoBase)                         {free(m_PSInfoBase);    m_PSInfoBase=NULL;}
-    if(m_pce[0])     {for(int i=0; i<16; i++) free(m_pce[i]);        m_pce[0]=NULL;}
+    if(m_AACDecInfo)                         {MemFree(m_AACDecInfo);    m_AACDecInfo=NULL;}
+    if(m_PSInfoBase)                         {MemFree(m_PSInfoBase);    m_PSInfoBase=NULL;}
+    if(m_pce[0])     {for(int i=0; i<16; i++) MemFree(m_pce[i]);        m_pce[0]=NULL;}
+    if(m_huffTabSpecLUT)                     {MemFree(m_huffTabSpecLUT); m_huffTabSpecLUT=NULL;}
+    MemTablesFree(m_hotTables, sizeof(m_hotTables) / sizeof(m_hotTables[0]));
 
 //    log_i("AACDecoder: %lu bytes memory was freed", ESP.getFreeHeap() - i);
 }
@@ -1306,6 +1367,7 @@ int AACGetChannels(){return m_AACDecInfo->nChans;}
 int AACGetBitsPerSample(){return 16;}
 int AACGetBitrate() {return m_AACDecInfo->bitRate;}
 int AACGetOutputSamps(){return m_AACDecInfo->nChans * AAC_MAX_NSAMPS;}
+AACKernelStats_t *AACGetKernelStats(){return &m_kernelStats;}
 
 /***********************************************************************************************************************
  * Function:    AACDecode
@@ -1328,6 +1390,37 @@ int AACGetOutputSamps(){return m_AACDecInfo->nChans * AAC_MAX_NSAMPS;}
  *                just call AACDecode again with more data in inbuf
  **********************************************************************************************************************/
 int AACDecode(uint8_t *inbuf, int *bytesLeft, short *outbuf)
+{
+    return AACDecodeFrame(inbuf, bytesLeft, outbuf);
+}
+
+/***********************************************************************************************************************
+ * Function:    AACDecode32
+ *
+ * Description: decode AAC frame to int32 PCM
+ *
+ * Inputs:      as AACDecode(), outbuf holds int32_t samples
+ *
+ * Outputs:     Q28 PCM data in outbuf (1.0 = 16-bit full scale, 3 guard bits), interleaved LRLRLR... if stereo
+ *              updated inbuf pointer, updated bytesLeft
+ *
+ * Return:      0 if successful, error code (< 0) if error
+ *
+ * Notes:       window/overlap-add saturates to 32 bit instead of rounding and clipping to 16 bit, so the
+ *                output carries the FBITS_OUT_IMDCT extra bits of the filterbank
+ **********************************************************************************************************************/
+int AACDecode32(uint8_t *inbuf, int *bytesLeft, int32_t *outbuf)
+{
+    return AACDecodeFrame(inbuf, bytesLeft, outbuf);
+}
+
+/***********************************************************************************************************************
+ * Function:    AACDecodeFrame
+ *
+ * Description: body of AACDecode() and AACDecode32(), pcm_t is short or int32_t
+ **********************************************************************************************************************/
+template <typename pcm_t>
+int AACDecodeFrame(uint8_t *inbuf, int *bytesLeft, pcm_t *outbuf)
 {
     int err, offset, bitOffset, bitsAvail;
     int ch, baseChan, elementChans;
@@ -1407,7 +1500,9 @@ int AACDecode(uint8_t *inbuf, int *bytesLeft, short *outbuf)
 
         /* noiseless decoder and dequantizer */
         for (ch = 0; ch < elementChans; ch++) {
+            KERNEL_TIME_START();
             err = DecodeNoiselessData(&inptr, &bitOffset, &bitsAvail, ch);
+            KERNEL_TIME(noiseless);
 
             if (err)
                 return err;
@@ -1418,12 +1513,15 @@ int AACDecode(uint8_t *inbuf, int *bytesLeft, short *outbuf)
 
         /* mid-side and intensity stereo */
         if (m_AACDecInfo->currBlockID == AAC_ID_CPE) {
+            KERNEL_TIME_START();
             if (StereoProcess())
                 return ERR_AAC_STEREO_PROCESS;
+            KERNEL_TIME(stereo);
         }
 
         /* PNS, TNS, inverse transform */
         for (ch = 0; ch < elementChans; ch++) {
+            KERNEL_TIME_START();
 
             if (PNS(ch))
                 return ERR_AAC_PNS;
@@ -1437,6 +1535,7 @@ int AACDecode(uint8_t *inbuf, int *bytesLeft, short *outbuf)
 
             if (TNSFilter(ch))
                 return ERR_AAC_TNS;
+            KERNEL_TIME(pnsTns);
 
             if (IMDCT(ch, baseChan + ch, outbuf))
                 return ERR_AAC_IMDCT;
@@ -1456,6 +1555,9 @@ int AACDecode(uint8_t *inbuf, int *bytesLeft, short *outbuf)
 
     /* update pointers */
     m_AACDecInfo->frameCount++;
+#ifdef AAC_KERNEL_PROFILE
+    m_kernelStats.frames++;
+#endif
     *bytesLeft -= (inptr - inbuf);
     inbuf = inptr;
 
@@ -1514,7 +1616,7 @@ void DecodeLPCCoefs(int order, int res, int8_t *filtCoef, int *a, int *b)
  *              order of filter
  *              'size' transform coefficients
  *              'order' LPC coefficients in Q(FBITS_LPC_COEFS)
- *              scratch buffer for history (must be >= order samples long)
+ *              scratch buffer for history (must be >= 2*order samples long)
  *
  * Outputs:     filtered transform coefficients
  *
@@ -1523,19 +1625,24 @@ void DecodeLPCCoefs(int order, int res, int8_t *filtCoef, int *a, int *b)
  * Notes:       assumes no guard bits in input transform coefficients
  *              gains 0 int bits
  *              history buffer does not need to be preserved between regions
+ *              history is kept twice (hist[k] == hist[k+order]), so y[n-1] ... y[n-order] are always the
+ *                contiguous hist[h] ... hist[h+order-1] and nothing has to be shifted per sample
+ *              the 64-bit sum is exact, so the order of the multiply-adds does not change the result
  **********************************************************************************************************************/
 int FilterRegion(int size, int dir, int order, int *audioCoef, int *a, int *hist)
 {
-    int i, j, y, hi32, inc, gbMask;
+    int i, j, y, hi32, inc, gbMask, h;
+    int *x;
     U64 sum64;
 
     /* init history to 0 every time */
-    for (i = 0; i < order; i++)
+    for (i = 0; i < 2*order; i++)
         hist[i] = 0;
 
     sum64.w64 = 0;     /* avoid warning */
     gbMask = 0;
     inc = (dir ? -1 : 1);
+    h = 0;
     do {
         /* sum64 = a0*y[n] = 1.0*y[n] */
         y = *audioCoef;
@@ -1543,11 +1650,9 @@ int FilterRegion(int size, int dir, int order, int *audioCoef, int *a, int *hist
         sum64.r.lo32 = y << FBITS_LPC_COEFS;
 
         /* sum64 += (a1*y[n-1] + a2*y[n-2] + ... + a[order-1]*y[n-(order-1)]) */
-        for (j = order - 1; j > 0; j--) {
-            sum64.w64 = MADD64(sum64.w64, hist[j], a[j]);
-            hist[j] = hist[j-1];
-        }
-        sum64.w64 = MADD64(sum64.w64, hist[0], a[0]);
+        x = hist + h;
+        for (j = 0; j < order; j++)
+            sum64.w64 = MADD64(sum64.w64, x[j], a[j]);
         y = (sum64.r.hi32 << (32 - FBITS_LPC_COEFS)) | (sum64.r.lo32 >> FBITS_LPC_COEFS);
 
         /* clip output (rare) */
@@ -1555,7 +1660,9 @@ int FilterRegion(int size, int dir, int order, int *audioCoef, int *a, int *hist
         if ((hi32 >> 31) != (hi32 >> (FBITS_LPC_COEFS-1)))
             y = (hi32 >> 31) ^ 0x7fffffff;
 
-        hist[0] = y;
+        if (--h < 0)
+            h = order - 1;
+        hist[h] = hist[h + order] = y;
         *audioCoef = y;
         audioCoef += inc;
         gbMask |= FASTABS(y);
@@ -2000,7 +2107,7 @@ int DecodeNextElement(uint8_t **buf, int *bitOffset, int *bitsAvail)
  *              normalization by -1/N is rolled into tables here (see trigtabs.c)
  *              uses 3-mul, 3-add butterflies instead of 4-mul, 2-add
  **********************************************************************************************************************/
-void PreMultiply(int tabidx, int *zbuf1)
+AAC_KERNEL_IRAM void PreMultiply(int tabidx, int *zbuf1)
 {
     int i, nmdct, ar1, ai1, ar2, ai2, z1, z2;
     int t, cms2, cps2a, sin2a, cps2b, sin2b;
@@ -2009,7 +2116,7 @@ void PreMultiply(int tabidx, int *zbuf1)
 
     nmdct = nmdctTab[tabidx];
     zbuf2 = zbuf1 + nmdct - 1;
-    csptr = cos4sin4tab + cos4sin4tabOffset[tabidx];
+    csptr = m_cos4sin4tab + cos4sin4tabOffset[tabidx];
 
     /* whole thing should fit in registers - verify that compiler does this */
     for (i = nmdct >> 2; i != 0; i--) {
@@ -2060,7 +2167,7 @@ void PreMultiply(int tabidx, int *zbuf1)
  * Notes:       minimum 1 GB in, 2 GB out - gains 2 int bits
  *              uses 3-mul, 3-add butterflies instead of 4-mul, 2-add
  **********************************************************************************************************************/
-void PostMultiply(int tabidx, int *fft1)
+AAC_KERNEL_IRAM void PostMultiply(int tabidx, int *fft1)
 {
     int i, nmdct, ar1, ai1, ar2, ai2, skipFactor;
     int t, cms2, cps2, sin2;
@@ -2121,7 +2228,7 @@ void PostMultiply(int tabidx, int *fft1)
  *
  * Notes:       see notes on PreMultiply(), above
  **********************************************************************************************************************/
-void PreMultiplyRescale(int tabidx, int *zbuf1, int es)
+AAC_KERNEL_IRAM void PreMultiplyRescale(int tabidx, int *zbuf1, int es)
 {
     int i, nmdct, ar1, ai1, ar2, ai2, z1, z2;
     int t, cms2, cps2a, sin2a, cps2b, sin2b;
@@ -2130,7 +2237,7 @@ void PreMultiplyRescale(int tabidx, int *zbuf1, int es)
 
     nmdct = nmdctTab[tabidx];
     zbuf2 = zbuf1 + nmdct - 1;
-    csptr = cos4sin4tab + cos4sin4tabOffset[tabidx];
+    csptr = m_cos4sin4tab + cos4sin4tabOffset[tabidx];
 
     /* whole thing should fit in registers - verify that compiler does this */
     for (i = nmdct >> 2; i != 0; i--) {
@@ -2179,7 +2286,7 @@ void PreMultiplyRescale(int tabidx, int *zbuf1, int es)
  * Notes:       clips output to [-2^30, 2^30 - 1], guaranteeing at least 1 guard bit
  *              see notes on PostMultiply(), above
  **********************************************************************************************************************/
-void PostMultiplyRescale(int tabidx, int *fft1, int es)
+AAC_KERNEL_IRAM void PostMultiplyRescale(int tabidx, int *fft1, int es)
 {
     int i, nmdct, ar1, ai1, ar2, ai2, skipFactor, z;
     int t, cs2, sin2;
@@ -2253,21 +2360,31 @@ void PostMultiplyRescale(int tabidx, int *fft1, int es)
  *                 short blocks = (-5 + 4 + 2) = 1 total
  *                 long blocks =  (-8 + 7 + 2) = 1 total
  **********************************************************************************************************************/
-void DCT4(int tabidx, int *coef, int gb)
+AAC_KERNEL_IRAM void DCT4(int tabidx, int *coef, int gb)
 {
     int es;
+    KERNEL_TIME_START();
 
     /* fast in-place DCT-IV - adds guard bits if necessary */
     if (gb < GBITS_IN_DCT4) {
         es = GBITS_IN_DCT4 - gb;
         PreMultiplyRescale(tabidx, coef, es);
+        KERNEL_TIME(preMultiply);
         R4FFT(tabidx, coef);
+        KERNEL_TIME_RESTART();
         PostMultiplyRescale(tabidx, coef, es);
+        KERNEL_TIME(postMultiply);
     } else {
         PreMultiply(tabidx, coef);
+        KERNEL_TIME(preMultiply);
         R4FFT(tabidx, coef);
+        KERNEL_TIME_RESTART();
         PostMultiply(tabidx, coef);
+        KERNEL_TIME(postMultiply);
     }
+#ifdef AAC_KERNEL_PROFILE
+    m_kernelStats.calls++;
+#endif
 }
 
 /***********************************************************************************************************************
@@ -2282,7 +2399,7 @@ void DCT4(int tabidx, int *coef, int gb)
  *
  * Return:      none
  **********************************************************************************************************************/
-void BitReverse(int *inout, int tabidx)
+AAC_KERNEL_IRAM void BitReverse(int *inout, int tabidx)
 {
     int *part0, *part1;
     int a,b, t;
@@ -2331,7 +2448,7 @@ void BitReverse(int *inout, int tabidx)
  * Notes:       assumes 2 guard bits, gains no integer bits,
  *                guard bits out = guard bits in - 2
  **********************************************************************************************************************/
-void R4FirstPass(int *x, int bg)
+AAC_KERNEL_IRAM void R4FirstPass(int *x, int bg)
 {
     int ar, ai, br, bi, cr, ci, dr, di;
 
@@ -2377,7 +2494,7 @@ void R4FirstPass(int *x, int bg)
  *                or guard bits in - 2 (if inputs bounded to +/- sqrt(2)/2)
  *              see scaling comments in code
  **********************************************************************************************************************/
-void R8FirstPass(int *x, int bg)
+AAC_KERNEL_IRAM void R8FirstPass(int *x, int bg)
 {
     int ar, ai, br, bi, cr, ci, dr, di;
     int sr, si, tr, ti, ur, ui, vr, vi;
@@ -2463,6 +2580,89 @@ void R8FirstPass(int *x, int bg)
     }
 }
 
+/***********************************************************************************************************************
+ * Function:    R4Butterfly
+ *
+ * Description: one radix-4 butterfly of R4Core
+ *
+ * Inputs:      pointer to the first of the 4 complex samples
+ *              distance between the samples (in ints)
+ *              pointer to the 3 twiddle factors
+ *
+ * Outputs:     processed samples in same buffer
+ *
+ * Return:      none
+ *
+ * Notes:       see scaling comments in R4Core
+ **********************************************************************************************************************/
+static inline __attribute__((always_inline)) void R4Butterfly(int *xptr, int step, const int *wptr)
+{
+    int ar, ai, br, bi, cr, ci, dr, di, tr, ti;
+    int wd, ws, wi;
+
+    ar = xptr[0];
+    ai = xptr[1];
+    xptr += step;
+
+    /* gain 2 int bits for br/bi, cr/ci, dr/di (MULSHIFT32 by Q30)
+     * gain 1 net GB
+     */
+    ws = wptr[0];
+    wi = wptr[1];
+    br = xptr[0];
+    bi = xptr[1];
+    wd = ws + 2*wi;
+    tr = MULSHIFT32(wi, br + bi);
+    br = MULSHIFT32(wd, br) - tr;    /* cos*br + sin*bi */
+    bi = MULSHIFT32(ws, bi) + tr;    /* cos*bi - sin*br */
+    xptr += step;
+
+    ws = wptr[2];
+    wi = wptr[3];
+    cr = xptr[0];
+    ci = xptr[1];
+    wd = ws + 2*wi;
+    tr = MULSHIFT32(wi, cr + ci);
+    cr = MULSHIFT32(wd, cr) - tr;
+    ci = MULSHIFT32(ws, ci) + tr;
+    xptr += step;
+
+    ws = wptr[4];
+    wi = wptr[5];
+    dr = xptr[0];
+    di = xptr[1];
+    wd = ws + 2*wi;
+    tr = MULSHIFT32(wi, dr + di);
+    dr = MULSHIFT32(wd, dr) - tr;
+    di = MULSHIFT32(ws, di) + tr;
+
+    tr = ar;
+    ti = ai;
+    ar = (tr >> 2) - br;
+    ai = (ti >> 2) - bi;
+    br = (tr >> 2) + br;
+    bi = (ti >> 2) + bi;
+
+    tr = cr;
+    ti = ci;
+    cr = tr + dr;
+    ci = di - ti;
+    dr = tr - dr;
+    di = di + ti;
+
+    xptr[0] = ar + ci;
+    xptr[1] = ai + dr;
+    xptr -= step;
+    xptr[0] = br - cr;
+    xptr[1] = bi - di;
+    xptr -= step;
+    xptr[0] = ar - ci;
+    xptr[1] = ai - dr;
+    xptr -= step;
+    xptr[0] = br + cr;
+    xptr[1] = bi + di;
+}
+
 /***********************************************************************************************************************
  * Function:    R4Core
  *
@@ -2481,11 +2681,11 @@ void R8FirstPass(int *x, int bg)
  *              min 1 GB in
  *              gbOut = gbIn - 1 (short block) or gbIn - 2 (long block)
  *              uses 3-mul, 3-add butterflies instead of 4-mul, 2-add
+ *              gp is 4 or 8 on entry, so the inner loop does two independent butterflies per
+ *                iteration, which gives the compiler room to hide load and multiply latencies
  **********************************************************************************************************************/
-void R4Core(int *x, int bg, int gp, int *wtab)
+AAC_KERNEL_IRAM void R4Core(int *x, int bg, int gp, int *wtab)
 {
-    int ar, ai, br, bi, cr, ci, dr, di, tr, ti;
-    int wd, ws, wi;
     int i, j, step;
     int *xptr, *wptr;
 
@@ -2506,71 +2706,11 @@ void R4Core(int *x, int bg, int gp, int *wtab)
 
             wptr = wtab;
 
-            for (j = gp; j != 0; j--) {
-
-                ar = xptr[0];
-                ai = xptr[1];
-                xptr += step;
-
-                /* gain 2 int bits for br/bi, cr/ci, dr/di (MULSHIFT32 by Q30)
-                 * gain 1 net GB
-                 */
-                ws = wptr[0];
-                wi = wptr[1];
-                br = xptr[0];
-                bi = xptr[1];
-                wd = ws + 2*wi;
-                tr = MULSHIFT32(wi, br + bi);
-                br = MULSHIFT32(wd, br) - tr;    /* cos*br + sin*bi */
-                bi = MULSHIFT32(ws, bi) + tr;    /* cos*bi - sin*br */
-                xptr += step;
-
-                ws = wptr[2];
-                wi = wptr[3];
-                cr = xptr[0];
-                ci = xptr[1];
-                wd = ws + 2*wi;
-                tr = MULSHIFT32(wi, cr + ci);
-                cr = MULSHIFT32(wd, cr) - tr;
-                ci = MULSHIFT32(ws, ci) + tr;
-                xptr += step;
-
-                ws = wptr[4];
-                wi = wptr[5];
-                dr = xptr[0];
-                di = xptr[1];
-                wd = ws + 2*wi;
-                tr = MULSHIFT32(wi, dr + di);
-                dr = MULSHIFT32(wd, dr) - tr;
-                di = MULSHIFT32(ws, di) + tr;
-                wptr += 6;
-
-                tr = ar;
-                ti = ai;
-                ar = (tr >> 2) - br;
-                ai = (ti >> 2) - bi;
-                br = (tr >> 2) + br;
-                bi = (ti >> 2) + bi;
-
-                tr = cr;
-                ti = ci;
-                cr = tr + dr;
-                ci = di - ti;
-                dr = tr - dr;
-                di = di + ti;
-
-                xptr[0] = ar + ci;
-                xptr[1] = ai + dr;
-                xptr -= step;
-                xptr[0] = br - cr;
-                xptr[1] = bi - di;
-                xptr -= step;
-                xptr[0] = ar - ci;
-                xptr[1] = ai - dr;
-                xptr -= step;
-                xptr[0] = br + cr;
-                xptr[1] = bi + di;
-                xptr += 2;
+            for (j = gp >> 1; j != 0; j--) {
+                R4Butterfly(xptr + 0, step, wptr + 0);
+                R4Butterfly(xptr + 2, step, wptr + 6);
+                xptr += 4;
+                wptr += 12;
             }
             xptr += 3*step;
         }
@@ -2596,22 +2736,28 @@ void R4Core(int *x, int bg, int gp, int *wtab)
  *              gains log2(nfft) - 2 int bits total
  *                so gain 7 int bits (LONG), 4 int bits (SHORT)
  **********************************************************************************************************************/
-void R4FFT(int tabidx, int *x)
+AAC_KERNEL_IRAM void R4FFT(int tabidx, int *x)
 {
     int order = nfftlog2Tab[tabidx];
     int nfft = nfftTab[tabidx];
+    KERNEL_TIME_START();
 
     /* decimation in time */
     BitReverse(x, tabidx);
+    KERNEL_TIME(bitReverse);
 
     if (order & 0x1) {
         /* long block: order = 9, nfft = 512 */
         R8FirstPass(x, nfft >> 3);                        /* gain 1 int bit,  lose 2 GB */
-        R4Core(x, nfft >> 5, 8, (int *)twidTabOdd);        /* gain 6 int bits, lose 2 GB */
+        KERNEL_TIME(firstPass);
+        R4Core(x, nfft >> 5, 8, (int *)m_twidTabOdd);        /* gain 6 int bits, lose 2 GB */
+        KERNEL_TIME(r4Core);
     } else {
         /* short block: order = 6, nfft = 64 */
         R4FirstPass(x, nfft >> 2);                        /* gain 0 int bits, lose 2 GB */
-        R4Core(x, nfft >> 4, 4, (int *)twidTabEven);    /* gain 4 int bits, lose 1 GB */
+        KERNEL_TIME(firstPass);
+        R4Core(x, nfft >> 4, 4, (int *)m_twidTabEven);    /* gain 4 int bits, lose 1 GB */
+        KERNEL_TIME(r4Core);
     }
 }
 
@@ -2657,14 +2803,14 @@ void UnpackZeros(int nVals, int *coef)
  **********************************************************************************************************************/
 void UnpackQuads(int cb, int nVals, int *coef)
 {
-    int w, x, y, z, maxBits, nCodeBits, nSignBits, val;
+    int w, x, y, z, nCodeBits, nSignBits, val;
     uint32_t bitBuf;
+    const uint16_t *lut = m_huffTabSpecLUT + m_huffTabSpecLUTOffset[cb - HUFFTAB_SPEC_OFFSET];
 
-    maxBits = huffTabSpecInfo[cb - HUFFTAB_SPEC_OFFSET].maxBits + 4;
     while (nVals > 0) {
-        /* decode quad */
-        bitBuf = GetBitsNoAdvance(maxBits) << (32 - maxBits);
-        nCodeBits = DecodeHuffmanScalar(huffTabSpec, &huffTabSpecInfo[cb - HUFFTAB_SPEC_OFFSET], bitBuf, &val);
+        /* decode quad, straight from the bitstream cache (at most 20 bits) */
+        bitBuf = PeekBitstreamCache();
+        nCodeBits = DecodeHuffmanSpec(lut, bitBuf, &val);
 
         w = (((int32_t)(val) << 20) >>   29);    /* bits 11-9, sign-extend */
         x = (((int32_t)(val) << 23) >>   29);    /* bits  8-6, sign-extend */
@@ -2674,7 +2820,7 @@ void UnpackQuads(int cb, int nVals, int *coef)
         bitBuf <<= nCodeBits;
         nSignBits = (int)(((uint32_t)(val) << 17) >> 29);    /* bits 14-12, unsigned */
 
-        AdvanceBitstream(nCodeBits + nSignBits);
+        SkipBitstreamCache(nCodeBits + nSignBits);
         if (nSignBits) {
             if (w)    {w ^= ((int32_t)bitBuf >> 31); w -= ((int32_t)bitBuf >> 31); bitBuf <<= 1;}
             if (x)    {x ^= ((int32_t)bitBuf >> 31); x -= ((int32_t)bitBuf >> 31); bitBuf <<= 1;}
@@ -2704,21 +2850,21 @@ void UnpackQuads(int cb, int nVals, int *coef)
  **********************************************************************************************************************/
 void UnpackPairsNoEsc(int cb, int nVals, int *coef)
 {
-    int y, z, maxBits, nCodeBits, nSignBits, val;
+    int y, z, nCodeBits, nSignBits, val;
     uint32_t bitBuf;
+    const uint16_t *lut = m_huffTabSpecLUT + m_huffTabSpecLUTOffset[cb - HUFFTAB_SPEC_OFFSET];
 
-    maxBits = huffTabSpecInfo[cb - HUFFTAB_SPEC_OFFSET].maxBits + 2;
     while (nVals > 0) {
-        /* decode pair */
-        bitBuf = GetBitsNoAdvance(maxBits) << (32 - maxBits);
-        nCodeBits = DecodeHuffmanScalar(huffTabSpec, &huffTabSpecInfo[cb-HUFFTAB_SPEC_OFFSET], bitBuf, &val);
+        /* decode pair, straight from the bitstream cache (at most 20 bits) */
+        bitBuf = PeekBitstreamCache();
+        nCodeBits = DecodeHuffmanSpec(lut, bitBuf, &val);
 
         y = (((int32_t)(val) << 22) >>   27);    /* bits  9-5, sign-extend */
         z = (((int32_t)(val) << 27) >>   27);    /* bits  4-0, sign-extend */
 
         bitBuf <<= nCodeBits;
         nSignBits = (((uint32_t)(val) << 20) >> 30);    /* bits 11-10, unsigned */
-        AdvanceBitstream(nCodeBits + nSignBits);
+        SkipBitstreamCache(nCodeBits + nSignBits);
         if (nSignBits) {
             if (y)    {y ^= ((int32_t)bitBuf >> 31); y -= ((int32_t)bitBuf >> 31); bitBuf <<= 1;}
             if (z)    {z ^= ((int32_t)bitBuf >> 31); z -= ((int32_t)bitBuf >> 31); bitBuf <<= 1;}
@@ -2746,21 +2892,21 @@ void UnpackPairsNoEsc(int cb, int nVals, int *coef)
  **********************************************************************************************************************/
 void UnpackPairsEsc(int cb, int nVals, int *coef)
 {
-    int y, z, maxBits, nCodeBits, nSignBits, n, val;
+    int y, z, nCodeBits, nSignBits, n, val;
     uint32_t bitBuf;
+    const uint16_t *lut = m_huffTabSpecLUT + m_huffTabSpecLUTOffset[cb - HUFFTAB_SPEC_OFFSET];
 
-    maxBits = huffTabSpecInfo[cb - HUFFTAB_SPEC_OFFSET].maxBits + 2;
     while (nVals > 0) {
-        /* decode pair with escape value */
-        bitBuf = GetBitsNoAdvance(maxBits) << (32 - maxBits);
-        nCodeBits = DecodeHuffmanScalar(huffTabSpec, &huffTabSpecInfo[cb-HUFFTAB_SPEC_OFFSET], bitBuf, &val);
+        /* decode pair with escape value, straight from the bitstream cache (at most 20 bits) */
+        bitBuf = PeekBitstreamCache();
+        nCodeBits = DecodeHuffmanSpec(lut, bitBuf, &val);
 
         y = (((int32_t)(val) << 20) >>   26);    /* bits 11-6, sign-extend */
         z = (((int32_t)(val) << 26) >>   26);    /* bits  5-0, sign-extend */
 
         bitBuf <<= nCodeBits;
         nSignBits = (((uint32_t)(val) << 18) >> 30);    /* bits 13-12, unsigned */
-        AdvanceBitstream(nCodeBits + nSignBits);
+        SkipBitstreamCache(nCodeBits + nSignBits);
 
         if (y == 16) {
             n = 4;
@@ -2926,7 +3072,7 @@ void DecodeSpectrumShort(int ch)
  *              window type (sin or KBD) for input buffer
  *              window type (sin or KBD) for overlap buffer
  *
- * Outputs:     one channel, one frame of 16-bit PCM, interleaved by nChans
+ * Outputs:     one channel, one frame of 16-bit (or Q28 int32) PCM, interleaved by nChans
  *
  * Return:      none
  *
@@ -2934,11 +3080,12 @@ void DecodeSpectrumShort(int ch)
  *                the output buffer (pcm) for stereo interleaving
  *              this should fit in registers on ARM
  **********************************************************************************************************************/
-void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTypeCurr, int winTypePrev)
+template <typename pcm_t>
+void DecWindowOverlap(int *buf0, int *over0, pcm_t *pcm0, int nChans, int winTypeCurr, int winTypePrev)
 {
     int in, w0, w1, f0, f1;
     int *buf1, *over1;
-    short *pcm1;
+    pcm_t *pcm1;
     const uint32_t *wndCurr, *wndPrev;
 
     buf0 += (1024 >> 1);
@@ -2946,7 +3093,7 @@ void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTyp
     pcm1  = pcm0 + (1024 - 1) * nChans;
     over1 = over0 + 1024 - 1;
 
-    wndPrev = (winTypePrev == 1 ? kbdWindow + kbdWindowOffset[1] : sinWindow + sinWindowOffset[1]);
+    wndPrev = (winTypePrev == 1 ? m_kbdWindow + kbdWindowOffset[1] : m_sinWindow + sinWindowOffset[1]);
     if (winTypeCurr == winTypePrev) {
         /* cut window loads in half since current and overlap sections use same symmetric window */
         do {
@@ -2958,11 +3105,11 @@ void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTyp
             f1 = MULSHIFT32(w1, in);
 
             in = *over0;
-            *pcm0 = CLIPTOSHORT( (in - f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+            StorePCM(pcm0, in - f0, FBITS_OUT_IMDCT);
             pcm0 += nChans;
 
             in = *over1;
-            *pcm1 = CLIPTOSHORT( (in + f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+            StorePCM(pcm1, in + f1, FBITS_OUT_IMDCT);
             pcm1 -= nChans;
 
             in = *buf1--;
@@ -2971,7 +3118,7 @@ void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTyp
         } while (over0 < over1);
     } else {
         /* different windows for current and overlap parts - should still fit in registers on ARM w/o stack spill */
-        wndCurr = (winTypeCurr == 1 ? kbdWindow + kbdWindowOffset[1] : sinWindow + sinWindowOffset[1]);
+        wndCurr = (winTypeCurr == 1 ? m_kbdWindow + kbdWindowOffset[1] : m_sinWindow + sinWindowOffset[1]);
         do {
             w0 = *wndPrev++;
             w1 = *wndPrev++;
@@ -2981,11 +3128,11 @@ void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTyp
             f1 = MULSHIFT32(w1, in);
 
             in = *over0;
-            *pcm0 = CLIPTOSHORT( (in - f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+            StorePCM(pcm0, in - f0, FBITS_OUT_IMDCT);
             pcm0 += nChans;
 
             in = *over1;
-            *pcm1 = CLIPTOSHORT( (in + f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+            StorePCM(pcm1, in + f1, FBITS_OUT_IMDCT);
             pcm1 -= nChans;
 
             w0 = *wndCurr++;
@@ -2998,6 +3145,110 @@ void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTyp
     }
 }
 
+/***********************************************************************************************************************
+ * Function:    DecWindowOverlapStereo
+ *
+ * Description: apply synthesis window, do overlap-add, clip to 16-bit PCM,
+ *                for winSequence LONG-LONG, both channels of a CPE at once
+ *
+ * Inputs:      input buffers (output of type-IV DCT), left and right
+ *              overlap buffers (saved from last time), left and right
+ *              window type (sin or KBD) for input buffers
+ *              window type (sin or KBD) for overlap buffers
+ *
+ * Outputs:     one frame of 16-bit (or Q28 int32) PCM, interleaved L/R
+ *
+ * Return:      none
+ *
+ * Notes:       same arithmetic as DecWindowOverlap(), so the output is bit-exact
+ *              the window coefficients are loaded once for both channels and each
+ *                clipped 16-bit L/R pair is written with one 32-bit store, so pcm0 must be 4-byte aligned
+ *              only used if both channels share the window (commonWin), see UseStereoWindowOverlap()
+ **********************************************************************************************************************/
+inline void StorePCMPair(short *pcm, int l, int r)
+{
+    l = (l + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT;
+    r = (r + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    *(uint32_t *)pcm = (uint16_t)CLIPTOSHORT(l) | ((uint32_t)(uint16_t)CLIPTOSHORT(r) << 16);
+#else
+    *(uint32_t *)pcm = (uint16_t)CLIPTOSHORT(r) | ((uint32_t)(uint16_t)CLIPTOSHORT(l) << 16);
+#endif
+}
+
+inline void StorePCMPair(int32_t *pcm, int l, int r)
+{
+    pcm[0] = CLIPTOQ28(l, FBITS_OUT_IMDCT);
+    pcm[1] = CLIPTOQ28(r, FBITS_OUT_IMDCT);
+}
+
+template <typename pcm_t>
+AAC_KERNEL_IRAM void DecWindowOverlapStereo(int *bufL, int *bufR, int *overL0, int *overR0, pcm_t *pcm0,
+                                            int winTypeCurr, int winTypePrev)
+{
+    int inL, inR, w0, w1;
+    int *bufL1, *bufR1, *overL1, *overR1;
+    pcm_t *pcm1;
+    const uint32_t *wndCurr, *wndPrev;
+
+    bufL  += (1024 >> 1);
+    bufR  += (1024 >> 1);
+    bufL1  = bufL - 1;
+    bufR1  = bufR - 1;
+    pcm1   = pcm0 + (1024 - 1) * 2;
+    overL1 = overL0 + 1024 - 1;
+    overR1 = overR0 + 1024 - 1;
+
+    wndPrev = (winTypePrev == 1 ? m_kbdWindow + kbdWindowOffset[1] : m_sinWindow + sinWindowOffset[1]);
+    if (winTypeCurr == winTypePrev) {
+        /* same symmetric window for current and overlap sections, one window load for 4 products */
+        do {
+            w0 = *wndPrev++;
+            w1 = *wndPrev++;
+            inL = *bufL++;
+            inR = *bufR++;
+
+            StorePCMPair(pcm0, *overL0 - MULSHIFT32(w0, inL),
+                               *overR0 - MULSHIFT32(w0, inR));
+            pcm0 += 2;
+            StorePCMPair(pcm1, *overL1 + MULSHIFT32(w1, inL),
+                               *overR1 + MULSHIFT32(w1, inR));
+            pcm1 -= 2;
+
+            inL = *bufL1--;
+            inR = *bufR1--;
+            *overL1-- = MULSHIFT32(w0, inL);
+            *overL0++ = MULSHIFT32(w1, inL);
+            *overR1-- = MULSHIFT32(w0, inR);
+            *overR0++ = MULSHIFT32(w1, inR);
+        } while (overL0 < overL1);
+    } else {
+        wndCurr = (winTypeCurr == 1 ? m_kbdWindow + kbdWindowOffset[1] : m_sinWindow + sinWindowOffset[1]);
+        do {
+            w0 = *wndPrev++;
+            w1 = *wndPrev++;
+            inL = *bufL++;
+            inR = *bufR++;
+
+            StorePCMPair(pcm0, *overL0 - MULSHIFT32(w0, inL),
+                               *overR0 - MULSHIFT32(w0, inR));
+            pcm0 += 2;
+            StorePCMPair(pcm1, *overL1 + MULSHIFT32(w1, inL),
+                               *overR1 + MULSHIFT32(w1, inR));
+            pcm1 -= 2;
+
+            w0 = *wndCurr++;
+            w1 = *wndCurr++;
+            inL = *bufL1--;
+            inR = *bufR1--;
+            *overL1-- = MULSHIFT32(w0, inL);
+            *overL0++ = MULSHIFT32(w1, inL);
+            *overR1-- = MULSHIFT32(w0, inR);
+            *overR0++ = MULSHIFT32(w1, inR);
+        } while (overL0 < overL1);
+    }
+}
+
 /***********************************************************************************************************************
  * Function:    DecWindowOverlapLongStart
  *
@@ -3010,7 +3261,7 @@ void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTyp
  *              window type (sin or KBD) for input buffer
  *              window type (sin or KBD) for overlap buffer
  *
- * Outputs:     one channel, one frame of 16-bit PCM, interleaved by nChans
+ * Outputs:     one channel, one frame of 16-bit (or Q28 int32) PCM, interleaved by nChans
  *
  * Return:      none
  *
@@ -3018,11 +3269,12 @@ void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTyp
  *                the output buffer (pcm) for stereo interleaving
  *              this should fit in registers on ARM
  **********************************************************************************************************************/
-void DecWindowOverlapLongStart(int *buf0, int *over0, short *pcm0, int nChans, int winTypeCurr, int winTypePrev)
+template <typename pcm_t>
+void DecWindowOverlapLongStart(int *buf0, int *over0, pcm_t *pcm0, int nChans, int winTypeCurr, int winTypePrev)
 {
     int i,  in, w0, w1, f0, f1;
     int *buf1, *over1;
-    short *pcm1;
+    pcm_t *pcm1;
     const uint32_t *wndPrev, *wndCurr;
 
     buf0 += (1024 >> 1);
@@ -3030,7 +3282,7 @@ void DecWindowOverlapLongStart(int *buf0, int *over0, short *pcm0, int nChans, i
     pcm1  = pcm0 + (1024 - 1) * nChans;
     over1 = over0 + 1024 - 1;
 
-    wndPrev = (winTypePrev == 1 ? kbdWindow + kbdWindowOffset[1] : sinWindow + sinWindowOffset[1]);
+    wndPrev = (winTypePrev == 1 ? m_kbdWindow + kbdWindowOffset[1] : m_sinWindow + sinWindowOffset[1]);
     i = 448;    /* 2 outputs, 2 overlaps per loop */
     do {
         w0 = *wndPrev++;
@@ -3041,11 +3293,11 @@ void DecWindowOverlapLongStart(int *buf0, int *over0, short *pcm0, int nChans, i
         f1 = MULSHIFT32(w1, in);
 
         in = *over0;
-        *pcm0 = CLIPTOSHORT( (in - f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm0, in - f0, FBITS_OUT_IMDCT);
         pcm0 += nChans;
 
         in = *over1;
-        *pcm1 = CLIPTOSHORT( (in + f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm1, in + f1, FBITS_OUT_IMDCT);
         pcm1 -= nChans;
 
         in = *buf1--;
@@ -3054,7 +3306,7 @@ void DecWindowOverlapLongStart(int *buf0, int *over0, short *pcm0, int nChans, i
         *over0++ = in >> 1;    /* Wn = 1 for n = (1024, 1025, ... 1471) */
     } while (--i);
 
-    wndCurr = (winTypeCurr == 1 ? kbdWindow + kbdWindowOffset[0] : sinWindow + sinWindowOffset[0]);
+    wndCurr = (winTypeCurr == 1 ? m_kbdWindow + kbdWindowOffset[0] : m_sinWindow + sinWindowOffset[0]);
 
     /* do 64 more loops - 2 outputs, 2 overlaps per loop */
     do {
@@ -3066,11 +3318,11 @@ void DecWindowOverlapLongStart(int *buf0, int *over0, short *pcm0, int nChans, i
         f1 = MULSHIFT32(w1, in);
 
         in = *over0;
-        *pcm0 = CLIPTOSHORT( (in - f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm0, in - f0, FBITS_OUT_IMDCT);
         pcm0 += nChans;
 
         in = *over1;
-        *pcm1 = CLIPTOSHORT( (in + f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm1, in + f1, FBITS_OUT_IMDCT);
         pcm1 -= nChans;
 
         w0 = *wndCurr++;    /* W[0], W[1], ... --> W[255], W[254], ... */
@@ -3094,7 +3346,7 @@ void DecWindowOverlapLongStart(int *buf0, int *over0, short *pcm0, int nChans, i
  *              window type (sin or KBD) for input buffer
  *              window type (sin or KBD) for overlap buffer
  *
- * Outputs:     one channel, one frame of 16-bit PCM, interleaved by nChans
+ * Outputs:     one channel, one frame of 16-bit (or Q28 int32) PCM, interleaved by nChans
  *
  * Return:      none
  *
@@ -3102,11 +3354,12 @@ void DecWindowOverlapLongStart(int *buf0, int *over0, short *pcm0, int nChans, i
  *                the output buffer (pcm) for stereo interleaving
  *              this should fit in registers on ARM
  **********************************************************************************************************************/
-void DecWindowOverlapLongStop(int *buf0, int *over0, short *pcm0, int nChans, int winTypeCurr, int winTypePrev)
+template <typename pcm_t>
+void DecWindowOverlapLongStop(int *buf0, int *over0, pcm_t *pcm0, int nChans, int winTypeCurr, int winTypePrev)
 {
     int i, in, w0, w1, f0, f1;
     int *buf1, *over1;
-    short *pcm1;
+    pcm_t *pcm1;
     const uint32_t *wndPrev, *wndCurr;
 
     buf0 += (1024 >> 1);
@@ -3114,8 +3367,8 @@ void DecWindowOverlapLongStop(int *buf0, int *over0, short *pcm0, int nChans, in
     pcm1  = pcm0 + (1024 - 1) * nChans;
     over1 = over0 + 1024 - 1;
 
-    wndPrev = (winTypePrev == 1 ? kbdWindow + kbdWindowOffset[0] : sinWindow + sinWindowOffset[0]);
-    wndCurr = (winTypeCurr == 1 ? kbdWindow + kbdWindowOffset[1] : sinWindow + sinWindowOffset[1]);
+    wndPrev = (winTypePrev == 1 ? m_kbdWindow + kbdWindowOffset[0] : m_sinWindow + sinWindowOffset[0]);
+    wndCurr = (winTypeCurr == 1 ? m_kbdWindow + kbdWindowOffset[1] : m_sinWindow + sinWindowOffset[1]);
 
     i = 448;    /* 2 outputs, 2 overlaps per loop */
     do {
@@ -3125,11 +3378,11 @@ void DecWindowOverlapLongStop(int *buf0, int *over0, short *pcm0, int nChans, in
         f1 = in >> 1;    /* scale since skipping multiply by Q31 */
 
         in = *over0;
-        *pcm0 = CLIPTOSHORT( (in + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm0, in, FBITS_OUT_IMDCT);
         pcm0 += nChans;
 
         in = *over1;
-        *pcm1 = CLIPTOSHORT( (in + f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm1, in + f1, FBITS_OUT_IMDCT);
         pcm1 -= nChans;
 
         w0 = *wndCurr++;
@@ -3150,11 +3403,11 @@ void DecWindowOverlapLongStop(int *buf0, int *over0, short *pcm0, int nChans, in
         f1 = MULSHIFT32(w1, in);
 
         in = *over0;
-        *pcm0 = CLIPTOSHORT( (in - f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm0, in - f0, FBITS_OUT_IMDCT);
         pcm0 += nChans;
 
         in = *over1;
-        *pcm1 = CLIPTOSHORT( (in + f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm1, in + f1, FBITS_OUT_IMDCT);
         pcm1 -= nChans;
 
         w0 = *wndCurr++;
@@ -3178,7 +3431,7 @@ void DecWindowOverlapLongStop(int *buf0, int *over0, short *pcm0, int nChans, in
  *              window type (sin or KBD) for input buffer
  *              window type (sin or KBD) for overlap buffer
  *
- * Outputs:     one channel, one frame of 16-bit PCM, interleaved by nChans
+ * Outputs:     one channel, one frame of 16-bit (or Q28 int32) PCM, interleaved by nChans
  *
  * Return:      none
  *
@@ -3186,23 +3439,24 @@ void DecWindowOverlapLongStop(int *buf0, int *over0, short *pcm0, int nChans, in
  *                the output buffer (pcm) for stereo interleaving
  *              this should fit in registers on ARM
  **********************************************************************************************************************/
-void DecWindowOverlapShort(int *buf0, int *over0, short *pcm0, int nChans, int winTypeCurr, int winTypePrev)
+template <typename pcm_t>
+void DecWindowOverlapShort(int *buf0, int *over0, pcm_t *pcm0, int nChans, int winTypeCurr, int winTypePrev)
 {
     int i, in, w0, w1, f0, f1;
     int *buf1, *over1;
-    short *pcm1;
+    pcm_t *pcm1;
     const uint32_t *wndPrev, *wndCurr;
 
-    wndPrev = (winTypePrev == 1 ? kbdWindow + kbdWindowOffset[0] : sinWindow + sinWindowOffset[0]);
-    wndCurr = (winTypeCurr == 1 ? kbdWindow + kbdWindowOffset[0] : sinWindow + sinWindowOffset[0]);
+    wndPrev = (winTypePrev == 1 ? m_kbdWindow + kbdWindowOffset[0] : m_sinWindow + sinWindowOffset[0]);
+    wndCurr = (winTypeCurr == 1 ? m_kbdWindow + kbdWindowOffset[0] : m_sinWindow + sinWindowOffset[0]);
 
     /* pcm[0-447] = 0 + overlap[0-447] */
     i = 448;
     do {
         f0 = *over0++;
         f1 = *over0++;
-        *pcm0 = CLIPTOSHORT( (f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );    pcm0 += nChans;
-        *pcm0 = CLIPTOSHORT( (f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );    pcm0 += nChans;
+        StorePCM(pcm0, f0, FBITS_OUT_IMDCT);    pcm0 += nChans;
+        StorePCM(pcm0, f1, FBITS_OUT_IMDCT);    pcm0 += nChans;
         i -= 2;
     } while (i);
 
@@ -3220,11 +3474,11 @@ void DecWindowOverlapShort(int *buf0, int *over0, short *pcm0, int nChans, int w
         f1 = MULSHIFT32(w1, in);
 
         in = *over0;
-        *pcm0 = CLIPTOSHORT( (in - f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm0, in - f0, FBITS_OUT_IMDCT);
         pcm0 += nChans;
 
         in = *over1;
-        *pcm1 = CLIPTOSHORT( (in + f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm1, in + f1, FBITS_OUT_IMDCT);
         pcm1 -= nChans;
 
         w0 = *wndCurr++;
@@ -3259,12 +3513,12 @@ void DecWindowOverlapShort(int *buf0, int *over0, short *pcm0, int nChans, int w
 
             in  = *(over0 - 128);    /* from last short block */
             in += *(over0 + 0);        /* from last full frame */
-            *pcm0 = CLIPTOSHORT( (in - f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+            StorePCM(pcm0, in - f0, FBITS_OUT_IMDCT);
             pcm0 += nChans;
 
             in  = *(over1 - 128);    /* from last short block */
             in += *(over1 + 0);        /* from last full frame */
-            *pcm1 = CLIPTOSHORT( (in + f1 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+            StorePCM(pcm1, in + f1, FBITS_OUT_IMDCT);
             pcm1 -= nChans;
 
             /* save over0/over1 for next short block, in the slots just vacated */
@@ -3293,7 +3547,7 @@ void DecWindowOverlapShort(int *buf0, int *over0, short *pcm0, int nChans, int w
 
         in  = *(over0 + 768);    /* from last short block */
         in += *(over0 + 896);    /* from last full frame */
-        *pcm0 = CLIPTOSHORT( (in - f0 + (1 << (FBITS_OUT_IMDCT-1))) >> FBITS_OUT_IMDCT );
+        StorePCM(pcm0, in - f0, FBITS_OUT_IMDCT);
         pcm0 += nChans;
 
         in  = *(over1 + 768);    /* from last short block */
@@ -3347,10 +3601,36 @@ void DecWindowOverlapShort(int *buf0, int *over0, short *pcm0, int nChans, int w
     } while (i);
 }
 
+/***********************************************************************************************************************
+ * Function:    UseStereoWindowOverlap
+ *
+ * Description: check whether both channels of the current element can be windowed
+ *                together by DecWindowOverlapStereo()
+ *
+ * Inputs:      first output channel of the element
+ *              output buffer (interleaved PCM)
+ *
+ * Outputs:     none
+ *
+ * Return:      nonzero if the element is a CPE with common LONG-LONG window and the same
+ *                previous window shape in both channels, and the output is 4-byte aligned
+ *
+ * Notes:       only asked for channel 0: windowing channel 0 alone updates its prevWinShape,
+ *                so the answer for channel 1 would no longer be the same
+ **********************************************************************************************************************/
+template <typename pcm_t>
+int UseStereoWindowOverlap(int baseChan, pcm_t *outbuf)
+{
+    return m_AACDecInfo->currBlockID == AAC_ID_CPE && m_AACDecInfo->nChans == 2 && m_PSInfoBase->commonWin == 1 &&
+           m_PSInfoBase->icsInfo[0].winSequence == 0 &&
+           m_PSInfoBase->prevWinShape[baseChan] == m_PSInfoBase->prevWinShape[baseChan + 1] &&
+           (((uintptr_t)(outbuf + baseChan)) & 0x03) == 0;
+}
+
 /***********************************************************************************************************************
  * Function:    IMDCT
  *
- * Description: inverse transform and convert to 16-bit PCM
+ * Description: inverse transform and convert to 16-bit or Q28 int32 PCM (see StorePCM())
  *
  * Inputs:      index of current channel (0 for SCE/LFE, 0 or 1 for CPE)
  *              output channel (range = [0, nChans-1])
@@ -3370,13 +3650,13 @@ void DecWindowOverlapShort(int *buf0, int *over0, short *pcm0, int nChans, int w
  *                a separate pass over the 32-bit PCM to produce 16-bit PCM output.
  *                This inflicts a slight performance hit when decoding non-SBR files.
  **********************************************************************************************************************/
-int IMDCT(int ch, int chOut, short *outbuf)
+template <typename pcm_t>
+int IMDCT(int ch, int chOut, pcm_t *outbuf)
 {
     int i;
     ICSInfo_t *icsInfo;
 
     icsInfo = (ch == 1 && m_PSInfoBase->commonWin == 1) ? &(m_PSInfoBase->icsInfo[0]) : &(m_PSInfoBase->icsInfo[ch]);
-    outbuf += chOut;
 
     /* optimized type-IV DCT (operates inplace) */
     if (icsInfo->winSequence == 2) {
@@ -3388,6 +3668,23 @@ int IMDCT(int ch, int chOut, short *outbuf)
         DCT4(1, m_PSInfoBase->coef[ch], m_PSInfoBase->gbCurrent[ch]);
     }
 
+    KERNEL_TIME_START();
+    /* CPE with common window: the first channel waits, the second one windows both */
+    if (ch == 0)
+        m_stereoWinPending = UseStereoWindowOverlap(chOut, outbuf);
+    if (m_stereoWinPending) {
+        if (ch == 0)
+            return 0;
+        m_stereoWinPending = 0;
+        DecWindowOverlapStereo(m_PSInfoBase->coef[0], m_PSInfoBase->coef[1], m_PSInfoBase->overlap[chOut - 1],
+                               m_PSInfoBase->overlap[chOut], outbuf + chOut - 1, icsInfo->winShape,
+                               m_PSInfoBase->prevWinShape[chOut]);
+        KERNEL_TIME(windowOverlap);
+        m_PSInfoBase->prevWinShape[chOut - 1] = icsInfo->winShape;
+        m_PSInfoBase->prevWinShape[chOut] = icsInfo->winShape;
+        return 0;
+    }
+    outbuf += chOut;
 
     /* window, overlap-add, round to PCM - optimized for each window sequence */
     if (icsInfo->winSequence == 0)
@@ -3402,6 +3699,7 @@ int IMDCT(int ch, int chOut, short *outbuf)
     else if (icsInfo->winSequence == 3)
         DecWindowOverlapLongStop(m_PSInfoBase->coef[ch], m_PSInfoBase->overlap[chOut], outbuf, m_AACDecInfo->nChans,
                                                                   icsInfo->winShape, m_PSInfoBase->prevWinShape[chOut]);
+    KERNEL_TIME(windowOverlap);
 
 //    m_AACDecInfo->rawSampleBuf[ch] = 0;
 //    m_AACDecInfo->rawSampleBytes = 0;
@@ -3523,7 +3821,7 @@ int DecodeOneScaleFactor()
 
     /* decode next scalefactor from bitstream */
     bitBuf = GetBitsNoAdvance(huffTabScaleFactInfo.maxBits) << (32 - huffTabScaleFactInfo.maxBits);
-    nBits = DecodeHuffmanScalar(huffTabScaleFact, &huffTabScaleFactInfo, bitBuf, &val);
+    nBits = DecodeHuffmanScalar(m_huffTabScaleFact, &huffTabScaleFactInfo, bitBuf, &val);
     AdvanceBitstream(nBits);
     return val;
 }
@@ -3860,6 +4158,113 @@ int DecodeHuffmanScalar(const signed short *huffTab, const HuffInfo_t *huffTabIn
     return (countPtr - huffTabInfo->count);
 }
 
+/***********************************************************************************************************************
+ * Function:    BuildHuffTabSpecLUT
+ *
+ * Description: build two-level lookup tables for the 11 spectral codebooks from huffTabSpecInfo
+ *
+ * Inputs:      buffer for the tables, or NULL to only calculate the size
+ *
+ * Outputs:     tables for all codebooks in lut, start of each table in m_huffTabSpecLUTOffset
+ *
+ * Return:      number of uint16_t entries needed for all tables (3156 for HUFFLUT_ROOT_BITS = 7)
+ *
+ * Notes:       the first level is indexed by the next HUFFLUT_ROOT_BITS bits, codes which are longer get
+ *                a second level sized for the longest code sharing that prefix
+ *              entry = (length << 11) | index into huffTabSpec for a code,
+ *                      ((16 + second level bits) << 11) | offset of second level for a prefix
+ *              uses the same canonical code assignment as DecodeHuffmanScalar()
+ **********************************************************************************************************************/
+int BuildHuffTabSpecLUT(uint16_t *lut)
+{
+    int cb, nBits, i, j, n, code, len, size, total;
+    uint8_t subBits[1 << HUFFLUT_ROOT_BITS];
+    uint16_t *tab, *sub, e;
+    const HuffInfo_t *info;
+
+    total = 0;
+    for (cb = 0; cb < 11; cb++) {
+        info = &huffTabSpecInfo[cb];
+
+        /* bits needed for the second level of each prefix */
+        memset(subBits, 0, sizeof(subBits));
+        code = 0;
+        for (nBits = 1; nBits <= info->maxBits; nBits++) {
+            n = info->count[nBits - 1];
+            for (i = 0; i < n && nBits > HUFFLUT_ROOT_BITS; i++) {
+                j = (code + i) >> (nBits - HUFFLUT_ROOT_BITS);
+                if (subBits[j] < nBits - HUFFLUT_ROOT_BITS)
+                    subBits[j] = nBits - HUFFLUT_ROOT_BITS;
+            }
+            code = (code + n) << 1;
+        }
+        size = 1 << HUFFLUT_ROOT_BITS;
+        for (j = 0; j < (1 << HUFFLUT_ROOT_BITS); j++) {
+            if (subBits[j]) {
+                if (lut)
+                    lut[total + j] = ((16 + subBits[j]) << 11) | size;
+                size += 1 << subBits[j];
+            }
+        }
+
+        /* fill in the codes, replicated over the unused low bits */
+        if (lut) {
+            m_huffTabSpecLUTOffset[cb] = total;
+            tab = lut + total;
+            code = 0;
+            e = info->offset;
+            for (nBits = 1; nBits <= info->maxBits; nBits++) {
+                n = info->count[nBits - 1];
+                for (i = 0; i < n; i++, code++, e++) {
+                    if (nBits <= HUFFLUT_ROOT_BITS) {
+                        sub = tab + (code << (HUFFLUT_ROOT_BITS - nBits));
+                        len = HUFFLUT_ROOT_BITS - nBits;
+                    } else {
+                        j = code >> (nBits - HUFFLUT_ROOT_BITS);
+                        len = subBits[j] - (nBits - HUFFLUT_ROOT_BITS);
+                        sub = tab + (tab[j] & 0x7ff) + ((code & ((1 << (nBits - HUFFLUT_ROOT_BITS)) - 1)) << len);
+                    }
+                    for (j = 0; j < (1 << len); j++)
+                        sub[j] = (nBits << 11) | e;
+                }
+                code <<= 1;
+            }
+        }
+        total += size;
+    }
+    return total;
+}
+
+/***********************************************************************************************************************
+ * Function:    DecodeHuffmanSpec
+ *
+ * Description: decode one spectral Huffman symbol with the lookup tables from BuildHuffTabSpecLUT()
+ *
+ * Inputs:      pointer to the lookup table of the codebook
+ *              left-aligned bit buffer with >= maxBits bits of the codebook
+ *
+ * Outputs:     decoded symbol in *val
+ *
+ * Return:      number of bits in symbol
+ *
+ * Notes:       same result as DecodeHuffmanScalar(huffTabSpec, ...), at most two table reads
+ **********************************************************************************************************************/
+inline int DecodeHuffmanSpec(const uint16_t *lut, uint32_t bitBuf, int32_t *val)
+{
+    uint32_t e, nBits;
+
+    e = lut[bitBuf >> (32 - HUFFLUT_ROOT_BITS)];
+    nBits = e >> 11;
+    if (nBits > 16) {
+        /* second level, indexed by the bits after the prefix */
+        nBits -= 16;
+        e = lut[(e & 0x7ff) + ((bitBuf << HUFFLUT_ROOT_BITS) >> (32 - nBits))];
+        nBits = e >> 11;
+    }
+    *val = (int32_t)m_huffTabSpec[e & 0x7ff];
+    return nBits;
+}
+
 /***********************************************************************************************************************
 * Function:    UnpackADTSHeader
 *
@@ -4568,13 +4973,16 @@ static const int pow14[4] PROGMEM = {
 
     int i, c, spec, energy, sq, scalef, scalei, invSqrtEnergy, z, gbMask;
 
+    /* nVals is a multiple of 4 (SFB width) */
     energy = 0;
-    for (i = 0; i < nVals; i++) {
-        spec = coef[i];
-
+    for (i = 0; i < nVals; i += 2) {
         /* max nVals = max SFB width = 96, so energy can gain < 2^7 bits in accumulation */
+        spec = coef[i];
         sq = (spec * spec) >> 8;        /* spec*spec range = (-2^30, 2^30) */
         energy += sq;
+        spec = coef[i+1];
+        sq = (spec * spec) >> 8;
+        energy += sq;
     }
 
     /* unless nVals == 1 (or the number generator is broken...), this should not happen */
@@ -4649,9 +5057,14 @@ static const int pow14[4] PROGMEM = {
 void GenerateNoiseVector(int *coef, int *last, int nVals)
 {
     int i;
+    uint32_t r = (uint32_t)*last;
 
-    for (i = 0; i < nVals; i++)
-        coef[i] = ((int32_t)Get32BitVal((uint32_t *)last)) >> 16;
+    /* same LCG as Get32BitVal(), seed kept in a register */
+    for (i = 0; i < nVals; i++) {
+        r = (1664525U * r) + 1013904223U;
+        coef[i] = ((int32_t)r) >> 16;
+    }
+    *last = (int)r;
 }
 
 /***********************************************************************************************************************
@@ -4668,10 +5081,7 @@ void GenerateNoiseVector(int *coef, int *last, int nVals)
  **********************************************************************************************************************/
 void CopyNoiseVector(int *coefL, int *coefR, int nVals)
 {
-    int i;
-
-    for (i = 0; i < nVals; i++)
-        coefR[i] = coefL[i];
+    memcpy(coefR, coefL, nVals * sizeof(int));
 }
 
 /***********************************************************************************************************************
@@ -4813,6 +5223,8 @@ int GetSampRateIdx(int sampRate)
  *
  * Notes:       assume no guard bits in input
  *              gains 0 int bits
+ *              gbCurrent is a lower bound for the guard bits of all input coefficients (it only decreases
+ *                from the dequantizer value), which lets most bands skip the per-coefficient overflow checks
  **********************************************************************************************************************/
 void StereoProcessGroup(int *coefL, int *coefR, const uint16_t *sfbTab,
                               int msMaskPres, uint8_t *msMaskPtr, int msMaskOffset, int maxSFB,
@@ -4845,7 +5257,14 @@ static const uint32_t pow14[2][4] PROGMEM = {
             scalef = pow14[cbIdx][sf & 0x03];
             scalei = (sf >> 2) + 2;            /* +2 to compensate for scalef = Q30 */
 
-            if (scalei > 0) {
+            if (scalei > 0 && scalei <= gbCurrent[0]) {
+                /* |MULSHIFT32(coefL, scalef)| <= 2^(30-gb), cannot overflow when shifted up by scalei <= gb */
+                do {
+                    cr = MULSHIFT32(*coefL++, scalef) << scalei;
+                    gbMaskR |= FASTABS(cr);
+                    *coefR++ = cr;
+                } while (--width);
+            } else if (scalei > 0) {
                 if (scalei > 30)
                     scalei = 30;
                 do {
@@ -4866,31 +5285,58 @@ static const uint32_t pow14[2][4] PROGMEM = {
                 } while (--width);
             }
         } else if ( cbIdx != 13 && ((msMaskPres == 1 && (msMask & 0x01)) || msMaskPres == 2) ) {
-            /* mid-side stereo (assumes no GB in inputs) */
-            do {
-                cl = *coefL;
-                cr = *coefR;
-
-                if ( (FASTABS(cl) | FASTABS(cr)) >> 30 ) {
-                    /* avoid overflow (rare) */
-                    cl >>= 1;
-                    sf = cl + (cr >> 1);
-                    {int sign = (sf) >> 31; if (sign != (sf) >> (30))  {(sf) = sign ^ ((1 << (30)) - 1);}}
-                    sf <<= 1;
-                    cl = cl - (cr >> 1);
-                    {int sign = (cl) >> 31; if (sign != (cl) >> (30))  {(cl) = sign ^ ((1 << (30)) - 1);}}
-                    cl <<= 1;
-                } else {
-                    /* usual case */
+            if (gbCurrent[0] > 0 && gbCurrent[1] > 0) {
+                /* mid-side stereo, all |inputs| < 2^30 so sum and difference cannot overflow (width is a multiple of 4) */
+                width >>= 1;
+                do {
+                    cl = coefL[0];
+                    cr = coefR[0];
                     sf = cl + cr;
                     cl -= cr;
-                }
+                    coefL[0] = sf;
+                    coefR[0] = cl;
+                    gbMaskL |= FASTABS(sf);
+                    gbMaskR |= FASTABS(cl);
+
+                    cl = coefL[1];
+                    cr = coefR[1];
+                    sf = cl + cr;
+                    cl -= cr;
+                    coefL[1] = sf;
+                    coefR[1] = cl;
+                    gbMaskL |= FASTABS(sf);
+                    gbMaskR |= FASTABS(cl);
+
+                    coefL += 2;
+                    coefR += 2;
+                } while (--width);
+            } else {
+                /* mid-side stereo (assumes no GB in inputs) */
+                do {
+                    cl = *coefL;
+                    cr = *coefR;
+
+                    if ( (FASTABS(cl) | FASTABS(cr)) >> 30 ) {
+                        /* avoid overflow (rare) */
+                        cl >>= 1;
+                        sf = cl + (cr >> 1);
+                        {int sign = (sf) >> 31; if (sign != (sf) >> (30))  {(sf) = sign ^ ((1 << (30)) - 1);}}
+                        sf <<= 1;
+                        cl = cl - (cr >> 1);
+                        {int sign = (cl) >> 31; if (sign != (cl) >> (30))  {(cl) = sign ^ ((1 << (30)) - 1);}}
+                        cl <<= 1;
+                    } else {
+                        /* usual case */
+                        sf = cl + cr;
+                        cl -= cr;
+                    }
 
-                *coefL++ = sf;
-                gbMaskL |= FASTABS(sf);
-                *coefR++ = cl;
-                gbMaskR |= FASTABS(cl);
-            } while (--width);
+                    *coefL++ = sf;
+                    gbMaskL |= FASTABS(sf);
+                    *coefR++ = cl;
+                    gbMaskR |= FASTABS(cl);
+                } while (--width);
+            }
 
         } else {
             /* nothing to do */
@@ -5582,7 +6028,7 @@ void SetBitstreamPointer(int nBytes, uint8_t *buf)
 {
     /* init bitstream */
 	m_aac_BitStreamInfo.bytePtr = buf;
-	m_aac_BitStreamInfo.iCache = 0;        /* 4-byte uint32_t */
+	m_aac_BitStreamInfo.cache = 0;         /* 8-byte uint64_t, left-justified */
 	m_aac_BitStreamInfo.cachedBits = 0;    /* i.e. zero bits in cache */
 	m_aac_BitStreamInfo.nBytes = nBytes;
 }
@@ -5590,7 +6036,7 @@ void SetBitstreamPointer(int nBytes, uint8_t *buf)
 /***********************************************************************************************************************
  * Function:    RefillBitstreamCache
  *
- * Description: read new data from bitstream buffer into 32-bit cache
+ * Description: top up the 64-bit cache with whole bytes from the bitstream buffer
  *
  * Inputs:      none
  *
@@ -5598,35 +6044,79 @@ void SetBitstreamPointer(int nBytes, uint8_t *buf)
  *
  * Return:      none
  *
- * Notes:       only call when iCache is completely drained (resets bitOffset to 0)
- *              always loads 4 new bytes except when bsi->nBytes < 4 (end of buffer)
+ * Notes:       can be called at any time, leaves at least 57 valid bits in the cache unless the end of the
+ *                buffer is reached (bsi->nBytes == 0)
+ *              if at least 8 bytes are left, one 8-byte big-endian load is or'ed in below the valid bits;
+ *                the bits of the partial byte beyond cachedBits are the true bits of the next byte, so
+ *                or'ing them in again on the next refill does not change them
+ *              bits beyond the end of the buffer read as zero, cachedBits goes negative on overrun
  *              stores data as big-endian in cache, regardless of machine endian-ness
  **********************************************************************************************************************/
-//Optimized for REV16, REV32 (FB)
 inline void RefillBitstreamCache()
 {
-    int nBytes = m_aac_BitStreamInfo.nBytes;
-    if (nBytes >= 4) {
-        /* optimize for common case, independent of machine endian-ness */
-    	m_aac_BitStreamInfo.iCache  = (*m_aac_BitStreamInfo.bytePtr++) << 24;
-    	m_aac_BitStreamInfo.iCache |= (*m_aac_BitStreamInfo.bytePtr++) << 16;
-    	m_aac_BitStreamInfo.iCache |= (*m_aac_BitStreamInfo.bytePtr++) <<  8;
-    	m_aac_BitStreamInfo.iCache |= (*m_aac_BitStreamInfo.bytePtr++);
-
-    	m_aac_BitStreamInfo.cachedBits = 32;
-    	m_aac_BitStreamInfo.nBytes -= 4;
+    aac_BitStreamInfo_t *bsi = &m_aac_BitStreamInfo;
+    const uint8_t *p = bsi->bytePtr;
+    int n;
+
+    if (bsi->nBytes >= 8) {
+        /* common case, no bounds check per byte */
+        uint64_t v = ((uint64_t)((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]) << 32) |
+                      (uint32_t)((p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7]);
+        n = (64 - bsi->cachedBits) >> 3;    /* whole bytes that fit, 1 - 8 */
+        bsi->cache |= v >> bsi->cachedBits;
+        bsi->bytePtr += n;
+        bsi->nBytes -= n;
+        bsi->cachedBits += (n << 3);
     } else {
-    	m_aac_BitStreamInfo.iCache = 0;
-        while (nBytes--) {
-        	m_aac_BitStreamInfo.iCache |= (*m_aac_BitStreamInfo.bytePtr++);
-        	m_aac_BitStreamInfo.iCache <<= 8;
+        /* end of buffer */
+        while (bsi->nBytes > 0 && bsi->cachedBits <= 56) {
+            bsi->cache |= (uint64_t)(*bsi->bytePtr++) << (56 - bsi->cachedBits);
+            bsi->cachedBits += 8;
+            bsi->nBytes--;
         }
-        m_aac_BitStreamInfo.iCache <<= ((3 - m_aac_BitStreamInfo.nBytes)*8);
-        m_aac_BitStreamInfo.cachedBits = 8*m_aac_BitStreamInfo.nBytes;
-        m_aac_BitStreamInfo.nBytes = 0;
     }
 }
 
+/***********************************************************************************************************************
+ * Function:    PeekBitstreamCache
+ *
+ * Description: get the next 32 bits from bitstream, do not advance bitstream pointer
+ *
+ * Inputs:      none
+ *
+ * Outputs:     updated bitstream info struct (cache may be refilled, bit position unchanged)
+ *
+ * Return:      the next 32 bits of data from bitstream buffer, left-justified
+ *
+ * Notes:       used by the spectral Huffman decoders which need at most 20 bits (code + signs) per symbol,
+ *                any bits past the end of the buffer are zero
+ **********************************************************************************************************************/
+inline uint32_t PeekBitstreamCache()
+{
+    if (m_aac_BitStreamInfo.cachedBits < 32)
+        RefillBitstreamCache();
+    return (uint32_t)(m_aac_BitStreamInfo.cache >> 32);
+}
+
+/***********************************************************************************************************************
+ * Function:    SkipBitstreamCache
+ *
+ * Description: consume bits which are known to be in the cache
+ *
+ * Inputs:      number of bits to advance bitstream, [0, 32]
+ *
+ * Outputs:     updated bitstream info struct
+ *
+ * Return:      none
+ *
+ * Notes:       only call after PeekBitstreamCache(), no refill
+ **********************************************************************************************************************/
+inline void SkipBitstreamCache(int nBits)
+{
+    m_aac_BitStreamInfo.cache <<= nBits;
+    m_aac_BitStreamInfo.cachedBits -= nBits;
+}
+
 /***********************************************************************************************************************
  * Function:    GetBits
  *
@@ -5645,23 +6135,12 @@ inline void RefillBitstreamCache()
  **********************************************************************************************************************/
 uint32_t GetBits(int nBits)
 {
-    uint32_t data, lowBits;
+    uint32_t data;
 
     nBits &= 0x1f;                          /* nBits mod 32 to avoid unpredictable results like >> by negative amount */
-    data = m_aac_BitStreamInfo.iCache >> (31 - nBits);        /* unsigned >> so zero-extend */
-    data >>= 1;                                         /* do as >> 31, >> 1 so that nBits = 0 works okay (returns 0) */
-    m_aac_BitStreamInfo.iCache <<= nBits;                    /* left-justify cache */
-    m_aac_BitStreamInfo.cachedBits -= nBits;                 /* how many bits have we drawn from the cache so far */
-
-    /* if we cross an int boundary, refill the cache */
-    if (m_aac_BitStreamInfo.cachedBits < 0) {
-        lowBits = -m_aac_BitStreamInfo.cachedBits;
-        RefillBitstreamCache();
-        data |= m_aac_BitStreamInfo.iCache >> (32 - lowBits);        /* get the low-order bits */
-
-        m_aac_BitStreamInfo.cachedBits -= lowBits;            /* how many bits have we drawn from the cache so far */
-        m_aac_BitStreamInfo.iCache <<= lowBits;            /* left-justify cache */
-    }
+    data = PeekBitstreamCache() >> (31 - nBits);    /* unsigned >> so zero-extend */
+    data >>= 1;                                     /* do as >> 31, >> 1 so that nBits = 0 works okay (returns 0) */
+    SkipBitstreamCache(nBits);
 
     return data;
 }
@@ -5674,7 +6153,7 @@ uint32_t GetBits(int nBits)
  * Inputs:      pointer to initialized aac_BitStreamInfo_t struct
  *              number of bits to get from bitstream
  *
- * Outputs:     none (state of aac_BitStreamInfo_t struct left unchanged)
+ * Outputs:     none (bit position of aac_BitStreamInfo_t struct left unchanged, cache may be refilled)
  *
  * Return:      the next nBits bits of data from bitstream buffer
  *
@@ -5684,28 +6163,11 @@ uint32_t GetBits(int nBits)
  **********************************************************************************************************************/
 uint32_t GetBitsNoAdvance(int nBits)
 {
-    uint8_t *buf;
-    uint32_t data, iCache;
-    int32_t lowBits;
+    uint32_t data;
 
     nBits &= 0x1f;                          /* nBits mod 32 to avoid unpredictable results like >> by negative amount */
-    data = m_aac_BitStreamInfo.iCache >> (31 - nBits);        /* unsigned >> so zero-extend */
-    data >>= 1;                                         /* do as >> 31, >> 1 so that nBits = 0 works okay (returns 0) */
-    lowBits = nBits - m_aac_BitStreamInfo.cachedBits;        /* how many bits do we have left to read */
-
-    /* if we cross an int boundary, read next bytes in buffer */
-    if (lowBits > 0) {
-        iCache = 0;
-        buf = m_aac_BitStreamInfo.bytePtr;
-        while (lowBits > 0) {
-            iCache <<= 8;
-            if (buf < m_aac_BitStreamInfo.bytePtr + m_aac_BitStreamInfo.nBytes)
-                iCache |= (uint32_t)*buf++;
-            lowBits -= 8;
-        }
-        lowBits = -lowBits;
-        data |= iCache >> lowBits;
-    }
+    data = PeekBitstreamCache() >> (31 - nBits);    /* unsigned >> so zero-extend */
+    data >>= 1;                                     /* do as >> 31, >> 1 so that nBits = 0 works okay (returns 0) */
 
     return data;
 }
@@ -5726,12 +6188,9 @@ uint32_t GetBitsNoAdvance(int nBits)
 void AdvanceBitstream(int nBits)
 {
     nBits &= 0x1f;
-    if (nBits > m_aac_BitStreamInfo.cachedBits) {
-        nBits -= m_aac_BitStreamInfo.cachedBits;
+    if (nBits > m_aac_BitStreamInfo.cachedBits)
         RefillBitstreamCache();
-    }
-    m_aac_BitStreamInfo.iCache <<= nBits;
-    m_aac_BitStreamInfo.cachedBits -= nBits;
+    SkipBitstreamCache(nBits);
 }
 
 /***********************************************************************************************************************
@@ -6,6 +6,15 @@
 
 #define ASSERT(x) /* do nothing */
 
+/* the DCT4/FFT kernels run once per channel and frame (8 times for short blocks), keep them in IRAM
+ * so that they do not compete with the tables for the flash cache
+ */
+#ifndef AAC_KERNEL_IRAM
+#define AAC_KERNEL_IRAM IRAM_ATTR
+#endif
+
+//#define AAC_KERNEL_PROFILE   /* count CPU cycles of the DCT4 kernels and Huffman decoding, see AACGetKernelStats() */
+
 #ifndef MAX
 #define MAX(a,b)    ((a) > (b) ? (a) : (b))
 #endif
@@ -78,7 +87,7 @@ typedef struct _AACDecInfo_t {
 
 typedef struct _aac_BitStreamInfo_t {
     uint8_t *bytePtr;
-    uint32_t iCache;
+    uint64_t cache;        /* left-justified, bits past cachedBits are zero or the true bits of *bytePtr */
     int cachedBits;
     int nBytes;
 } aac_BitStreamInfo_t;
@@ -203,6 +212,21 @@ typedef struct _ProgConfigElement_t {
     uint8_t cce[15];       /* [MAX_NUM_BCE] channel coupling elements: bit 4 = switching flag, bits 3-0 = inst tag */
 } ProgConfigElement_t;
 
+/* CPU cycles spent in the DCT4 kernels and the bitstream reader, only counted if AAC_KERNEL_PROFILE is defined */
+typedef struct _AACKernelStats_t {
+    uint32_t frames;       /* number of decoded frames */
+    uint32_t calls;        /* number of DCT4 calls */
+    uint32_t preMultiply;  /* PreMultiply, PreMultiplyRescale */
+    uint32_t bitReverse;
+    uint32_t firstPass;    /* R4FirstPass (short blocks), R8FirstPass (long blocks) */
+    uint32_t r4Core;
+    uint32_t postMultiply; /* PostMultiply, PostMultiplyRescale */
+    uint32_t windowOverlap;/* DecWindowOverlap family, per frame */
+    uint32_t noiseless;    /* DecodeNoiselessData (side info + spectral Huffman), per frame */
+    uint32_t stereo;       /* StereoProcess (mid-side, intensity), per frame */
+    uint32_t pnsTns;       /* PNS and TNSFilter, per frame */
+} AACKernelStats_t;
+
 /* state info struct for baseline (MPEG-4 LC) decoding */
 typedef struct _PSInfoBase_t {
     int                   dataCount;
@@ -224,7 +248,7 @@ typedef struct _PSInfoBase_t {
 //    PulseInfo_t           pulseInfo[2]; // [MAX_NCHANS_ELEM]
     TNSInfo_t             tnsInfo[2]; // [MAX_NCHANS_ELEM]
     int                   tnsLPCBuf[20]; // [MAX_TNS_ORDER]
-    int                   tnsWorkBuf[20]; //[MAX_TNS_ORDER]
+    int                   tnsWorkBuf[40]; //[2*MAX_TNS_ORDER], FilterRegion() keeps the history twice
     GainControlInfo_t     gainControlInfo[2]; // [MAX_NCHANS_ELEM]
     int                   gbCurrent[2];  // [MAX_NCHANS_ELEM]
     int                   coef[2][1024]; // [MAX_NCHANS_ELEM][AAC_MAX_NSAMPS]
@@ -238,12 +262,15 @@ void AACDecoder_FreeBuffers(void);
 int AACFindSyncWord(uint8_t *buf, int nBytes);
 void AACGetLastFrameInfo(AACFrameInfo_t *aacFrameInfo);
 int AACDecode(uint8_t *inbuf, int *bytesLeft, short *outbuf);
+int AACDecode32(uint8_t *inbuf, int *bytesLeft, int32_t *outbuf);
+template <typename pcm_t> int AACDecodeFrame(uint8_t *inbuf, int *bytesLeft, pcm_t *outbuf);
 int AACGetSampRate();
 int AACGetChannels();
 int AACGetBitsPerSample();
 int AACGetBitrate();
 int AACGetOutputSamps();
 int AACGetBitrate();
+AACKernelStats_t *AACGetKernelStats();
 void DecodeLPCCoefs(int order, int res, int8_t *filtCoef, int *a, int *b);
 int FilterRegion(int size, int dir, int order, int *audioCoef, int *a, int *hist);
 int TNSFilter(int ch);
@@ -270,11 +297,13 @@ void UnpackPairsNoEsc(int cb, int nVals, int *coef);
 void UnpackPairsEsc(int cb, int nVals, int *coef);
 void DecodeSpectrumLong(int ch);
 void DecodeSpectrumShort(int ch);
-void DecWindowOverlap(int *buf0, int *over0, short *pcm0, int nChans, int winTypeCurr, int winTypePrev);
-void DecWindowOverlapLongStart(int *buf0, int *over0, short *pcm0, int nChans, int winTypeCurr, int winTypePrev);
-void DecWindowOverlapLongStop(int *buf0, int *over0, short *pcm0, int nChans, int winTypeCurr, int winTypePrev);
-void DecWindowOverlapShort(int *buf0, int *over0, short *pcm0, int nChans, int winTypeCurr, int winTypePrev);
-int IMDCT(int ch, int chOut, short *outbuf);
+template <typename pcm_t> void DecWindowOverlap(int *buf0, int *over0, pcm_t *pcm0, int nChans, int winTypeCurr, int winTypePrev);
+template <typename pcm_t> void DecWindowOverlapStereo(int *bufL, int *bufR, int *overL0, int *overR0, pcm_t *pcm0, int winTypeCurr, int winTypePrev);
+template <typename pcm_t> int UseStereoWindowOverlap(int baseChan, pcm_t *outbuf);
+template <typename pcm_t> void DecWindowOverlapLongStart(int *buf0, int *over0, pcm_t *pcm0, int nChans, int winTypeCurr, int winTypePrev);
+template <typename pcm_t> void DecWindowOverlapLongStop(int *buf0, int *over0, pcm_t *pcm0, int nChans, int winTypeCurr, int winTypePrev);
+template <typename pcm_t> void DecWindowOverlapShort(int *buf0, int *over0, pcm_t *pcm0, int nChans, int winTypeCurr, int winTypePrev);
+template <typename pcm_t> int IMDCT(int ch, int chOut, pcm_t *outbuf);
 void DecodeICSInfo(ICSInfo_t *icsInfo, int sampRateIdx);
 void DecodeSectionData(int winSequence, int numWinGrp, int maxSFB, uint8_t *sfbCodeBook);
 int DecodeOneScaleFactor();
@@ -285,6 +314,8 @@ void DecodeGainControlInfo(int winSequence, GainControlInfo_t *gi);
 void DecodeICS(int ch);
 int DecodeNoiselessData(uint8_t **buf, int *bitOffset, int *bitsAvail, int ch);
 int DecodeHuffmanScalar(const signed short *huffTab, const HuffInfo_t *huffTabInfo, uint32_t bitBuf, int32_t *val);
+int BuildHuffTabSpecLUT(uint16_t *lut);
+inline int DecodeHuffmanSpec(const uint16_t *lut, uint32_t bitBuf, int32_t *val);
 int UnpackADTSHeader(uint8_t **buf, int *bitOffset, int *bitsAvail);
 int GetADTSChannelMapping(uint8_t *buf, int bitOffset, int bitsAvail);
 int GetNumChannelsADIF(int nPCE);
@@ -316,6 +347,8 @@ void CVKernel1(int *XBuf, int *accBuf);
 void CVKernel2(int *XBuf, int *accBuf);
 void SetBitstreamPointer(int nBytes, uint8_t *buf);
 inline void RefillBitstreamCache();
+inline uint32_t PeekBitstreamCache();
+inline void SkipBitstreamCache(int nBits);
 uint32_t GetBits(int nBits);
 uint32_t GetBitsNoAdvance(int nBits);
 void AdvanceBitstream(int nBits);
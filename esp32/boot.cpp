@@ -0,0 +1,160 @@
+/*
+ * boot.cpp
+ * runs the steps of setup() in parallel
+ *
+ * Most of the boot time is waiting: the power sequence of the amplifiers, the LCD controller, the SD card
+ * and the serial output of the FPGA coefficient load. Every step gets a task of its own, a step waits for
+ * the steps in its needs mask and delay() inside it yields to the others. The steps share the I2C and SPI
+ * buses, the I2C task (i2c.h) and the SPI transactions keep them apart. setup() calls BootWait() for the
+ * steps the first song needs and goes on, the rest completes in the background.
+ * The start and end of every step are kept for BootReport()
+ ************************************************************************************/
+
+#include "boot.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+static const uint32_t BOOT_DONE_SHIFT = 0;          /* bit i: step i finished */
+static const uint32_t BOOT_FAIL_SHIFT = 8;          /* bit 8 + i: step i failed or was skipped */
+
+static const BootStep_t *s_steps = NULL;
+static uint8_t            s_count = 0;
+static EventGroupHandle_t s_events = NULL;
+static uint32_t           s_start[BOOT_MAX_STEPS];  /* millis() */
+static uint32_t           s_end[BOOT_MAX_STEPS];    /* millis(), 0 while running */
+
+/***********************************************************************************************************************
+ * Function:    BootTask
+ *
+ * Description: task of one step, waits for the steps it needs and runs it
+ *
+ * Inputs:      index of the step
+ *
+ * Outputs:     s_start, s_end, the done bit and if failed the fail bit of the step
+ *
+ * Return:      none, deletes itself
+ **********************************************************************************************************************/
+static void BootTask(void *arg){
+    uint8_t i = (uint8_t)(uintptr_t)arg;
+    const BootStep_t *s = &s_steps[i];
+    EventBits_t bits = 0;
+    bool ok = false;
+
+    if(s->needs) bits = xEventGroupWaitBits(s_events, (EventBits_t)s->needs << BOOT_DONE_SHIFT, pdFALSE, pdTRUE,
+                                            portMAX_DELAY);
+    s_start[i] = millis();
+    if(!(bits & ((EventBits_t)s->needs << BOOT_FAIL_SHIFT))) ok = s->fn();
+    s_end[i] = millis();
+    xEventGroupSetBits(s_events, ((EventBits_t)1 << (i + BOOT_DONE_SHIFT)) |
+                                 (ok ? 0 : (EventBits_t)1 << (i + BOOT_FAIL_SHIFT)));
+    vTaskDelete(NULL);
+}
+
+/***********************************************************************************************************************
+ * Function:    BootStart
+ *
+ * Description: start a task for every step
+ *
+ * Inputs:      steps, n <= BOOT_MAX_STEPS, the list must stay valid until all steps are done
+ *
+ * Outputs:     none
+ *
+ * Return:      false without memory for the tasks
+ *
+ * Notes:       the tasks run at the priority of loop() on either core
+ **********************************************************************************************************************/
+bool BootStart(const BootStep_t *steps, uint8_t n){
+    uint8_t i;
+
+    if(n > BOOT_MAX_STEPS) return false;
+    if(!s_events) s_events = xEventGroupCreate();
+    if(!s_events) return false;
+    s_steps = steps;
+    s_count = n;
+    for(i = 0; i < n; i++){
+        s_start[i] = s_end[i] = 0;
+        if(xTaskCreatePinnedToCore(BootTask, steps[i].name, BOOT_STACK_SIZE, (void*)(uintptr_t)i, 1, NULL,
+                                   tskNO_AFFINITY) != pdPASS){
+            xEventGroupSetBits(s_events, ((EventBits_t)1 << (i + BOOT_DONE_SHIFT)) |
+                                         ((EventBits_t)1 << (i + BOOT_FAIL_SHIFT)));
+        }
+    }
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Function:    BootWait
+ *
+ * Description: wait until the steps of a mask are done
+ *
+ * Inputs:      mask (bit i = step i), timeout in ms
+ *
+ * Outputs:     none
+ *
+ * Return:      true if all of them succeeded, false if one failed or the time ran out
+ **********************************************************************************************************************/
+bool BootWait(uint8_t mask, uint32_t timeoutMs){
+    EventBits_t bits;
+
+    if(!s_events) return false;
+    bits = xEventGroupWaitBits(s_events, (EventBits_t)mask << BOOT_DONE_SHIFT, pdFALSE, pdTRUE,
+                               pdMS_TO_TICKS(timeoutMs));
+    if((bits & ((EventBits_t)mask << BOOT_DONE_SHIFT)) != ((EventBits_t)mask << BOOT_DONE_SHIFT)) return false;
+    return !(bits & ((EventBits_t)mask << BOOT_FAIL_SHIFT));
+}
+
+/***********************************************************************************************************************
+ * Function:    BootFailed
+ *
+ * Description: the step of a mask that made BootWait() return false
+ *
+ * Inputs:      mask (bit i = step i)
+ *
+ * Outputs:     *running = true if the step has not finished (timeout), false if it failed or was skipped
+ *
+ * Return:      name of the first such step, NULL if all of them succeeded
+ **********************************************************************************************************************/
+const char *BootFailed(uint8_t mask, bool *running){
+    EventBits_t bits;
+    uint8_t i;
+
+    *running = false;
+    if(!s_events) return NULL;
+    bits = xEventGroupGetBits(s_events);
+    for(i = 0; i < s_count; i++){
+        if(!(mask & (1 << i))) continue;
+        if(!(bits & ((EventBits_t)1 << (i + BOOT_DONE_SHIFT)))) *running = true;
+        else if(!(bits & ((EventBits_t)1 << (i + BOOT_FAIL_SHIFT)))) continue;
+        return s_steps[i].name;
+    }
+    return NULL;
+}
+
+/***********************************************************************************************************************
+ * Function:    BootReport
+ *
+ * Description: print when every step ran
+ *
+ * Inputs:      output function
+ *
+ * Outputs:     one line per step, ms since reset
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void BootReport(void (*out)(const char*)){
+    EventBits_t bits;
+    char line[80];
+    uint8_t i;
+
+    if(!out || !s_events) return;
+    bits = xEventGroupGetBits(s_events);
+    for(i = 0; i < s_count; i++){
+        if(!(bits & ((EventBits_t)1 << (i + BOOT_DONE_SHIFT))))
+            snprintf(line, sizeof(line), "boot: %-12s %5u ms ... running", s_steps[i].name, s_start[i]);
+        else
+            snprintf(line, sizeof(line), "boot: %-12s %5u ms ... %5u ms%s", s_steps[i].name, s_start[i], s_end[i],
+                     (bits & ((EventBits_t)1 << (i + BOOT_FAIL_SHIFT))) ? " failed" : "");
+        out(line);
+    }
+}
@@ -0,0 +1,19 @@
+// boot scheduler: the steps of setup() run as tasks, each starts as soon as the steps it needs are done,
+// setup() waits only for the steps the first song needs, the others finish while it plays
+#pragma once
+
+#include "Arduino.h"
+
+const uint8_t  BOOT_MAX_STEPS       = 8;
+const uint16_t BOOT_STACK_SIZE      = 6144;         /* per step task, SD mount and the directory walk need most */
+
+typedef struct _BootStep_t {
+    const char *name;
+    bool      (*fn)(void);       /* false = failed, the steps that need it are skipped and fail too */
+    uint8_t     needs;           /* bit i set = step i must be done first */
+} BootStep_t;
+
+bool BootStart(const BootStep_t *steps, uint8_t n);
+bool BootWait(uint8_t mask, uint32_t timeoutMs);
+const char *BootFailed(uint8_t mask, bool *running);
+void BootReport(void (*out)(const char*));
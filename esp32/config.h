@@ -5,6 +5,16 @@
 #define TAS5753MD
 #define SDCARD
 //#define WEB_RADIO
+#define I2S_32BIT   // 32 bit I2S slots carrying up to 24 bit data (FPGA 24/32 packaging), comment out for 16/16
+//#define CROSSFADE_MS 3000 // equal power crossfade between the shuffled songs, more than ~150 ms needs PSRAM
+//#define SRC_RATE 48000   // resample every song to one rate, the crossover is loaded once (SRC_QUALITY 0, 1, 2 = 24, 48, 64 taps)
+#define SRC_QUALITY 1
+// memory placement (mem_place.h), MEM_INTERNAL or MEM_PSRAM per class, PSRAM falls back to internal RAM without it
+#define MEM_PLACE_HOT    MEM_INTERNAL  // decoder working sets read and written per sample (IMDCT, polyphase, AAC spectra ...)
+#define MEM_PLACE_STATE  MEM_INTERNAL  // per frame decoder state (headers, side info, bit reservoir)
+#define MEM_PLACE_BULK   MEM_PSRAM     // input buffer, crossfade ring, FLAC frame buffer
+//#define MEM_TABLES_DRAM              // copy the hot decoder tables from flash to internal RAM while the codec is in use (AAC 22 KB, MP3 10 KB)
+#define FAST_BOOT       // setup() steps as parallel tasks (boot.h), the first song starts when the FPGA crossover and amplifier 0 are ready
 
 #define LCD_RST     25
 
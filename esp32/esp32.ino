@@ -29,6 +29,8 @@
 #include "Audio.h"
 #include "biquad.h"
 #include "lcdST7032.h"
+#include "i2c.h"
+#include "boot.h"
 
 Preferences preferences;
 Ticker  ticker;
@@ -97,11 +99,15 @@ File selectFileIncrement(int number, File dir){
 
 bool canPlay(const char* fileName) {
   return ( strstr(fileName, ".mp3") || strstr(fileName, ".MP3") ||
-           strstr(fileName, ".wav") || strstr(fileName, ".WAV")) ? true : false;  
+           strstr(fileName, ".wav") || strstr(fileName, ".WAV") ||
+           strstr(fileName, ".flac") || strstr(fileName, ".FLAC")) ? true : false;  
   }
 
 
-void playFirst(String songName) {
+char firstSongName[60];
+
+// skip a random number of songs past the one played first last time, and save this in preferences
+void selectFirst(String songName) {
   File entry = SD.open(songName);
   if (entry) {
     entry.close();
@@ -110,11 +116,96 @@ void playFirst(String songName) {
   entry = selectFileIncrement(increment, root);      
   preferences.putString("first_song",entry.name());
   preferences.end();
-  char szName[60];
-  strcpy(szName, entry.name());     
-  lcd_printScreen("%s", szName+1);//remove the leading "/"
-  Serial.print("Play first ");Serial.println(entry.name());
-  audio.connecttoFS(SD, entry.name());
+  strcpy(firstSongName, entry.name());     
+  }
+
+void playFirst() {
+  lcd_printScreen("%s", firstSongName+1);//remove the leading "/"
+  Serial.print("Play first ");Serial.println(firstSongName);
+  audio.connecttoFS(SD, firstSongName);
+  }
+
+
+// setup() steps, with FAST_BOOT each one is a task that starts when the steps in its needs mask are done
+#ifdef SRC_RATE
+  #define BOOT_CROSSOVER_RATE SRC_RATE
+#else
+  #define BOOT_CROSSOVER_RATE 44100 // most of the songs, a file at another rate reloads the crossover
+#endif
+
+enum {BOOT_LCD, BOOT_AMP_POWER, BOOT_AMP0, BOOT_AMP1, BOOT_SD, BOOT_FPGA, BOOT_INDEX, BOOT_STEPS};
+
+bool bootLcd() {
+  lcd_begin();
+  lcd_printf(0,0,"ESP32 FPGA-xover");
+  lcd_printf(1,0,"Audio I2S player");
+  return true;
+  }
+
+bool bootAmpPower() {
+#ifdef TAS5753MD
+  tas5753md_powerUp();
+#endif
+  return true;
+  }
+
+bool bootAmp0() {
+#ifdef TAS5753MD
+  return tas5753md_configDevice(0) != 0;
+#else
+  return true;
+#endif
+  }
+
+bool bootAmp1() {
+#ifdef TAS5753MD
+  return tas5753md_configDevice(1) != 0;
+#else
+  return true;
+#endif
+  }
+
+bool bootSd() {
+#ifdef SDCARD
+  adcAttachPin(35); // select unused floating pin 35 as analog ADC input 
+  randomSeed(analogRead(35)); // adc read from a floating pin gives an unpredictable number
+  if (!SD.begin(SD_CS)) return false;
+  root = SD.open("/");
+  return root ? true : false;
+#else
+  return true;
+#endif
+  }
+
+bool bootFpga() {
+  // the coefficients for the rate of the first song, Audio skips the reload if the rate matches
+  biquad_loadCoeffs_LR((double)BOOT_CROSSOVER_RATE);
+  return true;
+  }
+
+bool bootIndex() {
+#ifdef SDCARD
+  // Get the first song played last time
+  preferences.begin("esp32_i2s", false);
+  String fileName = preferences.getString("first_song", String("not_found"));
+  Serial.print("First song played last time : "); Serial.println(fileName);
+  selectFirst(fileName);
+#endif
+  return true;
+  }
+
+const BootStep_t bootSteps[BOOT_STEPS] = {
+  {"lcd",       bootLcd,      0},
+  {"amp power", bootAmpPower, 0},
+  {"amp0",      bootAmp0,     1 << BOOT_AMP_POWER},
+  {"amp1",      bootAmp1,     1 << BOOT_AMP_POWER},
+  {"sd",        bootSd,       0},
+  {"fpga",      bootFpga,     0},
+  {"index",     bootIndex,    1 << BOOT_SD},
+  };
+
+void printLine(const char *line) {
+  Serial.println(line);
   }
 
 void playNext(int index, File dir) {
@@ -137,17 +228,27 @@ void setup() {
     pinMode(PIN_FPGA_CS, OUTPUT);
     digitalWrite(PIN_FPGA_CS, HIGH);
     pinMode(PIN_ENC_BTN, INPUT);
-    Wire.begin(I2C_SDA, I2C_SCL);
-    
-    lcd_begin();
-    lcd_printf(0,0,"ESP32 FPGA-xover");
-    lcd_printf(1,0,"Audio I2S player");
-    delay(2000);
-    
+    i2c_begin(I2C_SDA, I2C_SCL); // the I2C task, all amplifier and LCD traffic is queued to it
+#ifdef SDCARD    
+    pinMode(SD_CS, OUTPUT);      
+    digitalWrite(SD_CS, HIGH);
+#endif
+    SPI.begin(SPI_SCK, SPI_MISO, SPI_MOSI); // SD and FPGA
+    SPI.setFrequency(10000000);
 #ifdef TAS5753MD
     encoder.attachHalfQuad(ENC_A, ENC_B);
     encoder.setCount(0);
+#endif
+
+#ifdef FAST_BOOT
+    // LCD, amplifiers, SD card, FPGA crossover and song index come up in parallel, the rest of
+    // setup() runs meanwhile, the first song waits only for the steps it needs, amplifier 1 may follow later
+    BootStart(bootSteps, BOOT_STEPS);
+#else
+    bootLcd();
+    delay(2000);
     
+#ifdef TAS5753MD
     // failure configuring TAS5753MD, loop forever
     if (tas5753md_config() == 0) {
       lcd_printScreen("TAS5753MD config error");
@@ -155,16 +256,7 @@ void setup() {
       while (1) delay(1);
       }
 #endif
-    
-#ifdef SDCARD    
-    pinMode(SD_CS, OUTPUT);      
-    digitalWrite(SD_CS, HIGH);
-    SPI.begin(SPI_SCK, SPI_MISO, SPI_MOSI);
-    SPI.setFrequency(10000000);
-    SD.begin(SD_CS);
-    adcAttachPin(35); // select unused floating pin 35 as analog ADC input 
-    randomSeed(analogRead(35)); // adc read from a floating pin gives an unpredictable number
-    root = SD.open("/");
+    bootSd();
 #endif
 
 
@@ -183,14 +275,38 @@ void setup() {
     REG_WRITE(PIN_CTRL, 0xFF0); 
     PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO0_U, FUNC_GPIO0_CLK_OUT1);
     audio.setVolume(10); // 0...21
+#ifdef CROSSFADE_MS
+    audio.setCrossfade(CROSSFADE_MS);
+#endif
+#ifdef SRC_RATE
+    audio.setResampler(SRC_RATE, SRC_QUALITY);
+#endif
 
+#ifdef FAST_BOOT
+    const uint8_t bootFirstSong = (1 << BOOT_LCD) | (1 << BOOT_AMP0) | (1 << BOOT_FPGA);
+    if (!BootWait(bootFirstSong, 5000)) {
+      // a step the first song needs failed (amplifier 0 did not answer) or hangs, loop forever
+      bool running;
+      const char *step = BootFailed(bootFirstSong, &running);
+      if (!step) step = "start";   // BootStart() had no memory
+      lcd_printScreen("boot: %s %s", step, running ? "timeout" : "error");
+      Serial.printf("boot step %s %s, exit setup and loop ...\r\n", step, running ? "timed out" : "failed");
+      BootReport(printLine);
+      while (1) delay(1);
+      }
+    audio.setCrossoverLoaded(BOOT_CROSSOVER_RATE);
+#ifdef SDCARD
+    if (BootWait(1 << BOOT_INDEX, 10000)) playFirst();
+    else {
+      lcd_printScreen("SD card error");
+      Serial.printf("SD card error, no songs\r\n");
+      }
+#endif
+#else
 #ifdef SDCARD
-  // Get the first song played last time, skip a random number of songs
-  // past it, and save this in preferences
-    preferences.begin("esp32_i2s", false);
-    String fileName = preferences.getString("first_song", String("not_found"));
-    Serial.print("First song played last time : "); Serial.println(fileName);
-    playFirst(fileName);
+    bootIndex();
+    playFirst();
+#endif
 #endif
 
     
@@ -200,6 +316,7 @@ void setup() {
   //  audio.connecttohost("http://mp3.ffh.de/radioffh/hqlivestream.aac"); //  128k aac
   //  audio.connecttohost("http://mp3.ffh.de/radioffh/hqlivestream.mp3"); //  128k mp3
   //  audio.connecttospeech("Wenn die Hunde schlafen, kann der Wolf gut Schafe stehlen.", "de");
+  //  audio.startRecording(SD, "/rec");  // archive the stream on SD, one file per StreamTitle
 #endif
 
    ticker.attach(0.025, btn_debounce);
@@ -209,6 +326,14 @@ void setup() {
 
  
 void loop(){
+    static bool bootReported = false;
+    if (!bootReported && audio.getFirstSampleTime()) {
+      bootReported = true;
+      Serial.printf("boot: first sample after %u ms\r\n", audio.getFirstSampleTime());
+  #ifdef FAST_BOOT
+      BootReport(printLine);
+  #endif
+      }
   #ifdef TAS5753MD
     int64_t enc = encoder.getCount();
     if (enc != encoderCount) {
@@ -241,7 +366,24 @@ void audio_id3data(const char *info){
   //Serial.println(info);
   }
 
+char nextSongName[60];
+
+void audio_preroll(const char *info){
+  // the current song is read completely, queue the next one so that it follows without a gap
+  File entry = selectFileIncrement(random(20)+1, root);
+  strcpy(nextSongName, entry.name());
+  audio.connecttoFSNext(SD, entry.name());
+  }
+
 void audio_eof_mp3(const char *info){  
+  i2c_report(printLine);
+  if (audio.isRunning()) { // the queued song plays already
+    lcd_printScreen("%s", nextSongName+1);//remove the leading "/"
+    Serial.print("playNext : ");
+    Serial.println(nextSongName);
+    Serial.println();
+    return;
+    }
   // skip a random number of songs and play next
   int index = random(20)+1;
   playNext(index, root);
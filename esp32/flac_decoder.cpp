@@ -0,0 +1,1115 @@
+/*
+ * flac_decoder.cpp
+ * FLAC decoder, fixed and LPC subframes with Rice coded residuals
+ *
+ * the input is appended to a frame buffer, a frame is decoded as soon as the header of the
+ * following frame (or the end of the stream) is in the buffer and the CRC-16 matches
+ * a decoded block is returned in pieces of at most FLAC_MAX_OUT_SAMPS samples per channel
+ ************************************************************************************/
+
+#include "flac_decoder.h"
+#include "mem_place.h"
+
+const uint8_t  FLAC_MAX_NCHANS      = 2;
+const uint16_t FLAC_MAX_BLOCKSIZE   = 4608;         /* largest block size of the streamable subset at <= 48kHz */
+const uint16_t FLAC_MAX_OUT_SAMPS   = 2048;         /* samples per channel per FLACDecode() call, size of Audio::m_outBuff */
+const uint8_t  FLAC_MAX_BPS         = 24;
+const uint8_t  FLAC_MAX_HEADER_BYTES = 16;          /* sync, codes, 7 byte UTF-8 number, block size, sample rate, CRC-8 */
+const uint8_t  FLAC_MIN_HEADER_BYTES = 6;
+const uint8_t  FLAC_MAX_FIXED_ORDER = 4;
+const uint8_t  FLAC_MAX_LPC_ORDER   = 32;
+const uint8_t  FLAC_STREAMINFO_LEN  = 34;
+const uint8_t  FLAC_CHAN_LEFT_SIDE  = 8;
+const uint8_t  FLAC_CHAN_RIGHT_SIDE = 9;
+const uint8_t  FLAC_CHAN_MID_SIDE   = 10;
+const uint8_t  FLAC_SUBFRAME_CONSTANT = 0;
+const uint8_t  FLAC_SUBFRAME_VERBATIM = 1;
+const uint8_t  FLAC_SUBFRAME_FIXED  = 8;            /* 001xxx, xxx = order */
+const uint8_t  FLAC_SUBFRAME_LPC    = 32;           /* 1xxxxx, xxxxx = order - 1 */
+
+FLACDecInfo_t       *m_FLACDecInfo;
+FLACBitStreamInfo_t  m_flacBSI;
+int32_t             *m_flacSamples[FLAC_MAX_NCHANS];
+
+const uint32_t flacSampRateTab[12] PROGMEM = {
+    0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000
+};
+
+const uint8_t flacBitsPerSampleTab[8] PROGMEM = {
+    0, 8, 12, 0, 16, 20, 24, 0
+};
+
+const uint8_t flacCrc8Tab[256] PROGMEM = {
+    0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
+    0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65, 0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
+    0xe0, 0xe7, 0xee, 0xe9, 0xfc, 0xfb, 0xf2, 0xf5, 0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
+    0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85, 0xa8, 0xaf, 0xa6, 0xa1, 0xb4, 0xb3, 0xba, 0xbd,
+    0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2, 0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea,
+    0xb7, 0xb0, 0xb9, 0xbe, 0xab, 0xac, 0xa5, 0xa2, 0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
+    0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32, 0x1f, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0d, 0x0a,
+    0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42, 0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a,
+    0x89, 0x8e, 0x87, 0x80, 0x95, 0x92, 0x9b, 0x9c, 0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
+    0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec, 0xc1, 0xc6, 0xcf, 0xc8, 0xdd, 0xda, 0xd3, 0xd4,
+    0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c, 0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44,
+    0x19, 0x1e, 0x17, 0x10, 0x05, 0x02, 0x0b, 0x0c, 0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
+    0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b, 0x76, 0x71, 0x78, 0x7f, 0x6a, 0x6d, 0x64, 0x63,
+    0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b, 0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13,
+    0xae, 0xa9, 0xa0, 0xa7, 0xb2, 0xb5, 0xbc, 0xbb, 0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8d, 0x84, 0x83,
+    0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
+};
+
+const uint16_t flacCrc16Tab[256] PROGMEM = {
+    0x0000, 0x8005, 0x800f, 0x000a, 0x801b, 0x001e, 0x0014, 0x8011,
+    0x8033, 0x0036, 0x003c, 0x8039, 0x0028, 0x802d, 0x8027, 0x0022,
+    0x8063, 0x0066, 0x006c, 0x8069, 0x0078, 0x807d, 0x8077, 0x0072,
+    0x0050, 0x8055, 0x805f, 0x005a, 0x804b, 0x004e, 0x0044, 0x8041,
+    0x80c3, 0x00c6, 0x00cc, 0x80c9, 0x00d8, 0x80dd, 0x80d7, 0x00d2,
+    0x00f0, 0x80f5, 0x80ff, 0x00fa, 0x80eb, 0x00ee, 0x00e4, 0x80e1,
+    0x00a0, 0x80a5, 0x80af, 0x00aa, 0x80bb, 0x00be, 0x00b4, 0x80b1,
+    0x8093, 0x0096, 0x009c, 0x8099, 0x0088, 0x808d, 0x8087, 0x0082,
+    0x8183, 0x0186, 0x018c, 0x8189, 0x0198, 0x819d, 0x8197, 0x0192,
+    0x01b0, 0x81b5, 0x81bf, 0x01ba, 0x81ab, 0x01ae, 0x01a4, 0x81a1,
+    0x01e0, 0x81e5, 0x81ef, 0x01ea, 0x81fb, 0x01fe, 0x01f4, 0x81f1,
+    0x81d3, 0x01d6, 0x01dc, 0x81d9, 0x01c8, 0x81cd, 0x81c7, 0x01c2,
+    0x0140, 0x8145, 0x814f, 0x014a, 0x815b, 0x015e, 0x0154, 0x8151,
+    0x8173, 0x0176, 0x017c, 0x8179, 0x0168, 0x816d, 0x8167, 0x0162,
+    0x8123, 0x0126, 0x012c, 0x8129, 0x0138, 0x813d, 0x8137, 0x0132,
+    0x0110, 0x8115, 0x811f, 0x011a, 0x810b, 0x010e, 0x0104, 0x8101,
+    0x8303, 0x0306, 0x030c, 0x8309, 0x0318, 0x831d, 0x8317, 0x0312,
+    0x0330, 0x8335, 0x833f, 0x033a, 0x832b, 0x032e, 0x0324, 0x8321,
+    0x0360, 0x8365, 0x836f, 0x036a, 0x837b, 0x037e, 0x0374, 0x8371,
+    0x8353, 0x0356, 0x035c, 0x8359, 0x0348, 0x834d, 0x8347, 0x0342,
+    0x03c0, 0x83c5, 0x83cf, 0x03ca, 0x83db, 0x03de, 0x03d4, 0x83d1,
+    0x83f3, 0x03f6, 0x03fc, 0x83f9, 0x03e8, 0x83ed, 0x83e7, 0x03e2,
+    0x83a3, 0x03a6, 0x03ac, 0x83a9, 0x03b8, 0x83bd, 0x83b7, 0x03b2,
+    0x0390, 0x8395, 0x839f, 0x039a, 0x838b, 0x038e, 0x0384, 0x8381,
+    0x0280, 0x8285, 0x828f, 0x028a, 0x829b, 0x029e, 0x0294, 0x8291,
+    0x82b3, 0x02b6, 0x02bc, 0x82b9, 0x02a8, 0x82ad, 0x82a7, 0x02a2,
+    0x82e3, 0x02e6, 0x02ec, 0x82e9, 0x02f8, 0x82fd, 0x82f7, 0x02f2,
+    0x02d0, 0x82d5, 0x82df, 0x02da, 0x82cb, 0x02ce, 0x02c4, 0x82c1,
+    0x8243, 0x0246, 0x024c, 0x8249, 0x0258, 0x825d, 0x8257, 0x0252,
+    0x0270, 0x8275, 0x827f, 0x027a, 0x826b, 0x026e, 0x0264, 0x8261,
+    0x0220, 0x8225, 0x822f, 0x022a, 0x823b, 0x023e, 0x0234, 0x8231,
+    0x8213, 0x0216, 0x021c, 0x8219, 0x0208, 0x820d, 0x8207, 0x0202
+};
+
+/***********************************************************************************************************************
+ * Function:    FLACDecoder_AllocateBuffers
+ *
+ * Description: allocate the decoder state and the sample buffers of the FLAC decoder
+ *
+ * Inputs:      none
+ *
+ * Outputs:     none
+ *
+ * Return:      false if not enough memory, otherwise true
+ *
+ * Notes:       the frame buffer depends on the stream, it is allocated by FLACParseStreamInfo()
+ **********************************************************************************************************************/
+bool FLACDecoder_AllocateBuffers(void){
+    if(!m_FLACDecInfo)     {m_FLACDecInfo = (FLACDecInfo_t*) MemAlloc(MEM_STATE, sizeof(FLACDecInfo_t), "FLACDecInfo");}
+    for(int ch = 0; ch < FLAC_MAX_NCHANS; ch++){
+        if(!m_flacSamples[ch]) m_flacSamples[ch] = (int32_t*) MemAlloc(MEM_HOT, sizeof(int32_t) * FLAC_MAX_BLOCKSIZE, "flacSamples");
+    }
+    if(!m_FLACDecInfo || !m_flacSamples[0] || !m_flacSamples[1]) {
+            log_e("not enough memory to allocate flacdecoder buffers");
+            return false;
+    }
+    if(m_FLACDecInfo->frameBuf) MemFree(m_FLACDecInfo->frameBuf);
+    memset(m_FLACDecInfo, 0, sizeof(FLACDecInfo_t));
+    memset(&m_flacBSI,    0, sizeof(FLACBitStreamInfo_t));
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecoder_FreeBuffers
+ *
+ * Description: free all the memory of the FLAC decoder
+ *
+ * Inputs:      none
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void FLACDecoder_FreeBuffers(void){
+    if(m_FLACDecInfo){
+        if(m_FLACDecInfo->frameBuf)          {MemFree(m_FLACDecInfo->frameBuf);}
+        MemFree(m_FLACDecInfo);              m_FLACDecInfo = NULL;
+    }
+    for(int ch = 0; ch < FLAC_MAX_NCHANS; ch++){
+        if(m_flacSamples[ch])                {MemFree(m_flacSamples[ch]); m_flacSamples[ch] = NULL;}
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecoder_ClearBuffer
+ *
+ * Description: drop the buffered input and the not yet returned samples, e.g. before a resync or a seek
+ *
+ * Inputs:      none
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void FLACDecoder_ClearBuffer(void){
+    if(!m_FLACDecInfo) return;
+    m_FLACDecInfo->frameBufFill = 0;
+    m_FLACDecInfo->searchPos = FLAC_MIN_HEADER_BYTES;
+    m_FLACDecInfo->crc = 0;
+    m_FLACDecInfo->crcPos = 0;
+    m_FLACDecInfo->blockSize = 0;
+    m_FLACDecInfo->outPos = 0;
+    m_FLACDecInfo->outputSamps = 0;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACParseStreamInfo
+ *
+ * Description: read the STREAMINFO metadata block and allocate the frame buffer for this stream
+ *
+ * Inputs:      pointer to the block data (without the 4 byte metadata block header)
+ *              number of valid bytes in buf
+ *
+ * Outputs:     filled streamInfo
+ *
+ * Return:      0 if successful, error code (< 0) if error
+ *
+ * Notes:       the frame buffer holds the largest frame and the header of the next one, if the encoder
+ *                did not store the maximum frame size the worst case of a verbatim frame is used
+ **********************************************************************************************************************/
+int FLACParseStreamInfo(const uint8_t *buf, int len){
+    FLACStreamInfo_t *si;
+    uint32_t size;
+
+    if(!m_FLACDecInfo) return ERR_FLAC_OUT_OF_MEMORY;
+    if(len < FLAC_STREAMINFO_LEN) return ERR_FLAC_INDATA_UNDERFLOW;
+    si = &m_FLACDecInfo->streamInfo;
+
+    si->minBlockSize  = (buf[0] << 8) | buf[1];
+    si->maxBlockSize  = (buf[2] << 8) | buf[3];
+    si->minFrameSize  = (buf[4] << 16) | (buf[5] << 8) | buf[6];
+    si->maxFrameSize  = (buf[7] << 16) | (buf[8] << 8) | buf[9];
+    si->sampRate      = (buf[10] << 12) | (buf[11] << 4) | (buf[12] >> 4);
+    si->nChans        = ((buf[12] >> 1) & 0x07) + 1;
+    si->bitsPerSample = (((buf[12] & 0x01) << 4) | (buf[13] >> 4)) + 1;
+    si->totalSamples  = ((uint64_t)(buf[13] & 0x0f) << 32) |
+                        (uint32_t)((buf[14] << 24) | (buf[15] << 16) | (buf[16] << 8) | buf[17]);
+
+    if(si->sampRate == 0)                       return ERR_FLAC_NO_STREAMINFO;
+    if(si->nChans > FLAC_MAX_NCHANS)            return ERR_FLAC_NCHANS_TOO_HIGH;
+    if(si->bitsPerSample > FLAC_MAX_BPS)        return ERR_FLAC_UNSUPPORTED_FORMAT;
+    if(si->maxBlockSize > FLAC_MAX_BLOCKSIZE)   return ERR_FLAC_BLOCKSIZE_TOO_BIG;
+    if(si->maxBlockSize == 0) si->maxBlockSize = FLAC_MAX_BLOCKSIZE;
+
+    if(si->maxFrameSize)
+        size = si->maxFrameSize;
+    else    /* verbatim subframes, side channel with one extra bit */
+        size = (uint32_t)si->maxBlockSize * si->nChans * (si->bitsPerSample + 1) / 8 + si->nChans * 2 + FLAC_MAX_HEADER_BYTES + 2;
+    size += 2 * FLAC_MAX_HEADER_BYTES;
+
+    if(m_FLACDecInfo->frameBuf) MemFree(m_FLACDecInfo->frameBuf);
+    m_FLACDecInfo->frameBuf = (uint8_t*) MemAlloc(MEM_BULK, size, "FLAC frame buffer");
+    if(!m_FLACDecInfo->frameBuf){
+        m_FLACDecInfo->frameBufSize = 0;
+        log_e("not enough memory to allocate the flac frame buffer (%u bytes)", size);
+        return ERR_FLAC_OUT_OF_MEMORY;
+    }
+    m_FLACDecInfo->frameBufSize = size;
+    FLACDecoder_ClearBuffer();
+    return ERR_FLAC_NONE;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACCrc8
+ *
+ * Description: CRC-8 of the frame header, polynomial x^8 + x^2 + x + 1, initial value 0
+ *
+ * Inputs:      pointer to data, number of bytes
+ *
+ * Outputs:     none
+ *
+ * Return:      crc
+ **********************************************************************************************************************/
+uint8_t FLACCrc8(const uint8_t *buf, int nBytes){
+    uint8_t crc = 0;
+    while(nBytes--) crc = pgm_read_byte(&flacCrc8Tab[crc ^ *buf++]);
+    return crc;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACCrc16
+ *
+ * Description: update the CRC-16 of a frame, polynomial x^16 + x^15 + x^2 + 1
+ *
+ * Inputs:      crc of the previous bytes (0 at the start of the frame)
+ *              pointer to data, number of bytes
+ *
+ * Outputs:     none
+ *
+ * Return:      updated crc
+ *
+ * Notes:       the crc over a whole frame including its CRC-16 footer is 0
+ **********************************************************************************************************************/
+uint16_t FLACCrc16(uint16_t crc, const uint8_t *buf, int nBytes){
+    while(nBytes--) crc = (crc << 8) ^ pgm_read_word(&flacCrc16Tab[(crc >> 8) ^ *buf++]);
+    return crc;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecodeFrameHeader
+ *
+ * Description: parse and verify a frame header
+ *
+ * Inputs:      pointer to the sync word
+ *              number of valid bytes in buf
+ *
+ * Outputs:     filled frame header
+ *
+ * Return:      length of the header in bytes, ERR_FLAC_INDATA_UNDERFLOW if buf ends inside the header,
+ *                ERR_FLAC_INVALID_FRAMEHEADER if this is no header
+ *
+ * Notes:       the CRC-8 is checked, sample rate and sample size code 0 need the STREAMINFO
+ **********************************************************************************************************************/
+int FLACDecodeFrameHeader(const uint8_t *buf, int nBytes, FLACFrameHeader_t *fh){
+    int i, n, bsCode, srCode, chCode, ssCode, extra;
+    uint8_t c;
+    FLACStreamInfo_t *si = &m_FLACDecInfo->streamInfo;
+
+    if(nBytes < 4) return ERR_FLAC_INDATA_UNDERFLOW;
+    if(buf[0] != 0xff || (buf[1] & 0xfe) != 0xf8) return ERR_FLAC_INVALID_FRAMEHEADER;
+    bsCode = buf[2] >> 4;
+    srCode = buf[2] & 0x0f;
+    chCode = buf[3] >> 4;
+    ssCode = (buf[3] >> 1) & 0x07;
+    if(bsCode == 0 || srCode == 15 || chCode > FLAC_CHAN_MID_SIDE || (buf[3] & 0x01)) return ERR_FLAC_INVALID_FRAMEHEADER;
+    if(ssCode == 3 || ssCode == 7) return ERR_FLAC_INVALID_FRAMEHEADER;
+
+    /* frame or sample number, UTF-8 coded */
+    i = 4;
+    if(nBytes < i + 1) return ERR_FLAC_INDATA_UNDERFLOW;
+    c = buf[i++];
+    if(!(c & 0x80))               n = 0;
+    else if((c & 0xe0) == 0xc0)   n = 1;
+    else if((c & 0xf0) == 0xe0)   n = 2;
+    else if((c & 0xf8) == 0xf0)   n = 3;
+    else if((c & 0xfc) == 0xf8)   n = 4;
+    else if((c & 0xfe) == 0xfc)   n = 5;
+    else if(c == 0xfe)            n = 6;
+    else return ERR_FLAC_INVALID_FRAMEHEADER;
+    if(nBytes < i + n) return ERR_FLAC_INDATA_UNDERFLOW;
+    while(n--){
+        if((buf[i++] & 0xc0) != 0x80) return ERR_FLAC_INVALID_FRAMEHEADER;
+    }
+
+    extra = (bsCode == 6) + 2 * (bsCode == 7) + (srCode == 12) + 2 * (srCode == 13 || srCode == 14);
+    if(nBytes < i + extra + 1) return ERR_FLAC_INDATA_UNDERFLOW;
+
+    if(bsCode == 1)         fh->blockSize = 192;
+    else if(bsCode <= 5)    fh->blockSize = 576 << (bsCode - 2);
+    else if(bsCode == 6)   {fh->blockSize = buf[i] + 1; i += 1;}
+    else if(bsCode == 7)   {fh->blockSize = ((buf[i] << 8) | buf[i + 1]) + 1; i += 2;}
+    else                    fh->blockSize = 256 << (bsCode - 8);
+
+    if(srCode == 0)         fh->sampRate = si->sampRate;
+    else if(srCode < 12)    fh->sampRate = pgm_read_dword(&flacSampRateTab[srCode]);
+    else if(srCode == 12)  {fh->sampRate = buf[i] * 1000; i += 1;}
+    else if(srCode == 13)  {fh->sampRate = (buf[i] << 8) | buf[i + 1]; i += 2;}
+    else                   {fh->sampRate = ((buf[i] << 8) | buf[i + 1]) * 10; i += 2;}
+
+    fh->bitsPerSample = ssCode ? pgm_read_byte(&flacBitsPerSampleTab[ssCode]) : si->bitsPerSample;
+    if(fh->sampRate == 0 || fh->bitsPerSample == 0) return ERR_FLAC_INVALID_FRAMEHEADER;
+
+    if(FLACCrc8(buf, i) != buf[i]) return ERR_FLAC_INVALID_FRAMEHEADER;
+    i++;
+
+    fh->blockingStrategy = buf[1] & 0x01;
+    fh->chanAssign = chCode;
+    fh->nChans = (chCode < FLAC_CHAN_LEFT_SIDE) ? chCode + 1 : 2;
+    fh->headerBytes = i;
+    return i;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACFindNextFrame
+ *
+ * Description: locate the next frame header which fits to the stream
+ *
+ * Inputs:      buffer to search, first position to check, number of valid bytes in buf
+ *
+ * Outputs:     none
+ *
+ * Return:      offset of the header, -1 if none was found
+ *
+ * Notes:       a header has to pass the CRC-8 and, if the STREAMINFO is known, match its sample rate,
+ *                channels, sample size and maximum block size, so sync patterns in the audio data are rare
+ *              a header which is cut off at the end of buf is not found
+ **********************************************************************************************************************/
+int FLACFindNextFrame(const uint8_t *buf, int start, int nBytes){
+    FLACFrameHeader_t fh;
+    FLACStreamInfo_t *si = &m_FLACDecInfo->streamInfo;
+    int i;
+
+    for(i = start; i < nBytes - 1; i++){
+        if(buf[i] != 0xff || (buf[i + 1] & 0xfe) != 0xf8) continue;
+        if(FLACDecodeFrameHeader(buf + i, nBytes - i, &fh) < 0) continue;
+        if(si->sampRate){
+            if(fh.sampRate != si->sampRate || fh.nChans != si->nChans) continue;
+            if(fh.bitsPerSample != si->bitsPerSample || fh.blockSize > si->maxBlockSize) continue;
+        }
+        return i;
+    }
+    return -1;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACFindSyncWord
+ *
+ * Description: locate the next frame header in the raw FLAC stream
+ *
+ * Inputs:      buffer to search for the header
+ *              max number of bytes to search in buffer
+ *
+ * Outputs:     none
+ *
+ * Return:      offset to the first frame header (bytes from start of buf)
+ *              -1 if no header was found
+ **********************************************************************************************************************/
+int FLACFindSyncWord(uint8_t *buf, int nBytes){
+    if(!m_FLACDecInfo) return -1;
+    return FLACFindNextFrame(buf, 0, nBytes);
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecode
+ *
+ * Description: decode FLAC frames, 16 bit output
+ *
+ * Inputs:      pointer to the input data, the first call after a sync has to start with a frame header
+ *              number of valid bytes in input, 0 flushes the last frame at the end of the stream
+ *              pointer to outbuf, big enough to hold FLAC_MAX_OUT_SAMPS samples per channel
+ *
+ * Outputs:     interleaved PCM, FLACGetOutputSamps() samples
+ *              updated bytesLeft
+ *
+ * Return:      0 if successful, error code (< 0) if error
+ *              ERR_FLAC_INDATA_UNDERFLOW if the input was buffered but no frame is complete yet
+ *
+ * Notes:       a block is returned in pieces of FLAC_MAX_OUT_SAMPS, while samples are pending no input
+ *                is consumed
+ *              samples of more than 16 bits are rounded and saturated
+ **********************************************************************************************************************/
+int FLACDecode(uint8_t *inbuf, int *bytesLeft, short *outbuf){
+    FLACDecInfo_t *di = m_FLACDecInfo;
+    int err, i, n, nChans, shift;
+    const int32_t *s0, *s1;
+
+    if(!di || !di->frameBuf) return ERR_FLAC_NO_STREAMINFO;
+    di->outputSamps = 0;
+    if(di->outPos >= di->blockSize){
+        err = FLACFillAndDecode(inbuf, bytesLeft);
+        if(err) return err;
+    }
+
+    nChans = di->frameHeader.nChans;
+    n = di->blockSize - di->outPos;
+    if(n > FLAC_MAX_OUT_SAMPS) n = FLAC_MAX_OUT_SAMPS;
+    s0 = m_flacSamples[0] + di->outPos;
+    s1 = m_flacSamples[nChans - 1] + di->outPos;
+    shift = di->frameHeader.bitsPerSample - 16;
+
+    if(shift == 0){
+        if(nChans == 2) for(i = 0; i < n; i++) {*outbuf++ = (short)s0[i]; *outbuf++ = (short)s1[i];}
+        else            for(i = 0; i < n; i++)  *outbuf++ = (short)s0[i];
+    }
+    else if(shift < 0){
+        shift = -shift;
+        for(i = 0; i < n; i++){
+            *outbuf++ = (short)(s0[i] << shift);
+            if(nChans == 2) *outbuf++ = (short)(s1[i] << shift);
+        }
+    }
+    else{
+        int32_t rnd = 1 << (shift - 1), x;
+        for(i = 0; i < n; i++){
+            x = (s0[i] + rnd) >> shift;
+            if(x > 32767) x = 32767;
+            *outbuf++ = (short)x;
+            if(nChans == 2){
+                x = (s1[i] + rnd) >> shift;
+                if(x > 32767) x = 32767;
+                *outbuf++ = (short)x;
+            }
+        }
+    }
+    di->outPos += n;
+    di->outputSamps = n * nChans;
+    return ERR_FLAC_NONE;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecode32
+ *
+ * Description: decode FLAC frames, full precision output
+ *
+ * Inputs:      see FLACDecode()
+ *
+ * Outputs:     interleaved PCM in Q28 (a 24 bit sample in bits 28..5), the int32 format of MP3Decode32()
+ *                and AACDecode32(), the 3 guard bits stay unused for lossless input
+ *              updated bytesLeft
+ *
+ * Return:      0 if successful, error code (< 0) if error
+ **********************************************************************************************************************/
+int FLACDecode32(uint8_t *inbuf, int *bytesLeft, int32_t *outbuf){
+    FLACDecInfo_t *di = m_FLACDecInfo;
+    int err, i, n, nChans, shift;
+    const int32_t *s0, *s1;
+
+    if(!di || !di->frameBuf) return ERR_FLAC_NO_STREAMINFO;
+    di->outputSamps = 0;
+    if(di->outPos >= di->blockSize){
+        err = FLACFillAndDecode(inbuf, bytesLeft);
+        if(err) return err;
+    }
+
+    nChans = di->frameHeader.nChans;
+    n = di->blockSize - di->outPos;
+    if(n > FLAC_MAX_OUT_SAMPS) n = FLAC_MAX_OUT_SAMPS;
+    s0 = m_flacSamples[0] + di->outPos;
+    s1 = m_flacSamples[nChans - 1] + di->outPos;
+    shift = 29 - di->frameHeader.bitsPerSample;       /* full scale at 1 << 28 */
+
+    for(i = 0; i < n; i++){
+        *outbuf++ = (int32_t)((uint32_t)s0[i] << shift);
+        if(nChans == 2) *outbuf++ = (int32_t)((uint32_t)s1[i] << shift);
+    }
+    di->outPos += n;
+    di->outputSamps = n * nChans;
+    return ERR_FLAC_NONE;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACFillAndDecode
+ *
+ * Description: append input to the frame buffer and decode the frame at its start once it is complete
+ *
+ * Inputs:      pointer to the input data
+ *              number of valid bytes in input, 0 = end of stream
+ *
+ * Outputs:     updated bytesLeft, decoded block in m_flacSamples
+ *
+ * Return:      0 if a block was decoded, ERR_FLAC_INDATA_UNDERFLOW if more input is needed, other error
+ *                codes (< 0) if the frame is corrupt, the frame buffer is cleared in this case
+ *
+ * Notes:       the frame ends where a matching header follows and the CRC-16 up to there is 0, a false
+ *                header inside the frame only costs a CRC update, the CRC is computed incrementally
+ **********************************************************************************************************************/
+int FLACFillAndDecode(uint8_t *inbuf, int *bytesLeft){
+    FLACDecInfo_t *di = m_FLACDecInfo;
+    uint8_t *buf = di->frameBuf;
+    bool flush = (*bytesLeft == 0);
+    int n, start, end, err;
+
+    n = di->frameBufSize - di->frameBufFill;
+    if(n > *bytesLeft) n = *bytesLeft;
+    memcpy(buf + di->frameBufFill, inbuf, n);
+    di->frameBufFill += n;
+    *bytesLeft -= n;
+
+    for(;;){
+        start = di->searchPos;
+        end = FLACFindNextFrame(buf, start, di->frameBufFill);
+        if(end < 0){
+            /* a cut off header can start in the last bytes */
+            if(di->frameBufFill - FLAC_MAX_HEADER_BYTES + 1 > start) di->searchPos = di->frameBufFill - FLAC_MAX_HEADER_BYTES + 1;
+            if(flush && di->frameBufFill > 0){
+                end = di->frameBufFill;                 /* last frame of the stream */
+            }
+            else if(di->frameBufFill == di->frameBufSize){
+                FLACDecoder_ClearBuffer();              /* no frame end, corrupt frame */
+                return ERR_FLAC_FRAME_CRC;
+            }
+            else return ERR_FLAC_INDATA_UNDERFLOW;
+        }
+        di->crc = FLACCrc16(di->crc, buf + di->crcPos, end - di->crcPos);
+        di->crcPos = end;
+        if(di->crc == 0) break;
+        if(end == di->frameBufFill){
+            FLACDecoder_ClearBuffer();
+            return ERR_FLAC_FRAME_CRC;
+        }
+        di->searchPos = end + 1;                        /* false header inside the frame */
+    }
+
+    err = FLACDecodeFrame(end);
+    n = di->frameBufFill - end;
+    memmove(buf, buf + end, n);
+    di->frameBufFill = n;
+    di->searchPos = FLAC_MIN_HEADER_BYTES;
+    di->crc = 0;
+    di->crcPos = 0;
+    di->outPos = 0;
+    if(err){
+        FLACDecoder_ClearBuffer();
+        return err;
+    }
+    return ERR_FLAC_NONE;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecodeFrame
+ *
+ * Description: decode the frame at the start of the frame buffer
+ *
+ * Inputs:      length of the frame in bytes, including the CRC-16
+ *
+ * Outputs:     m_flacSamples, blockSize, frameHeader
+ *
+ * Return:      0 if successful, error code (< 0) if error
+ **********************************************************************************************************************/
+int FLACDecodeFrame(int frameEnd){
+    FLACDecInfo_t *di = m_FLACDecInfo;
+    FLACFrameHeader_t fh;
+    int hdr, ch, bps, err;
+
+    di->blockSize = 0;
+    hdr = FLACDecodeFrameHeader(di->frameBuf, frameEnd, &fh);
+    if(hdr < 0) return ERR_FLAC_INVALID_FRAMEHEADER;
+    if(fh.nChans > FLAC_MAX_NCHANS)            return ERR_FLAC_NCHANS_TOO_HIGH;
+    if(fh.bitsPerSample > FLAC_MAX_BPS)        return ERR_FLAC_UNSUPPORTED_FORMAT;
+    if(fh.blockSize > FLAC_MAX_BLOCKSIZE)      return ERR_FLAC_BLOCKSIZE_TOO_BIG;
+
+    FLACSetBitstreamPointer(frameEnd - hdr, di->frameBuf + hdr);
+    for(ch = 0; ch < fh.nChans; ch++){
+        bps = fh.bitsPerSample;
+        if((fh.chanAssign == FLAC_CHAN_LEFT_SIDE  && ch == 1) ||
+           (fh.chanAssign == FLAC_CHAN_RIGHT_SIDE && ch == 0) ||
+           (fh.chanAssign == FLAC_CHAN_MID_SIDE   && ch == 1)) bps++;     /* side channel */
+        err = FLACDecodeSubframe(m_flacSamples[ch], fh.blockSize, bps);
+        if(err) return err;
+    }
+    FLACByteAlign();
+    FLACGetBits(16);                                                   /* CRC-16, checked before */
+    if(FLACBitsUsed(di->frameBuf + hdr) > (frameEnd - hdr) * 8) return ERR_FLAC_INVALID_SUBFRAME;
+
+    if(fh.chanAssign >= FLAC_CHAN_LEFT_SIDE) FLACDecorrelate(fh.chanAssign, fh.blockSize);
+
+    di->frameHeader = fh;
+    di->frameBytes = frameEnd;
+    di->blockSize = fh.blockSize;
+    return ERR_FLAC_NONE;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecodeSubframe
+ *
+ * Description: decode one channel of a frame
+ *
+ * Inputs:      output buffer, block size, bits per sample of this channel
+ *
+ * Outputs:     blockSize samples
+ *
+ * Return:      0 if successful, error code (< 0) if error
+ *
+ * Notes:       the residual is decoded in place behind the warm-up samples and then restored by the predictor
+ **********************************************************************************************************************/
+int FLACDecodeSubframe(int32_t *samples, int blockSize, int bps){
+    uint32_t hdr;
+    int i, type, wasted, order, precision, shift, err;
+    int32_t coefs[FLAC_MAX_LPC_ORDER];
+
+    hdr = FLACGetBits(8);
+    if(hdr & 0x80) return ERR_FLAC_INVALID_SUBFRAME;
+    type = (hdr >> 1) & 0x3f;
+    wasted = 0;
+    if(hdr & 0x01){                                 /* wasted bits, unary coded k - 1 */
+        wasted = 1;
+        while(!FLACGetBits(1)){
+            if(++wasted >= bps) return ERR_FLAC_INVALID_SUBFRAME;
+        }
+        bps -= wasted;
+    }
+
+    if(type == FLAC_SUBFRAME_CONSTANT){
+        int32_t v = FLACGetSignedBits(bps);
+        for(i = 0; i < blockSize; i++) samples[i] = v;
+    }
+    else if(type == FLAC_SUBFRAME_VERBATIM){
+        for(i = 0; i < blockSize; i++) samples[i] = FLACGetSignedBits(bps);
+    }
+    else if(type >= FLAC_SUBFRAME_FIXED && type <= FLAC_SUBFRAME_FIXED + FLAC_MAX_FIXED_ORDER){
+        order = type - FLAC_SUBFRAME_FIXED;
+        if(order > blockSize) return ERR_FLAC_INVALID_SUBFRAME;
+        for(i = 0; i < order; i++) samples[i] = FLACGetSignedBits(bps);
+        err = FLACDecodeResidual(samples + order, blockSize, order);
+        if(err) return err;
+        FLACRestoreFixed(samples, blockSize, order);
+    }
+    else if(type >= FLAC_SUBFRAME_LPC){
+        order = type - FLAC_SUBFRAME_LPC + 1;
+        if(order > blockSize) return ERR_FLAC_INVALID_SUBFRAME;
+        for(i = 0; i < order; i++) samples[i] = FLACGetSignedBits(bps);
+        precision = FLACGetBits(4) + 1;
+        if(precision == 16) return ERR_FLAC_INVALID_SUBFRAME;
+        shift = FLACGetSignedBits(5);
+        if(shift < 0) return ERR_FLAC_INVALID_SUBFRAME;
+        for(i = 0; i < order; i++) coefs[i] = FLACGetSignedBits(precision);
+        err = FLACDecodeResidual(samples + order, blockSize, order);
+        if(err) return err;
+        /* the 32 bit sum cannot overflow if the coefficients were quantized for it (libFLAC does) */
+        if(bps + precision + (31 - __builtin_clz(order)) <= 32) FLACRestoreLPC(samples, blockSize, coefs, order, shift);
+        else                                                    FLACRestoreLPC64(samples, blockSize, coefs, order, shift);
+    }
+    else return ERR_FLAC_INVALID_SUBFRAME;
+
+    if(wasted){
+        for(i = 0; i < blockSize; i++) samples[i] = (int32_t)((uint32_t)samples[i] << wasted);
+    }
+    return ERR_FLAC_NONE;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecodeResidual
+ *
+ * Description: decode the Rice coded residual of a fixed or LPC subframe
+ *
+ * Inputs:      output buffer, block size, predictor order
+ *
+ * Outputs:     blockSize - predOrder residual values
+ *
+ * Return:      0 if successful, error code (< 0) if error
+ **********************************************************************************************************************/
+int FLACDecodeResidual(int32_t *residual, int blockSize, int predOrder){
+    int method, paramBits, escape, partOrder, partSamps, p, n, param, rawBits, err;
+
+    method = FLACGetBits(2);
+    if(method > 1) return ERR_FLAC_INVALID_RESIDUAL;
+    paramBits = method ? 5 : 4;                     /* RICE2 has 5 bit parameters */
+    escape = (1 << paramBits) - 1;
+    partOrder = FLACGetBits(4);
+    partSamps = blockSize >> partOrder;
+    if((partSamps << partOrder) != blockSize || partSamps < predOrder) return ERR_FLAC_INVALID_RESIDUAL;
+
+    for(p = 0; p < (1 << partOrder); p++){
+        n = p ? partSamps : partSamps - predOrder;
+        param = FLACGetBits(paramBits);
+        if(param == escape){                        /* unencoded partition */
+            rawBits = FLACGetBits(5);
+            if(rawBits) for(int i = 0; i < n; i++) residual[i] = FLACGetSignedBits(rawBits);
+            else        memset(residual, 0, n * sizeof(int32_t));
+        }
+        else{
+            err = FLACDecodeRice(residual, n, param);
+            if(err) return err;
+        }
+        residual += n;
+    }
+    return ERR_FLAC_NONE;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecodeRice
+ *
+ * Description: decode one partition of Rice codes
+ *
+ * Inputs:      output buffer, number of values, Rice parameter [0, 30]
+ *
+ * Outputs:     nVals residual values
+ *
+ * Return:      0 if successful, ERR_FLAC_INVALID_RESIDUAL if the bitstream ends
+ *
+ * Notes:       the 64-bit cache is kept in registers, the unary part is counted with one clz,
+ *                only a quotient which runs past the cached bits takes the slow path
+ *              a refill leaves at least 57 bits, enough for any code with a quotient < 26
+ **********************************************************************************************************************/
+int FLACDecodeRice(int32_t *residual, int nVals, int param){
+    FLACBitStreamInfo_t *bsi = &m_flacBSI;
+    uint64_t cache = bsi->cache;
+    int bits = bsi->cachedBits;
+    uint32_t q, u;
+    int z;
+
+    while(nVals--){
+        if(bits < 32){
+            bsi->cache = cache; bsi->cachedBits = bits;
+            FLACRefillBitCache();
+            cache = bsi->cache; bits = bsi->cachedBits;
+        }
+        z = cache ? __builtin_clzll(cache) : 64;
+        if(z < bits){
+            q = z;
+            cache <<= z; cache <<= 1;               /* two shifts, z + 1 can be 64 */
+            bits -= z + 1;
+        }
+        else{                                       /* long run of zeros, across refills */
+            q = 0;
+            for(;;){
+                if(z < bits){
+                    q += z;
+                    cache <<= z; cache <<= 1;
+                    bits -= z + 1;
+                    break;
+                }
+                q += bits;
+                bsi->cache = 0; bsi->cachedBits = 0;
+                FLACRefillBitCache();
+                cache = bsi->cache; bits = bsi->cachedBits;
+                if(bits <= 0) return ERR_FLAC_INVALID_RESIDUAL;
+                z = cache ? __builtin_clzll(cache) : 64;
+            }
+        }
+        if(param){
+            if(bits < param){
+                bsi->cache = cache; bsi->cachedBits = bits;
+                FLACRefillBitCache();
+                cache = bsi->cache; bits = bsi->cachedBits;
+                if(bits < param) return ERR_FLAC_INVALID_RESIDUAL;
+            }
+            u = (q << param) | (uint32_t)(cache >> (64 - param));
+            cache <<= param;
+            bits -= param;
+        }
+        else u = q;
+        *residual++ = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+    }
+    bsi->cache = cache;
+    bsi->cachedBits = bits;
+    return ERR_FLAC_NONE;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACRestoreFixed
+ *
+ * Description: add the fixed polynomial prediction to the residual
+ *
+ * Inputs:      warm-up samples followed by the residual, block size, order [0, 4]
+ *
+ * Outputs:     restored samples
+ *
+ * Return:      none
+ *
+ * Notes:       the history is kept in registers, one load and one store per sample
+ **********************************************************************************************************************/
+void FLACRestoreFixed(int32_t *samples, int blockSize, int order){
+    int i;
+    int32_t s1, s2, s3, s4;
+
+    switch(order){
+    case 1:
+        s1 = samples[0];
+        for(i = 1; i < blockSize; i++) samples[i] = s1 = samples[i] + s1;
+        break;
+    case 2:
+        s2 = samples[0]; s1 = samples[1];
+        for(i = 2; i < blockSize; i++){
+            int32_t x = samples[i] + 2 * s1 - s2;
+            samples[i] = x; s2 = s1; s1 = x;
+        }
+        break;
+    case 3:
+        s3 = samples[0]; s2 = samples[1]; s1 = samples[2];
+        for(i = 3; i < blockSize; i++){
+            int32_t x = samples[i] + 3 * (s1 - s2) + s3;
+            samples[i] = x; s3 = s2; s2 = s1; s1 = x;
+        }
+        break;
+    case 4:
+        s4 = samples[0]; s3 = samples[1]; s2 = samples[2]; s1 = samples[3];
+        for(i = 4; i < blockSize; i++){
+            int32_t x = samples[i] + 4 * (s1 + s3) - 6 * s2 - s4;
+            samples[i] = x; s4 = s3; s3 = s2; s2 = s1; s1 = x;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    LPCRestore32
+ *
+ * Description: LPC restoration with a 32 bit sum for one order
+ *
+ * Notes:       always inlined with a constant order, the inner loop is unrolled and the coefficients stay
+ *                in registers
+ **********************************************************************************************************************/
+static inline __attribute__((always_inline)) void LPCRestore32(int32_t *samples, int blockSize, const int32_t *coefs, const int order, int shift)
+{
+    int32_t c[12];
+    int i, j;
+
+    for(j = 0; j < order; j++) c[j] = coefs[j];
+    for(i = order; i < blockSize; i++){
+        const int32_t *h = samples + i;
+        int32_t sum = 0;
+        for(j = 0; j < order; j++) sum += c[j] * h[-1 - j];
+        samples[i] += sum >> shift;
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACRestoreLPC
+ *
+ * Description: add the LPC prediction to the residual, 32 bit sum
+ *
+ * Inputs:      warm-up samples followed by the residual, block size, quantized coefficients, order [1, 32],
+ *                shift of the sum
+ *
+ * Outputs:     restored samples
+ *
+ * Return:      none
+ *
+ * Notes:       coefs[0] belongs to the previous sample
+ *              orders up to 12 (all subset streams at <= 48kHz) have their own unrolled loop
+ **********************************************************************************************************************/
+void FLACRestoreLPC(int32_t *samples, int blockSize, const int32_t *coefs, int order, int shift){
+    int i, j;
+
+    switch(order){
+    case  1: LPCRestore32(samples, blockSize, coefs,  1, shift); return;
+    case  2: LPCRestore32(samples, blockSize, coefs,  2, shift); return;
+    case  3: LPCRestore32(samples, blockSize, coefs,  3, shift); return;
+    case  4: LPCRestore32(samples, blockSize, coefs,  4, shift); return;
+    case  5: LPCRestore32(samples, blockSize, coefs,  5, shift); return;
+    case  6: LPCRestore32(samples, blockSize, coefs,  6, shift); return;
+    case  7: LPCRestore32(samples, blockSize, coefs,  7, shift); return;
+    case  8: LPCRestore32(samples, blockSize, coefs,  8, shift); return;
+    case  9: LPCRestore32(samples, blockSize, coefs,  9, shift); return;
+    case 10: LPCRestore32(samples, blockSize, coefs, 10, shift); return;
+    case 11: LPCRestore32(samples, blockSize, coefs, 11, shift); return;
+    case 12: LPCRestore32(samples, blockSize, coefs, 12, shift); return;
+    default: break;
+    }
+    for(i = order; i < blockSize; i++){
+        int32_t sum = 0;
+        for(j = 0; j < order; j++) sum += coefs[j] * samples[i - 1 - j];
+        samples[i] += sum >> shift;
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACRestoreLPC64
+ *
+ * Description: add the LPC prediction to the residual, 64 bit sum
+ *
+ * Inputs:      see FLACRestoreLPC()
+ *
+ * Outputs:     restored samples
+ *
+ * Return:      none
+ *
+ * Notes:       for high resolution streams whose coefficients and samples exceed a 32 bit sum
+ **********************************************************************************************************************/
+void FLACRestoreLPC64(int32_t *samples, int blockSize, const int32_t *coefs, int order, int shift){
+    int i, j;
+
+    for(i = order; i < blockSize; i++){
+        int64_t sum = 0;
+        for(j = 0; j < order; j++) sum += (int64_t)coefs[j] * samples[i - 1 - j];
+        samples[i] += (int32_t)(sum >> shift);
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACDecorrelate
+ *
+ * Description: undo the stereo decorrelation
+ *
+ * Inputs:      channel assignment (left/side, right/side, mid/side), block size
+ *
+ * Outputs:     left and right channel in m_flacSamples
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void FLACDecorrelate(int chanAssign, int blockSize){
+    int32_t *s0 = m_flacSamples[0];
+    int32_t *s1 = m_flacSamples[1];
+    int i;
+
+    if(chanAssign == FLAC_CHAN_LEFT_SIDE){              /* s0 = left, s1 = side */
+        for(i = 0; i < blockSize; i++) s1[i] = s0[i] - s1[i];
+    }
+    else if(chanAssign == FLAC_CHAN_RIGHT_SIDE){        /* s0 = side, s1 = right */
+        for(i = 0; i < blockSize; i++) s0[i] += s1[i];
+    }
+    else if(chanAssign == FLAC_CHAN_MID_SIDE){          /* s0 = mid, s1 = side */
+        for(i = 0; i < blockSize; i++){
+            int32_t side = s1[i];
+            int32_t mid = (int32_t)((uint32_t)s0[i] << 1) | (side & 1);
+            s0[i] = (mid + side) >> 1;
+            s1[i] = (mid - side) >> 1;
+        }
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACGetSampRate, FLACGetChannels, FLACGetBitsPerSample, FLACGetBitRate, FLACGetOutputSamps,
+ *              FLACGetTotalSamples, FLACGetBufferedBytes, FLACGetPendingSamps
+ *
+ * Description: stream and decoder state, FLACGetBitsPerSample() is the resolution of the stream, FLACDecode()
+ *                always returns 16 bit
+ **********************************************************************************************************************/
+int FLACGetSampRate(){
+    if(!m_FLACDecInfo) return 0;
+    if(m_FLACDecInfo->frameHeader.sampRate) return m_FLACDecInfo->frameHeader.sampRate;
+    return m_FLACDecInfo->streamInfo.sampRate;
+}
+int FLACGetChannels(){
+    if(!m_FLACDecInfo) return 0;
+    if(m_FLACDecInfo->frameHeader.nChans) return m_FLACDecInfo->frameHeader.nChans;
+    return m_FLACDecInfo->streamInfo.nChans;
+}
+int FLACGetBitsPerSample(){
+    if(!m_FLACDecInfo) return 0;
+    if(m_FLACDecInfo->frameHeader.bitsPerSample) return m_FLACDecInfo->frameHeader.bitsPerSample;
+    return m_FLACDecInfo->streamInfo.bitsPerSample;
+}
+int FLACGetBitRate(){
+    if(!m_FLACDecInfo || !m_FLACDecInfo->frameHeader.blockSize) return 0;
+    return (uint64_t)m_FLACDecInfo->frameBytes * 8 * m_FLACDecInfo->frameHeader.sampRate / m_FLACDecInfo->frameHeader.blockSize;
+}
+int FLACGetOutputSamps(){
+    if(!m_FLACDecInfo) return 0;
+    return m_FLACDecInfo->outputSamps;
+}
+uint64_t FLACGetTotalSamples(){
+    if(!m_FLACDecInfo) return 0;
+    return m_FLACDecInfo->streamInfo.totalSamples;
+}
+int FLACGetBufferedBytes(){
+    if(!m_FLACDecInfo) return 0;
+    return m_FLACDecInfo->frameBufFill;
+}
+int FLACGetPendingSamps(){
+    if(!m_FLACDecInfo) return 0;
+    return m_FLACDecInfo->blockSize - m_FLACDecInfo->outPos;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACSetBitstreamPointer
+ *
+ * Description: initialize bitstream reader
+ *
+ * Inputs:      number of bytes in bitstream
+ *              pointer to byte-aligned buffer of data to read from
+ *
+ * Outputs:     initialized bitstream info struct
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void FLACSetBitstreamPointer(int nBytes, const uint8_t *buf){
+    m_flacBSI.bytePtr = buf;
+    m_flacBSI.cache = 0;            /* 8-byte uint64_t, left-justified */
+    m_flacBSI.cachedBits = 0;       /* i.e. zero bits in cache */
+    m_flacBSI.nBytes = nBytes;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACRefillBitCache
+ *
+ * Description: top up the 64-bit cache with whole bytes from the bitstream buffer
+ *
+ * Inputs:      none
+ *
+ * Outputs:     updated bitstream info struct
+ *
+ * Return:      none
+ *
+ * Notes:       same scheme as RefillBitstreamCache() of the AAC decoder, at least 57 valid bits unless the
+ *                end of the buffer is reached, bits beyond the end read as zero
+ **********************************************************************************************************************/
+inline void FLACRefillBitCache(){
+    FLACBitStreamInfo_t *bsi = &m_flacBSI;
+    const uint8_t *p = bsi->bytePtr;
+    int n;
+
+    if(bsi->nBytes >= 8){
+        uint64_t v = ((uint64_t)((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]) << 32) |
+                      (uint32_t)((p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7]);
+        n = (64 - bsi->cachedBits) >> 3;    /* whole bytes that fit, 1 - 8 */
+        bsi->cache |= v >> bsi->cachedBits;
+        bsi->bytePtr += n;
+        bsi->nBytes -= n;
+        bsi->cachedBits += (n << 3);
+    }
+    else{
+        while(bsi->nBytes > 0 && bsi->cachedBits <= 56){
+            bsi->cache |= (uint64_t)(*bsi->bytePtr++) << (56 - bsi->cachedBits);
+            bsi->cachedBits += 8;
+            bsi->nBytes--;
+        }
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACGetBits
+ *
+ * Description: get bits from bitstream, advance bitstream pointer
+ *
+ * Inputs:      number of bits to get from bitstream, [0, 31]
+ *
+ * Outputs:     updated bitstream info struct
+ *
+ * Return:      the next nBits bits of data from bitstream buffer
+ *
+ * Notes:       for speed, does not indicate error if you overrun bit buffer (cachedBits goes negative)
+ **********************************************************************************************************************/
+uint32_t FLACGetBits(int nBits){
+    uint32_t data;
+
+    nBits &= 0x1f;
+    if(m_flacBSI.cachedBits < 32) FLACRefillBitCache();
+    data = (uint32_t)(m_flacBSI.cache >> 32) >> (31 - nBits);
+    data >>= 1;                                     /* do as >> 31, >> 1 so that nBits = 0 works okay (returns 0) */
+    m_flacBSI.cache <<= nBits;
+    m_flacBSI.cachedBits -= nBits;
+    return data;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACGetSignedBits
+ *
+ * Description: get a two's complement number from bitstream
+ *
+ * Inputs:      number of bits, [1, 31]
+ *
+ * Outputs:     updated bitstream info struct
+ *
+ * Return:      sign extended value
+ **********************************************************************************************************************/
+int32_t FLACGetSignedBits(int nBits){
+    return (int32_t)(FLACGetBits(nBits) << (32 - nBits)) >> (32 - nBits);
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACByteAlign
+ *
+ * Description: bump bitstream pointer to start of next byte
+ *
+ * Inputs:      none
+ *
+ * Outputs:     byte-aligned bitstream
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void FLACByteAlign(){
+    int offset = m_flacBSI.cachedBits & 0x07;
+    m_flacBSI.cache <<= offset;
+    m_flacBSI.cachedBits -= offset;
+}
+
+/***********************************************************************************************************************
+ * Function:    FLACBitsUsed
+ *
+ * Description: calculate how many bits have been read from bitstream
+ *
+ * Inputs:      pointer to start of bitstream buffer
+ *
+ * Outputs:     none
+ *
+ * Return:      number of bits read from bitstream, more than the buffer holds on overrun
+ **********************************************************************************************************************/
+int FLACBitsUsed(const uint8_t *startBuf){
+    return (m_flacBSI.bytePtr - startBuf) * 8 - m_flacBSI.cachedBits;
+}
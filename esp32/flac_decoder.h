@@ -0,0 +1,98 @@
+// FLAC decoder (fixed and LPC subframes, Rice coded residuals), streaming, one block at a time
+#pragma once
+#pragma GCC optimize ("O3")
+
+#include "Arduino.h"
+
+enum {
+    ERR_FLAC_NONE                         =   0,
+    ERR_FLAC_INDATA_UNDERFLOW             =  -1,
+    ERR_FLAC_OUT_OF_MEMORY                =  -2,
+    ERR_FLAC_NO_STREAMINFO                =  -3,
+    ERR_FLAC_INVALID_FRAMEHEADER          =  -4,
+    ERR_FLAC_UNSUPPORTED_FORMAT           =  -5,
+    ERR_FLAC_BLOCKSIZE_TOO_BIG            =  -6,
+    ERR_FLAC_NCHANS_TOO_HIGH              =  -7,
+    ERR_FLAC_INVALID_SUBFRAME             =  -8,
+    ERR_FLAC_INVALID_RESIDUAL             =  -9,
+    ERR_FLAC_FRAME_CRC                    = -10,
+    ERR_FLAC_UNKNOWN                      = -9999
+};
+
+typedef struct _FLACStreamInfo_t {
+    uint16_t minBlockSize;
+    uint16_t maxBlockSize;
+    uint32_t minFrameSize;       /* bytes, 0 = unknown */
+    uint32_t maxFrameSize;       /* bytes, 0 = unknown */
+    uint32_t sampRate;
+    uint8_t  nChans;
+    uint8_t  bitsPerSample;
+    uint64_t totalSamples;       /* per channel, 0 = unknown */
+} FLACStreamInfo_t;
+
+typedef struct _FLACFrameHeader_t {
+    uint8_t  blockingStrategy;   /* 0 = fixed, 1 = variable block size */
+    uint16_t blockSize;
+    uint32_t sampRate;
+    uint8_t  chanAssign;         /* 0..7 = independent, 8 = left/side, 9 = right/side, 10 = mid/side */
+    uint8_t  nChans;
+    uint8_t  bitsPerSample;
+    uint8_t  headerBytes;        /* including the CRC-8 */
+} FLACFrameHeader_t;
+
+typedef struct _FLACBitStreamInfo_t {
+    const uint8_t *bytePtr;
+    uint64_t cache;              /* left-justified, bits past cachedBits are zero or the true bits of *bytePtr */
+    int cachedBits;
+    int nBytes;
+} FLACBitStreamInfo_t;
+
+typedef struct _FLACDecInfo_t {
+    FLACStreamInfo_t  streamInfo;
+    FLACFrameHeader_t frameHeader;     /* of the last decoded frame */
+    uint8_t          *frameBuf;        /* input bytes of the current frame and the start of the next one */
+    int               frameBufSize;
+    int               frameBufFill;
+    int               searchPos;       /* next position to look for the following frame header */
+    uint16_t          crc;             /* CRC-16 of frameBuf[0 .. crcPos) */
+    int               crcPos;
+    int               blockSize;       /* samples per channel in samples[], 0 = empty */
+    int               outPos;          /* samples per channel of samples[] already returned */
+    int               outputSamps;     /* samples (all channels) returned by the last FLACDecode() */
+    int               frameBytes;      /* size of the last decoded frame */
+} FLACDecInfo_t;
+
+bool FLACDecoder_AllocateBuffers(void);
+void FLACDecoder_FreeBuffers(void);
+void FLACDecoder_ClearBuffer(void);
+int  FLACParseStreamInfo(const uint8_t *buf, int len);
+int  FLACFindSyncWord(uint8_t *buf, int nBytes);
+int  FLACDecode(uint8_t *inbuf, int *bytesLeft, short *outbuf);
+int  FLACDecode32(uint8_t *inbuf, int *bytesLeft, int32_t *outbuf);
+int  FLACGetSampRate();
+int  FLACGetChannels();
+int  FLACGetBitsPerSample();
+int  FLACGetBitRate();
+int  FLACGetOutputSamps();
+uint64_t FLACGetTotalSamples();
+int  FLACGetBufferedBytes();
+int  FLACGetPendingSamps();
+int  FLACDecodeFrameHeader(const uint8_t *buf, int nBytes, FLACFrameHeader_t *fh);
+int  FLACFindNextFrame(const uint8_t *buf, int start, int nBytes);
+int  FLACFillAndDecode(uint8_t *inbuf, int *bytesLeft);
+int  FLACDecodeFrame(int frameEnd);
+int  FLACDecodeSubframe(int32_t *samples, int blockSize, int bps);
+int  FLACDecodeResidual(int32_t *residual, int blockSize, int predOrder);
+int  FLACDecodeRice(int32_t *residual, int nVals, int param);
+void FLACRestoreFixed(int32_t *samples, int blockSize, int order);
+void FLACRestoreLPC(int32_t *samples, int blockSize, const int32_t *coefs, int order, int shift);
+void FLACRestoreLPC64(int32_t *samples, int blockSize, const int32_t *coefs, int order, int shift);
+void FLACDecorrelate(int chanAssign, int blockSize);
+uint8_t  FLACCrc8(const uint8_t *buf, int nBytes);
+uint16_t FLACCrc16(uint16_t crc, const uint8_t *buf, int nBytes);
+void FLACSetBitstreamPointer(int nBytes, const uint8_t *buf);
+inline void FLACRefillBitCache();
+uint32_t FLACGetBits(int nBits);
+int32_t FLACGetSignedBits(int nBits);
+void FLACByteAlign();
+int  FLACBitsUsed(const uint8_t *startBuf);
@@ -0,0 +1,197 @@
+/*
+ * http_parser.cpp
+ * incremental parser for the text parts of a web stream
+ *
+ * processWebStream() reads whole buffers from the client and hands them to one of the functions below,
+ * each takes as many bytes as belong to the current line, metadata block or chunk size line and returns
+ * that count, the rest of the buffer is left to the caller (audio data, the next line ...).
+ * HTTPDechunk() removes the framing of a chunked transfer in place, the payload stays where it was read to
+ * A line or block is collected in a fixed arena inside the parser state, nothing is allocated
+ ************************************************************************************/
+
+#include "http_parser.h"
+
+/***********************************************************************************************************************
+ * Function:    HTTPParserReset
+ *
+ * Description: forget a partial line, metadata block or chunk size line (new connection)
+ *
+ * Inputs:      parser state
+ *
+ * Outputs:     cleared state
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void HTTPParserReset(HTTPParser_t *p){
+    p->len = 0;
+    p->arena[0] = 0;
+    p->metaLen = 0;
+    p->metaLeft = 0;
+    p->metaStarted = false;
+    p->complete = false;
+    p->overflow = false;
+    p->chunkDigits = 0;
+    p->chunkExt = false;
+    p->chunkSize = 0;
+    p->chunkLeft = 0;
+    p->lastChunk = false;
+}
+
+/***********************************************************************************************************************
+ * Function:    HTTPParseLine
+ *
+ * Description: collect a header or playlist line up to LF
+ *
+ * Inputs:      parser state, buf, len bytes
+ *
+ * Outputs:     p->complete = true and the line in p->arena if LF was found
+ *
+ * Return:      bytes consumed, including the LF
+ *
+ * Notes:       CR, NUL and bytes above 0x7F are dropped like the byte wise parser did,
+ *                the part of a line that does not fit into the arena is dropped (p->overflow)
+ **********************************************************************************************************************/
+int HTTPParseLine(HTTPParser_t *p, const uint8_t *buf, int len){
+    const uint8_t *lf = (const uint8_t*)memchr(buf, '\n', len);
+    int n = lf ? lf - buf + 1 : len;
+    int i, w;
+
+    if(p->complete){
+        p->len = 0;
+        p->complete = false;
+        p->overflow = false;
+    }
+    w = p->len;
+    for(i = 0; i < n; i++){
+        uint8_t b = buf[i];
+        if(b > 0x7F || b == '\r' || b == '\n' || b == 0) continue;
+        if(w < HTTP_ARENA_SIZE - 1) p->arena[w++] = b;
+        else p->overflow = true;
+    }
+    p->len = w;
+    p->arena[w] = 0;
+    if(lf) p->complete = true;
+    return n;
+}
+
+/***********************************************************************************************************************
+ * Function:    HTTPParseMeta
+ *
+ * Description: collect an ICY metadata block, the length byte (16 bytes units) and the text
+ *
+ * Inputs:      parser state, buf, len bytes
+ *
+ * Outputs:     p->complete = true with the text in p->arena (up to the first NUL of the padding) and its
+ *                length in p->metaLen when the block is complete, immediately for the usual empty block
+ *
+ * Return:      bytes consumed
+ **********************************************************************************************************************/
+int HTTPParseMeta(HTTPParser_t *p, const uint8_t *buf, int len){
+    int n = 0, k, room;
+
+    if(p->complete){
+        p->len = 0;
+        p->complete = false;
+        p->overflow = false;
+    }
+    if(!p->metaStarted){
+        if(len < 1) return 0;
+        p->metaLen = p->metaLeft = buf[0] * 16;
+        p->metaStarted = true;
+        p->len = 0;
+        n = 1;
+    }
+    k = len - n;
+    if(k > p->metaLeft) k = p->metaLeft;
+    room = HTTP_ARENA_SIZE - 1 - p->len;
+    if(k > room) p->overflow = true;
+    memcpy(p->arena + p->len, buf + n, k < room ? k : room);
+    p->len += k < room ? k : room;
+    p->metaLeft -= k;
+    n += k;
+    if(p->metaLeft == 0){
+        p->arena[p->len] = 0;
+        p->metaStarted = false;
+        p->complete = true;
+    }
+    return n;
+}
+
+/***********************************************************************************************************************
+ * Function:    HTTPParseChunkSize
+ *
+ * Description: decode the hex size line in front of a chunk of a chunked transfer
+ *
+ * Inputs:      parser state, buf, len bytes
+ *
+ * Outputs:     size = chunk size if the line is complete (0 = last chunk), -1 if more bytes are needed
+ *
+ * Return:      bytes consumed, the data of the chunk starts behind them
+ *
+ * Notes:       the empty line (CRLF) behind the data of the previous chunk is skipped, extensions behind ';'
+ *                are ignored
+ **********************************************************************************************************************/
+int HTTPParseChunkSize(HTTPParser_t *p, const uint8_t *buf, int len, int32_t *size){
+    int i;
+
+    *size = -1;
+    for(i = 0; i < len; i++){
+        uint8_t b = buf[i];
+        if(b == '\n'){
+            if(!p->chunkDigits){                     // CRLF behind the data of the last chunk
+                p->chunkExt = false;
+                continue;
+            }
+            *size = p->chunkSize;
+            p->chunkSize = 0;
+            p->chunkDigits = 0;
+            p->chunkExt = false;
+            return i + 1;
+        }
+        if(p->chunkExt) continue;
+        if(b == ';'){ p->chunkExt = true; continue; }
+        if(b >= '0' && b <= '9') b -= '0';
+        else if((b | 0x20) >= 'a' && (b | 0x20) <= 'f') b = (b | 0x20) - 'a' + 10;
+        else continue;                               // CR, blanks
+        if(p->chunkDigits < 7) p->chunkSize = (p->chunkSize << 4) | b;
+        p->chunkDigits++;
+    }
+    return len;
+}
+
+/***********************************************************************************************************************
+ * Function:    HTTPDechunk
+ *
+ * Description: strip the chunk size lines out of a buffer of a chunked transfer
+ *
+ * Inputs:      parser state, buf, len bytes as read from the client
+ *
+ * Outputs:     the payload moved to the front of buf, p->chunkLeft for the next buffer
+ *
+ * Return:      payload bytes in buf, <= len
+ *
+ * Notes:       works in place, every byte is moved at most once and only if a size line lies in front of it,
+ *                a chunk that spans buffers and a size line that is split between two reads are carried over
+ *                in the parser state
+ **********************************************************************************************************************/
+int HTTPDechunk(HTTPParser_t *p, uint8_t *buf, int len){
+    int r = 0, w = 0, k;
+    int32_t size;
+
+    while(r < len){
+        if(p->lastChunk) break;
+        if(p->chunkLeft == 0){
+            r += HTTPParseChunkSize(p, buf + r, len - r, &size);
+            if(size > 0) p->chunkLeft = size;
+            if(size == 0) p->lastChunk = true;
+            continue;
+        }
+        k = len - r;
+        if((uint32_t)k > p->chunkLeft) k = p->chunkLeft;
+        if(w != r) memmove(buf + w, buf + r, k);
+        w += k;
+        r += k;
+        p->chunkLeft -= k;
+    }
+    return w;
+}
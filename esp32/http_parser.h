@@ -0,0 +1,28 @@
+// incremental parser for the text parts of a web stream: HTTP/ICY header lines, playlist lines,
+// ICY metadata blocks and chunk size lines, fed with whole read() buffers, no heap
+#pragma once
+
+#include "Arduino.h"
+
+const uint16_t HTTP_ARENA_SIZE      = 1536;         /* longest header line or metadata block kept, +1 for the NUL */
+
+typedef struct _HTTPParser_t {
+    char     arena[HTTP_ARENA_SIZE];  /* the current line or metadata block, NUL terminated when complete */
+    uint16_t len;                     /* bytes in arena */
+    uint16_t metaLen;                 /* length of the metadata block, from its length byte */
+    uint16_t metaLeft;                /* bytes of the metadata block still to come */
+    bool     metaStarted;             /* length byte seen */
+    bool     complete;                /* arena holds a whole line or block, cleared by the next call */
+    bool     overflow;                /* the line or block was longer than the arena, the rest is dropped */
+    uint8_t  chunkDigits;             /* hex digits of the chunk size line so far */
+    bool     chunkExt;                /* behind ';' of a chunk extension */
+    uint32_t chunkSize;
+    uint32_t chunkLeft;               /* payload bytes of the current chunk still to come */
+    bool     lastChunk;               /* size 0 seen, the rest (trailers) is dropped */
+} HTTPParser_t;
+
+void HTTPParserReset(HTTPParser_t *p);
+int  HTTPParseLine(HTTPParser_t *p, const uint8_t *buf, int len);
+int  HTTPParseMeta(HTTPParser_t *p, const uint8_t *buf, int len);
+int  HTTPParseChunkSize(HTTPParser_t *p, const uint8_t *buf, int len, int32_t *size);
+int  HTTPDechunk(HTTPParser_t *p, uint8_t *buf, int len);
@@ -1,31 +1,202 @@
 #include <Arduino.h>
 #include <Wire.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "i2c.h"
 
+// Only i2c_task() touches Wire. loop() waits for the bus only if it asks to (I2C_WAIT): a volume step from the
+// encoder is queued and a newer one replaces it while it still waits, the LCD flush task queues its row updates
+// behind the amplifiers, and a mute goes out before anything else that is waiting.
 
- void i2c_writeByte(uint8_t deviceAddress, uint8_t registerAddress, uint8_t d) {
-  Wire.beginTransmission(deviceAddress);  
-  Wire.write(registerAddress);
-  Wire.write(d);
-  Wire.endTransmission();     
+#define SLOT_FREE     0
+#define SLOT_PENDING  1
+#define SLOT_ACTIVE   2
+#define SLOT_DONE     3 // I2C_WAIT, until the caller picks up the result
+
+typedef struct {
+  volatile uint8_t state;
+  uint8_t  prio;
+  uint8_t  flags;
+  uint8_t  read;               // 1 = read one byte from the register
+  uint8_t  dev;
+  uint8_t  reg;
+  uint8_t  len;
+  uint8_t  data[I2C_DATA_MAX]; // written, or the byte read
+  uint32_t seq;                // order of posting, within a priority the oldest goes first
+  uint32_t postUs;             // micros() of the first post, a coalesced write keeps it
+  SemaphoreHandle_t done;      // given when an I2C_WAIT transaction is done
+  } I2C_SLOT;
+
+static I2C_SLOT slot[I2C_QUEUE_LEN];
+static I2C_STATS stats[I2C_MAX_DEVICES];
+static uint32_t seqNext = 0;
+static SemaphoreHandle_t i2cMutex = xSemaphoreCreateMutex(); // slot[], stats[]
+static SemaphoreHandle_t i2cWork = xSemaphoreCreateBinary(); // given at each post
+static bool i2cStarted = false;
+
+// statistics of a device, i2cMutex held, NULL if all I2C_MAX_DEVICES entries are taken
+static I2C_STATS* i2c_device(uint8_t deviceAddress) {
+  for (int inx = 0; inx < I2C_MAX_DEVICES; inx++) {
+    if (stats[inx].addr == deviceAddress) return &stats[inx];
+    if (stats[inx].addr == 0) {
+      stats[inx].addr = deviceAddress;
+      return &stats[inx];
+      }
+    }
+  return NULL;
+  }
+
+static void i2c_task(void* param) {
+  while (1) {
+    xSemaphoreTake(i2cWork, portMAX_DELAY);
+    while (1) {
+      I2C_SLOT* s = NULL;
+      xSemaphoreTake(i2cMutex, portMAX_DELAY);
+      for (int inx = 0; inx < I2C_QUEUE_LEN; inx++) {
+        I2C_SLOT* t = &slot[inx];
+        if (t->state != SLOT_PENDING) continue;
+        if (!s || (t->prio < s->prio) || ((t->prio == s->prio) && ((int32_t)(t->seq - s->seq) < 0))) s = t;
+        }
+      if (!s) {
+        xSemaphoreGive(i2cMutex);
+        break;
+        }
+      s->state = SLOT_ACTIVE;
+      xSemaphoreGive(i2cMutex);
+
+      uint32_t startUs = micros();
+      uint8_t err;
+      Wire.beginTransmission(s->dev);
+      Wire.write(s->reg);
+      if (s->read) {
+        err = Wire.endTransmission(false); // restart
+        Wire.requestFrom(s->dev, (uint8_t) 1);
+        s->data[0] = Wire.read();
+        Wire.endTransmission();
+        }
+      else {
+        for (int inx = 0; inx < s->len; inx++) {
+          Wire.write(s->data[inx]);
+          }
+        err = Wire.endTransmission();
+        }
+      uint32_t endUs = micros();
+
+      xSemaphoreTake(i2cMutex, portMAX_DELAY);
+      I2C_STATS* st = i2c_device(s->dev);
+      if (st) {
+        st->count++;
+        if (err) st->errors++;
+        st->sumUs += endUs - s->postUs;
+        if (endUs - s->postUs > st->maxUs) st->maxUs = endUs - s->postUs;
+        if (endUs - startUs > st->maxBusUs) st->maxBusUs = endUs - startUs;
+        }
+      if (s->flags & I2C_WAIT) {
+        s->state = SLOT_DONE;
+        xSemaphoreGive(s->done);
+        }
+      else s->state = SLOT_FREE;
+      xSemaphoreGive(i2cMutex);
+      }
+    }
+  }
+
+// queue a transaction, pRead = read one byte into *pRead (waits)
+static int i2c_submit(uint8_t prio, uint8_t deviceAddress, uint8_t registerAddress, const uint8_t* pBuffer, int numBytes, uint8_t flags, uint8_t* pRead) {
+  int inx;
+  if ((numBytes > I2C_DATA_MAX) || (prio >= I2C_PRIOS) || !i2cStarted) return 0;
+  if (pRead) flags = (flags | I2C_WAIT) & ~I2C_COALESCE;
+  while (1) {
+    xSemaphoreTake(i2cMutex, portMAX_DELAY);
+    if ((flags & I2C_COALESCE) && !(flags & I2C_WAIT)) {
+      for (inx = 0; inx < I2C_QUEUE_LEN; inx++) {
+        I2C_SLOT* s = &slot[inx];
+        if ((s->state == SLOT_PENDING) && (s->flags == flags) && (s->dev == deviceAddress) &&
+            (s->reg == registerAddress) && (s->len == numBytes)) {
+          memcpy(s->data, pBuffer, numBytes); // latest wins
+          if (prio < s->prio) s->prio = prio;
+          I2C_STATS* st = i2c_device(deviceAddress);
+          if (st) st->coalesced++;
+          xSemaphoreGive(i2cMutex);
+          return 1;
+          }
+        }
+      }
+    for (inx = 0; inx < I2C_QUEUE_LEN; inx++) {
+      if (slot[inx].state == SLOT_FREE) break;
+      }
+    if (inx < I2C_QUEUE_LEN) break;
+    xSemaphoreGive(i2cMutex);
+    vTaskDelay(1); // full, only a burst of LCD updates gets here
+    }
+  I2C_SLOT* s = &slot[inx];
+  s->prio = prio;
+  s->flags = flags;
+  s->read = pRead ? 1 : 0;
+  s->dev = deviceAddress;
+  s->reg = registerAddress;
+  s->len = pRead ? 0 : numBytes;
+  if (!pRead) memcpy(s->data, pBuffer, numBytes);
+  s->seq = seqNext++;
+  s->postUs = micros();
+  s->state = SLOT_PENDING;
+  xSemaphoreGive(i2cMutex);
+  xSemaphoreGive(i2cWork);
+  if (!(flags & I2C_WAIT)) return 1;
+
+  xSemaphoreTake(s->done, portMAX_DELAY);
+  if (pRead) *pRead = s->data[0];
+  xSemaphoreTake(i2cMutex, portMAX_DELAY);
+  s->state = SLOT_FREE;
+  xSemaphoreGive(i2cMutex);
+  return 1;
+  }
+
+void i2c_begin(int sda, int scl) {
+  if (i2cStarted) return;
+  Wire.begin(sda, scl);
+  for (int inx = 0; inx < I2C_QUEUE_LEN; inx++) {
+    slot[inx].done = xSemaphoreCreateBinary();
+    }
+  i2cStarted = xTaskCreatePinnedToCore(i2c_task, "i2c", I2C_TASK_STACK, NULL, 2, NULL, 0) == pdPASS;
+  }
+
+// queue a write of numBytes (up to I2C_DATA_MAX) to a register, returns 0 if it can not be queued
+int i2c_post(uint8_t prio, uint8_t deviceAddress, uint8_t registerAddress, const uint8_t* pBuffer, int numBytes, uint8_t flags) {
+  return i2c_submit(prio, deviceAddress, registerAddress, pBuffer, numBytes, flags, NULL);
+  }
+
+void i2c_writeByte(uint8_t deviceAddress, uint8_t registerAddress, uint8_t d) {
+  i2c_submit(I2C_PRIO_CONFIG, deviceAddress, registerAddress, &d, 1, I2C_WAIT, NULL);
   }
 
 void i2c_writeBuffer(uint8_t deviceAddress, uint8_t registerAddress, uint8_t* pBuffer, int numBytes) {
-  Wire.beginTransmission(deviceAddress);  
-  Wire.write(registerAddress);
-  for (int inx = 0; inx < numBytes; inx++) {
-    Wire.write(pBuffer[inx]);
-    }           
-  Wire.endTransmission();     
+  i2c_submit(I2C_PRIO_CONFIG, deviceAddress, registerAddress, pBuffer, numBytes, I2C_WAIT, NULL);
   }
 
 uint8_t i2c_readByte(uint8_t deviceAddress, uint8_t registerAddress){
-  uint8_t d; 
-  Wire.beginTransmission(deviceAddress);
-  Wire.write(registerAddress);
-  Wire.endTransmission(false); // restart
-  Wire.requestFrom(deviceAddress, (uint8_t) 1);
-  d = Wire.read();
-  Wire.endTransmission(); 
+  uint8_t d = 0;
+  i2c_submit(I2C_PRIO_CONFIG, deviceAddress, registerAddress, NULL, 0, I2C_WAIT, &d);
   return d;
   }
+
+void i2c_getStats(I2C_STATS* pStats) {
+  xSemaphoreTake(i2cMutex, portMAX_DELAY);
+  memcpy(pStats, stats, sizeof(stats));
+  xSemaphoreGive(i2cMutex);
+  }
+
+// one line per device, latency = queue wait + bus time
+void i2c_report(void (*out)(const char*)) {
+  I2C_STATS st[I2C_MAX_DEVICES];
+  char line[120];
+  i2c_getStats(st);
+  for (int inx = 0; inx < I2C_MAX_DEVICES; inx++) {
+    if (!st[inx].addr) continue;
+    snprintf(line, sizeof(line), "i2c 0x%02X: %u transactions, %u coalesced, %u errors, latency mean %u us max %u us, bus max %u us",
+             st[inx].addr, st[inx].count, st[inx].coalesced, st[inx].errors,
+             st[inx].count ? st[inx].sumUs / st[inx].count : 0, st[inx].maxUs, st[inx].maxBusUs);
+    out(line);
+    }
+  }
@@ -1,10 +1,40 @@
 #ifndef _I2C_H
 #define _I2C_H
 
+// All I2C traffic (amplifiers, LCD) goes through one queue, a task of its own owns Wire and runs the
+// pending transaction of the highest priority first, in order within a priority
 
+#define I2C_PRIO_MUTE       0   // amplifier mute/unmute, ahead of everything
+#define I2C_PRIO_VOLUME     1
+#define I2C_PRIO_CONFIG     2   // i2c_writeByte(), i2c_writeBuffer(), i2c_readByte()
+#define I2C_PRIO_LCD        3
+#define I2C_PRIOS           4
+
+#define I2C_COALESCE     0x01   // replaces the data of a write to the same device and register still waiting
+#define I2C_WAIT         0x02   // return after the transaction is done
+
+#define I2C_QUEUE_LEN      16   // transactions waiting or running
+#define I2C_DATA_MAX       16   // bytes after the register byte, one LCD row
+#define I2C_MAX_DEVICES     4   // addresses with statistics
+#define I2C_TASK_STACK   2048
+
+typedef struct {
+  uint8_t  addr;               // 0 = unused entry
+  uint32_t count;              // transactions done
+  uint32_t coalesced;          // writes merged into one still waiting
+  uint32_t errors;             // no ACK
+  uint32_t sumUs;              // queue wait + bus time, for the mean
+  uint32_t maxUs;              // longest queue wait + bus time
+  uint32_t maxBusUs;           // longest bus time
+  } I2C_STATS;
+
+void i2c_begin(int sda, int scl);
+int  i2c_post(uint8_t prio, uint8_t deviceAddress, uint8_t registerAddress, const uint8_t* pBuffer, int numBytes, uint8_t flags);
 void i2c_writeByte(uint8_t deviceAddress, uint8_t registerAddress, uint8_t d);
 void i2c_writeBuffer(uint8_t deviceAddress, uint8_t registerAddress, uint8_t* pBuffer, int numBytes);
 uint8_t i2c_readByte(uint8_t deviceAddress, uint8_t registerAddress);
+void i2c_getStats(I2C_STATS* pStats); // I2C_MAX_DEVICES entries
+void i2c_report(void (*out)(const char*));
 
 
 #endif
@@ -1,11 +1,31 @@
 #include <Arduino.h>
-#include <Wire.h>
 #include "config.h"
 #include "lcdST7032.h"
+#include "i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 static uint8_t displayOnOffSetting = (DISPLAY_ON_OFF | DISPLAY_ON_OFF_D);
 static uint8_t contrast = 20;
 
+// lcd_printf(), lcd_printScreen(), lcd_write() and lcd_clear() change frame[] under lcdMutex and return,
+// lcd_task() compares it with shown[] every LCD_FRAME_MS and sends each changed row span as one address
+// command plus one multi-byte data transfer, instead of one transaction and 30us per character
+static char frame[LCD_ROWS][LCD_COLS];   // what the display should show
+static char shown[LCD_ROWS][LCD_COLS];   // what it shows, lcd_task() only
+static uint8_t curRow = 0;               // lcd_setCursor(), lcd_write()
+static uint8_t curCol = 0;
+static char scrollText[LCD_TEXT_MAX];    // lcd_printScreen() text
+static int  scrollLen = 0;               // 0 after lcd_printf(), lcd_write(), lcd_clear()
+static int  scrollPos = 0;               // first character shown
+static int  scrollHold = 0;              // steps to stand still
+static uint32_t scrollTime = 0;          // millis() of the last step
+static SemaphoreHandle_t lcdMutex = xSemaphoreCreateMutex();
+static TaskHandle_t lcdTaskHandle = NULL;
+
+static void lcd_task(void* param);
+
 
 void lcd_begin() {
    digitalWrite(LCD_RST, LOW);
@@ -20,47 +40,107 @@ void lcd_begin() {
    delay(300);
    lcd_Write_Instruction(displayOnOffSetting);
    lcd_Write_Instruction(ENTRY_MODE_SET | ENTRY_MODE_SET_ID); 
+   lcd_Write_Instruction(CLEAR_DISPLAY);
+   delayMicroseconds(HOME_CLEAR_DELAY_US);
+   memset(shown, ' ', sizeof(shown));
    lcd_clear();
-   lcd_home();
+   if (!lcdTaskHandle) {
+      xTaskCreatePinnedToCore(lcd_task, "lcd", LCD_TASK_STACK, NULL, 1, &lcdTaskHandle, 0);
+      }
    }	
 
+// render the window of the scrolling text at scrollPos, lcdMutex held
+static void lcd_scrollRender() {
+   for (int r = 0; r < LCD_ROWS; r++) {
+      for (int c = 0; c < LCD_COLS; c++) {
+         int inx = scrollPos + r*LCD_COLS + c;
+         frame[r][c] = inx < scrollLen ? scrollText[inx] : ' ';
+         }
+      }
+   }
+
+// advance a text longer than the screen by one character every LCD_SCROLL_MS, lcdMutex held
+static void lcd_scrollStep() {
+   if (scrollLen <= LCD_ROWS*LCD_COLS) return;
+   if (millis() - scrollTime < LCD_SCROLL_MS) return;
+   scrollTime = millis();
+   if (scrollHold) {
+      scrollHold--;
+      return;
+      }
+   if (scrollPos + LCD_ROWS*LCD_COLS >= scrollLen) scrollPos = 0;
+   else scrollPos++;
+   if ((scrollPos == 0) || (scrollPos + LCD_ROWS*LCD_COLS >= scrollLen)) scrollHold = LCD_SCROLL_HOLD;
+   lcd_scrollRender();
+   }
+
+// send the span of a row from the first to the last changed cell
+static void lcd_flushRow(int r, const char* want) {
+   int first = 0;
+   int last = LCD_COLS - 1;
+   while ((first < LCD_COLS) && (want[first] == shown[r][first])) first++;
+   if (first == LCD_COLS) return;
+   while (want[last] == shown[r][last]) last--;
+   uint8_t cmd = SET_DDRAM_ADDRESS | ((r ? LINE_2_ADR : LINE_1_ADR) + first);
+   // both queued behind the amplifiers, the I2C task keeps their order. The address counter increments after
+   // each byte, at 100kHz a byte on the bus takes longer than the 26us the ST7032 needs to write it
+   i2c_post(I2C_PRIO_LCD, Write_Address, CNTRBIT_CO, &cmd, 1, 0);
+   i2c_post(I2C_PRIO_LCD, Write_Address, CNTRBIT_RS, (const uint8_t*)&want[first], last - first + 1, 0);
+   memcpy(&shown[r][first], &want[first], last - first + 1);
+   }
+
+static void lcd_task(void* param) {
+   char want[LCD_ROWS][LCD_COLS];
+   while (1) {
+      xSemaphoreTake(lcdMutex, portMAX_DELAY);
+      lcd_scrollStep();
+      memcpy(want, frame, sizeof(want));
+      xSemaphoreGive(lcdMutex);
+      for (int r = 0; r < LCD_ROWS; r++) {
+         lcd_flushRow(r, want[r]);
+         }
+      vTaskDelay(pdMS_TO_TICKS(LCD_FRAME_MS));
+      }
+   }
+
 void lcd_Write_Instruction(uint8_t cmd){
-	Wire.beginTransmission(Write_Address);
-	Wire.write(CNTRBIT_CO);  
-	Wire.write(cmd);
-	Wire.endTransmission();
+	i2c_post(I2C_PRIO_LCD, Write_Address, CNTRBIT_CO, &cmd, 1, I2C_WAIT);
 	delayMicroseconds(WRITE_DELAY_US);
    }
 
 void lcd_Write_Data(uint8_t data){
-	Wire.beginTransmission(Write_Address);
-	Wire.write(CNTRBIT_RS); 
-	Wire.write(data);
-	Wire.endTransmission();
+	i2c_post(I2C_PRIO_LCD, Write_Address, CNTRBIT_RS, &data, 1, I2C_WAIT);
 	delayMicroseconds(WRITE_DELAY_US);
     }
 
-size_t lcd_write(uint8_t chr) {
-	lcd_Write_Data(chr);
+size_t lcd_write(uint8_t chr) { // at the cursor of lcd_setCursor(), characters past the end of the row are dropped
+	xSemaphoreTake(lcdMutex, portMAX_DELAY);
+	scrollLen = 0;
+	if (curCol < LCD_COLS) frame[curRow][curCol++] = chr;
+	xSemaphoreGive(lcdMutex);
 	return 1;
     }
 
 void lcd_clear() { //clear display
-	lcd_Write_Instruction(CLEAR_DISPLAY);
-	delayMicroseconds(HOME_CLEAR_DELAY_US);
+	xSemaphoreTake(lcdMutex, portMAX_DELAY);
+	memset(frame, ' ', sizeof(frame));
+	scrollLen = 0;
+	curRow = curCol = 0;
+	xSemaphoreGive(lcdMutex);
     }
 
 void lcd_home() { //return to first line address 0
-	lcd_Write_Instruction(RETURN_HOME);
-	delayMicroseconds(HOME_CLEAR_DELAY_US);
+	xSemaphoreTake(lcdMutex, portMAX_DELAY);
+	curRow = curCol = 0;
+	xSemaphoreGive(lcdMutex);
 }
 
 void lcd_setCursor(uint8_t line, uint8_t pos) {
-	uint8_t p;
 	if(pos > 15) pos = 0;
-	if(line == 0) p = LINE_1_ADR + pos;
-	else p = LINE_2_ADR + pos;
-	lcd_Write_Instruction(SET_DDRAM_ADDRESS | p);
+	xSemaphoreTake(lcdMutex, portMAX_DELAY);
+	curRow = (line == 0) ? 0 : 1;
+	curCol = pos;
+	xSemaphoreGive(lcdMutex);
    }
 
 void lcd_display() { // turn on display 
@@ -113,38 +193,33 @@ void lcd_printf(int r, int c, char* format, ...)    {
    char szbuf[80];
    va_list args;
    va_start(args,format);
-   vsprintf(szbuf,format,args);
+   vsnprintf(szbuf,sizeof(szbuf),format,args);
    va_end(args);
    lcd_setCursor(r,c);
+   xSemaphoreTake(lcdMutex, portMAX_DELAY);
+   scrollLen = 0;
    char *sz = szbuf;
-   while (*sz) {
-      lcd_Write_Data(*sz); 
+   while (*sz && (curCol < LCD_COLS)) {
+      frame[curRow][curCol++] = *sz; 
       sz++;
       }  
+   xSemaphoreGive(lcdMutex);
    }	
 
+// up to LCD_COLS characters per row, a text longer than the screen scrolls through both rows
 void lcd_printScreen(char* format, ...)    {
-   char szbuf[50];
+   char szbuf[LCD_TEXT_MAX];
    va_list args;
    va_start(args,format);
-   vsprintf(szbuf,format,args);
+   vsnprintf(szbuf,sizeof(szbuf),format,args);
    va_end(args);
-   lcd_clear();
-   char *sz = szbuf;
-   int cnt = 0;
-   lcd_setCursor(0,0);
-   while (*sz && (cnt < 16)) {
-      lcd_Write_Data(*sz); 
-      sz++;
-      cnt++;
-      }  
-   if (*sz) {
-      lcd_setCursor(1,0);
-      cnt = 0;
-      while (*sz && (cnt < 16)) {
-        lcd_Write_Data(*sz); 
-        sz++;
-        cnt++;
-        }
-    }        
+   xSemaphoreTake(lcdMutex, portMAX_DELAY);
+   strcpy(scrollText, szbuf);
+   scrollLen = strlen(scrollText);
+   scrollPos = 0;
+   scrollHold = LCD_SCROLL_HOLD;
+   scrollTime = millis();
+   curRow = curCol = 0;
+   lcd_scrollRender();
+   xSemaphoreGive(lcdMutex);
   }
@@ -62,6 +62,15 @@
 #define WRITE_DELAY_US                  30 //see data sheet
 #define HOME_CLEAR_DELAY_US			  1200 //see data sheet
 
+// shadow framebuffer, lcd_printf() & co. only write to it, a low priority task sends the cells that changed
+#define LCD_ROWS                         2
+#define LCD_COLS                        16
+#define LCD_TEXT_MAX                    64 //lcd_printScreen() text, longer than LCD_ROWS*LCD_COLS scrolls
+#define LCD_FRAME_MS                    50 //flush period
+#define LCD_SCROLL_MS                  400 //one character per step
+#define LCD_SCROLL_HOLD                  5 //steps the start and the end of a scrolling text stand still
+#define LCD_TASK_STACK                2048
+
 void lcd_begin();
 void lcd_clear();
 void lcd_home();
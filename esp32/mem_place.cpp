@@ -0,0 +1,226 @@
+/*
+ * mem_place.cpp
+ * tiered placement of the decoder state and the audio buffers
+ *
+ * With PSRAM enabled, malloc() serves everything above CONFIG_SPIRAM_MALLOC_ALWAYSINTERNAL (4 KB) from PSRAM first,
+ * which puts the IMDCT and polyphase buffers of MP3 and the spectra and overlap buffers of AAC behind the cache, exactly the
+ * memory the decoders read and write for every sample. The decoders ask for memory by class instead, config.h
+ * maps each class to internal RAM or PSRAM (MEM_PLACE_HOT, MEM_PLACE_STATE, MEM_PLACE_BULK), so the small
+ * working sets stay in DRAM and only the large, sequentially read buffers go to PSRAM. A block that does not
+ * fit where the policy wants it is taken from the other RAM and reported. How many cycles this saves on the
+ * target has not been measured yet: AUDIO_DECODE_PROFILE prints the decoder load of the placement the sketch
+ * was built with, the comparison needs a second build with MEM_PLACE_HOT set to MEM_PSRAM.
+ * The const tables are not allocated, they stay in flash and are read through the cache.
+ * The hottest of them are read through pointers (MemTable_t). With MEM_TABLES_DRAM, MemTablesLoad() copies them
+ * to internal RAM when the codec allocates its buffers, MemTablesFree() points back to flash when the codec is
+ * freed. The copies are meant to keep an SD or SPI transfer that evicts the cache from stalling the transforms,
+ * neither the misses nor the decode time variance have been measured on the target (there is no cache miss
+ * counter, AUDIO_DECODE_PROFILE prints the spread and maximum per decode call instead). Tables with 16 bit
+ * entries cannot live in IRAM (32 bit access only), DRAM takes them all.
+ ************************************************************************************/
+
+#include "mem_place.h"
+#include "config.h"
+#include "esp_heap_caps.h"
+
+#ifndef MEM_PLACE_HOT
+#define MEM_PLACE_HOT       MEM_INTERNAL
+#endif
+#ifndef MEM_PLACE_STATE
+#define MEM_PLACE_STATE     MEM_INTERNAL
+#endif
+#ifndef MEM_PLACE_BULK
+#define MEM_PLACE_BULK      MEM_PSRAM
+#endif
+
+typedef struct {
+    void       *p;
+    const char *what;
+    uint32_t    size;
+    uint8_t     cls;
+    uint8_t     place;
+} MemBlock_t;
+
+static const MemPlace_t s_policy[MEM_CLASSES] = {MEM_PLACE_HOT, MEM_PLACE_STATE, MEM_PLACE_BULK, MEM_INTERNAL};
+static const char      *s_className[MEM_CLASSES] = {"hot", "state", "bulk", "tables"};
+static const char      *s_placeName[2] = {"internal RAM", "PSRAM"};
+static MemBlock_t       s_block[MEM_MAX_BLOCKS];
+
+static void *MemTake(MemPlace_t place, size_t size){
+    return heap_caps_malloc(size, (place == MEM_PSRAM ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL) | MALLOC_CAP_8BIT);
+}
+
+static void MemTrack(void *p, MemClass_t c, size_t size, MemPlace_t place, const char *what){
+    int i;
+
+    for(i = 0; i < MEM_MAX_BLOCKS; i++){
+        if(s_block[i].p) continue;
+        s_block[i].p = p;
+        s_block[i].what = what;
+        s_block[i].size = size;
+        s_block[i].cls = c;
+        s_block[i].place = place;
+        break;
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    MemPlacement
+ *
+ * Description: where blocks of a class are allocated
+ *
+ * Inputs:      class
+ *
+ * Outputs:     none
+ *
+ * Return:      the place of the policy, MEM_INTERNAL if there is no PSRAM
+ **********************************************************************************************************************/
+MemPlace_t MemPlacement(MemClass_t c){
+    if(s_policy[c] == MEM_PSRAM && psramFound()) return MEM_PSRAM;
+    return MEM_INTERNAL;
+}
+
+/***********************************************************************************************************************
+ * Function:    MemAlloc
+ *
+ * Description: allocate a cleared block of a class
+ *
+ * Inputs:      class, size in bytes, name for MemReport()
+ *
+ * Outputs:     the block is listed for MemReport()
+ *
+ * Return:      pointer to the block, NULL if neither RAM has room for it
+ *
+ * Notes:       the block comes from the other RAM if the place of the policy is full
+ **********************************************************************************************************************/
+void *MemAlloc(MemClass_t c, size_t size, const char *what){
+    MemPlace_t place = MemPlacement(c);
+    void *p = MemTake(place, size);
+
+    if(!p && psramFound()){
+        place = (place == MEM_PSRAM) ? MEM_INTERNAL : MEM_PSRAM;
+        p = MemTake(place, size);
+    }
+    if(!p) return NULL;
+    memset(p, 0, size);
+    MemTrack(p, c, size, place, what);
+    return p;
+}
+
+/***********************************************************************************************************************
+ * Function:    MemFree
+ *
+ * Description: free a block of MemAlloc()
+ *
+ * Inputs:      pointer to the block or NULL
+ *
+ * Outputs:     the block is removed from the list
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void MemFree(void *p){
+    int i;
+
+    if(!p) return;
+    for(i = 0; i < MEM_MAX_BLOCKS; i++){
+        if(s_block[i].p != p) continue;
+        s_block[i].p = NULL;
+        break;
+    }
+    heap_caps_free(p);
+}
+
+/***********************************************************************************************************************
+ * Function:    MemReport
+ *
+ * Description: print the placement of the allocated blocks
+ *
+ * Inputs:      output function (audio_info), policy = also print the policy and the free memory (at boot)
+ *
+ * Outputs:     one line with the bytes of each class and where they are, one line for every block that is not
+ *                where the policy wants it
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void MemReport(void (*out)(const char*), bool policy){
+    uint32_t bytes[MEM_CLASSES][2] = {{0}};
+    char line[160];
+    int i, c, n;
+
+    if(!out) return;
+    if(policy){
+        snprintf(line, sizeof(line), "memory: hot in %s, state in %s, bulk in %s, %u bytes internal and %u bytes PSRAM free",
+                 s_placeName[MemPlacement(MEM_HOT)], s_placeName[MemPlacement(MEM_STATE)],
+                 s_placeName[MemPlacement(MEM_BULK)], (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                 (uint32_t)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+        out(line);
+    }
+    for(i = 0; i < MEM_MAX_BLOCKS; i++){
+        if(s_block[i].p) bytes[s_block[i].cls][s_block[i].place] += s_block[i].size;
+    }
+    n = snprintf(line, sizeof(line), "memory:");
+    for(c = 0; c < MEM_CLASSES; c++){
+        n += snprintf(line + n, sizeof(line) - n, " %s %u/%u", s_className[c], bytes[c][MEM_INTERNAL], bytes[c][MEM_PSRAM]);
+    }
+    snprintf(line + n, sizeof(line) - n, " bytes internal/PSRAM");
+    out(line);
+    for(i = 0; i < MEM_MAX_BLOCKS; i++){
+        if(!s_block[i].p || s_block[i].place == MemPlacement((MemClass_t)s_block[i].cls)) continue;
+        snprintf(line, sizeof(line), "memory: %s (%s, %u bytes) in %s, %s is full", s_block[i].what,
+                 s_className[s_block[i].cls], s_block[i].size, s_placeName[s_block[i].place],
+                 s_placeName[MemPlacement((MemClass_t)s_block[i].cls)]);
+        out(line);
+    }
+}
+
+/***********************************************************************************************************************
+ * Function:    MemTablesLoad
+ *
+ * Description: copy const tables to internal RAM (MEM_TABLES_DRAM in config.h), nothing without the option
+ *
+ * Inputs:      list of tables, number of entries
+ *
+ * Outputs:     *ref of each table points to its copy
+ *
+ * Return:      none
+ *
+ * Notes:       a table that does not fit is read from flash as before, tables already copied are skipped
+ **********************************************************************************************************************/
+void MemTablesLoad(const MemTable_t *t, int n){
+#ifdef MEM_TABLES_DRAM
+    int i;
+
+    for(i = 0; i < n; i++){
+        if(*t[i].ref != t[i].flash) continue;
+        void *p = MemTake(MEM_INTERNAL, t[i].size);
+        if(!p) continue;
+        memcpy(p, t[i].flash, t[i].size);
+        MemTrack(p, MEM_TABLE, t[i].size, MEM_INTERNAL, t[i].what);
+        *t[i].ref = p;
+    }
+#else
+    (void)t;
+    (void)n;
+#endif
+}
+
+/***********************************************************************************************************************
+ * Function:    MemTablesFree
+ *
+ * Description: release the copies of MemTablesLoad()
+ *
+ * Inputs:      list of tables, number of entries
+ *
+ * Outputs:     *ref of each table points to flash
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void MemTablesFree(const MemTable_t *t, int n){
+    int i;
+
+    for(i = 0; i < n; i++){
+        if(*t[i].ref == t[i].flash) continue;
+        MemFree((void*)*t[i].ref);
+        *t[i].ref = t[i].flash;
+    }
+}
@@ -0,0 +1,35 @@
+// memory placement: decoder state and buffers are allocated by class, config.h decides per class whether it
+// goes to internal RAM or PSRAM, the const tables stay in flash unless MEM_TABLES_DRAM copies the hot ones
+// to internal RAM while their codec is in use. MemReport() prints where everything went
+#pragma once
+
+#include "Arduino.h"
+
+typedef enum {
+    MEM_INTERNAL = 0,            /* DRAM, single cycle, no cache */
+    MEM_PSRAM    = 1             /* SPI RAM behind the 32 KB flash/PSRAM cache, a miss costs a 32 byte line over SPI */
+} MemPlace_t;
+
+typedef enum {
+    MEM_HOT = 0,                 /* touched per sample: IMDCT, polyphase, Huffman output, AAC spectra, FLAC samples, SRC */
+    MEM_STATE,                   /* touched per frame: headers, side info, bit reservoir, program config */
+    MEM_BULK,                    /* large and read once in order: input buffer, crossfade ring, FLAC frame buffer */
+    MEM_TABLE,                   /* DRAM copies of const tables (MemTablesLoad), internal RAM only */
+    MEM_CLASSES
+} MemClass_t;
+
+const uint8_t  MEM_MAX_BLOCKS       = 40;           /* live allocations listed by MemReport() */
+
+typedef struct _MemTable_t {
+    const void **ref;            /* the pointer the decoder reads the table through */
+    const void  *flash;          /* the table in flash, *ref points here without a copy */
+    uint32_t     size;
+    const char  *what;
+} MemTable_t;
+
+MemPlace_t MemPlacement(MemClass_t c);
+void *MemAlloc(MemClass_t c, size_t size, const char *what);
+void  MemFree(void *p);
+void  MemReport(void (*out)(const char*), bool policy);
+void  MemTablesLoad(const MemTable_t *t, int n);
+void  MemTablesFree(const MemTable_t *t, int n);
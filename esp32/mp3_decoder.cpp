@@ -6,11 +6,14 @@
  *  Updated on: 27.06.2020
  */
 #include "mp3_decoder.h"
+#include "mem_place.h"
 
 const uint8_t  m_SYNCWORDH              =0xff;
 const uint8_t  m_SYNCWORDL              =0xf0;
 const uint8_t  m_DQ_FRACBITS_OUT        =25;  // number of fraction bits in output of dequant
 const uint8_t  m_CSHIFT                 =12;  // coefficients have 12 leading sign bits for early-terminating mulitplies
+const uint8_t  m_PCM_FRACBITS           =m_DQ_FRACBITS_OUT - 2 - 2 - 15;  // fraction bits below the 16-bit LSB out of the polyphase filter
+const uint8_t  m_FBITS_OUT_PCM32        =13;  // fraction bits below the 16-bit LSB in the int32 output (Q28, 3 guard bits)
 const uint8_t  m_SIBYTES_MPEG1_MONO     =17;
 const uint8_t  m_SIBYTES_MPEG1_STEREO   =32;
 const uint8_t  m_SIBYTES_MPEG2_MONO     =9;
@@ -651,7 +654,7 @@ const uint32_t m_COS3_0 = 0x4545e9ef;  /* Q31 */
 const uint32_t m_COS3_1 = 0x539eba45;  /* Q30 */
 const uint32_t m_COS4_0 = 0x5a82799a;  /* Q31 */
 
-const uint32_t m_dcttab[48] PROGMEM = { // faster in ROM
+const uint32_t dcttab[48] PROGMEM = { // faster in ROM
     /* first pass */
      m_COS0_0,  m_COS0_15, m_COS1_0,    /* 31, 27, 31 */
      m_COS0_1,  m_COS0_14, m_COS1_1,    /* 31, 29, 31 */
@@ -672,6 +675,19 @@ const uint32_t m_dcttab[48] PROGMEM = { // faster in ROM
     -m_COS2_1, -m_COS2_2,  m_COS3_1,   /* 31, 31, 30 */
 };
 
+/* the tables read for every sample or codeword, through pointers that MemTablesLoad() may redirect to DRAM */
+static const unsigned short *m_huffTable = huffTable;
+static const uint32_t       *m_polyCoef  = polyCoef;
+static const uint32_t       *m_dcttab    = dcttab;
+static const uint32_t      (*m_imdctWin)[36] = imdctWin;
+
+static const MemTable_t m_hotTables[] = {
+    {(const void**)&m_huffTable, huffTable, sizeof(huffTable), "huffTable"},
+    {(const void**)&m_polyCoef,  polyCoef,  sizeof(polyCoef),  "polyCoef"},
+    {(const void**)&m_dcttab,    dcttab,    sizeof(dcttab),    "dcttab"},
+    {(const void**)&m_imdctWin,  imdctWin,  sizeof(imdctWin),  "imdctWin"},
+};
+
 /***********************************************************************************************************************
  * B I T S T R E A M
  **********************************************************************************************************************/
@@ -736,10 +752,18 @@ int CheckPadBit(){
     return (m_FrameHeader->paddingBit ? 1 : 0);
 }
 //----------------------------------------------------------------------------------------------------------------------
+int CheckFrameHeader(const unsigned char *buf){
+    /* sync word, then the fields which would index the tables with bad values (see UnpackFrameHeader) */
+    if ((buf[0] & m_SYNCWORDH) != m_SYNCWORDH || (buf[1] & m_SYNCWORDL) != m_SYNCWORDL)  return -1;
+    if (((buf[1] >> 1) & 0x03) == 0) return -1;                              /* layer 4 */
+    if (((buf[2] >> 2) & 0x03) == 3 || ((buf[2] >> 4) & 0x0f) == 15) return -1; /* srIdx, brIdx */
+    return 0;
+}
+//----------------------------------------------------------------------------------------------------------------------
 int UnpackFrameHeader(unsigned char *buf){
     int verIdx;
     /* validate pointers and sync word */
-    if ((buf[0] & m_SYNCWORDH) != m_SYNCWORDH || (buf[1] & m_SYNCWORDL) != m_SYNCWORDL)  return -1;
+    if (CheckFrameHeader(buf) == -1) return -1;
     /* read header fields - use bitmasks instead of GetBits() for speed, since format never varies */
     verIdx = (buf[1] >> 3) & 0x03;
     m_MPEGVersion = (MPEGVersion_t) (verIdx == 0 ? MPEG25 : ((verIdx & 0x01) ? MPEG1 : MPEG2));
@@ -1164,17 +1188,144 @@ int UnpackScaleFactors( unsigned char *buf, int *bitOffset, int bitsAvail, int g
  *              -1 if sync not found after searching nBytes
  **********************************************************************************************************************/
 int MP3FindSyncWord(unsigned char *buf, int nBytes) {
-    int i;
+    int i = 0;
+    uint32_t w;
+    MP3FrameHeaderInfo_t fhi;
 
-    /* find byte-aligned syncword - need 12 (MPEG 1,2) or 11 (MPEG 2.5) matching bits */
-    for (i = 0; i < nBytes - 1; i++) {
-        if ((buf[i + 0] & m_SYNCWORDH) == m_SYNCWORDH
-                && (buf[i + 1] & m_SYNCWORDL) == m_SYNCWORDL)
-            return i;
+    /* find byte-aligned syncword - need 12 (MPEG 1,2) or 11 (MPEG 2.5) matching bits
+     * audio data rarely contains 0xff, so skip aligned words without any 0xff byte in one step
+     * (~w has a zero byte where w has 0xff), and check the remaining candidates bytewise
+     */
+    while (i < nBytes - 1) {
+        if ((((uintptr_t)(buf + i)) & 0x03) == 0 && i + 4 <= nBytes) {
+            w = ~(*(uint32_t *)(buf + i));
+            if (((w - 0x01010101) & ~w & 0x80808080) == 0) {
+                i += 4;
+                continue;
+            }
+        }
+        if ((buf[i + 0] & m_SYNCWORDH) == m_SYNCWORDH && (buf[i + 1] & m_SYNCWORDL) == m_SYNCWORDL) {
+            /* reject candidates which cannot be a layer 3 frame header, if the whole header is in buf */
+            if (i + 4 > nBytes || MP3ParseFrameHeader(buf + i, &fhi) == 0)
+                return i;
+        }
+        i++;
     }
 
     return -1;
 }
+/***********************************************************************************************************************
+ * Function:    MP3ParseFrameHeader
+ *
+ * Description: parse a layer 3 frame header without changing the decoder state
+ *
+ * Inputs:      pointer to 4-byte frame header
+ *
+ * Outputs:     filled-in MP3FrameHeaderInfo struct
+ *
+ * Return:      0 if the header is valid, -1 otherwise
+ *
+ * Notes:       uses the same checks as UnpackFrameHeader(), so it can be used by file scanners
+ *                while a decode is in progress
+ **********************************************************************************************************************/
+int MP3ParseFrameHeader(const unsigned char *buf, MP3FrameHeaderInfo_t *fhi){
+    int verIdx, ver, srIdx, brIdx, mono, crc;
+
+    if (CheckFrameHeader(buf) == -1 || ((buf[1] >> 1) & 0x03) != 1)  /* layer 3 only */
+        return -1;
+    verIdx = (buf[1] >> 3) & 0x03;
+    ver = (verIdx == 0 ? MPEG25 : ((verIdx & 0x01) ? MPEG1 : MPEG2));
+    crc = 1 - ((buf[1] >> 0) & 0x01);
+    brIdx = (buf[2] >> 4) & 0x0f;
+    srIdx = (buf[2] >> 2) & 0x03;
+    mono = (((buf[3] >> 6) & 0x03) == Mono);
+
+    fhi->samprate = samplerateTab[ver][srIdx];
+    fhi->nChans = (mono ? 1 : 2);
+    fhi->samplesPerFrame = samplesPerFrameTab[ver][2];
+    fhi->sideInfoEnd = 4 + (crc ? 2 : 0) + sideBytesTab[ver][mono ? 0 : 1];
+    fhi->frameBytes = (brIdx ? slotTab[ver][srIdx][brIdx] + ((buf[2] >> 1) & 0x01) : 0);
+    return 0;
+}
+//----------------------------------------------------------------------------------------------------------------------
+uint32_t ReadBigEndian(const unsigned char *p, int n){
+    uint32_t v = 0;
+    while (n--) v = (v << 8) | *p++;
+    return v;
+}
+/***********************************************************************************************************************
+ * Function:    MP3ParseVBRTag
+ *
+ * Description: look for a Xing/Info or VBRI tag in the first frame of a file
+ *
+ * Inputs:      pointer to the frame header of the first frame
+ *              number of valid bytes in buf
+ *
+ * Outputs:     filled-in MP3VBRTag struct, a VBRI table of contents is converted
+ *                to the Xing format (100 entries, 1 percent playtime each), encoder delay
+ *                and padding if a LAME tag follows the Xing/Info tag
+ *
+ * Return:      true if a tag was found
+ **********************************************************************************************************************/
+bool MP3ParseVBRTag(const unsigned char *buf, int nBytes, MP3VBRTag_t *tag){
+    MP3FrameHeaderInfo_t fhi;
+    const unsigned char *p;
+    uint32_t flags, entries, scale, entrySize, framesPerEntry, len, pos, f0, tf;
+    int e, i;
+
+    memset(tag, 0, sizeof(MP3VBRTag_t));
+    if (MP3ParseFrameHeader(buf, &fhi) == -1) return false;
+
+    /* Xing (VBR) or Info (CBR) tag follows the side info */
+    p = buf + fhi.sideInfoEnd;
+    if (p + 120 <= buf + nBytes && (!memcmp(p, "Xing", 4) || !memcmp(p, "Info", 4))) {
+        flags = ReadBigEndian(p + 4, 4);
+        p += 8;
+        if (flags & 0x01) {tag->frames = ReadBigEndian(p, 4); p += 4;}
+        if (flags & 0x02) {tag->bytes  = ReadBigEndian(p, 4); p += 4;}
+        if (flags & 0x04) {memcpy(tag->toc, p, 100); tag->hasToc = (tag->frames && tag->bytes); p += 100;}
+        if (flags & 0x08) p += 4;   /* quality indicator */
+
+        /* LAME extension: 9 byte encoder version, 12 bytes info/lowpass/replay gain/flags/bitrate, then
+           12 bits encoder delay and 12 bits padding (also written by ffmpeg as "Lavf"/"Lavc") */
+        if (p + 24 <= buf + nBytes && (!memcmp(p, "LAME", 4) || !memcmp(p, "Lavf", 4) || !memcmp(p, "Lavc", 4))) {
+            tag->encDelay   = (p[21] << 4) | (p[22] >> 4);
+            tag->encPadding = ((p[22] & 0x0f) << 8) | p[23];
+            tag->hasLame = true;
+        }
+        return true;
+    }
+
+    /* VBRI tag (Fraunhofer) is always 32 bytes after the frame header */
+    p = buf + 4 + 32;
+    if (p + 26 > buf + nBytes || memcmp(p, "VBRI", 4)) return false;
+    tag->bytes     = ReadBigEndian(p + 10, 4);
+    tag->frames    = ReadBigEndian(p + 14, 4);
+    entries        = ReadBigEndian(p + 18, 2);
+    scale          = ReadBigEndian(p + 20, 2);
+    entrySize      = ReadBigEndian(p + 22, 2);
+    framesPerEntry = ReadBigEndian(p + 24, 2);
+    p += 26;
+    if (!tag->frames || !tag->bytes || !framesPerEntry || entrySize < 1 || entrySize > 4
+            || p + entries * entrySize > buf + nBytes)
+        return true;
+
+    /* every VBRI entry holds the size of framesPerEntry frames, interpolate the percent steps */
+    pos = 0;
+    i = 0;
+    for (e = 0; e < (int)entries && i < 100; e++) {
+        len = ReadBigEndian(p + e * entrySize, entrySize) * scale;
+        f0 = e * framesPerEntry;
+        while (i < 100 && (tf = (uint64_t)i * tag->frames / 100) < f0 + framesPerEntry) {
+            uint32_t b = pos + (uint64_t)len * (tf - f0) / framesPerEntry;
+            tag->toc[i++] = (b >= tag->bytes ? 255 : (uint64_t)b * 256 / tag->bytes);
+        }
+        pos += len;
+    }
+    while (i < 100) tag->toc[i++] = 255;
+    tag->hasToc = true;
+    return true;
+}
 /***********************************************************************************************************************
  * Function:    MP3FindFreeSync
  *
@@ -1267,6 +1418,8 @@ int MP3GetChannels(){return m_MP3FrameInfo->nChans;}
 int MP3GetBitsPerSample(){return m_MP3FrameInfo->bitsPerSample;}
 int MP3GetBitrate(){return m_MP3FrameInfo->bitrate;}
 int MP3GetOutputSamps(){return m_MP3FrameInfo->outputSamps;}
+uint32_t MP3GetMainDataBytesCopied(){return m_MP3DecInfo ? m_MP3DecInfo->mainBytesCopied : 0;}
+void MP3ResetReservoir(){if(m_MP3DecInfo){m_MP3DecInfo->mainBufWrite=0; m_MP3DecInfo->reservoirBytes=0;}} // after a seek
 /***********************************************************************************************************************
  * Function:    MP3GetNextFrameInfo
  *
@@ -1300,11 +1453,45 @@ int MP3GetNextFrameInfo(unsigned char *buf) {
  *
  * Return:      none
  **********************************************************************************************************************/
-void MP3ClearBadFrame( short *outbuf) {
+template <typename pcm_t> void MP3ClearBadFrame(pcm_t *outbuf) {
     int i;
     for (i = 0; i < m_MP3DecInfo->nGrans * m_MP3DecInfo->nGranSamps * m_MP3DecInfo->nChans; i++)
         outbuf[i] = 0;
 }
+/***********************************************************************************************************************
+ * Function:    MP3AppendMainData
+ *
+ * Description: append main data slots to the bit reservoir
+ *
+ * Inputs:      pointer to main data slots
+ *              number of bytes to append (<= m_MAINBUF_SIZE)
+ *              number of reservoir bytes that must stay contiguous in front of the new slots
+ *
+ * Outputs:     updated mainBuf, mainBufWrite, reservoirBytes and mainBytesCopied
+ *
+ * Return:      pointer to the first appended byte in mainBuf
+ *
+ * Notes:       the reservoir is not moved on every frame, only when the window is full it wraps to the
+ *                start of mainBuf, carrying keepBytes (<= m_MAX_MAINDATABEGIN) along
+ **********************************************************************************************************************/
+unsigned char *MP3AppendMainData(const unsigned char *src, int nBytes, int keepBytes){
+    unsigned char *dst;
+
+    if (keepBytes > m_MP3DecInfo->reservoirBytes)
+        keepBytes = m_MP3DecInfo->reservoirBytes;
+    if (m_MP3DecInfo->mainBufWrite + nBytes > m_RESERVOIR_SIZE) {
+        memmove(m_MP3DecInfo->mainBuf, m_MP3DecInfo->mainBuf + m_MP3DecInfo->mainBufWrite - keepBytes, keepBytes);
+        m_MP3DecInfo->mainBytesCopied += keepBytes;
+        m_MP3DecInfo->mainBufWrite = keepBytes;
+        m_MP3DecInfo->reservoirBytes = keepBytes;
+    }
+    dst = m_MP3DecInfo->mainBuf + m_MP3DecInfo->mainBufWrite;
+    memcpy(dst, src, nBytes);
+    m_MP3DecInfo->mainBytesCopied += nBytes;
+    m_MP3DecInfo->mainBufWrite += nBytes;
+    m_MP3DecInfo->reservoirBytes += nBytes;
+    return dst;
+}
 /***********************************************************************************************************************
  * Function:    MP3Decode
  *
@@ -1325,6 +1512,32 @@ void MP3ClearBadFrame( short *outbuf) {
  *                is not supported (bit reservoir is not maintained if useSize on)
  **********************************************************************************************************************/
 int MP3Decode( unsigned char *inbuf, int *bytesLeft, short *outbuf, int useSize){
+    return MP3DecodeFrame(inbuf, bytesLeft, outbuf, useSize);
+}
+/***********************************************************************************************************************
+ * Function:    MP3Decode32
+ *
+ * Description: decode one frame of MP3 data to int32 PCM
+ *
+ * Inputs:      as MP3Decode(), outbuf holds int32_t samples
+ *
+ * Outputs:     Q28 PCM data in outbuf (1.0 = 16-bit full scale, 3 guard bits), interleaved LRLRLR... if stereo
+ *              updated inbuf pointer, updated bytesLeft
+ *
+ * Return:      error code, as MP3Decode()
+ *
+ * Notes:       the polyphase sums are saturated to 32 bit instead of being rounded and clipped to 16 bit,
+ *                so the output carries 13 more fraction bits and peaks up to 8 times full scale
+ **********************************************************************************************************************/
+int MP3Decode32(unsigned char *inbuf, int *bytesLeft, int32_t *outbuf, int useSize){
+    return MP3DecodeFrame(inbuf, bytesLeft, outbuf, useSize);
+}
+/***********************************************************************************************************************
+ * Function:    MP3DecodeFrame
+ *
+ * Description: body of MP3Decode() and MP3Decode32(), pcm_t is short or int32_t
+ **********************************************************************************************************************/
+template <typename pcm_t> int MP3DecodeFrame(unsigned char *inbuf, int *bytesLeft, pcm_t *outbuf, int useSize){
     int offset, bitOffset, mainBits, gr, ch, fhBytes, siBytes, freeFrameBytes;
     int prevBitOffset, sfBlockBits, huffBlockBits;
     unsigned char *mainPtr;
@@ -1385,23 +1598,27 @@ int MP3Decode( unsigned char *inbuf, int *bytesLeft, short *outbuf, int useSize)
             MP3ClearBadFrame(outbuf);
             return ERR_MP3_INDATA_UNDERFLOW;
         }
-        /* fill main data buffer with enough new data for this frame */
-        if (m_MP3DecInfo->mainDataBytes >= m_MP3DecInfo->mainDataBegin) {
-            /* adequate "old" main data available (i.e. bit reservoir) */
-            memmove(m_MP3DecInfo->mainBuf,
-                    m_MP3DecInfo->mainBuf + m_MP3DecInfo->mainDataBytes - m_MP3DecInfo->mainDataBegin,
-                    m_MP3DecInfo->mainDataBegin);
-            memcpy (m_MP3DecInfo->mainBuf + m_MP3DecInfo->mainDataBegin, inbuf,
-                    m_MP3DecInfo->nSlots);
-
+        if (m_MP3DecInfo->mainDataBegin == 0) {
+            /* frame does not use the bit reservoir - decode main data straight out of inbuf and keep
+             * only the tail that the next frame can reference (its main data starts behind this one's) */
+            m_MP3DecInfo->mainDataBytes = m_MP3DecInfo->nSlots;
+            mainPtr = inbuf;
+            if (m_MP3DecInfo->nSlots > m_MAX_MAINDATABEGIN)
+                MP3AppendMainData(inbuf + m_MP3DecInfo->nSlots - m_MAX_MAINDATABEGIN, m_MAX_MAINDATABEGIN, 0);
+            else
+                MP3AppendMainData(inbuf, m_MP3DecInfo->nSlots, 0);
+            inbuf += m_MP3DecInfo->nSlots;
+            *bytesLeft -= (m_MP3DecInfo->nSlots);
+        } else if (m_MP3DecInfo->reservoirBytes >= m_MP3DecInfo->mainDataBegin) {
+            /* adequate "old" main data available (i.e. bit reservoir), new slots go right behind it */
+            mainPtr = MP3AppendMainData(inbuf, m_MP3DecInfo->nSlots, m_MP3DecInfo->mainDataBegin)
+                    - m_MP3DecInfo->mainDataBegin;
             m_MP3DecInfo->mainDataBytes = m_MP3DecInfo->mainDataBegin + m_MP3DecInfo->nSlots;
             inbuf += m_MP3DecInfo->nSlots;
             *bytesLeft -= (m_MP3DecInfo->nSlots);
-            mainPtr = m_MP3DecInfo->mainBuf;
         } else {
             /* not enough data in bit reservoir from previous frames (perhaps starting in middle of file) */
-            memcpy(m_MP3DecInfo->mainBuf + m_MP3DecInfo->mainDataBytes, inbuf, m_MP3DecInfo->nSlots);
-            m_MP3DecInfo->mainDataBytes += m_MP3DecInfo->nSlots;
+            MP3AppendMainData(inbuf, m_MP3DecInfo->nSlots, m_MP3DecInfo->mainDataBegin);
             inbuf += m_MP3DecInfo->nSlots;
             *bytesLeft -= (m_MP3DecInfo->nSlots);
             MP3ClearBadFrame( outbuf);
@@ -1510,21 +1727,22 @@ void MP3Decoder_ClearBuffer(void) {
 bool MP3Decoder_AllocateBuffers(void)
 {
 
-    if(!m_MP3DecInfo)       {m_MP3DecInfo    = (MP3DecInfo_t*)      malloc(sizeof(MP3DecInfo_t)   );}
-    if(!m_FrameHeader)      {m_FrameHeader   = (FrameHeader_t*)     malloc(sizeof(FrameHeader_t)  );}
-    if(!m_SideInfo)         {m_SideInfo      = (SideInfo_t*)        malloc(sizeof(SideInfo_t)     );}
-    if(!m_ScaleFactorJS)    {m_ScaleFactorJS = (ScaleFactorJS_t*)   malloc(sizeof(ScaleFactorJS_t));}
-    if(!m_HuffmanInfo)      {m_HuffmanInfo   = (HuffmanInfo_t*)     malloc(sizeof(HuffmanInfo_t)  );}
-    if(!m_DequantInfo)      {m_DequantInfo   = (DequantInfo_t*)     malloc(sizeof(DequantInfo_t)  );}
-    if(!m_IMDCTInfo)        {m_IMDCTInfo     = (IMDCTInfo_t*)       malloc(sizeof(IMDCTInfo_t)    );}
-    if(!m_SubbandInfo)      {m_SubbandInfo   = (SubbandInfo_t*)     malloc(sizeof(SubbandInfo_t)  );}
-    if(!m_MP3FrameInfo)     {m_MP3FrameInfo  = (MP3FrameInfo_t*)    malloc(sizeof(MP3FrameInfo_t) );}
+    if(!m_MP3DecInfo)       {m_MP3DecInfo    = (MP3DecInfo_t*)      MemAlloc(MEM_STATE, sizeof(MP3DecInfo_t),    "MP3DecInfo"   );}
+    if(!m_FrameHeader)      {m_FrameHeader   = (FrameHeader_t*)     MemAlloc(MEM_STATE, sizeof(FrameHeader_t),   "FrameHeader"  );}
+    if(!m_SideInfo)         {m_SideInfo      = (SideInfo_t*)        MemAlloc(MEM_STATE, sizeof(SideInfo_t),      "SideInfo"     );}
+    if(!m_ScaleFactorJS)    {m_ScaleFactorJS = (ScaleFactorJS_t*)   MemAlloc(MEM_STATE, sizeof(ScaleFactorJS_t), "ScaleFactorJS");}
+    if(!m_HuffmanInfo)      {m_HuffmanInfo   = (HuffmanInfo_t*)     MemAlloc(MEM_HOT,   sizeof(HuffmanInfo_t),   "HuffmanInfo"  );}
+    if(!m_DequantInfo)      {m_DequantInfo   = (DequantInfo_t*)     MemAlloc(MEM_HOT,   sizeof(DequantInfo_t),   "DequantInfo"  );}
+    if(!m_IMDCTInfo)        {m_IMDCTInfo     = (IMDCTInfo_t*)       MemAlloc(MEM_HOT,   sizeof(IMDCTInfo_t),     "IMDCTInfo"    );}
+    if(!m_SubbandInfo)      {m_SubbandInfo   = (SubbandInfo_t*)     MemAlloc(MEM_HOT,   sizeof(SubbandInfo_t),   "SubbandInfo"  );}
+    if(!m_MP3FrameInfo)     {m_MP3FrameInfo  = (MP3FrameInfo_t*)    MemAlloc(MEM_STATE, sizeof(MP3FrameInfo_t),  "MP3FrameInfo" );}
 
 
     if(!m_MP3DecInfo || !m_FrameHeader || !m_SideInfo || !m_ScaleFactorJS || !m_HuffmanInfo ||
        !m_DequantInfo || !m_IMDCTInfo || !m_SubbandInfo || !m_MP3FrameInfo) {
         log_e("not enough memory to allocate mp3decoder buffers");
     }
+    MemTablesLoad(m_hotTables, sizeof(m_hotTables) / sizeof(m_hotTables[0]));
     MP3Decoder_ClearBuffer();
     return true;
 }
@@ -1545,15 +1763,16 @@ void MP3Decoder_FreeBuffers()
 {
 //    uint32_t i = ESP.getFreeHeap();
 
-    if(m_MP3DecInfo)        {free(m_MP3DecInfo);      m_MP3DecInfo=NULL;}
-    if(m_FrameHeader)       {free(m_FrameHeader);     m_FrameHeader=NULL;}
-    if(m_SideInfo)          {free(m_SideInfo);        m_SideInfo=NULL;}
-    if(m_ScaleFactorJS )    {free(m_ScaleFactorJS);   m_ScaleFactorJS=NULL;}
-    if(m_HuffmanInfo)       {free(m_HuffmanInfo);     m_HuffmanInfo=NULL;}
-    if(m_DequantInfo)       {free(m_DequantInfo);     m_DequantInfo=0;}
-    if(m_IMDCTInfo)         {free(m_IMDCTInfo);       m_IMDCTInfo=0;}
-    if(m_SubbandInfo)       {free(m_SubbandInfo);     m_SubbandInfo=0;}
-    if(m_MP3FrameInfo)      {free(m_MP3FrameInfo);    m_MP3FrameInfo=0;}
+    if(m_MP3DecInfo)        {MemFree(m_MP3DecInfo);      m_MP3DecInfo=NULL;}
+    if(m_FrameHeader)       {MemFree(m_FrameHeader);     m_FrameHeader=NULL;}
+    if(m_SideInfo)          {MemFree(m_SideInfo);        m_SideInfo=NULL;}
+    if(m_ScaleFactorJS )    {MemFree(m_ScaleFactorJS);   m_ScaleFactorJS=NULL;}
+    if(m_HuffmanInfo)       {MemFree(m_HuffmanInfo);     m_HuffmanInfo=NULL;}
+    if(m_DequantInfo)       {MemFree(m_DequantInfo);     m_DequantInfo=0;}
+    if(m_IMDCTInfo)         {MemFree(m_IMDCTInfo);       m_IMDCTInfo=0;}
+    if(m_SubbandInfo)       {MemFree(m_SubbandInfo);     m_SubbandInfo=0;}
+    if(m_MP3FrameInfo)      {MemFree(m_MP3FrameInfo);    m_MP3FrameInfo=0;}
+    MemTablesFree(m_hotTables, sizeof(m_hotTables) / sizeof(m_hotTables[0]));
 
 //    log_i("MP3Decoder: %lu bytes memory was freed", ESP.getFreeHeap() - i);
 }
@@ -1597,7 +1816,7 @@ int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsigned ch
         return -1;
     startBits = bitsLeft;
 
-    tBase = (unsigned short *) (huffTable + huffTabOffset[tabIdx]);
+    tBase = (unsigned short *) (m_huffTable + huffTabOffset[tabIdx]);
     linBits = huffTabLookup[tabIdx].linBits;
     tabType = (HuffTabType_t)huffTabLookup[tabIdx].tabType;
 
@@ -2763,7 +2982,7 @@ void WinPrevious(int *xPrev, int *xPrevWin, int btPrev){
     /* mapping (see IMDCT12x3): xPrev[0-2] = sum[6-8], xPrev[3-8] = sum[12-17] */
     if (btPrev == 2) {
         /* this could be reordered for minimum loads/stores */
-        wpLo = imdctWin[btPrev];
+        wpLo = m_imdctWin[btPrev];
         xPrevWin[0] = MULSHIFT32(wpLo[6], xPrev[2])
                 + MULSHIFT32(wpLo[0], xPrev[6]);
         xPrevWin[1] = MULSHIFT32(wpLo[7], xPrev[1])
@@ -2786,7 +3005,7 @@ void WinPrevious(int *xPrev, int *xPrevWin, int btPrev){
                 xPrevWin[16] = xPrevWin[17] = 0;
     } else {
         /* use ARM-style pointers (*ptr++) so that ADS compiles well */
-        wpLo = imdctWin[btPrev] + 18;
+        wpLo = m_imdctWin[btPrev] + 18;
         wpHi = wpLo + 17;
         xpwLo = xPrevWin;
         xpwHi = xPrevWin + 17;
@@ -3098,7 +3317,7 @@ int IMDCT36(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx
          */
         WinPrevious(xPrev, xPrevWin, btPrev);
 
-        wp = imdctWin[btCurr];
+        wp = m_imdctWin[btCurr];
         for (i = 0; i < 9; i++) {
             c = *cp--;
             xo = *(xp + 9);
@@ -3234,7 +3453,7 @@ int IMDCT12x3(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb){
      * xPrevWin[i] << 2 still has 1 gb always, max gain of windowed xBuf stuff also < 1.0 and gain the sign bit
      * so y calculations won't overflow
      */
-    wp = imdctWin[2];
+    wp = m_imdctWin[2];
     mOut = 0;
     for (i = 0; i < 3; i++) {
         yLo = (xPrevWin[0 + i] << 2);
@@ -3463,11 +3682,11 @@ int IMDCT( int gr, int ch) {
  * Inputs:      filled MP3DecInfo structure, after calling IMDCT for all channels
  *              vbuf[ch] and vindex[ch] must be preserved between calls
  *
- * Outputs:     decoded PCM data, interleaved LRLRLR... if stereo
+ * Outputs:     decoded PCM data, interleaved LRLRLR... if stereo (16 bit or Q28, see PolyphaseStore())
  *
  * Return:      0 on success,  -1 if null input pointers
  **********************************************************************************************************************/
-int Subband( short *pcmBuf) {
+template <typename pcm_t> int Subband(pcm_t *pcmBuf) {
     int b;
     if (m_MP3DecInfo->nChans == 2) {
         /* stereo */
@@ -3478,7 +3697,7 @@ int Subband( short *pcmBuf) {
                     (b & 0x01), m_IMDCTInfo->gb[1]);
             PolyphaseStereo(pcmBuf,
                     m_SubbandInfo->vbuf + m_SubbandInfo->vindex + m_VBUF_LENGTH * (b & 0x01),
-                    polyCoef);
+                    m_polyCoef);
             m_SubbandInfo->vindex = (m_SubbandInfo->vindex - (b & 0x01)) & 7;
             pcmBuf += (2 * m_NBANDS);
         }
@@ -3489,7 +3708,7 @@ int Subband( short *pcmBuf) {
                     (b & 0x01), m_IMDCTInfo->gb[0]);
             PolyphaseMono(pcmBuf,
                     m_SubbandInfo->vbuf + m_SubbandInfo->vindex + m_VBUF_LENGTH * (b & 0x01),
-                    polyCoef);
+                    m_polyCoef);
             m_SubbandInfo->vindex = (m_SubbandInfo->vindex - (b & 0x01)) & 7;
             pcmBuf += m_NBANDS;
         }
@@ -3694,6 +3913,46 @@ short ClipToShort(int x, int fracBits){
 
     return (short)x;
 }
+/***********************************************************************************************************************
+ * Function:    ClipToQ28
+ *
+ * Description: saturate a 64-bit polyphase sum to the int32 output format
+ *
+ * Inputs:      sum (already rounded) with fracBits fraction bits below Q28
+ *
+ * Outputs:     none
+ *
+ * Return:      Q28 PCM sample, 1.0 = 16-bit full scale, clipped to [-8.0, 8.0)
+ *
+ * Notes:       the 3 guard bits keep overshoots past full scale, so they can still be scaled down by the volume
+ *                control before the final clip in the I2S output
+ **********************************************************************************************************************/
+int ClipToQ28(uint64_t x, int fracBits){
+    int64_t y;
+
+    y = (int64_t)x >> fracBits;
+    if (y != (int)y)
+        y = (y >> 63) ^ 0x7fffffff;
+
+    return (int)y;
+}
+/***********************************************************************************************************************
+ * PCM output of the polyphase filter, the same MAC loops serve both output formats:
+ *   short:   rounded to Q16.0 and clipped to 16 bit (m_PCM_FRACBITS fraction bits are dropped)
+ *   int32_t: Q28, keeps m_FBITS_OUT_PCM32 of the m_PCM_FRACBITS + 32 - m_CSHIFT fraction bits of the sum
+ **********************************************************************************************************************/
+inline uint64_t PolyphaseRndVal(short *){
+    return (uint64_t)1 << (m_PCM_FRACBITS - 1 + (32 - m_CSHIFT));
+}
+inline uint64_t PolyphaseRndVal(int32_t *){
+    return (uint64_t)1 << (m_PCM_FRACBITS - m_FBITS_OUT_PCM32 - 1 + (32 - m_CSHIFT));
+}
+inline void PolyphaseStore(short *pcm, uint64_t sum){
+    *pcm = ClipToShort((int)SAR64(sum, (32-m_CSHIFT)), m_PCM_FRACBITS);
+}
+inline void PolyphaseStore(int32_t *pcm, uint64_t sum){
+    *pcm = ClipToQ28(sum, m_PCM_FRACBITS - m_FBITS_OUT_PCM32 + (32 - m_CSHIFT));
+}
 /***********************************************************************************************************************
  * Function:    PolyphaseMono
  *
@@ -3706,18 +3965,18 @@ short ClipToShort(int x, int fracBits){
  *              no minimum number of guard bits is required for input vbuf
  *                (see additional scaling comments below)
  *
- * Outputs:     32 samples of one channel of decoded PCM data, (i.e. Q16.0)
+ * Outputs:     32 samples of one channel of decoded PCM data, (i.e. Q16.0, or Q28 if pcm is int32_t)
  *
  * Return:      none
  **********************************************************************************************************************/
-void PolyphaseMono(short *pcm, int *vbuf, const uint32_t *coefBase){
+template <typename pcm_t> void PolyphaseMono(pcm_t *pcm, int *vbuf, const uint32_t *coefBase){
     int i;
     const uint32_t *coef;
     int *vb1;
     int vLo, vHi, c1, c2;
     uint64_t sum1L, sum2L, rndVal;
 
-    rndVal = (uint64_t)( 1ULL << ((m_DQ_FRACBITS_OUT - 2 - 2 - 1) - 1 + (32 - m_CSHIFT)) );
+    rndVal = PolyphaseRndVal(pcm);
 
     /* special case, output sample 0 */
     coef = coefBase;
@@ -3727,7 +3986,7 @@ void PolyphaseMono(short *pcm, int *vbuf, const uint32_t *coefBase){
         c1=*coef; coef++; c2=*coef; coef++; vLo=*(vb1+(j)); vHi=*(vb1+(23-(j))); // 0...7
         sum1L=MADD64(sum1L, vLo, c1); sum1L=MADD64(sum1L, vHi, -c2);
     }
-    *(pcm + 0) = ClipToShort((int)SAR64(sum1L, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
+    PolyphaseStore(pcm + 0, sum1L);
 
     /* special case, output sample 16 */
     coef = coefBase + 256;
@@ -3736,7 +3995,7 @@ void PolyphaseMono(short *pcm, int *vbuf, const uint32_t *coefBase){
     for(int j=0; j<8; j++){
         c1=*coef; coef++; vLo=*(vb1+(j)); sum1L = MADD64(sum1L, vLo,  c1); // 0...7
     }
-    *(pcm + 16) = ClipToShort((int)SAR64(sum1L, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
+    PolyphaseStore(pcm + 16, sum1L);
 
     /* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
     coef = coefBase + 16;
@@ -3752,8 +4011,8 @@ void PolyphaseMono(short *pcm, int *vbuf, const uint32_t *coefBase){
             sum1L=MADD64(sum1L, vHi, -c2); sum2L = MADD64(sum2L, vHi,  c1);
         }
         vb1 += 64;
-        *(pcm)       = ClipToShort((int)SAR64(sum1L, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
-        *(pcm + 2*i) = ClipToShort((int)SAR64(sum2L, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
+        PolyphaseStore(pcm, sum1L);
+        PolyphaseStore(pcm + 2*i, sum2L);
         pcm++;
     }
 }
@@ -3769,20 +4028,20 @@ void PolyphaseMono(short *pcm, int *vbuf, const uint32_t *coefBase){
  *              no minimum number of guard bits is required for input vbuf
  *                (see additional scaling comments below)
  *
- * Outputs:     32 samples of two channels of decoded PCM data, (i.e. Q16.0)
+ * Outputs:     32 samples of two channels of decoded PCM data, (i.e. Q16.0, or Q28 if pcm is int32_t)
  *
  * Return:      none
  *
  * Notes:       interleaves PCM samples LRLRLR...
  **********************************************************************************************************************/
-void PolyphaseStereo(short *pcm, int *vbuf, const uint32_t *coefBase){
+template <typename pcm_t> void PolyphaseStereo(pcm_t *pcm, int *vbuf, const uint32_t *coefBase){
     int i;
     const uint32_t *coef;
     int *vb1;
     int vLo, vHi, c1, c2;
     uint64_t sum1L, sum2L, sum1R, sum2R, rndVal;
 
-    rndVal = (uint64_t)( 1 << ((m_DQ_FRACBITS_OUT - 2 - 2 - 15) - 1 + (32 - m_CSHIFT)) );
+    rndVal = PolyphaseRndVal(pcm);
 
     /* special case, output sample 0 */
     coef = coefBase;
@@ -3795,8 +4054,8 @@ void PolyphaseStereo(short *pcm, int *vbuf, const uint32_t *coefBase){
         vLo=*(vb1+32+(j)); vHi=*(vb1+32+(23-(j)));
         sum1R=MADD64(sum1R, vLo,  c1); sum1R=MADD64(sum1R, vHi, -c2); \
     }
-    *(pcm + 0) = ClipToShort((int)SAR64(sum1L, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
-    *(pcm + 1) = ClipToShort((int)SAR64(sum1R, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
+    PolyphaseStore(pcm + 0, sum1L);
+    PolyphaseStore(pcm + 1, sum1R);
 
     /* special case, output sample 16 */
     coef = coefBase + 256;
@@ -3807,8 +4066,8 @@ void PolyphaseStereo(short *pcm, int *vbuf, const uint32_t *coefBase){
         c1=*coef; coef++; vLo = *(vb1+(j)); sum1L = MADD64(sum1L, vLo,  c1);
         vLo = *(vb1+32+(j)); sum1R = MADD64(sum1R, vLo,  c1);
     }
-    *(pcm + 2*16 + 0) = ClipToShort((int)SAR64(sum1L, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
-    *(pcm + 2*16 + 1) = ClipToShort((int)SAR64(sum1R, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
+    PolyphaseStore(pcm + 2*16 + 0, sum1L);
+    PolyphaseStore(pcm + 2*16 + 1, sum1R);
 
     /* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
     coef = coefBase + 16;
@@ -3829,10 +4088,10 @@ void PolyphaseStereo(short *pcm, int *vbuf, const uint32_t *coefBase){
             sum1R=MADD64(sum1R, vHi, -c2); sum2R=MADD64(sum2R, vHi,  c1);
         }
         vb1 += 64;
-        *(pcm + 0)         = ClipToShort((int)SAR64(sum1L, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
-        *(pcm + 1)         = ClipToShort((int)SAR64(sum1R, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
-        *(pcm + 2*2*i + 0) = ClipToShort((int)SAR64(sum2L, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
-        *(pcm + 2*2*i + 1) = ClipToShort((int)SAR64(sum2R, (32-m_CSHIFT)), m_DQ_FRACBITS_OUT - 2 - 2 - 15);
+        PolyphaseStore(pcm + 0, sum1L);
+        PolyphaseStore(pcm + 1, sum1R);
+        PolyphaseStore(pcm + 2*2*i + 0, sum2L);
+        PolyphaseStore(pcm + 2*2*i + 1, sum2R);
         pcm += 2;
     }
 }
@@ -11,10 +11,13 @@ static const uint8_t  m_NBANDS                 =32;
 static const uint8_t  m_MAX_REORDER_SAMPS      =(192-126)*3;      // largest critical band for short blocks (see sfBandTable)
 static const uint16_t m_VBUF_LENGTH            =17*2* m_NBANDS;    // for double-sized vbuf FIFO
 static const uint8_t  m_MAX_SCFBD              =4;     // max scalefactor bands per channel
-static const uint16_t m_MAINBUF_SIZE           =1940;
+static const uint16_t m_MAINBUF_SIZE           =1940;  // largest main_data section (reservoir + nSlots)
+static const uint16_t m_RESERVOIR_SIZE         =4096;  // bit reservoir window, >= 2 * m_MAINBUF_SIZE
+static const uint16_t m_MAX_MAINDATABEGIN      =511;   // largest backward reference into the bit reservoir
 static const uint8_t  m_MAX_NGRAN              =2;     // max granules
 static const uint8_t  m_MAX_NCHAN              =2;     // max channels
 static const uint16_t m_MAX_NSAMP              =576;   // max samples per channel, per granule
+static const uint16_t m_DECODER_DELAY          =529;   // output lags the encoder input by 529 samples (LAME, iTunes gapless info)
 
 enum {
     ERR_MP3_NONE =                  0,
@@ -44,6 +47,24 @@ typedef struct MP3FrameInfo {
     int version;
 } MP3FrameInfo_t;
 
+typedef struct MP3FrameHeaderInfo { /* filled in by MP3ParseFrameHeader(), decoder state is not touched */
+    int frameBytes;                 /* header + side info + main data + pad byte, 0 in free format */
+    int samprate;
+    int nChans;
+    int samplesPerFrame;
+    int sideInfoEnd;                /* offset of the first byte after the side info (Xing tag position) */
+} MP3FrameHeaderInfo_t;
+
+typedef struct MP3VBRTag {          /* Xing/Info or VBRI tag in the first frame of a file */
+    uint32_t frames;                /* number of frames, 0 if unknown */
+    uint32_t bytes;                 /* number of audio bytes, 0 if unknown */
+    uint8_t  toc[100];              /* toc[i] = byte position of i percent playtime, in 1/256 of bytes */
+    bool     hasToc;
+    uint16_t encDelay;              /* LAME tag: samples added by the encoder at the start */
+    uint16_t encPadding;            /* LAME tag: samples added by the encoder at the end */
+    bool     hasLame;
+} MP3VBRTag_t;
+
 typedef struct SFBandTable {
     int/*short*/ l[23];
     int/*short*/ s[14];
@@ -179,8 +200,12 @@ typedef struct SubbandInfo {
 } SubbandInfo_t;
 
 typedef struct MP3DecInfo {
-    /* buffer which must be large enough to hold largest possible main_data section */
-    unsigned char mainBuf[m_MAINBUF_SIZE];
+    /* bit reservoir - main data slots are appended until the window is full, then it wraps to the start
+     * carrying only the mainDataBegin bytes the current frame still references */
+    unsigned char mainBuf[m_RESERVOIR_SIZE];
+    int mainBufWrite;       /* index where the next main data slots are stored */
+    int reservoirBytes;     /* main data history ending at mainBufWrite */
+    uint32_t mainBytesCopied; /* bytes copied into or inside the reservoir, for profiling */
     /* special info for "free" bitrate files */
     int freeBitrateFlag;
     int freeBitrateSlots;
@@ -459,19 +484,25 @@ const uint32_t csa[8][2] PROGMEM = {
 bool MP3Decoder_AllocateBuffers(void);
 void MP3Decoder_FreeBuffers();
 int  MP3Decode( unsigned char *inbuf, int *bytesLeft, short *outbuf, int useSize);
+int  MP3Decode32(unsigned char *inbuf, int *bytesLeft, int32_t *outbuf, int useSize);
 void MP3GetLastFrameInfo();
 int  MP3GetNextFrameInfo(unsigned char *buf);
 int  MP3FindSyncWord(unsigned char *buf, int nBytes);
+int  MP3ParseFrameHeader(const unsigned char *buf, MP3FrameHeaderInfo_t *fhi);
+bool MP3ParseVBRTag(const unsigned char *buf, int nBytes, MP3VBRTag_t *tag);
 int  MP3GetSampRate();
 int  MP3GetChannels();
 int  MP3GetBitsPerSample();
 int  MP3GetBitrate();
 int  MP3GetOutputSamps();
+uint32_t MP3GetMainDataBytesCopied();
+void MP3ResetReservoir();
 
 //internally used
 void MP3Decoder_ClearBuffer(void);
-void PolyphaseMono(short *pcm, int *vbuf, const uint32_t *coefBase);
-void PolyphaseStereo(short *pcm, int *vbuf, const uint32_t *coefBase);
+template <typename pcm_t> int MP3DecodeFrame(unsigned char *inbuf, int *bytesLeft, pcm_t *outbuf, int useSize);
+template <typename pcm_t> void PolyphaseMono(pcm_t *pcm, int *vbuf, const uint32_t *coefBase);
+template <typename pcm_t> void PolyphaseStereo(pcm_t *pcm, int *vbuf, const uint32_t *coefBase);
 void SetBitstreamPointer(BitStreamInfo_t *bsi, int nBytes, unsigned char *buf);
 unsigned int GetBits(BitStreamInfo_t *bsi, int nBits);
 int CalcBitsUsed(BitStreamInfo_t *bsi, unsigned char *startBuf, int startOffset);
@@ -482,19 +513,23 @@ void IntensityProcMPEG2(int x[m_MAX_NCHAN][m_MAX_NSAMP], int nSamps, ScaleFactor
 void FDCT32(int *x, int *d, int offset, int oddBlock, int gb);// __attribute__ ((section (".data")));
 void FreeBuffers();
 int CheckPadBit();
+int CheckFrameHeader(const unsigned char *buf);
+uint32_t ReadBigEndian(const unsigned char *p, int n);
 int UnpackFrameHeader(unsigned char *buf);
 int UnpackSideInfo(unsigned char *buf);
 int DecodeHuffman( unsigned char *buf, int *bitOffset, int huffBlockBits, int gr, int ch);
 int MP3Dequantize( int gr);
 int IMDCT( int gr, int ch);
 int UnpackScaleFactors( unsigned char *buf, int *bitOffset, int bitsAvail, int gr, int ch);
-int Subband(short *pcmBuf);
+template <typename pcm_t> int Subband(pcm_t *pcmBuf);
 short ClipToShort(int x, int fracBits);
+int ClipToQ28(uint64_t x, int fracBits);
 void RefillBitstreamCache(BitStreamInfo_t *bsi);
 void UnpackSFMPEG1(BitStreamInfo_t *bsi, SideInfoSub_t *sis, ScaleFactorInfoSub_t *sfis, int *scfsi, int gr, ScaleFactorInfoSub_t *sfisGr0);
 void UnpackSFMPEG2(BitStreamInfo_t *bsi, SideInfoSub_t *sis, ScaleFactorInfoSub_t *sfis, int gr, int ch, int modeExt, ScaleFactorJS_t *sfjs);
 int MP3FindFreeSync(unsigned char *buf, unsigned char firstFH[4], int nBytes);
-void MP3ClearBadFrame( short *outbuf);
+template <typename pcm_t> void MP3ClearBadFrame(pcm_t *outbuf);
+unsigned char *MP3AppendMainData(const unsigned char *src, int nBytes, int keepBytes);
 int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsigned char *buf, int bitOffset);
 int DecodeHuffmanQuads(int *vwxy, int nVals, int tabIdx, int bitsLeft, unsigned char *buf, int bitOffset);
 int DequantBlock(int *inbuf, int *outbuf, int num, int scale);
@@ -0,0 +1,265 @@
+/*
+ * recorder.cpp
+ * stream recorder, the compressed audio of a web stream goes to files on SD
+ *
+ * processWebStream() hands every block it has put into the input buffer (ICY metadata and chunk framing
+ * already removed) to RecWrite(), which copies it into one of two buffers. A full buffer is passed to the
+ * writer task through a queue and the other one is filled meanwhile. The task runs on core 0, the audio
+ * loop on core 1, so a slow card never stalls the decoder or the network reads, if both buffers are full
+ * the bytes are counted as dropped. The buffers lie in DMA capable internal RAM, 32 bit aligned, and are
+ * written as whole sectors, the SD driver transfers them with one multi block write and no bounce buffer.
+ * Only the last write of a file may be shorter.
+ * RecSplit() closes the file behind the bytes recorded so far, the next bytes start a new one
+ ************************************************************************************/
+
+#include "recorder.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+
+typedef struct {
+    uint8_t      *data;
+    uint32_t      len;
+    char          name[RECORD_NAME_LEN];     /* open this file before writing, "" = append */
+    volatile bool busy;                      /* owned by the writer task */
+} RecSlot_t;
+
+static RecSlot_t      s_slot[2];
+static uint8_t        s_cur;                 /* the slot RecWrite() fills */
+static char           s_next[RECORD_NAME_LEN];   /* file of the next bytes, set by RecSplit() */
+static char           s_dir[32];
+static fs::FS        *s_fs = NULL;
+static QueueHandle_t  s_queue = NULL;
+static volatile bool  s_running = false;     /* recording, RecWrite() takes data */
+static volatile bool  s_taskAlive = false;   /* the writer task has not seen REC_STOP yet */
+static uint16_t       s_fileNo;
+static RecStats_t     s_stats;
+static uint64_t       s_busyUs;              /* time spent in write() */
+static uint32_t       s_droppedTee;          /* no free buffer, counted by RecWrite() on the audio core */
+static uint32_t       s_droppedCard;         /* card full, counted by the writer task on the other core */
+static uint32_t       s_t0;                  /* millis() of RecStart() */
+static const uint8_t  REC_STOP = 0xFF;       /* queue entry behind the last buffer */
+
+/***********************************************************************************************************************
+ * Function:    RecTask
+ *
+ * Description: writer task, takes full buffers from the queue and writes them to the current file
+ *
+ * Inputs:      none
+ *
+ * Outputs:     s_stats, the slot is released (busy = false) when it has been written
+ *
+ * Return:      none, deletes itself on REC_STOP
+ **********************************************************************************************************************/
+static void RecTask(void *){
+    File file;
+    char path[sizeof(s_dir) + RECORD_NAME_LEN + 1];
+    uint8_t i;
+
+    while(true){
+        if(xQueueReceive(s_queue, &i, portMAX_DELAY) != pdTRUE) continue;
+        if(i == REC_STOP) break;
+        RecSlot_t *s = &s_slot[i];
+        if(s->name[0]){
+            if(file) file.close();
+            snprintf(path, sizeof(path), "%s/%s", s_dir, s->name);
+            file = s_fs->open(path, FILE_WRITE);
+            if(file) s_stats.files++;
+        }
+        if(file && s->len){
+            uint32_t t = micros();
+            uint32_t n = file.write(s->data, s->len);
+            t = micros() - t;
+            s_busyUs += t;
+            if(t > s_stats.maxWriteUs) s_stats.maxWriteUs = t;
+            s_stats.bytes += n;
+            s_droppedCard += s->len - n;                 /* card full */
+        }
+        s->len = 0;
+        s->name[0] = 0;
+        s->busy = false;                                 /* RecWrite() may fill it again */
+    }
+    if(file) file.close();
+    s_taskAlive = false;
+    vTaskDelete(NULL);
+}
+
+/***********************************************************************************************************************
+ * Function:    RecHandOff
+ *
+ * Description: pass the slot being filled to the writer task, continue with the other one
+ *
+ * Inputs:      none
+ *
+ * Outputs:     s_cur
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+static void RecHandOff(void){
+    s_slot[s_cur].busy = true;
+    xQueueSend(s_queue, &s_cur, 0);                      /* never full, it has room for both slots and REC_STOP */
+    s_cur ^= 1;
+}
+
+/***********************************************************************************************************************
+ * Function:    RecStart
+ *
+ * Description: allocate the buffers and start the writer task, the first file begins with RecSplit()
+ *
+ * Inputs:      file system (SD, SD_MMC ...), directory, created if it does not exist
+ *
+ * Outputs:     cleared statistics
+ *
+ * Return:      true if the recorder runs, false without memory or if the task of the last recording still
+ *                hangs in a write
+ **********************************************************************************************************************/
+bool RecStart(fs::FS &fs, const char *dir){
+    int i;
+
+    if(s_running) RecStop();
+    if(s_taskAlive) return false;
+    for(i = 0; i < 2; i++){
+        if(!s_slot[i].data) s_slot[i].data = (uint8_t*)heap_caps_malloc(RECORD_BUF_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_32BIT);
+        if(!s_slot[i].data) return false;
+        s_slot[i].len = 0;
+        s_slot[i].name[0] = 0;
+        s_slot[i].busy = false;
+    }
+    if(!s_queue) s_queue = xQueueCreate(3, sizeof(uint8_t));
+    if(!s_queue) return false;
+    snprintf(s_dir, sizeof(s_dir), "%s", dir);
+    if(s_dir[0] && !fs.exists(s_dir)) fs.mkdir(s_dir);
+    s_fs = &fs;
+    s_cur = 0;
+    s_next[0] = 0;
+    s_fileNo = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_busyUs = 0;
+    s_droppedTee = s_droppedCard = 0;
+    s_t0 = millis();
+    s_taskAlive = true;
+    if(xTaskCreatePinnedToCore(RecTask, "recorder", 4096, NULL, 1, NULL, 0) != pdPASS){
+        s_taskAlive = false;
+        return false;
+    }
+    s_running = true;
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Function:    RecStop
+ *
+ * Description: write what has been recorded, close the file and end the writer task
+ *
+ * Inputs:      none
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ *
+ * Notes:       waits for the card to take the last two buffers, 2 s at most, the buffers are kept for the
+ *                next recording
+ **********************************************************************************************************************/
+void RecStop(void){
+    uint32_t t = millis();
+
+    if(!s_running) return;
+    s_running = false;
+    if(s_slot[s_cur].len && !s_slot[s_cur].busy) RecHandOff();
+    xQueueSend(s_queue, &REC_STOP, 0);
+    while(s_taskAlive && millis() - t < 2000) vTaskDelay(1);
+}
+
+bool RecActive(void){
+    return s_running;
+}
+
+/***********************************************************************************************************************
+ * Function:    RecWrite
+ *
+ * Description: tee a block of the stream into the record buffers
+ *
+ * Inputs:      buf, len bytes, compressed audio without metadata
+ *
+ * Outputs:     full buffers are passed to the writer task
+ *
+ * Return:      none
+ *
+ * Notes:       never waits, bytes that find no free buffer are dropped and counted
+ **********************************************************************************************************************/
+void RecWrite(const uint8_t *buf, uint32_t len){
+    uint32_t t = micros(), n;
+
+    if(!s_running) return;
+    while(len){
+        RecSlot_t *s = &s_slot[s_cur];
+        if(s->busy){
+            s_droppedTee += len;
+            break;
+        }
+        if(s->len == 0){                                 /* a fresh buffer, the file it belongs to */
+            memcpy(s->name, s_next, RECORD_NAME_LEN);
+            s_next[0] = 0;
+        }
+        n = RECORD_BUF_SIZE - s->len;
+        if(n > len) n = len;
+        memcpy(s->data + s->len, buf, n);
+        s->len += n;
+        buf += n;
+        len -= n;
+        if(s->len == RECORD_BUF_SIZE) RecHandOff();
+    }
+    t = micros() - t;
+    if(t > s_stats.maxTeeUs) s_stats.maxTeeUs = t;
+}
+
+/***********************************************************************************************************************
+ * Function:    RecSplit
+ *
+ * Description: the bytes recorded from now on go to a new file
+ *
+ * Inputs:      title (StreamTitle or station name), extension by codec
+ *
+ * Outputs:     the partly filled buffer is passed to the writer task, it ends the current file
+ *
+ * Return:      none
+ *
+ * Notes:       the file name is a running number and the title, characters FAT does not allow become '_'
+ **********************************************************************************************************************/
+void RecSplit(const char *title, const char *ext){
+    uint32_t t = micros();
+    char clean[RECORD_TITLE_LEN + 1];
+    int i;
+
+    if(!s_running) return;
+    for(i = 0; i < RECORD_TITLE_LEN && title[i]; i++){
+        char c = title[i];
+        clean[i] = (c < ' ' || c > 0x7E || strchr("\"*/:<>?\\|", c)) ? '_' : c;
+    }
+    clean[i] = 0;
+    if(i == 0) strcpy(clean, "stream");
+    snprintf(s_next, sizeof(s_next), "%03u %s.%s", ++s_fileNo, clean, ext);
+    if(s_slot[s_cur].len && !s_slot[s_cur].busy) RecHandOff();
+    t = micros() - t;
+    if(t > s_stats.maxTeeUs) s_stats.maxTeeUs = t;
+}
+
+/***********************************************************************************************************************
+ * Function:    RecGetStats
+ *
+ * Description: statistics of the current or last recording
+ *
+ * Inputs:      none
+ *
+ * Outputs:     *s
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void RecGetStats(RecStats_t *s){
+    uint32_t ms = millis() - s_t0;
+    *s = s_stats;
+    s->dropped = s_droppedTee + s_droppedCard;           /* one writer per counter, no read-modify-write across cores */
+    s->writeKBps = s_busyUs ? (uint32_t)((uint64_t)s_stats.bytes * 1000 / s_busyUs) : 0;
+    s->cardLoad = ms ? (uint8_t)min((uint64_t)100, s_busyUs / 10 / ms) : 0;
+}
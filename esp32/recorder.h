@@ -0,0 +1,27 @@
+// stream recorder: tees the compressed bytes of a web stream into files on SD, written by a task of its own
+// from two sector aligned buffers, the caller (the audio loop) never waits for the card
+#pragma once
+
+#include "Arduino.h"
+#include "FS.h"
+
+const uint16_t RECORD_BUF_SIZE      = 8192;         /* per buffer, 16 sectors of 512 bytes per write */
+const uint8_t  RECORD_NAME_LEN      = 64;           /* file name without the directory */
+const uint8_t  RECORD_TITLE_LEN     = 48;           /* part of the StreamTitle used in the file name */
+
+typedef struct _RecStats_t {
+    uint32_t bytes;              /* written to the card */
+    uint32_t dropped;            /* lost because both buffers were full, the card was too slow */
+    uint16_t files;
+    uint32_t writeKBps;          /* bytes written / time spent in write(), the sustained speed of the card */
+    uint8_t  cardLoad;           /* time spent in write() / time recorded, % */
+    uint32_t maxWriteUs;         /* longest write() of one buffer */
+    uint32_t maxTeeUs;           /* longest RecWrite() or RecSplit(), the time added to the audio loop */
+} RecStats_t;
+
+bool RecStart(fs::FS &fs, const char *dir);
+void RecStop(void);
+bool RecActive(void);
+void RecWrite(const uint8_t *buf, uint32_t len);
+void RecSplit(const char *title, const char *ext);
+void RecGetStats(RecStats_t *s);
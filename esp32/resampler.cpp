@@ -0,0 +1,228 @@
+/*
+ * resampler.cpp
+ * sample rate converter, polyphase FIR with a Kaiser windowed sinc prototype
+ *
+ * the output runs at a fixed rate, so I2S and the FPGA crossover are not reprogrammed between songs
+ * of different sample rates. out / in = L / M, the prototype is designed at L * in and split into
+ * L phases of taps coefficients each. Every input frame gives floor or ceil of L / M output frames
+ * the samples are float, the ESP32 FPU has a fused multiply-add (madd.s) but no integer SIMD,
+ * both channels share the coefficient loads, no scaling, Q28 in gives Q28 out
+ ************************************************************************************/
+
+#include "resampler.h"
+#include "mem_place.h"
+
+typedef struct { uint16_t taps; float beta; float rolloff; } SRCPreset_t;
+
+const SRCPreset_t srcPresets[3] PROGMEM = {
+    /* taps, Kaiser beta, cutoff relative to the lower Nyquist frequency */
+    { 24,  6.0f, 0.88f },
+    { 48,  8.0f, 0.93f },
+    { 64,  9.5f, 0.95f }
+};
+
+SRCInfo_t *m_SRCInfo;
+
+/***********************************************************************************************************************
+ * Function:    SRCBesselI0
+ *
+ * Description: modified Bessel function of the first kind, order 0, power series
+ *
+ * Inputs:      x
+ *
+ * Outputs:     none
+ *
+ * Return:      I0(x)
+ **********************************************************************************************************************/
+static float SRCBesselI0(float x){
+    float sum = 1.0f, term = 1.0f, q = x * x / 4;
+    for(int k = 1; k < 50; k++){
+        term *= q / ((float)k * k);
+        sum += term;
+        if(term < sum * 1e-8f) break;
+    }
+    return sum;
+}
+
+/***********************************************************************************************************************
+ * Function:    SRCInit
+ *
+ * Description: set up the converter for a pair of rates, the coefficients of the last pair are kept
+ *
+ * Inputs:      input and output sample rate, quality SRC_LOW ... SRC_HIGH
+ *
+ * Outputs:     m_SRCInfo, history cleared if the ratio changes
+ *
+ * Return:      true if the ratio is supported (at most SRC_MAX_OUT output frames per input frame,
+ *                phases * taps <= SRC_MAX_COEFS) and the memory could be allocated
+ *
+ * Notes:       the coefficients are computed in float, 7680 of them at 44.1 -> 48 kHz with 48 taps,
+ *                each phase is normalized to a gain of 1 so a constant passes without ripple
+ **********************************************************************************************************************/
+bool SRCInit(uint32_t inRate, uint32_t outRate, uint8_t quality){
+    uint32_t a, b, t;
+    int L, M, T, N, p, j;
+    float fc, center, beta, i0beta;
+
+    if(!inRate || !outRate || quality > SRC_HIGH) return false;
+    if(m_SRCInfo && m_SRCInfo->coefs && m_SRCInfo->inRate == inRate && m_SRCInfo->outRate == outRate &&
+       m_SRCInfo->quality == quality) return true;
+
+    a = inRate; b = outRate;                        /* greatest common divisor */
+    while(b){ t = a % b; a = b; b = t; }
+    L = outRate / a;
+    M = inRate / a;
+    T = srcPresets[quality].taps;
+    if(L > 0xffff || M > 0xffff) return false;
+    if((L + M - 1) / M > SRC_MAX_OUT || (uint32_t)L * T > SRC_MAX_COEFS) return false;
+
+    if(!m_SRCInfo){
+        m_SRCInfo = (SRCInfo_t*)MemAlloc(MEM_HOT, sizeof(SRCInfo_t), "SRCInfo");
+        if(!m_SRCInfo) return false;
+    }
+    if(m_SRCInfo->coefs) MemFree(m_SRCInfo->coefs);
+    m_SRCInfo->coefs = (float*)MemAlloc(MEM_HOT, L * T * sizeof(float), "SRC coefs");   /* read in the inner loop */
+    if(!m_SRCInfo->coefs){
+        m_SRCInfo->inRate = 0;
+        return false;
+    }
+
+    /* prototype h[i], i = p + k * L, at L * inRate, cutoff at rolloff * the lower of both Nyquist frequencies */
+    N = L * T;
+    center = (N - 1) / 2.0f;
+    fc = srcPresets[quality].rolloff / (L > M ? L : M);            /* relative to the Nyquist frequency of L * inRate */
+    beta = srcPresets[quality].beta;
+    i0beta = SRCBesselI0(beta);
+    for(p = 0; p < L; p++){
+        float *c = &m_SRCInfo->coefs[p * T];
+        float sum = 0;
+        for(j = 0; j < T; j++){
+            int   i = p + (T - 1 - j) * L;                        /* window frame j is input frame n - (T - 1 - j) */
+            float x = i - center;
+            float r = x / center;
+            float s = (x == 0) ? fc : sinf((float)M_PI * fc * x) / ((float)M_PI * x);
+            float w = SRCBesselI0(beta * sqrtf(fmaxf(0.0f, 1.0f - r * r))) / i0beta;
+            c[j] = s * w;
+            sum += c[j];
+        }
+        for(j = 0; j < T; j++) c[j] /= sum;
+    }
+    m_SRCInfo->inRate  = inRate;
+    m_SRCInfo->outRate = outRate;
+    m_SRCInfo->quality = quality;
+    m_SRCInfo->L = L;
+    m_SRCInfo->M = M;
+    m_SRCInfo->taps = T;
+    SRCClearHistory();
+    return true;
+}
+
+/***********************************************************************************************************************
+ * Function:    SRCFree
+ *
+ * Description: release the coefficients and the state
+ *
+ * Inputs:      none
+ *
+ * Outputs:     m_SRCInfo = NULL
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void SRCFree(void){
+    if(!m_SRCInfo) return;
+    if(m_SRCInfo->coefs) MemFree(m_SRCInfo->coefs);
+    MemFree(m_SRCInfo);
+    m_SRCInfo = NULL;
+}
+
+/***********************************************************************************************************************
+ * Function:    SRCClearHistory
+ *
+ * Description: forget the past input frames (seek, stop)
+ *
+ * Inputs:      none
+ *
+ * Outputs:     history zeroed, phase 0
+ *
+ * Return:      none
+ **********************************************************************************************************************/
+void SRCClearHistory(void){
+    if(!m_SRCInfo) return;
+    memset(m_SRCInfo->hist, 0, sizeof(m_SRCInfo->hist));
+    m_SRCInfo->pos = 0;
+    m_SRCInfo->phase = 0;
+}
+
+/***********************************************************************************************************************
+ * Function:    SRCFir
+ *
+ * Description: one output frame, dot product of a phase with the window of both channels
+ *
+ * Inputs:      coefficients of the phase, window (interleaved L/R, oldest first), taps (multiple of 4)
+ *
+ * Outputs:     out[0], out[1]
+ *
+ * Return:      none
+ *
+ * Notes:       four accumulators per channel keep the FPU pipeline busy, each coefficient is loaded once
+ **********************************************************************************************************************/
+static inline void SRCFir(const float *c, const float *x, int taps, int32_t *out){
+    float l0 = 0, l1 = 0, l2 = 0, l3 = 0, r0 = 0, r1 = 0, r2 = 0, r3 = 0, v;
+    for(int j = 0; j < taps; j += 4, c += 4, x += 8){
+        l0 += c[0] * x[0]; r0 += c[0] * x[1];
+        l1 += c[1] * x[2]; r1 += c[1] * x[3];
+        l2 += c[2] * x[4]; r2 += c[2] * x[5];
+        l3 += c[3] * x[6]; r3 += c[3] * x[7];
+    }
+    v = (l0 + l1) + (l2 + l3);
+    if(v >  2147483520.0f) v =  2147483520.0f;     /* largest float below 2^31 */
+    if(v < -2147483648.0f) v = -2147483648.0f;
+    out[0] = (int32_t)(v + (v >= 0 ? 0.5f : -0.5f));
+    v = (r0 + r1) + (r2 + r3);
+    if(v >  2147483520.0f) v =  2147483520.0f;
+    if(v < -2147483648.0f) v = -2147483648.0f;
+    out[1] = (int32_t)(v + (v >= 0 ? 0.5f : -0.5f));
+}
+
+/***********************************************************************************************************************
+ * Function:    SRCProcess
+ *
+ * Description: push one stereo input frame, return the output frames that are due
+ *
+ * Inputs:      in[2] (L, R), room for SRC_MAX_OUT interleaved frames in out
+ *
+ * Outputs:     out, 0 ... ceil(L / M) frames
+ *
+ * Return:      number of output frames
+ *
+ * Notes:       the delay is taps / 2 input frames
+ **********************************************************************************************************************/
+int SRCProcess(const int32_t *in, int32_t *out){
+    SRCInfo_t *s = m_SRCInfo;
+    int T = s->taps, w = s->pos, n = 0;
+    float *h = s->hist;
+
+    h[2 * w]           = h[2 * (w + T)]     = (float)in[0];
+    h[2 * w + 1]       = h[2 * (w + T) + 1] = (float)in[1];
+    if(++w == T) w = 0;
+    s->pos = w;
+    while(s->phase < s->L){                         /* window h[w] ... h[w + T - 1], the newest frame last */
+        SRCFir(&s->coefs[s->phase * T], &h[2 * w], T, &out[2 * n]);
+        n++;
+        s->phase += s->M;
+    }
+    s->phase -= s->L;
+    return n;
+}
+
+int SRCGetL(void){
+    return m_SRCInfo ? m_SRCInfo->L : 0;
+}
+
+int SRCGetM(void){
+    return m_SRCInfo ? m_SRCInfo->M : 0;
+}
+
+int SRCGetTaps(void){
+    return m_SRCInfo ? m_SRCInfo->taps : 0;
+}
@@ -0,0 +1,36 @@
+// sample rate converter, polyphase FIR (Kaiser windowed sinc), rational ratio, stereo, one frame at a time
+#pragma once
+#pragma GCC optimize ("O3")
+
+#include "Arduino.h"
+
+enum {
+    SRC_LOW                               =   0,    /* 24 taps per phase, flat to 16.5 kHz, images -69 dB, 15 KB at 44.1 -> 48 kHz */
+    SRC_MEDIUM                            =   1,    /* 48 taps, 18.8 kHz, -89 dB, 30 KB */
+    SRC_HIGH                              =   2     /* 64 taps, 19.5 kHz, -100 dB, 40 KB */
+};
+
+const uint8_t  SRC_MAX_OUT          = 6;            /* output frames per input frame, 8 -> 48 kHz */
+const uint8_t  SRC_MAX_TAPS         = 64;
+const uint16_t SRC_MAX_COEFS        = 20480;        /* phases * taps, 22.05 -> 48 kHz (320 phases) at SRC_HIGH */
+
+typedef struct _SRCInfo_t {
+    uint32_t inRate;
+    uint32_t outRate;
+    uint16_t L;                  /* outRate / inRate = L / M, reduced */
+    uint16_t M;
+    uint16_t taps;               /* per phase */
+    uint16_t phase;              /* the next output frame lies phase / L input frames behind the oldest pending one */
+    uint16_t pos;                /* write position in hist[], frames */
+    uint8_t  quality;
+    float   *coefs;              /* [L][taps], coefs[p * taps + j] weights window frame j, j = 0 is the oldest */
+    float    hist[2 * 2 * SRC_MAX_TAPS]; /* interleaved L/R, written twice so that the window is contiguous */
+} SRCInfo_t;
+
+bool SRCInit(uint32_t inRate, uint32_t outRate, uint8_t quality);
+void SRCFree(void);
+void SRCClearHistory(void);
+int  SRCProcess(const int32_t *in, int32_t *out);
+int  SRCGetL(void);
+int  SRCGetM(void);
+int  SRCGetTaps(void);
@@ -1,4 +1,6 @@
 #include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "config.h"
 #include "tas5753md.h"
 #include "i2c.h"
@@ -11,25 +13,40 @@
 
 
 static uint16_t volume = 0x180;// max 0x000, min 0x3FF (mute)
+static bool muted = false;      // last tas5753md_mute() / tas5753md_unmute(), a device configured later starts in it
+static volatile bool ready[2] = {false, false}; // configured, a device still in its power up sequence is skipped
+// muted, volume and ready[] change together with the writes they cause, so the writes reach the queue in the
+// order of the calls: a device that joins during a mute (FAST_BOOT, amplifier 1) can not unmute behind it
+static SemaphoreHandle_t tasMutex = xSemaphoreCreateMutex();
 
+// returns when both are muted, e.g. before the FPGA coefficients are reloaded
 void tas5753md_mute(void) {
+    uint8_t mute = 0x40;
     Serial.printf("Muting TAS5753MD\r\n");
+    xSemaphoreTake(tasMutex, portMAX_DELAY);
+    muted = true;
+    // back to back: a priority runs in order, amplifier 1 done means amplifier 0 is done too
     #ifdef TA0
-    i2c_writeByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SYS_CTRL_2, 0x40);
+    if (ready[0]) i2c_post(I2C_PRIO_MUTE, TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SYS_CTRL_2, &mute, 1, ready[1] ? 0 : I2C_WAIT);
     #endif
     #ifdef TA1
-    i2c_writeByte(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_SYS_CTRL_2, 0x40);
+    if (ready[1]) i2c_post(I2C_PRIO_MUTE, TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_SYS_CTRL_2, &mute, 1, I2C_WAIT);
     #endif
+    xSemaphoreGive(tasMutex);
   }
 
 void tas5753md_unmute(void) {
+    uint8_t unmute = 0x00;
     Serial.printf("Un-muting TAS5753MD\r\n");
+    xSemaphoreTake(tasMutex, portMAX_DELAY);
+    muted = false;
     #ifdef TA0
-    i2c_writeByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SYS_CTRL_2, 0x00);
+    if (ready[0]) i2c_post(I2C_PRIO_MUTE, TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SYS_CTRL_2, &unmute, 1, 0);
     #endif
     #ifdef TA1
-    i2c_writeByte(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_SYS_CTRL_2, 0x00);
+    if (ready[1]) i2c_post(I2C_PRIO_MUTE, TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_SYS_CTRL_2, &unmute, 1, 0);
     #endif
+    xSemaphoreGive(tasMutex);
   }
 
 
@@ -46,19 +63,24 @@ void tas5753md_adjustVolume(int upDown) {
     tas5753md_setVolume(volume);
     }
 
+// queued, a step of the encoder replaces one that is still waiting
 void tas5753md_setVolume(uint16_t val) {
     uint8_t buf[2];
     buf[0] = (uint8_t)((val >> 8) & 0xFF);
     buf[1] = (uint8_t)(val & 0xFF);
+    xSemaphoreTake(tasMutex, portMAX_DELAY);
+    volume = val;
     #ifdef TA0
-    i2c_writeBuffer(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_MASTER_VOL, buf, 2);
+    if (ready[0]) i2c_post(I2C_PRIO_VOLUME, TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_MASTER_VOL, buf, 2, I2C_COALESCE);
     #endif
     #ifdef TA1
-    i2c_writeBuffer(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_MASTER_VOL, buf, 2);
+    if (ready[1]) i2c_post(I2C_PRIO_VOLUME, TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_MASTER_VOL, buf, 2, I2C_COALESCE);
     #endif
+    xSemaphoreGive(tasMutex);
   }
-    
-int tas5753md_config(void) {
+
+// power and reset sequence shared by both devices, ~90ms
+void tas5753md_powerUp(void) {
     pinMode(TAS_RST, OUTPUT);
     digitalWrite(TAS_RST, 1);
     pinMode(TAS_PSW, OUTPUT);
@@ -76,84 +98,70 @@ int tas5753md_config(void) {
     delay(10);
     digitalWrite(TAS_RST, 1);
     delay(20);
+    }
+
+// configure one device (0, 1) after tas5753md_powerUp(), ~200ms of waiting, the two can run in parallel tasks
+int tas5753md_configDevice(int n) {
+    uint8_t addr = n ? TAS5753MD_I2C_ADDR_1 : TAS5753MD_I2C_ADDR_0;
 
     // device id should return 0x41
-    #ifdef TA0
-    uint8_t id0;
-    id0 = i2c_readByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_DEVICE_ID);
-    Serial.printf("TAS5753MD_0 device id = 0x%02X\r\n\r\n", id0);
-    if (id0 != 0x41) {
-      Serial.printf("Error reading TAS5753MD device 0 id, should return 0x41\r\n");
+    uint8_t id;
+    id = i2c_readByte(addr, TAS5753MD_REG_DEVICE_ID);
+    Serial.printf("TAS5753MD_%d device id = 0x%02X\r\n\r\n", n, id);
+    if (id != 0x41) {
+      Serial.printf("Error reading TAS5753MD device %d id, should return 0x41\r\n", n);
       return 0;
       }
-    #endif
 
-    #ifdef TA1
-    uint8_t id1;
-    id1 = i2c_readByte(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_DEVICE_ID);
-    Serial.printf("TAS5753MD_1 device id = 0x%02X\r\n\r\n", id1);
-    if (id1 != 0x41) {
-      Serial.printf("Error reading TAS5753MD device 1 id, should return 0x41\r\n");
-      return 0;
-      }
-    #endif
-    
-    #ifdef TA0
-    i2c_writeByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_OSC_TRIM, 0x00);
-    #endif
-    #ifdef TA1
-    i2c_writeByte(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_OSC_TRIM, 0x00);
-    #endif
+    i2c_writeByte(addr, TAS5753MD_REG_OSC_TRIM, 0x00);
     delay(100);
     
-    // Data format 16/16 bit (32bits per frame). ESP32 code only generates 
-    // 16/16  in 32bit frame (Need to change this dynamically if we allow
-    // read 24bit wav files )
-    #ifdef TA0
-    i2c_writeByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SDATA_INTERFACE, 0x03);
-    #endif
-    #ifdef TA1
-    i2c_writeByte(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_SDATA_INTERFACE, 0x03);
+    // Data format has to match the I2S frames the FPGA passes on from the ESP32 :
+    // I2S 24bit (0x05) in 32/32 frames (64bits per frame) with I2S_32BIT, 
+    // otherwise I2S 16bit (0x03) in 16/16 frames (32bits per frame)
+    #ifdef I2S_32BIT
+    uint8_t sdata = 0x05;
+    #else
+    uint8_t sdata = 0x03;
     #endif
+    i2c_writeByte(addr, TAS5753MD_REG_SDATA_INTERFACE, sdata);
 
     // disable equalization filters, passthru enabled
     uint8_t buf[] = {0x0F, 0x70, 0x00, 0x80};
-    #ifdef TA0
-    i2c_writeBuffer(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_BANK_SW_CTRL, buf, 4);
-    #endif
-    #ifdef TA1
-    i2c_writeBuffer(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_BANK_SW_CTRL, buf, 4);
-    #endif
+    i2c_writeBuffer(addr, TAS5753MD_REG_BANK_SW_CTRL, buf, 4);
 
     // limit modulation to 93.8% to allow higher voltage supplies above 18V
-    #ifdef TA0
-    i2c_writeByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_MOD_LIMIT, 0x07);
-    #endif
-    #ifdef TA1
-    i2c_writeByte(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_MOD_LIMIT, 0x07);
-    #endif
+    i2c_writeByte(addr, TAS5753MD_REG_MOD_LIMIT, 0x07);
 
-    // unmute
-    #ifdef TA0
-    i2c_writeByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SYS_CTRL_2, 0x00);
-    #endif
-    #ifdef TA1
-    i2c_writeByte(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_SYS_CTRL_2, 0x00);
-    #endif
+    // clear error status register
+    i2c_writeByte(addr, TAS5753MD_REG_ERROR_STATUS, 0x00);
+
+    // from here on mute, unmute and volume reach this device too, it takes over the mute state
+    // (unmuted, or muted if a crossover reload is running) and the volume set meanwhile
+    xSemaphoreTake(tasMutex, portMAX_DELAY);
+    ready[n] = true;
+    uint8_t ctrl = muted ? 0x40 : 0x00;
+    i2c_post(I2C_PRIO_MUTE, addr, TAS5753MD_REG_SYS_CTRL_2, &ctrl, 1, I2C_WAIT);
+    xSemaphoreGive(tasMutex);
     delay(100);
 
-    // set power on default volume
-    tas5753md_setVolume(volume);
+    xSemaphoreTake(tasMutex, portMAX_DELAY);
+    buf[0] = (uint8_t)((volume >> 8) & 0xFF);
+    buf[1] = (uint8_t)(volume & 0xFF);
+    i2c_post(I2C_PRIO_VOLUME, addr, TAS5753MD_REG_MASTER_VOL, buf, 2, I2C_WAIT);
+    xSemaphoreGive(tasMutex);
+    return 1;
+    }
 
-    // clear error status register
+int tas5753md_config(void) {
+    tas5753md_powerUp();
     #ifdef TA0
-    i2c_writeByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_ERROR_STATUS, 0x00);
+    if (tas5753md_configDevice(0) == 0) return 0;
     #endif
     #ifdef TA1
-    i2c_writeByte(TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_ERROR_STATUS, 0x00);
+    if (tas5753md_configDevice(1) == 0) return 0;
     #endif
     return 1;
 	  }
 
  
-
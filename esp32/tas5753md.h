@@ -28,6 +28,8 @@
 
 
 int  tas5753md_config(void);
+void tas5753md_powerUp(void);
+int  tas5753md_configDevice(int n);
 void tas5753md_mute(void);
 void tas5753md_unmute(void);
 void tas5753md_adjustVolume(int upDown);
@@ -0,0 +1,139 @@
+/*
+ * aac_snr.cpp
+ * the AAC long block synthesis (DCT4 + window/overlap-add, IMDCT()) with 16 bit and Q28 output against a double
+ * precision IMDCT of the same quantized spectrum
+ *
+ * The spectrum is the sine window MDCT of the test signal, quantized to the fraction bits the decoder expects
+ * (FBITS_OUT_DQ_OFF). aac_decoder.cpp is included for IMDCT() and the decoder state.
+ *
+ * Checked: the SNR of both outputs is not below the table of the Q28 change, the single channel and the channel
+ * pair output agree
+ ************************************************************************************/
+
+#include "aac_decoder.cpp"
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+static const int N = 2048, M = 1024;               // window, frame
+static std::vector<double> cosTab;                 // MDCT kernel, N * M
+
+static double sinw(int n){ return sin(M_PI / N * (n + 0.5)); }
+
+// the signals of the table, 16 bit full scale = 32768
+static std::vector<double> signal(int kind, int n){
+    std::vector<double> x(n);
+    for(int i = 0; i < n; i++){
+        double t = i / 44100.0;
+        switch(kind){
+        case 0: x[i] = 0.89 * 32768 * (0.4 * sin(2 * M_PI * 220 * t) + 0.3 * sin(2 * M_PI * 1870 * t + 1) +
+                                       0.2 * sin(2 * M_PI * 5300 * t + 2) + 0.1 * sin(2 * M_PI * 11000 * t + 3)); break;
+        case 1: x[i] = 32768 * pow(10, -40 / 20.0) * sin(2 * M_PI * 1000 * t); break;
+        case 2: x[i] = 32768 * pow(10, -70 / 20.0) * sin(2 * M_PI * 1000 * t); break;
+        case 3: x[i] = 32768 * pow(10, 2 / 20.0) * sin(2 * M_PI * 440 * t); break;     // overshoots full scale
+        }
+    }
+    return x;
+}
+
+// forward MDCT of frame f, quantized
+static void mdct(const std::vector<double> &x, int f, int *coef){
+    double z[N];
+    for(int n = 0; n < N; n++){
+        int i = (f - 1) * M + n;
+        z[n] = (i >= 0 && i < (int)x.size()) ? x[i] * sinw(n) : 0;
+    }
+    for(int k = 0; k < M; k++){
+        double s = 0;
+        for(int n = 0; n < N; n++) s += z[n] * cosTab[(size_t)n * M + k];
+        coef[k] = (int)lrint(s * (1 << FBITS_OUT_DQ_OFF) * 2);
+    }
+}
+
+// the reference: IMDCT of the quantized spectrum in double, sine window, overlap-add
+static void imdctRef(const int *coef, double *over, double *out){
+    double y[N];
+    for(int n = 0; n < N; n++){
+        double s = 0;
+        for(int k = 0; k < M; k++) s += coef[k] * cosTab[(size_t)n * M + k];
+        y[n] = 2 * s * sinw(n) / (1 << FBITS_OUT_DQ_OFF) / N;
+    }
+    for(int n = 0; n < M; n++){ out[n] = over[n] + y[n]; over[n] = y[n + M]; }
+}
+
+static int guardBits(const int *c){
+    int m = 0;
+    for(int k = 0; k < M; k++) m |= abs(c[k]);
+    return m ? __builtin_clz(m) - 1 : 31;
+}
+
+// IMDCT() of every frame on nChans channels, out = last channel * scale, returns the time per channel and frame
+template <typename pcm_t> static double runDec(const std::vector<std::vector<int>> &coefs, int nChans, std::vector<double> &out, double scale){
+    static pcm_t pcm[2 * M] __attribute__((aligned(4)));
+    double t = 0;
+    AACDecoder_AllocateBuffers();
+    m_AACDecInfo->nChans = nChans;
+    m_AACDecInfo->currBlockID = nChans == 2 ? AAC_ID_CPE : AAC_ID_SCE;
+    m_PSInfoBase->commonWin = nChans == 2;
+    for(size_t f = 0; f < coefs.size(); f++){
+        for(int ch = 0; ch < nChans; ch++){
+            memcpy(m_PSInfoBase->coef[ch], coefs[f].data(), M * sizeof(int));
+            m_PSInfoBase->gbCurrent[ch] = guardBits(coefs[f].data());
+            m_PSInfoBase->icsInfo[ch].winSequence = 0;
+            m_PSInfoBase->icsInfo[ch].winShape = 0;
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        for(int ch = 0; ch < nChans; ch++) IMDCT(ch, ch, pcm);
+        t += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        for(int i = 0; i < M; i++) out.push_back(pcm[i * nChans + nChans - 1] * scale);
+        if(nChans == 2) for(int i = 0; i < M; i++) if(pcm[2 * i] != pcm[2 * i + 1]) out[out.size() - M + i] = NAN;
+    }
+    AACDecoder_FreeBuffers();
+    return t / coefs.size() / nChans;
+}
+
+static double snr(const std::vector<double> &ref, const std::vector<double> &y){
+    double s = 0, e = 0;
+    for(size_t i = 2 * M; i < ref.size(); i++){ s += ref[i] * ref[i]; e += (y[i] - ref[i]) * (y[i] - ref[i]); }
+    return 10 * log10(s / e);
+}
+
+int main(){
+    struct { const char *name; double snr16, snr28; } table[] = {   // dB, the table of the Q28 change
+        {"multitone -1 dBFS", 89.8, 92.1}, {"1 kHz -40 dBFS", 57.7, 65.1},
+        {"1 kHz -70 dBFS",    28.0, 35.1}, {"440 Hz +2 dBFS", 17.3, 90.5}};
+    const int nFrames = 60;
+    bool ok = true;
+
+    cosTab.resize((size_t)N * M);
+    for(int n = 0; n < N; n++) for(int k = 0; k < M; k++) cosTab[(size_t)n * M + k] = cos(2 * M_PI / N * (n + (N / 2 + 1) / 2.0) * (k + 0.5));
+
+    printf("AAC synthesis                16 bit       Q28   IMDCT() per channel\n");
+    for(int kind = 0; kind < 4; kind++){
+        std::vector<double> x = signal(kind, nFrames * M), ref, y16, y32, y16s, y32s, d;
+        std::vector<std::vector<int>> coefs(nFrames, std::vector<int>(M));
+        double over[M] = {0}, o[M];
+        for(int f = 0; f < nFrames; f++){
+            mdct(x, f, coefs[f].data());
+            imdctRef(coefs[f].data(), over, o);
+            ref.insert(ref.end(), o, o + M);
+        }
+        runDec<short>(coefs, 1, y16, 1.0);
+        runDec<int32_t>(coefs, 1, y32, 1.0 / (1 << 13));
+        double t16 = runDec<short>(coefs, 2, y16s, 1.0), t32 = runDec<int32_t>(coefs, 2, y32s, 1.0 / (1 << 13));
+        for(int r = 0; r < 30; r++){                   // best of 30
+            d.clear(); t16 = std::min(t16, runDec<short>(coefs, 2, d, 1.0));
+            d.clear(); t32 = std::min(t32, runDec<int32_t>(coefs, 2, d, 1.0));
+        }
+        double s16 = snr(ref, y16), s32 = snr(ref, y32);
+        bool same = y16 == y16s && y32 == y32s;
+        bool good = same && s16 >= table[kind].snr16 - 0.1 && s32 >= table[kind].snr28 - 0.1;
+        printf("  %-22s %6.1f dB %6.1f dB   %5.2f / %5.2f us  %s\n", table[kind].name, s16, s32, t16 * 1e6, t32 * 1e6,
+               good ? "ok" : same ? "WRONG" : "WRONG, channel pair differs");
+        ok &= good;
+    }
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
@@ -0,0 +1,397 @@
+/*
+ * aac_test.cpp
+ * the AAC-LC decoder on synthetic ADTS streams, bit exact against the decoder before the kernel changes, with the
+ * time of its kernels
+ *
+ * The streams are written by the encoder below from the decoder's own Huffman tables: random quantized spectra in
+ * every spectral codebook (escapes included), PNS, intensity stereo, M/S with and without a mask, pulses, TNS on
+ * long and short blocks, all window sequences and shapes, channel pairs with and without a common window, and a
+ * mono stream. The 16 bit output of AACDecode() hashes to the value the decoder of the baseline commit gives on
+ * the same streams; AACDecode32() has to round to the same samples.
+ *
+ * Timings: the per frame kernel times of AAC_KERNEL_PROFILE (ESP.getCycleCount() of the stubs counts host time in
+ * 240 MHz cycles, the timer calls included), and two micro-benchmarks: the spectral Huffman lookup tables
+ * (DecodeHuffmanSpec()) against the bit by bit walk (DecodeHuffmanScalar()) on the same cache, and the window/
+ * overlap-add of a channel pair in one pass (DecWindowOverlapStereo()) against one pass per channel.
+ ************************************************************************************/
+
+#define AAC_KERNEL_PROFILE
+#include "aac_decoder.cpp"
+#include <cstdio>
+#include <vector>
+#include <map>
+#include <array>
+#include <chrono>
+#include <algorithm>
+
+static bool g_verbose;
+
+struct Bits {
+    std::vector<uint8_t> b;
+    int n = 0;
+    void put(uint32_t v, int bits){
+        for(int i = bits - 1; i >= 0; i--){
+            if(n % 8 == 0) b.push_back(0);
+            if((v >> i) & 1) b.back() |= 0x80 >> (n % 8);
+            n++;
+        }
+    }
+};
+
+struct Code { uint32_t bits; int len; };
+typedef std::array<int, 4> Tuple;
+
+static std::map<int, Code>   s_sfCode;             // scalefactor delta -> code
+static std::map<Tuple, Code> s_specCode[12];       // spectral codebook, values (magnitudes if unsigned) -> code
+
+// the canonical codes of a table as DecodeHuffmanScalar() assigns them, symbol -> code
+static std::map<int, Code> codesOf(const HuffInfo_t &info, const int16_t *tab){
+    std::map<int, Code> m;
+    uint32_t start = 0;
+    int idx = info.offset;
+    for(int len = 1; len <= info.maxBits; len++){
+        int n = info.count[len - 1];
+        for(int i = 0; i < n; i++) m[tab[idx + i]] = {start + i, len};
+        idx += n;
+        start = (start + n) << 1;
+    }
+    return m;
+}
+
+// the symbol of a spectral codebook unpacked as UnpackQuads() / UnpackPairsNoEsc() / UnpackPairsEsc() do
+static Tuple unpack(int cb, int32_t v){
+    if(cb <= 4)  return {(v << 20) >> 29, (v << 23) >> 29, (v << 26) >> 29, (v << 29) >> 29};
+    if(cb <= 10) return {(v << 22) >> 27, (v << 27) >> 27, 0, 0};
+    return {(v << 20) >> 26, (v << 26) >> 26, 0, 0};
+}
+
+static void buildCodes(){
+    s_sfCode = codesOf(huffTabScaleFactInfo, huffTabScaleFact);
+    for(int cb = 1; cb <= 11; cb++){
+        for(auto &c : codesOf(huffTabSpecInfo[cb - HUFFTAB_SPEC_OFFSET], huffTabSpec)) s_specCode[cb][unpack(cb, c.first)] = c.second;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// encoder
+static const int SR_IDX = 4;                        // 44.1 kHz
+static const int cbMax[12] = {0, 1, 1, 2, 2, 4, 4, 7, 7, 12, 12, 16};
+static const bool cbSigned[12] = {0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0};
+
+struct Ics { int winSeq, winShape, maxSFB, sfGroup, nGroups, groupLen[8]; };
+
+static int rnd(int n){ return rand() % n; }
+
+static Ics randomIcs(int winSeq){
+    Ics ics = {winSeq, rnd(2), 0, 0, 1, {1}};
+    if(winSeq == 2){
+        ics.maxSFB = 6 + rnd(sfBandTotalShort[SR_IDX] - 5);
+        ics.sfGroup = rnd(128);
+        for(int mask = 0x40; mask; mask >>= 1){
+            if(ics.sfGroup & mask) ics.groupLen[ics.nGroups - 1]++;
+            else ics.groupLen[ics.nGroups++] = 1;
+        }
+    }
+    else ics.maxSFB = 30 + rnd(sfBandTotalLong[SR_IDX] - 29);
+    return ics;
+}
+
+static void putIcsInfo(Bits &b, const Ics &ics){
+    b.put(0, 1); b.put(ics.winSeq, 2); b.put(ics.winShape, 1);
+    if(ics.winSeq == 2){ b.put(ics.maxSFB, 4); b.put(ics.sfGroup, 7); }
+    else{ b.put(ics.maxSFB, 6); b.put(0, 1); }  // no prediction in LC
+}
+
+static void putSf(Bits &b, int delta){ b.put(s_sfCode[delta].bits, s_sfCode[delta].len); }
+
+static int quantized(int cb){
+    if(rnd(2)) return 0;
+    int m = 1 + rnd(cbMax[cb]);
+    if(cb == 11 && m == 16) m = 16 + rnd(rnd(8) ? 100 : 8000);
+    return rnd(2) ? -m : m;
+}
+
+// n values of codebook cb: codewords, sign bits of the unsigned books, escapes
+static void putSpectrum(Bits &b, int cb, int n){
+    int step = cb <= 4 ? 4 : 2;
+    for(int i = 0; i < n; i += step){
+        int v[4] = {0};
+        Tuple key = {0, 0, 0, 0};
+        for(int k = 0; k < step; k++){
+            v[k] = quantized(cb);
+            key[k] = cbSigned[cb] ? v[k] : std::min(abs(v[k]), 16);
+        }
+        b.put(s_specCode[cb][key].bits, s_specCode[cb][key].len);
+        if(!cbSigned[cb]) for(int k = 0; k < step; k++) if(v[k]) b.put(v[k] < 0, 1);
+        if(cb == 11) for(int k = 0; k < 2; k++) if(abs(v[k]) >= 16){
+            int m = abs(v[k]), e = 31 - __builtin_clz(m);
+            b.put(((1u << (e - 4)) - 1) << 1, e - 3);    // e - 4 ones and a zero
+            b.put(m - (1 << e), e);
+        }
+    }
+}
+
+static void putTns(Bits &b, int winSeq){
+    if(winSeq == 2){
+        for(int w = 0; w < 8; w++){
+            int nFilt = rnd(2);
+            b.put(nFilt, 1);
+            if(!nFilt) continue;
+            int res = rnd(2), order = rnd(8);
+            b.put(res, 1); b.put(rnd(16), 4); b.put(order, 3);
+            if(order){
+                int compress = rnd(2), bits = res + 3 - compress;
+                b.put(rnd(2), 1); b.put(compress, 1);
+                for(int i = 0; i < order; i++) b.put(rnd(1 << bits), bits);
+            }
+        }
+        return;
+    }
+    int nFilt = 1 + rnd(3), res = rnd(2);
+    b.put(nFilt, 2); b.put(res, 1);
+    for(int f = 0; f < nFilt; f++){
+        int order = rnd(13);
+        b.put(rnd(64), 6); b.put(order, 5);
+        if(order){
+            int compress = rnd(2), bits = res + 3 - compress;
+            b.put(rnd(2), 1); b.put(compress, 1);
+            for(int i = 0; i < order; i++) b.put(rnd(1 << bits), bits);
+        }
+    }
+}
+
+// individual_channel_stream(), intensity codebooks only in the second channel of a common window pair
+static void putChannel(Bits &b, const Ics &ics, bool common, bool intensity){
+    const bool isShort = ics.winSeq == 2;
+    const uint16_t *sfb = isShort ? sfBandTabShort + sfBandTabShortOffset[SR_IDX] : sfBandTabLong + sfBandTabLongOffset[SR_IDX];
+    const int lenBits = isShort ? 3 : 5, esc = (1 << lenBits) - 1, gg = 60 + rnd(25);
+    std::vector<int> cbs;
+
+    b.put(gg, 8);
+    if(!common) putIcsInfo(b, ics);
+    for(int g = 0; g < ics.nGroups; g++){
+        for(int s = 0; s < ics.maxSFB;){
+            int len = 1 + rnd(std::min(ics.maxSFB - s, isShort ? 4 : 10)), r = rnd(100), cb;
+            cb = r < 8 ? 0 : r < 16 ? 13 : (intensity && r < 26) ? 14 + rnd(2) : 1 + rnd(11);
+            b.put(cb, 4);
+            for(int l = len;; l -= esc){
+                b.put(std::min(l, esc), lenBits);
+                if(l < esc) break;
+            }
+            cbs.insert(cbs.end(), len, cb);
+            s += len;
+        }
+    }
+    int sf = gg, is = 0, nrg = gg - 90 - 256, d;
+    bool firstNoise = true;
+    for(int cb : cbs){
+        if(cb == 14 || cb == 15){ d = rnd(7) - 3; is += d; putSf(b, d); }
+        else if(cb == 13 && firstNoise){ d = 346 - 10 + rnd(10); b.put(d, 9); nrg += d; firstNoise = false; }
+        else if(cb == 13){ d = rnd(7) - 3; nrg += d; putSf(b, d); }
+        else if(cb){
+            d = rnd(9) - 4;
+            if(abs(sf + d - gg) > 20) d = -d;
+            sf += d;
+            putSf(b, d);
+        }
+    }
+    b.put(!isShort && rnd(4) == 0, 1);              // pulse data, long blocks only
+    if(b.b.back() & (0x80 >> ((b.n - 1) % 8))){
+        int n = rnd(4);
+        b.put(n, 2); b.put(rnd(std::min(ics.maxSFB, 20)), 6);
+        for(int i = 0; i <= n; i++){ b.put(rnd(32), 5); b.put(rnd(16), 4); }
+    }
+    b.put(rnd(3) == 0, 1);                          // TNS
+    if(b.b.back() & (0x80 >> ((b.n - 1) % 8))) putTns(b, ics.winSeq);
+    b.put(0, 1);                                    // no gain control
+    for(int g = 0, i = 0; g < ics.nGroups; g++) for(int s = 0; s < ics.maxSFB; s++, i++){
+        if(cbs[i] >= 1 && cbs[i] <= 11) putSpectrum(b, cbs[i], (sfb[s + 1] - sfb[s]) * ics.groupLen[g]);
+    }
+}
+
+// nFrames ADTS frames of one SCE or one CPE, the window sequences in a valid order
+static std::vector<uint8_t> makeStream(int nChans, int nFrames, unsigned seed){
+    std::vector<uint8_t> s;
+    int winSeq = 0;
+    srand(seed);
+    for(int f = 0; f < nFrames; f++){
+        Bits b;
+        winSeq = winSeq == 1 ? 2 : winSeq == 2 ? (rnd(5) < 3 ? 2 : 3) : (rnd(7) ? 0 : 1);
+        if(nChans == 1){
+            b.put(AAC_ID_SCE, 3); b.put(0, 4);
+            putChannel(b, randomIcs(winSeq), false, false);
+        }
+        else{
+            bool common = rnd(4) != 0;
+            Ics ics[2] = {randomIcs(winSeq), randomIcs(winSeq)};
+            b.put(AAC_ID_CPE, 3); b.put(0, 4); b.put(common, 1);
+            if(common){
+                int ms = rnd(3);
+                ics[1] = ics[0];
+                putIcsInfo(b, ics[0]);
+                b.put(ms, 2);
+                if(ms == 1) for(int i = 0; i < ics[0].nGroups * ics[0].maxSFB; i++) b.put(rnd(2), 1);
+            }
+            putChannel(b, ics[0], common, false);
+            putChannel(b, ics[1], common, common);
+        }
+        b.put(AAC_ID_END, 3);
+        Bits h;
+        int len = 7 + b.b.size();
+        h.put(0xFFF, 12); h.put(0, 1); h.put(0, 2); h.put(1, 1);                   // MPEG-4, no CRC
+        h.put(AAC_PROFILE_LC, 2); h.put(SR_IDX, 4); h.put(0, 1); h.put(nChans, 3);
+        h.put(0, 4); h.put(len, 13); h.put(0x7FF, 11); h.put(0, 2);
+        s.insert(s.end(), h.b.begin(), h.b.end());
+        s.insert(s.end(), b.b.begin(), b.b.end());
+    }
+    return s;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// the whole stream, frame by frame as Audio::sendBytes() does, returns the frames decoded
+template <typename pcm_t> static int decode(std::vector<uint8_t> &d, std::vector<pcm_t> &out){
+    static pcm_t pcm[2 * 1024] __attribute__((aligned(4)));
+    int pos = 0, frames = 0;
+    AACDecoder_AllocateBuffers();
+    while(pos < (int)d.size()){
+        int left = d.size() - pos;
+        if(AACFindSyncWord(&d[pos], left) != 0) break;
+        if(sizeof(pcm_t) == 2){ if(AACDecode(&d[pos], &left, (short*)pcm)) break; }
+        else if(AACDecode32(&d[pos], &left, (int32_t*)pcm)) break;
+        pos = d.size() - left;
+        out.insert(out.end(), pcm, pcm + AACGetOutputSamps());
+        frames++;
+    }
+    AACDecoder_FreeBuffers();
+    return frames;
+}
+
+static uint64_t fnv(const std::vector<short> &v){
+    uint64_t h = 0xcbf29ce484222325ull;
+    for(short s : v) for(int i = 0; i < 2; i++){ h ^= (uint8_t)(s >> (8 * i)); h *= 0x100000001b3ull; }
+    return h;
+}
+
+static bool check(bool ok, const char *what){
+    printf("  %-66s %s\n", what, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// spectral Huffman: the same codewords through the lookup tables and the bit by bit walk, ns per codeword
+static bool benchHuffman(){
+    bool same = true;
+    printf("spectral Huffman, ns per codeword   lookup table   bit walk\n");
+    AACDecoder_AllocateBuffers();
+    for(int cb = 1; cb <= 11; cb++){
+        const int n = 20000;
+        std::vector<int32_t> want, got(n), got2(n);
+        Bits b;
+        for(int i = 0; i < n; i++){                 // symbols as they occur, zeros and small values first
+            auto it = s_specCode[cb].begin();
+            Tuple key = {0, 0, 0, 0};
+            int step = cb <= 4 ? 4 : 2;
+            for(int k = 0; k < step; k++) key[k] = cbSigned[cb] ? quantized(cb) : std::min(abs(quantized(cb)), 16);
+            it = s_specCode[cb].find(key);
+            b.put(it->second.bits, it->second.len);
+            want.push_back(it->second.len);
+        }
+        b.put(0, 32);
+        const uint16_t *lut = m_huffTabSpecLUT + m_huffTabSpecLUTOffset[cb - HUFFTAB_SPEC_OFFSET];
+        const HuffInfo_t *info = &huffTabSpecInfo[cb - HUFFTAB_SPEC_OFFSET];
+        double tLut = 1e9, tWalk = 1e9;
+        for(int r = 0; r < 20; r++){
+            auto t0 = std::chrono::steady_clock::now();
+            SetBitstreamPointer(b.b.size(), b.b.data());
+            for(int i = 0; i < n; i++){ int len = DecodeHuffmanSpec(lut, PeekBitstreamCache(), &got[i]); SkipBitstreamCache(len); }
+            auto t1 = std::chrono::steady_clock::now();
+            SetBitstreamPointer(b.b.size(), b.b.data());
+            for(int i = 0; i < n; i++){ int len = DecodeHuffmanScalar(m_huffTabSpec, info, PeekBitstreamCache(), &got2[i]); SkipBitstreamCache(len); }
+            auto t2 = std::chrono::steady_clock::now();
+            tLut = std::min(tLut, std::chrono::duration<double, std::nano>(t1 - t0).count() / n);
+            tWalk = std::min(tWalk, std::chrono::duration<double, std::nano>(t2 - t1).count() / n);
+        }
+        same &= got == got2;
+        printf("  codebook %2d                        %6.2f        %6.2f\n", cb, tLut, tWalk);
+    }
+    AACDecoder_FreeBuffers();
+    return same;
+}
+
+// window/overlap-add of a LONG-LONG channel pair: one pass for both channels against one per channel, us per frame
+static bool benchWindow(){
+    static int buf[2][1024], over[2][2][1024];
+    static short pcm[2][2 * 1024] __attribute__((aligned(4)));
+    bool same = true;
+    srand(3);
+    for(int ch = 0; ch < 2; ch++) for(int i = 0; i < 1024; i++){ buf[ch][i] = rand() % 4000000 - 2000000; over[0][ch][i] = over[1][ch][i] = rand() % 4000000 - 2000000; }
+    for(int shape = 0; shape < 4; shape++){        // current and previous shape, bit exact
+        DecWindowOverlapStereo(buf[0], buf[1], over[0][0], over[0][1], pcm[0], shape & 1, shape >> 1);
+        DecWindowOverlap(buf[0], over[1][0], pcm[1], 2, shape & 1, shape >> 1);
+        DecWindowOverlap(buf[1], over[1][1], pcm[1] + 1, 2, shape & 1, shape >> 1);
+        same &= !memcmp(pcm[0], pcm[1], sizeof(pcm[0])) && !memcmp(over[0], over[1], sizeof(over[0]));
+    }
+    double tPair = 1e9, tEach = 1e9;
+    for(int r = 0; r < 20; r++){
+        auto t0 = std::chrono::steady_clock::now();
+        for(int i = 0; i < 200; i++) DecWindowOverlapStereo(buf[0], buf[1], over[0][0], over[0][1], pcm[0], 1, 1);
+        auto t1 = std::chrono::steady_clock::now();
+        for(int i = 0; i < 200; i++){
+            DecWindowOverlap(buf[0], over[1][0], pcm[1], 2, 1, 1);
+            DecWindowOverlap(buf[1], over[1][1], pcm[1] + 1, 2, 1, 1);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        tPair = std::min(tPair, std::chrono::duration<double, std::micro>(t1 - t0).count() / 200);
+        tEach = std::min(tEach, std::chrono::duration<double, std::micro>(t2 - t1).count() / 200);
+    }
+    printf("window/overlap-add, us per stereo frame: both channels in one pass %.2f, one pass per channel %.2f\n", tPair, tEach);
+    return same;
+}
+
+int main(int argc, char **){
+    // FNV-1a of the 16 bit output of the baseline decoder on these streams
+    const uint64_t wantStereo = 0xc2926cf5afdf0134ull, wantMono = 0xdc2b5b8852de29f7ull;
+    bool ok = true;
+
+    g_verbose = argc > 1;
+    buildCodes();
+    std::vector<uint8_t> stereo = makeStream(2, 400, 1), mono = makeStream(1, 100, 2);
+    std::vector<short> s16, m16;
+    std::vector<int32_t> s32;
+    int nS = decode(stereo, s16), nM = decode(mono, m16);
+    decode(stereo, s32);
+    uint64_t hS = fnv(s16), hM = fnv(m16);
+    printf("stereo: %d of 400 frames, %zu bytes, output %016llx\n", nS, stereo.size(), (unsigned long long)hS);
+    printf("mono:   %d of 100 frames, %zu bytes, output %016llx\n", nM, mono.size(), (unsigned long long)hM);
+    if(g_verbose){
+        long clip = 0, peak = 0;
+        for(short v : s16){ clip += v == 32767 || v == -32768; peak = std::max(peak, (long)abs(v)); }
+        printf("  peak %ld, %.2f %% clipped\n", peak, 100.0 * clip / s16.size());
+    }
+    ok &= check(nS == 400 && nM == 100, "every frame decodes");
+    ok &= check(hS == wantStereo && hM == wantMono, "16 bit output bit exact with the baseline decoder");
+    bool same = s32.size() == s16.size();
+    for(size_t i = 0; same && i < s32.size(); i++) same = std::min(std::max((s32[i] + (1ll << 12)) >> 13, -32768ll), 32767ll) == s16[i];
+    ok &= check(same, "the Q28 output rounds to the 16 bit output");
+
+    // kernel profile of the stereo stream, the fastest of 5 runs per kernel
+    AACKernelStats_t best;
+    memset(&best, 0xff, sizeof(best));
+    for(int r = 0; r < 5; r++){
+        std::vector<short> d;
+        memset(&m_kernelStats, 0, sizeof(m_kernelStats));
+        decode(stereo, d);
+        uint32_t *b = (uint32_t*)&best, *k = (uint32_t*)&m_kernelStats;
+        for(size_t i = 0; i < sizeof(best) / 4; i++) b[i] = std::min(b[i], k[i]);
+    }
+    const double us = 1.0 / 240;
+    printf("AAC_KERNEL_PROFILE, us per stereo frame: noiseless %.2f, stereo %.2f, PNS+TNS %.2f, window/overlap-add %.2f\n",
+           best.noiseless * us / best.frames, best.stereo * us / best.frames, best.pnsTns * us / best.frames, best.windowOverlap * us / best.frames);
+    printf("  per DCT4 call (%.1f per frame): pre %.2f, FFT %.2f, post %.2f\n", (double)best.calls / best.frames,
+           best.preMultiply * us / best.calls, (best.bitReverse + best.firstPass + best.r4Core) * us / best.calls, best.postMultiply * us / best.calls);
+
+    ok &= check(benchHuffman(), "lookup tables and bit walk decode the same symbols");
+    ok &= check(benchWindow(), "stereo window/overlap-add bit exact with two single channel passes");
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
@@ -0,0 +1,65 @@
+/*
+ * amp_test.cpp
+ * tas5753md.cpp through the I2C queue (i2c.cpp) to the bus model of board.cpp
+ *
+ * FAST_BOOT configures amplifier 1 while the first song may already play. A crossover reload mutes both
+ * amplifiers, if amplifier 1 finishes its config during the reload it has to stay muted until the unmute,
+ * and it has to take the volume set while it was not ready.
+ ************************************************************************************/
+
+#include "board.h"
+#include "i2c.h"
+#include "tas5753md.h"
+
+// the last write of device dev to register reg, empty if there was none
+static std::vector<uint8_t> lastWrite(const std::vector<BusTx> &bus, uint8_t dev, uint8_t reg){
+    std::vector<uint8_t> d;
+    for(const BusTx &t : bus){
+        if(t.dev == dev && !t.read && t.bytes.size() > 1 && t.bytes[0] == reg) d.assign(t.bytes.begin() + 1, t.bytes.end());
+    }
+    return d;
+}
+
+static bool check(bool ok, const char *what){
+    printf("  %-66s %s\n", what, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+int main(int argc, char **){
+    bool ok = true;
+    std::vector<BusTx> bus;
+
+    g_verbose = argc > 1;
+    i2c_begin(0, 0);
+    tas5753md_powerUp();
+    ok &= check(tas5753md_configDevice(0) == 1, "amplifier 0 configured");
+    bus = busTake();
+    ok &= check(lastWrite(bus, TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SYS_CTRL_2) == std::vector<uint8_t>{0x00},
+                "amplifier 0 unmuted");
+
+    // amplifier 1 joins while a crossover reload holds the amplifiers muted
+    std::thread amp1([]{ tas5753md_configDevice(1); });
+    sleepMs(50);                                       // amplifier 1 is in its 100 ms after the oscillator trim
+    tas5753md_mute();
+    tas5753md_setVolume(0x120);
+    sleepMs(400);                                      // amplifier 1 is done, the reload still runs
+    amp1.join();
+    bus = busTake();
+    for(const BusTx &t : bus) if(g_verbose) printf("     %s\n", busText(t).c_str());
+    ok &= check(lastWrite(bus, TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SYS_CTRL_2) == std::vector<uint8_t>{0x40},
+                "amplifier 0 muted for the reload");
+    ok &= check(lastWrite(bus, TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_SYS_CTRL_2) == std::vector<uint8_t>{0x40},
+                "amplifier 1, configured during the reload, stays muted");
+    ok &= check(lastWrite(bus, TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_MASTER_VOL) == std::vector<uint8_t>{0x01, 0x20},
+                "amplifier 1 takes the volume set while it was not ready");
+
+    tas5753md_unmute();
+    sleepMs(20);
+    bus = busTake();
+    ok &= check(lastWrite(bus, TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_SYS_CTRL_2) == std::vector<uint8_t>{0x00} &&
+                lastWrite(bus, TAS5753MD_I2C_ADDR_1, TAS5753MD_REG_SYS_CTRL_2) == std::vector<uint8_t>{0x00},
+                "both unmuted after the reload");
+
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
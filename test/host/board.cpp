@@ -0,0 +1,136 @@
+/*
+ * board.cpp
+ * Arduino, FreeRTOS and Wire for the board tests (board.h)
+ *
+ * Unlike stubs.cpp, delay() and vTaskDelay() sleep: the boot steps, the I2C task and the LCD task run in parallel
+ * threads and their order depends on the time they take.
+ ************************************************************************************/
+
+#include "board.h"
+#include "Wire.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <condition_variable>
+#include <pthread.h>
+
+static auto t0 = std::chrono::steady_clock::now();
+
+unsigned long millis(){ return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count(); }
+unsigned long micros(){ return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count(); }
+void delay(unsigned long ms){ std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(unsigned int us){ std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void pinMode(int, int){}
+void digitalWrite(int, int){}
+int  digitalRead(int){ return 0; }
+
+bool g_verbose = false;
+HardwareSerial Serial;
+size_t Print::print(const char *s){ if(g_verbose) fputs(s, stdout); return 0; }
+size_t Print::println(const char *s){ if(g_verbose) puts(s); return 0; }
+size_t Print::println(const String &s){ return println(s.c_str()); }
+size_t Print::printf(const char *f, ...){
+    va_list a;
+    if(!g_verbose) return 0;
+    va_start(a, f);
+    vprintf(f, a);
+    va_end(a);
+    return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// FreeRTOS on threads: a semaphore is a count under a mutex, a mutex one that starts at 1
+struct StubSem {
+    std::mutex m;
+    std::condition_variable cv;
+    int n;
+};
+SemaphoreHandle_t xSemaphoreCreateMutex(void){ StubSem *s = new StubSem; s->n = 1; return s; }
+SemaphoreHandle_t xSemaphoreCreateBinary(void){ StubSem *s = new StubSem; s->n = 0; return s; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t h, TickType_t){
+    StubSem *s = (StubSem*)h;
+    std::unique_lock<std::mutex> l(s->m);
+    s->cv.wait(l, [s]{ return s->n > 0; });
+    s->n--;
+    return pdTRUE;
+}
+BaseType_t xSemaphoreGive(SemaphoreHandle_t h){
+    StubSem *s = (StubSem*)h;
+    std::lock_guard<std::mutex> l(s->m);
+    if(s->n < 1) s->n++;
+    s->cv.notify_all();
+    return pdTRUE;
+}
+
+struct StubEvents {
+    std::mutex m;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+EventGroupHandle_t xEventGroupCreate(void){ return new StubEvents; }
+EventBits_t xEventGroupSetBits(EventGroupHandle_t h, EventBits_t b){
+    StubEvents *e = (StubEvents*)h;
+    std::lock_guard<std::mutex> l(e->m);
+    e->bits |= b;
+    e->cv.notify_all();
+    return e->bits;
+}
+EventBits_t xEventGroupGetBits(EventGroupHandle_t h){
+    StubEvents *e = (StubEvents*)h;
+    std::lock_guard<std::mutex> l(e->m);
+    return e->bits;
+}
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t h, EventBits_t b, BaseType_t, BaseType_t, TickType_t t){
+    StubEvents *e = (StubEvents*)h;
+    std::unique_lock<std::mutex> l(e->m);
+    auto all = [e, b]{ return (e->bits & b) == b; };
+    if(t == portMAX_DELAY) e->cv.wait(l, all);
+    else                   e->cv.wait_for(l, std::chrono::milliseconds(t), all);
+    return e->bits;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t f, const char*, uint32_t, void *a, UBaseType_t, TaskHandle_t *h, BaseType_t){
+    if(h) *h = (TaskHandle_t)1;
+    std::thread(f, a).detach();
+    return pdPASS;
+}
+void vTaskDelete(TaskHandle_t){ pthread_exit(nullptr); }
+void vTaskDelay(TickType_t t){ delay(t); }
+
+//---------------------------------------------------------------------------------------------------------------------
+// Wire: a transaction is logged when it ends, a read ends at requestFrom()
+TwoWire Wire;
+int     g_busUs = 300;                             // 100 kHz, a few bytes
+uint8_t g_busReadValue = 0x41;
+static std::vector<BusTx> s_bus;
+static std::mutex         s_busLock;
+static BusTx              s_tx;
+
+static void busEnd(){
+    if(g_busUs) std::this_thread::sleep_for(std::chrono::microseconds(g_busUs));
+    s_tx.us = micros();
+    std::lock_guard<std::mutex> l(s_busLock);
+    s_bus.push_back(s_tx);
+}
+
+std::vector<BusTx> busTake(){
+    std::lock_guard<std::mutex> l(s_busLock);
+    std::vector<BusTx> b;
+    b.swap(s_bus);
+    return b;
+}
+
+void    TwoWire::begin(int, int){}
+void    TwoWire::setClock(uint32_t){}
+void    TwoWire::beginTransmission(uint8_t a){ s_tx.dev = a; s_tx.read = false; s_tx.bytes.clear(); }
+size_t  TwoWire::write(uint8_t b){ s_tx.bytes.push_back(b); return 1; }
+size_t  TwoWire::write(const uint8_t *p, size_t n){ s_tx.bytes.insert(s_tx.bytes.end(), p, p + n); return n; }
+uint8_t TwoWire::endTransmission(bool stop){
+    if(s_tx.bytes.empty()) return 0;               // the stop after a read
+    if(!stop){ s_tx.read = true; return 0; }       // repeated start, the read follows
+    busEnd();
+    s_tx.bytes.clear();
+    return 0;
+}
+uint8_t TwoWire::requestFrom(uint8_t, uint8_t n){ busEnd(); s_tx.bytes.clear(); return n; }
+int     TwoWire::read(){ return g_busReadValue; }
@@ -0,0 +1,40 @@
+/*
+ * board.h
+ * the board side of the sketch on Linux: boot steps, the I2C queue, the amplifiers and the LCD
+ *
+ * board.cpp stands in for the Arduino core, FreeRTOS and Wire. Tasks are threads, delay() sleeps, and every
+ * I2C transaction that reaches the bus is logged in g_bus with its device, bytes and the time it took place.
+ * A transaction keeps the bus g_busUs, so work queued meanwhile has to wait as it does on the board.
+ ************************************************************************************/
+
+#pragma once
+#include "Arduino.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <thread>
+
+struct BusTx {
+    uint8_t  dev;
+    bool     read;                                 // register read, bytes = register
+    std::vector<uint8_t> bytes;                    // register, then the data written
+    unsigned long us;                              // micros() at the end of the transaction
+};
+
+extern bool     g_verbose;
+extern int      g_busUs;                           // bus time per transaction
+extern uint8_t  g_busReadValue;                    // what every register read returns, 0x41 = TAS5753MD id
+std::vector<BusTx> busTake();                      // the transactions since the last call
+
+static inline void sleepMs(int ms){ std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// "2A: 05 40" for a write of 0x40 to register 5 of device 0x2A, "2A? 01" for a read
+static inline std::string busText(const BusTx &t){
+    char b[8];
+    std::string s;
+    snprintf(b, sizeof(b), "%02X%c", t.dev, t.read ? '?' : ':');
+    s = b;
+    for(uint8_t x : t.bytes){ snprintf(b, sizeof(b), " %02X", x); s += b; }
+    return s;
+}
@@ -0,0 +1,94 @@
+/*
+ * boot_test.cpp
+ * boot.cpp with the steps of esp32.ino replaced by sleeps of about their length, amplifier 1 fails
+ *
+ * Checked: the first song waits only for its steps, a step starts after the ones it needs, a failed step skips
+ * the steps that need it, BootFailed() names the failed step and tells a timeout from a failure.
+ ************************************************************************************/
+
+#include "board.h"
+#include "boot.h"
+#include <map>
+
+enum {LCD, AMP_POWER, AMP0, AMP1, SD, FPGA, INDEX, AFTER_AMP1, STEPS};
+
+static bool s_afterAmp1Ran = false;
+static bool lcd()       { sleepMs(320); return true; }
+static bool ampPower()  { sleepMs(90);  return true; }
+static bool amp0()      { sleepMs(200); return true; }
+static bool amp1()      { sleepMs(200); return false; }     // no answer
+static bool sd()        { sleepMs(150); return true; }
+static bool fpga()      { sleepMs(250); return true; }
+static bool songIndex() { sleepMs(100); return true; }
+static bool afterAmp1() { s_afterAmp1Ran = true; return true; }
+
+static const BootStep_t steps[STEPS] = {
+    {"lcd",       lcd,       0},
+    {"amp power", ampPower,  0},
+    {"amp0",      amp0,      1 << AMP_POWER},
+    {"amp1",      amp1,      1 << AMP_POWER},
+    {"sd",        sd,        0},
+    {"fpga",      fpga,      0},
+    {"index",     songIndex, 1 << SD},
+    {"after amp1", afterAmp1, 1 << AMP1},
+};
+
+struct Span { unsigned start, end; bool failed; };
+static std::map<std::string, Span> s_report;
+
+// "boot: amp0           90 ms ...   290 ms failed"
+static void report(const char *line){
+    char name[16];
+    Span s = {0, 0, false};
+    if(g_verbose) puts(line);
+    if(sscanf(line, "boot: %12c %u ms ... %u ms", name, &s.start, &s.end) != 3) return;
+    name[12] = 0;
+    std::string n(name);
+    n.erase(n.find_last_not_of(' ') + 1);
+    s.failed = strstr(line, "failed") != NULL;
+    s_report[n] = s;
+}
+
+static bool check(bool ok, const char *what){
+    printf("  %-60s %s\n", what, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+int main(int argc, char **){
+    bool ok = true, running;
+    const char *step;
+    const uint8_t first = (1 << LCD) | (1 << AMP0) | (1 << FPGA);
+
+    g_verbose = argc > 1;
+    unsigned long t0 = millis();
+    BootStart(steps, STEPS);
+
+    ok &= check(!BootWait(1 << FPGA, 100), "BootWait() returns false on a timeout");
+    step = BootFailed(1 << FPGA, &running);
+    ok &= check(step && !strcmp(step, "fpga") && running, "BootFailed() names the running step");
+
+    ok &= check(BootWait(first, 5000), "the steps of the first song succeed");
+    unsigned long tFirst = millis() - t0;
+    printf("  first song steps done after %lu ms, one after the other they take %d ms\n", tFirst, 320 + 90 + 200 + 250);
+    ok &= check(tFirst < 450, "lcd, amp0 and fpga run in parallel");
+    ok &= check(BootFailed(first, &running) == NULL, "BootFailed() is NULL if all of them succeeded");
+
+    ok &= check(!BootWait(1 << AMP1, 5000), "the failed amplifier is reported");
+    step = BootFailed((1 << AMP0) | (1 << AMP1), &running);
+    ok &= check(step && !strcmp(step, "amp1") && !running, "BootFailed() names the failed step");
+    ok &= check(BootWait(1 << INDEX, 5000), "the index succeeds");
+    ok &= check(!BootWait(1 << AFTER_AMP1, 5000) && !s_afterAmp1Ran, "a step that needs the failed one is skipped");
+    step = BootFailed(1 << AFTER_AMP1, &running);
+    ok &= check(step && !strcmp(step, "after amp1") && !running, "and reported failed");
+
+    BootReport(report);
+    ok &= check(s_report.size() == STEPS, "BootReport() has a line per step");
+    ok &= check(s_report["amp0"].start >= s_report["amp power"].end, "amp0 starts after the power sequence");
+    ok &= check(s_report["amp1"].start >= s_report["amp power"].end, "amp1 starts after the power sequence");
+    ok &= check(s_report["index"].start >= s_report["sd"].end, "the index starts after SD");
+    ok &= check(s_report["amp1"].failed && s_report["after amp1"].failed && !s_report["amp0"].failed,
+                "the report marks amp1 and the step after it failed");
+
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
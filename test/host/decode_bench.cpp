@@ -0,0 +1,267 @@
+/*
+ * decode_bench.cpp
+ * decoder time per second of 44.1 kHz stereo: MP3 at 128 kbit/s against FLAC at 16 and 24 bit, both outputs
+ * (FLACDecode() / MP3Decode() 16 bit, FLACDecode32() / MP3Decode32() Q28), fed in 1600 byte chunks as
+ * Audio::sendBytes() does, best of 5
+ *
+ * The MP3 stream is the frames of harness.h: every granule carries 64 lines, the synthesis runs in full but the
+ * Huffman part is lighter than in music. The FLAC streams come from the small encoder below (blocks of 4096,
+ * fixed orders 0-4 or LPC order 8 with 12 bit coefficients, Rice partitions, left/right or mid/side, as
+ * flac -5 does) on a multitone with noise.
+ *
+ * Checked: the FLAC output is bit exact in both formats, the MP3 stream decodes without error
+ ************************************************************************************/
+
+#include "harness.h"
+#include "flac_decoder.h"
+#include <chrono>
+
+static const int RATE = 44100, BLOCK = 4096;
+
+//---------------------------------------------------------------------------------------------------------------------
+// FLAC encoder
+static void putSigned(BitWriter &w, int32_t v, int bits){ w.put((uint32_t)v & (uint32_t)((1ull << bits) - 1), bits); }
+static uint32_t zigzag(int64_t r){ return r >= 0 ? (uint32_t)r << 1 : ((uint32_t)~r << 1) | 1; }
+
+// partitioned Rice, the partition order and the parameters of the least bits
+static void putResidual(BitWriter &w, const std::vector<int64_t> &r, int order){
+    int n = r.size(), bestPo = 0;
+    uint64_t best = ~0ull;
+    auto param = [&](int from, int to, uint64_t *bits){
+        uint64_t sum = 0;
+        int k = 0;
+        for(int i = from; i < to; i++) sum += zigzag(r[i]);
+        while(k < 14 && ((uint64_t)(to - from) << (k + 1)) < sum) k++;
+        *bits = 4;
+        for(int i = from; i < to; i++) *bits += (zigzag(r[i]) >> k) + 1 + k;
+        return k;
+    };
+    for(int po = 0; po <= 6 && (n >> po) > order && !(n & ((1 << po) - 1)); po++){
+        uint64_t bits = 0, b;
+        for(int p = 0; p < (1 << po); p++){ param(p ? p * (n >> po) : order, (p + 1) * (n >> po), &b); bits += b; }
+        if(bits < best){ best = bits; bestPo = po; }
+    }
+    w.put(0, 2); w.put(bestPo, 4);                  // RICE, partition order
+    for(int p = 0; p < (1 << bestPo); p++){
+        uint64_t b;
+        int from = p ? p * (n >> bestPo) : order, to = (p + 1) * (n >> bestPo), k = param(from, to, &b);
+        w.put(k, 4);
+        for(int i = from; i < to; i++){
+            uint32_t u = zigzag(r[i]);
+            for(uint32_t q = u >> k; q; q--) w.put(0, 1);
+            w.put(1, 1);
+            if(k) w.put(u & ((1u << k) - 1), k);
+        }
+    }
+}
+
+static BitWriter fixedSubframe(const std::vector<int32_t> &s, int bps, int order){
+    static const int c[5][4] = {{0}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+    BitWriter w;
+    std::vector<int64_t> r(s.size());
+    w.put(0, 1); w.put(8 + order, 6); w.put(0, 1);
+    for(int i = 0; i < order; i++) putSigned(w, s[i], bps);
+    for(size_t i = order; i < s.size(); i++){
+        int64_t p = 0;
+        for(int j = 0; j < order; j++) p += (int64_t)c[order][j] * s[i - 1 - j];
+        r[i] = s[i] - p;
+    }
+    putResidual(w, r, order);
+    return w;
+}
+
+// Levinson-Durbin on the autocorrelation, coefficients quantized to 12 bit
+static BitWriter lpcSubframe(const std::vector<int32_t> &s, int bps, int order){
+    const int prec = 12;
+    int n = s.size(), shift, q[32];
+    double ac[33] = {0}, a[33] = {0}, t[33], err, cmax = 0;
+    BitWriter w;
+    std::vector<int64_t> r(n);
+
+    for(int l = 0; l <= order; l++) for(int i = l; i < n; i++) ac[l] += (double)s[i] * s[i - l];
+    if(ac[0] == 0) return fixedSubframe(s, bps, 0);
+    err = ac[0] * (1 + 1e-9);
+    for(int i = 1; i <= order; i++){
+        double k = ac[i];
+        for(int j = 1; j < i; j++) k -= a[j] * ac[i - j];
+        k /= err;
+        memcpy(t, a, sizeof(a));
+        a[i] = k;
+        for(int j = 1; j < i; j++) a[j] = t[j] - k * t[i - j];
+        err *= 1 - k * k;
+    }
+    for(int j = 1; j <= order; j++) cmax = std::max(cmax, fabs(a[j]));
+    shift = std::min(15, std::max(0, prec - 2 - (int)floor(log2(cmax))));
+    for(int j = 0; j < order; j++) q[j] = std::min(2047L, std::max(-2048L, lround(a[j + 1] * (1 << shift))));
+    w.put(0, 1); w.put(32 + order - 1, 6); w.put(0, 1);
+    for(int i = 0; i < order; i++) putSigned(w, s[i], bps);
+    w.put(prec - 1, 4); putSigned(w, shift, 5);
+    for(int j = 0; j < order; j++) putSigned(w, q[j], prec);
+    for(int i = order; i < n; i++){
+        int64_t p = 0;
+        for(int j = 0; j < order; j++) p += (int64_t)q[j] * s[i - 1 - j];
+        r[i] = s[i] - (p >> shift);
+    }
+    putResidual(w, r, order);
+    return w;
+}
+
+static void putSubframe(BitWriter &w, const std::vector<int32_t> &s, int bps){
+    BitWriter best = lpcSubframe(s, bps, 8);
+    for(int order = 0; order <= 4; order++){
+        BitWriter f = fixedSubframe(s, bps, order);
+        if(f.n < best.n) best = f;
+    }
+    for(int i = 0; i < best.n; i++) w.put((best.b[i / 8] >> (7 - i % 8)) & 1, 1);
+}
+
+static uint8_t crc8(const std::vector<uint8_t> &p){
+    uint8_t c = 0;
+    for(uint8_t b : p){ c ^= b; for(int i = 0; i < 8; i++) c = (c & 0x80) ? (c << 1) ^ 0x07 : c << 1; }
+    return c;
+}
+static uint16_t crc16(const std::vector<uint8_t> &p){
+    uint16_t c = 0;
+    for(uint8_t b : p){ c ^= b << 8; for(int i = 0; i < 8; i++) c = (c & 0x8000) ? (c << 1) ^ 0x8005 : c << 1; }
+    return c;
+}
+
+static std::vector<uint8_t> encodeFlac(const std::vector<int32_t> &L, const std::vector<int32_t> &R, int bps){
+    uint32_t n = L.size();
+    uint8_t head[4 + 4 + 34] = {'f', 'L', 'a', 'C', 0x80, 0, 0, 34, BLOCK >> 8, BLOCK & 0xFF, BLOCK >> 8, BLOCK & 0xFF};
+    uint8_t *p = head + 8;                           // STREAMINFO, the last metadata block
+    p[10] = RATE >> 12; p[11] = (uint8_t)(RATE >> 4); p[12] = ((RATE & 15) << 4) | (1 << 1) | ((bps - 1) >> 4);
+    p[13] = ((bps - 1) & 15) << 4; p[14] = n >> 24; p[15] = n >> 16; p[16] = n >> 8; p[17] = n;
+    std::vector<uint8_t> d(head, head + sizeof(head));
+
+    for(uint32_t pos = 0, fn = 0; pos < n; pos += BLOCK, fn++){
+        uint32_t bs = std::min<uint32_t>(BLOCK, n - pos);
+        std::vector<int32_t> l(L.begin() + pos, L.begin() + pos + bs), r(R.begin() + pos, R.begin() + pos + bs), mid(bs), side(bs);
+        for(uint32_t i = 0; i < bs; i++){ mid[i] = (l[i] + r[i]) >> 1; side[i] = l[i] - r[i]; }
+        BitWriter lr, ms;
+        putSubframe(lr, l, bps); putSubframe(lr, r, bps);
+        putSubframe(ms, mid, bps); putSubframe(ms, side, bps + 1);
+        bool useMs = ms.n < lr.n;
+        std::vector<uint8_t> f = {0xFF, 0xF8, (uint8_t)(((bs == BLOCK ? 12 : 7) << 4) | 9),
+                                  (uint8_t)(((useMs ? 10 : 1) << 4) | ((bps == 16 ? 4 : 6) << 1))};
+        if(fn < 0x80) f.push_back(fn);
+        else{ f.push_back(0xC0 | (fn >> 6)); f.push_back(0x80 | (fn & 0x3F)); }
+        if(bs != BLOCK){ f.push_back((bs - 1) >> 8); f.push_back(bs - 1); }
+        f.push_back(crc8(f));
+        BitWriter &sub = useMs ? ms : lr;
+        f.insert(f.end(), sub.b.begin(), sub.b.end());
+        uint16_t c = crc16(f);
+        f.push_back(c >> 8); f.push_back(c);
+        d.insert(d.end(), f.begin(), f.end());
+    }
+    return d;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// multitone with slowly drifting pitch and noise, bps bit full scale
+static void music(std::vector<int32_t> &L, std::vector<int32_t> &R, size_t n, int bps){
+    const double f[6] = {110, 220.5, 445, 1330, 3300, 7000}, amp = (1 << (bps - 1)) - 1;
+    double ph[6] = {0};
+    srand(5);
+    L.resize(n); R.resize(n);
+    for(size_t i = 0; i < n; i++){
+        double v = 0, env = 0.5 + 0.5 * sin(i * 2e-5);
+        for(int k = 0; k < 6; k++){ v += sin(ph[k]) * 0.15 / (k + 1); ph[k] += 2 * M_PI * f[k] * (1 + 0.1 * sin(i * 1e-4)) / RATE; }
+        for(int c = 0; c < 2; c++){
+            double x = v * env + (rand() / (double)RAND_MAX - 0.5) * 0.02 + (c ? 0.05 * sin(i * 0.013) : 0);
+            (c ? R : L)[i] = (int32_t)llround(x * amp);
+        }
+    }
+}
+
+// the whole stream in 1600 byte chunks, seconds of the fastest of 5 runs, the output of the last
+template <typename pcm_t> static double timeFlac(const std::vector<uint8_t> &d, std::vector<pcm_t> &out){
+    static pcm_t pcm[2 * 2048];                     // FLAC_MAX_OUT_SAMPS of flac_decoder.cpp per channel
+    double best = 1e9;
+    for(int run = 0; run < 5; run++){
+        size_t pos = 8 + 34;
+        out.clear();
+        FLACDecoder_AllocateBuffers();
+        FLACParseStreamInfo(&d[8], 34);
+        auto t0 = std::chrono::steady_clock::now();
+        for(;;){
+            int len = std::min<size_t>(1600, d.size() - pos), left = len, err;
+            if(!len && !FLACGetBufferedBytes() && !FLACGetPendingSamps()) break;
+            if(sizeof(pcm_t) == 2) err = FLACDecode((uint8_t*)&d[pos], &left, (short*)pcm);
+            else                   err = FLACDecode32((uint8_t*)&d[pos], &left, (int32_t*)pcm);
+            pos += len - left;
+            if(err == ERR_FLAC_INDATA_UNDERFLOW && len) continue;
+            if(err) break;
+            out.insert(out.end(), pcm, pcm + FLACGetOutputSamps());
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        FLACDecoder_FreeBuffers();
+    }
+    return best;
+}
+
+template <typename pcm_t> static double timeMp3(const std::vector<uint8_t> &d, size_t *samples){
+    static pcm_t pcm[2 * 1152];
+    double best = 1e9;
+    for(int run = 0; run < 5; run++){
+        size_t pos = 0;
+        *samples = 0;
+        MP3Decoder_AllocateBuffers();
+        auto t0 = std::chrono::steady_clock::now();
+        while(pos < d.size()){
+            int left = std::min<size_t>(1600, d.size() - pos), len = left, s = MP3FindSyncWord((unsigned char*)&d[pos], len);
+            if(s) break;                                // the frames follow each other
+            int err = sizeof(pcm_t) == 2 ? MP3Decode((unsigned char*)&d[pos], &left, (short*)pcm, 0)
+                                         : MP3Decode32((unsigned char*)&d[pos], &left, (int32_t*)pcm, 0);
+            if(err) break;
+            pos += len - left;
+            *samples += MP3GetOutputSamps();
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        MP3Decoder_FreeBuffers();
+    }
+    return best;
+}
+
+static bool check(bool ok, const char *what){
+    printf("  %-66s %s\n", what, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+int main(int argc, char **){
+    const int frames = 800;
+    const size_t n = frames * 1152;
+    const double secs = (double)n / RATE;
+    bool ok = true, exact = true;
+
+    g_verbose = argc > 1;
+    std::vector<uint8_t> mp3;
+    for(int i = 0; i < frames; i++){ std::vector<uint8_t> f = mp3Frame(77000 + i); mp3.insert(mp3.end(), f.begin(), f.end()); }
+    size_t s16, s32;
+    double m16 = timeMp3<short>(mp3, &s16), m32 = timeMp3<int32_t>(mp3, &s32);
+
+    printf("per second of 44.1 kHz stereo, best of 5      kbit/s   16 bit out     Q28 out\n");
+    printf("  %-44s %6.0f  %7.0f us  %7.0f us\n", "MP3 128 kbit/s", mp3.size() * 8 / secs / 1000, m16 / secs * 1e6, m32 / secs * 1e6);
+
+    for(int bps : {16, 24}){
+        std::vector<int32_t> L, R, q28;
+        std::vector<short> p16;
+        music(L, R, n, bps);
+        std::vector<uint8_t> flac = encodeFlac(L, R, bps);
+        double f16 = timeFlac(flac, p16), f32 = timeFlac(flac, q28);
+        bool same = p16.size() == 2 * n && q28.size() == 2 * n;
+        for(size_t i = 0; same && i < n; i++) for(int c = 0; c < 2; c++){
+            int32_t x = (c ? R : L)[i], e16 = bps == 16 ? x : std::min(32767, (x + 128) >> 8);
+            same &= p16[2 * i + c] == e16 && q28[2 * i + c] == (int32_t)((uint32_t)x << (29 - bps));
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "FLAC %d bit, LPC 8, %s", bps, same ? "bit exact" : "NOT BIT EXACT");
+        printf("  %-44s %6.0f  %7.0f us  %7.0f us   %.1f / %.1f x MP3\n", label, flac.size() * 8 / secs / 1000,
+               f16 / secs * 1e6, f32 / secs * 1e6, f16 / m16, f32 / m32);
+        exact &= same;
+    }
+    ok &= check(exact, "FLAC at 16 and 24 bit bit exact in both output formats");
+    ok &= check(s16 == 2 * n && s32 == 2 * n, "the MP3 stream decoded in full in both output formats");
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
@@ -0,0 +1,237 @@
+/*
+ * gapless_test.cpp
+ * two local files back to back through Audio::loop(), the next one queued by connecttoFSNext() from
+ * audio_preroll(), against the old handover (audio_eof_mp3() -> connecttoFS())
+ *
+ * WAV and FLAC: the frames carry their index (left a sawtooth, right a hash), the speaker output is walked in
+ * order. Every pairing has to play all frames, none lost, the last frame of A right before the first of B.
+ * MP3 with a LAME tag, an iTunSMPB comment or no gapless info: A and B have to play as the decoder alone
+ * decodes them, trimmed by their encoder delay and padding, and adjacent.
+ * The gap of the old handover is printed only.
+ ************************************************************************************/
+
+#include "harness.h"
+
+static Audio *audio;
+static bool g_gapless;
+static std::string g_next;
+static int g_eof;
+
+void audio_preroll(const char*){
+    if(g_gapless && !g_next.empty()){ audio->connecttoFSNext(SD, g_next.c_str()); g_next = ""; }
+}
+void audio_eof_mp3(const char*){
+    g_eof++;
+    if(audio->isRunning() || g_next.empty()) return;    // gapless: B runs already
+    std::string n = g_next;
+    g_next = "";
+    audio->connecttoFS(SD, n.c_str());
+}
+void audio_info(const char *i){ if(g_verbose) printf("info  %s\n", i); }
+
+//---------------------------------------------------------------------------------------------------------------------
+// test content: frame n of A followed by B
+static int16_t contentL(uint32_t n){ return (int16_t)((n * 7) & 0x7fff) - 16384; }
+static int16_t contentR(uint32_t n){ return (int16_t)((n * 2654435761u) >> 17) - 16384; }
+static Frame   content(uint32_t n){ return {(int32_t)contentL(n) << 16, (int32_t)contentR(n) << 16}; }
+
+static void put16(std::vector<uint8_t> &v, uint32_t x){ v.push_back(x); v.push_back(x >> 8); }
+static void put32(std::vector<uint8_t> &v, uint32_t x){ put16(v, x); put16(v, x >> 16); }
+static void putText(std::vector<uint8_t> &v, const char *t){ v.insert(v.end(), t, t + strlen(t)); }
+
+static void writeFile(const char *name, const std::vector<uint8_t> &d){
+    FILE *f = fopen((std::string(".") + name).c_str(), "wb");
+    fwrite(d.data(), 1, d.size(), f);
+    fclose(f);
+}
+
+static void makeWav(const char *name, uint32_t first, uint32_t n){
+    std::vector<uint8_t> d;
+    putText(d, "RIFF"); put32(d, 36 + n * 4); putText(d, "WAVEfmt ");
+    put32(d, 16); put16(d, 1); put16(d, 2); put32(d, 44100); put32(d, 44100 * 4); put16(d, 4); put16(d, 16);
+    putText(d, "data"); put32(d, n * 4);
+    for(uint32_t i = 0; i < n; i++){ put16(d, (uint16_t)contentL(first + i)); put16(d, (uint16_t)contentR(first + i)); }
+    writeFile(name, d);
+}
+
+static uint8_t crc8(const std::vector<uint8_t> &p){
+    uint8_t c = 0;
+    for(uint8_t b : p){ c ^= b; for(int i = 0; i < 8; i++) c = (c & 0x80) ? (c << 1) ^ 0x07 : c << 1; }
+    return c;
+}
+static uint16_t crc16(const std::vector<uint8_t> &p){
+    uint16_t c = 0;
+    for(uint8_t b : p){ c ^= b << 8; for(int i = 0; i < 8; i++) c = (c & 0x8000) ? (c << 1) ^ 0x8005 : c << 1; }
+    return c;
+}
+
+// FLAC, 44.1 kHz, 16 bit stereo, blocks of 4096 frames (the last one shorter) with verbatim subframes
+static void makeFlac(const char *name, uint32_t first, uint32_t n){
+    std::vector<uint8_t> d;
+    uint8_t si[34] = {0x10, 0x00, 0x10, 0x00};      // block size 4096 .. 4096, frame sizes unknown
+    si[10] = 44100 >> 12; si[11] = (uint8_t)(44100 >> 4); si[12] = ((44100 & 15) << 4) | (1 << 1); si[13] = 15 << 4;
+    si[14] = n >> 24; si[15] = n >> 16; si[16] = n >> 8; si[17] = n;
+    putText(d, "fLaC");
+    d.push_back(0x80); d.push_back(0); d.push_back(0); d.push_back(34);   // STREAMINFO, last metadata block
+    d.insert(d.end(), si, si + 34);
+    for(uint32_t pos = 0, fn = 0; pos < n; pos += 4096, fn++){
+        uint32_t bs = std::min(4096u, n - pos);
+        std::vector<uint8_t> f = {0xFF, 0xF8, (uint8_t)(((bs == 4096 ? 12 : 7) << 4) | 9), (1 << 4) | (4 << 1)};
+        if(fn < 0x80) f.push_back(fn);
+        else{ f.push_back(0xC0 | (fn >> 6)); f.push_back(0x80 | (fn & 0x3F)); }
+        if(bs != 4096){ f.push_back((bs - 1) >> 8); f.push_back(bs - 1); }
+        f.push_back(crc8(f));
+        for(int ch = 0; ch < 2; ch++){
+            f.push_back(0x02);                           // verbatim, no wasted bits
+            for(uint32_t i = 0; i < bs; i++){
+                int16_t v = ch ? contentR(first + pos + i) : contentL(first + pos + i);
+                f.push_back((uint16_t)v >> 8); f.push_back(v);
+            }
+        }
+        uint16_t c = crc16(f);
+        f.push_back(c >> 8); f.push_back(c);
+        d.insert(d.end(), f.begin(), f.end());
+    }
+    writeFile(name, d);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// MP3: the frames of harness.h behind an Info tag with or without the LAME extension, or an ID3v2 iTunSMPB comment
+struct Mp3File { std::vector<uint8_t> data; uint32_t trimStart, trimEnd; };
+enum { LAME, ITUNSMPB, NOINFO };
+
+static std::vector<uint8_t> infoFrame(uint32_t frames, int delay, int padding, bool lame){
+    std::vector<uint8_t> f = {0xFF, 0xFB, 0x90, 0x00};
+    uint32_t bytes = (frames + 1) * FRAMEBYTES;
+    f.resize(4 + 32, 0);                            // side info
+    putText(f, "Info");
+    for(int i = 3; i >= 0; i--) f.push_back(0x0F >> (8 * i));   // frames, bytes, TOC, quality
+    for(int i = 3; i >= 0; i--) f.push_back(frames >> (8 * i));
+    for(int i = 3; i >= 0; i--) f.push_back(bytes >> (8 * i));
+    for(int i = 0; i < 100; i++) f.push_back(i * 256 / 100);
+    for(int i = 0; i < 4; i++) f.push_back(0);
+    if(lame){
+        putText(f, "LAME3.100");
+        for(int i = 0; i < 12; i++) f.push_back(0);
+        f.push_back(delay >> 4); f.push_back(((delay & 15) << 4) | (padding >> 8)); f.push_back(padding);
+    }
+    f.resize(FRAMEBYTES, 0);
+    return f;
+}
+
+static std::vector<uint8_t> id3iTunSMPB(int delay, int padding, uint32_t samples){
+    char txt[160];
+    std::vector<uint8_t> body = {0, 'e', 'n', 'g'}, frame, tag = {'I', 'D', '3', 3, 0, 0};
+    snprintf(txt, sizeof(txt), " 00000000 %08X %08X %016X 00000000 00000000 00000000 00000000", delay, padding, samples);
+    putText(body, "iTunSMPB"); body.push_back(0); putText(body, txt);
+    putText(frame, "COMM");
+    for(int i = 3; i >= 0; i--) frame.push_back(body.size() >> (8 * i));
+    frame.push_back(0); frame.push_back(0);
+    frame.insert(frame.end(), body.begin(), body.end());
+    for(int i = 3; i >= 0; i--) tag.push_back((frame.size() >> (7 * i)) & 127);   // syncsafe size
+    tag.insert(tag.end(), frame.begin(), frame.end());
+    return tag;
+}
+
+// trimStart/trimEnd: the output of the decoder alone that belongs to the track, the tag frame decodes to 1152
+// frames of silence and the decoder delays by 529
+static Mp3File makeMp3(const char *name, uint32_t seed, int frames, int delay, int padding, int kind){
+    Mp3File m;
+    if(kind == ITUNSMPB) m.data = id3iTunSMPB(delay, padding, frames * 1152 - delay - padding);
+    if(kind != NOINFO){
+        std::vector<uint8_t> t = infoFrame(frames, delay, padding, kind == LAME);
+        m.data.insert(m.data.end(), t.begin(), t.end());
+    }
+    for(int i = 0; i < frames; i++){
+        std::vector<uint8_t> f = mp3Frame(seed * 1000 + i);
+        m.data.insert(m.data.end(), f.begin(), f.end());
+    }
+    m.trimStart = kind == NOINFO ? 0 : 1152 + delay + 529;
+    m.trimEnd = kind == NOINFO ? frames * 1152 : m.trimStart + frames * 1152 - delay - padding;
+    writeFile(name, m.data);
+    return m;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+static void play(const char *a, const char *b, bool gapless){
+    g_speaker.clear(); g_dma.clear(); g_events.clear();
+    g_eof = 0; g_gapless = gapless; g_next = b;
+    audio->connecttoFS(SD, a);
+    for(long it = 0; it < 5000000 && g_eof < 2; it++) audio->loop();
+    dmaFlush();
+}
+
+// WAV/FLAC: frames between the last of A and the first of B, frames of content skipped, all played
+static bool playPcm(const char *label, const char *a, const char *b, uint32_t nA, uint32_t nB, bool gapless){
+    long lastA = -1, firstB = -1, lost = 0;
+    size_t w = 0;
+
+    play(a, b, gapless);
+    for(size_t i = 0; i < g_speaker.size() && w < nA + nB; i++){
+        if(g_speaker[i] != content(w)){
+            size_t k = w + 1;                           // content skipped?
+            while(w && k < nA + nB && k < w + 20000 && g_speaker[i] != content(k)) k++;
+            if(!w || k == nA + nB || k == w + 20000) continue;
+            lost += k - w;
+            if(w < nA && k >= nA) lastA = i - 1;
+            w = k;
+        }
+        if(w == nA - 1) lastA = i;
+        if(w == nA) firstB = i;
+        w++;
+    }
+    long gap = firstB - lastA - 1;
+    bool ok = w == nA + nB && !lost && gap == 0;
+    printf("  %-14s %-16s gap %6ld frames (%6.1f ms), %ld frames lost, %s  %s\n", label, gapless ? "gapless" : "eof+connecttoFS",
+           gap, gap / 44.1, lost, w == nA + nB ? "all played" : "NOT ALL PLAYED", gapless ? (ok ? "ok" : "WRONG") : "");
+    return ok || !gapless;
+}
+
+// MP3: A and B as the decoder alone decodes them, trimmed, and adjacent
+static bool playMp3(const char *label, int kindA, int dA, int pA, int kindB, int dB, int pB, bool gapless){
+    Mp3File A = makeMp3("/gap_a.mp3", 1, 60, dA, pA, kindA), B = makeMp3("/gap_b.mp3", 2, 40, dB, pB, kindB);
+    std::vector<Frame> rA = decodeMp3(A.data), rB = decodeMp3(B.data);
+    std::vector<Frame> tA(rA.begin() + A.trimStart, rA.begin() + std::min<size_t>(A.trimEnd, rA.size()));
+    std::vector<Frame> tB(rB.begin() + B.trimStart, rB.begin() + std::min<size_t>(B.trimEnd, rB.size()));
+
+    play("/gap_a.mp3", "/gap_b.mp3", gapless);
+    long pa = findSeq(g_speaker, tA, 0), pb = pa >= 0 ? findSeq(g_speaker, tB, pa + tA.size()) : -1;
+    long gap = (pa >= 0 && pb >= 0) ? pb - (pa + (long)tA.size()) : -1;
+    bool ok = pa >= 0 && pb >= 0 && gap == 0;
+    printf("  %-20s %-16s A %s (%zu frames), B %s (%zu frames), gap %ld frames (%.1f ms)  %s\n", label,
+           gapless ? "gapless" : "eof+connecttoFS", pa >= 0 ? "exact" : "NOT FOUND", tA.size(), pb >= 0 ? "exact" : "NOT FOUND",
+           tB.size(), gap, gap / 44.1, gapless ? (ok ? "ok" : "WRONG") : "");
+    return ok || !gapless;
+}
+
+int main(int argc, char **){
+    const uint32_t nA = 44100 * 2 + 123, nB = 44100 + 77;
+    bool ok = true;
+
+    g_verbose = argc > 1;
+    SD.root = ".";
+    audio = new Audio();
+    makeWav("/gap_a.wav", 0, nA);
+    makeWav("/gap_b.wav", nA, nB);
+    makeFlac("/gap_a.flac", 0, nA);
+    makeFlac("/gap_b.flac", nA, nB);
+
+    printf("WAV and FLAC, every frame identified:\n");
+    ok &= playPcm("wav -> wav",   "/gap_a.wav",  "/gap_b.wav",  nA, nB, false);
+    ok &= playPcm("wav -> wav",   "/gap_a.wav",  "/gap_b.wav",  nA, nB, true);
+    ok &= playPcm("flac -> flac", "/gap_a.flac", "/gap_b.flac", nA, nB, false);
+    ok &= playPcm("flac -> flac", "/gap_a.flac", "/gap_b.flac", nA, nB, true);
+    ok &= playPcm("wav -> flac",  "/gap_a.wav",  "/gap_b.flac", nA, nB, true);
+    ok &= playPcm("flac -> wav",  "/gap_a.flac", "/gap_b.wav",  nA, nB, true);
+
+    printf("MP3, reference = the decoder alone, trimmed by the gapless info:\n");
+    for(int gapless = 0; gapless < 2; gapless++){
+        ok &= playMp3("LAME -> LAME",         LAME,     576, 1000, LAME,     576,  1200, gapless);
+        ok &= playMp3("LAME -> iTunSMPB",     LAME,     576,  700, ITUNSMPB, 1105, 1600, gapless);
+        ok &= playMp3("iTunSMPB -> LAME",     ITUNSMPB, 1105, 1500, LAME,    576,  600,  gapless);
+        ok &= playMp3("no info -> no info",   NOINFO,   0,    0,    NOINFO,  0,    0,    gapless);
+    }
+
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
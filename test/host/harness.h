@@ -0,0 +1,180 @@
+/*
+ * harness.h
+ * the audio library on Linux: the stubs (stubs.cpp, net.cpp), the test stream and the stand-in server
+ *
+ * The test stream is MPEG-1 layer III, 44.1 kHz, 128 kbit/s, stereo, made of crafted frames (Huffman table 1,
+ * no reservoir, no scalefactors) that differ from each other. The reference output is the same stream decoded
+ * by the decoder alone, the output of Audio::loop() must contain it bit exact.
+ ************************************************************************************/
+
+#pragma once
+#include "Audio.h"
+#include "SD.h"
+#include "mp3_decoder.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+typedef std::pair<int32_t, int32_t> Frame;         // left, right as written to I2S
+struct Event { size_t pos; std::string what; };    // I2S and amplifier calls, pos = frames written before
+
+// stubs.cpp
+extern std::vector<Frame> g_speaker;
+extern std::deque<Frame>  g_dma;
+extern std::vector<Event> g_events;
+extern bool     g_verbose, g_psram, g_realtime, g_rtRunning;
+extern int      g_speed, g_nbTry, g_nbFail;
+extern long     g_starved, g_starveEvents;
+extern uint32_t g_rate;
+extern int      g_sdUsPerKB, g_sdStallEvery, g_sdStallMs;
+void dmaFlush();
+void rtDrain();
+
+// net.cpp
+extern const uint8_t *g_mem;
+extern size_t g_memLen, g_memPos, g_memChunk;
+extern long   g_reads, g_readBytes, g_connects, g_dnsAsync;
+extern bool   g_peerClosed;
+int memListener();
+
+static const int FRAMEBYTES = 417;                 // 144 * 128000 / 44100, no padding slot
+
+struct BitWriter {
+    std::vector<uint8_t> b;
+    int n = 0;
+    void put(uint32_t v, int bits){
+        for(int i = bits - 1; i >= 0; i--){
+            if(n % 8 == 0) b.push_back(0);
+            if((v >> i) & 1) b.back() |= 0x80 >> (n % 8);
+            n++;
+        }
+    }
+};
+
+static inline std::vector<uint8_t> mp3Frame(uint32_t seed){
+    BitWriter main, side;
+    int len[2][2], pairs = 32;
+    std::vector<uint8_t> f = {0xFF, 0xFB, 0x90, 0x00};  // MPEG-1 L3, no CRC, 128k, 44.1k, no padding, stereo
+
+    srand(seed);
+    for(int gr = 0; gr < 2; gr++) for(int ch = 0; ch < 2; ch++){
+        int s = main.n;
+        for(int k = 0; k < pairs; k++){            // big values, table 1, x and y in -1..1
+            int x = rand() % 3 - 1, y = rand() % 3 - 1;
+            if(!x && !y) main.put(1, 1);
+            else if(!x)  main.put(1, 3);
+            else if(!y)  main.put(1, 2);
+            else         main.put(0, 3);
+            if(x) main.put(x < 0, 1);
+            if(y) main.put(y < 0, 1);
+        }
+        len[gr][ch] = main.n - s;
+    }
+    side.put(0, 9); side.put(0, 3); side.put(0, 8);    // main_data_begin, private bits, scfsi
+    for(int gr = 0; gr < 2; gr++) for(int ch = 0; ch < 2; ch++){
+        side.put(len[gr][ch], 12); side.put(pairs, 9); side.put(175, 8); side.put(0, 4); side.put(0, 1);
+        side.put(1, 5); side.put(1, 5); side.put(1, 5); side.put(7, 4); side.put(7, 3);
+        side.put(0, 1); side.put(0, 1); side.put(0, 1);
+    }
+    f.insert(f.end(), side.b.begin(), side.b.end());
+    f.insert(f.end(), main.b.begin(), main.b.end());
+    f.resize(FRAMEBYTES, 0);
+    return f;
+}
+
+// n frames, written to stream.mp3 for the server
+static inline std::vector<uint8_t> makeStream(int n){
+    std::vector<uint8_t> s;
+    for(int i = 0; i < n; i++){
+        std::vector<uint8_t> f = mp3Frame(77000 + i);
+        s.insert(s.end(), f.begin(), f.end());
+    }
+    FILE *fp = fopen("stream.mp3", "wb");
+    fwrite(s.data(), 1, s.size(), fp);
+    fclose(fp);
+    return s;
+}
+
+// the decoder alone, I2S words as Audio::Gain32() produces them at full volume
+static inline std::vector<Frame> decodeMp3(const std::vector<uint8_t> &d){
+    static int32_t pcm[2 * 1152];
+    std::vector<Frame> out;
+    size_t pos = 0;
+    auto g = [](int32_t v){
+        if(v > 0x0FFFFFFF)  v = 0x0FFFFFFF;
+        if(v < -0x10000000) v = -0x10000000;
+        return v << 3;
+    };
+
+    MP3Decoder_AllocateBuffers();
+    while(pos + 4 < d.size()){
+        int s = MP3FindSyncWord((unsigned char*)&d[pos], d.size() - pos);
+        if(s < 0) break;
+        pos += s;
+        int left = d.size() - pos;
+        if(MP3Decode32((unsigned char*)&d[pos], &left, pcm, 0)){ pos++; continue; }
+        pos = d.size() - left;
+        for(int i = 0; i < MP3GetOutputSamps() / 2; i++) out.push_back({g(pcm[2 * i]), g(pcm[2 * i + 1])});
+    }
+    MP3Decoder_FreeBuffers();
+    return out;
+}
+
+static inline long findSeq(const std::vector<Frame> &s, const std::vector<Frame> &pat, size_t from){
+    for(size_t i = from; i + pat.size() <= s.size(); i++){
+        if(std::equal(pat.begin(), pat.end(), s.begin() + i)) return i;
+    }
+    return -1;
+}
+
+// compares out from p on with want. A web stream that refills its input buffer stretches a period into a block
+// now and then (Audio::jitterStretch()): the output goes on with want after up to 1024 frames of crossfade,
+// matched by the next 64 frames. Returns the frames of want matched, *ins the frames stretched in
+static inline size_t matchStretched(const std::vector<Frame> &out, size_t p, const std::vector<Frame> &want, long *ins){
+    size_t i = 0;
+    *ins = 0;
+    while(i < want.size() && p < out.size()){
+        if(out[p] == want[i]){ i++; p++; continue; }
+        size_t k = std::min((size_t)64, want.size() - i), j;
+        for(j = 1; j <= 1024 && p + j + k <= out.size(); j++){
+            if(std::equal(want.begin() + i, want.begin() + i + k, out.begin() + p + j)) break;
+        }
+        if(i == 0 || j > 1024 || p + j + k > out.size()) break;
+        *ins += j; p += j;
+    }
+    return i;
+}
+
+// server.py on a free port, serves stream.mp3; returns the port
+static pid_t g_server = 0;
+static inline int startServer(){
+    char line[32] = {0};
+    int p[2];
+
+    if(pipe(p)) return 0;
+    g_server = fork();
+    if(!g_server){
+        dup2(p[1], 1);
+        close(p[0]);
+        execlp("python3", "python3", "server.py", "stream.mp3", (char*)nullptr);
+        _exit(127);
+    }
+    close(p[1]);
+    if(read(p[0], line, sizeof(line) - 1) <= 0) line[0] = 0;  // "ready <port>" once it listens
+    close(p[0]);
+    return strncmp(line, "ready ", 6) ? 0 : atoi(line + 6);
+}
+static inline void stopServer(){
+    if(!g_server) return;
+    kill(g_server, SIGTERM);
+    waitpid(g_server, nullptr, 0);
+    g_server = 0;
+}
+
+static inline double secondsSince(std::chrono::steady_clock::time_point t0){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
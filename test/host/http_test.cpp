@@ -0,0 +1,200 @@
+/*
+ * http_test.cpp
+ * web streams from the stand-in server through Audio::loop(): response header, ICY metadata, chunked
+ * transfer encoding, redirect and playlists
+ *
+ *   http_test          every stream must play bit exact, apart from periods stretched in after an underrun,
+ *                      with the right station name and titles
+ *   http_test bench    parse throughput of http_parser alone and of the header and metadata states of
+ *                      processWebStream(), from memory in 1460 byte reads
+ ************************************************************************************/
+
+#include "harness.h"
+#include "http_parser.h"
+
+static Audio *audio;
+static std::vector<std::string> g_titles;
+static std::string g_station;
+static std::vector<uint8_t> g_stream;
+static std::vector<Frame> g_ref;
+static int g_port;
+
+void audio_showstreamtitle(const char *t){ g_titles.push_back(t); }
+void audio_showstation(const char *s){ g_station = s; }
+void audio_info(const char *i){ if(g_verbose) printf("info  %s\n", i); }
+
+//---------------------------------------------------------------------------------------------------------------------
+// plays path until the server closes (conns = 1) or until the stream has started anew on connection conns + 1
+static bool run(const char *path, const char *expectStation, int nTitles, const char *host = "127.0.0.1", int conns = 1){
+    std::string url = std::string("http://") + host + ":" + std::to_string(g_port) + path;
+    auto   t0 = std::chrono::steady_clock::now();
+    long   c0 = g_connects, idle = 0;
+    size_t last = 0, s1 = 0;
+
+    g_speaker.clear(); g_dma.clear(); g_titles.clear(); g_station = ""; g_peerClosed = false;
+    audio->connecttohost(url.c_str());
+    for(long it = 0; it < 20000000; it++){
+        audio->loop();
+        size_t n = g_speaker.size() + g_dma.size();
+        if(n != last){ last = n; idle = 0; } else idle++;
+        if(g_peerClosed && idle > 50000) break;
+        if(g_connects - c0 > conns && !s1) s1 = n;     // the end of the stream is a lost connection, it starts anew
+        if(s1 && n > s1 + 100 * 1152) break;           // behind the input buffer of the first connection
+    }
+    double secs = secondsSince(t0);
+    audio->stopSong();
+    dmaFlush();
+
+    // all but the last frames, which stay in the input buffer (< 1600 bytes), must be played bit exact
+    std::vector<Frame> want(g_ref.begin(), g_ref.end() - 24 * 1152);
+    long p = findSeq(g_speaker, std::vector<Frame>(want.begin(), want.begin() + 1152), 0);
+    long ins = 0;
+    size_t same = p >= 0 ? matchStretched(g_speaker, p, want, &ins) : 0;
+    bool exact = same == want.size();
+    std::vector<std::string> exp;
+    for(int k = 0; k < nTitles; k += 2){
+        exp.push_back(k == 4 ? "Long " + std::string(300, 'x') : "Artist " + std::to_string(k) + " - Song " + std::to_string(k));
+    }
+    if(g_titles.size() > exp.size() && s1) g_titles.resize(exp.size());   // titles of the second connection
+    bool titles = g_titles == exp;
+    printf("  %-10s station '%s' %s, %zu titles %s, audio %s (%zu frames, %ld stretched), %ld connects, %.2f s\n", path,
+           g_station.c_str(), g_station == expectStation ? "ok" : "WRONG", g_titles.size(), titles ? "ok" : "WRONG",
+           exact ? "bit exact" : "DIFFERS", g_speaker.size(), ins, g_connects - c0, secs);
+    if(!exact && p >= 0) printf("     first difference at frame %zu of %zu (mp3 frame %zu)\n", same, want.size(), same / 1152);
+    if(!exact && p < 0) printf("     start not found\n");
+    if(!titles) for(auto &t : g_titles) printf("     title '%.60s'\n", t.c_str());
+    return exact && titles && g_station == expectStation;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// http_parser alone: 1 MB of header lines, ICY metadata blocks and chunk size lines in 1460 byte reads, best of 20
+static void benchParser(){
+    static HTTPParser_t hp;
+    std::string lines, meta, chunks;
+
+    while(lines.size() < (1 << 20)) lines += "icy-notice2: SHOUTcast DNAS/posix(linux x64) v2.6.0.750<BR>\r\ncontent-type: audio/mpeg\r\n";
+    while(meta.size() < (1 << 20)){
+        std::string t = "StreamTitle='Some Artist - A Somewhat Longer Song Title (Radio Edit)';StreamUrl='http://example.com/cover.jpg';";
+        t.resize((t.size() + 15) / 16 * 16, '\0');
+        meta += (char)(t.size() / 16);
+        meta += t;
+        meta += '\0';                                  // and an empty block
+    }
+    while(chunks.size() < (1 << 20)) chunks += "\r\n1f4;ext=1\r\n";
+
+    for(int kind = 0; kind < 3; kind++){
+        const std::string &d = kind == 0 ? lines : kind == 1 ? meta : chunks;
+        const uint8_t *b = (const uint8_t*)d.data();
+        double best = 1e9;
+        long items = 0;
+        for(int r = 0; r < 20; r++){
+            auto t0 = std::chrono::steady_clock::now();
+            HTTPParserReset(&hp);
+            items = 0;
+            for(size_t pos = 0; pos < d.size(); pos += 1460){
+                int w = std::min<size_t>(1460, d.size() - pos), q = 0;
+                while(q < w){
+                    int32_t sz = -1;
+                    if(kind == 0)      q += HTTPParseLine(&hp, b + pos + q, w - q);
+                    else if(kind == 1) q += HTTPParseMeta(&hp, b + pos + q, w - q);
+                    else               q += HTTPParseChunkSize(&hp, b + pos + q, w - q, &sz);
+                    if(kind < 2 ? hp.complete : sz >= 0) items++;
+                }
+            }
+            best = std::min(best, secondsSince(t0));
+        }
+        printf("  %-22s %7.1f MB/s, %ld items\n", kind == 0 ? "header lines" : kind == 1 ? "ICY metadata blocks" : "chunk size lines",
+               d.size() / best / 1e6, items);
+    }
+
+    for(int c : {17, 500, 7000}){                      // HTTPDechunk in place
+        std::vector<uint8_t> m, w;
+        double best = 1e9;
+        long pay = 0;
+        while(m.size() < (1 << 20)){
+            char h[16];
+            snprintf(h, sizeof(h), "%x\r\n", c);
+            m.insert(m.end(), h, h + strlen(h));
+            m.insert(m.end(), c, 'a');
+            m.push_back('\r'); m.push_back('\n');
+        }
+        for(int r = 0; r < 20; r++){
+            w = m;
+            auto t0 = std::chrono::steady_clock::now();
+            HTTPParserReset(&hp);
+            pay = 0;
+            for(size_t pos = 0; pos < w.size(); pos += 1460) pay += HTTPDechunk(&hp, &w[pos], std::min<size_t>(1460, w.size() - pos));
+            best = std::min(best, secondsSince(t0));
+        }
+        printf("  HTTPDechunk, chunks of %5d bytes: %7.1f MB/s, %ld payload bytes of %zu\n", c, m.size() / best / 1e6, pay, m.size());
+    }
+}
+
+// header and metadata through processWebStream(): loop passes and time spent in these states
+static void benchStream(const char *label){
+    std::string hdr = "ICY 200 OK\r\nicy-notice1: <BR>This stream requires Winamp<BR>\r\n"
+                      "icy-notice2: SHOUTcast DNAS/posix(linux x64) v2.6.0.750<BR>\r\nicy-name: Bench Station\r\nicy-genre: Pop\r\n"
+                      "icy-url: http://example.com\r\ncontent-type: audio/mpeg\r\nicy-pub: 1\r\nicy-metaint:16000\r\nicy-br:128\r\n\r\n";
+    std::vector<uint8_t> m(hdr.begin(), hdr.end());
+    long   loopsHdr = 0, loopsMeta = 0, r0 = g_reads;
+    double usHdr = 0, usMeta = 0;
+    size_t metaBytes = 0;
+    int    blocks = 0;
+
+    for(size_t k = 0; k + 16000 <= g_stream.size(); k += 16000){
+        std::string t = "StreamTitle='Some Artist " + std::to_string(k) +
+                        " - A Somewhat Longer Song Title (Radio Edit)';StreamUrl='http://example.com/cover.jpg';";
+        t.resize((t.size() + 15) / 16 * 16, '\0');
+        m.insert(m.end(), g_stream.begin() + k, g_stream.begin() + k + 16000);
+        m.push_back(t.size() / 16);
+        m.insert(m.end(), t.begin(), t.end());
+        metaBytes += t.size() + 1;
+        blocks++;
+    }
+    g_mem = m.data(); g_memLen = m.size(); g_memPos = 0; g_memChunk = 1460;
+    g_speaker.clear(); g_dma.clear(); g_titles.clear();
+    audio->connecttohost(("http://127.0.0.1:" + std::to_string(memListener()) + "/bench").c_str());
+    while(g_memPos < g_memLen){
+        uint8_t dm = audio->getDatamode();
+        auto t0 = std::chrono::steady_clock::now();
+        audio->loop();
+        double us = secondsSince(t0) * 1e6;
+        if(dm == AUDIO_HEADER)  { loopsHdr++;  usHdr += us; }
+        if(dm == AUDIO_METADATA){ loopsMeta++; usMeta += us; }
+    }
+    audio->stopSong();
+    g_mem = nullptr;
+    printf("  %-8s header %zu bytes: %5ld loop passes %7.1f us, metadata %d blocks %zu bytes: %5ld loop passes %7.1f us (%.2f MB/s), %ld reads in all\n",
+           label, hdr.size(), loopsHdr, usHdr, blocks, metaBytes, loopsMeta, usMeta, metaBytes / usMeta, g_reads - r0);
+}
+
+int main(int argc, char **argv){
+    bool ok = true;
+
+    g_verbose = argc > 1 && !strcmp(argv[1], "-v");
+    g_stream = makeStream(300);
+    g_ref = decodeMp3(g_stream);
+    audio = new Audio();
+
+    if(argc > 1 && !strcmp(argv[1], "bench")){
+        printf("http_parser, 1460 byte reads:\n");
+        benchParser();
+        printf("processWebStream, 1460 byte reads:\n");
+        for(int r = 0; r < 3; r++) benchStream(r ? "" : "warmup");
+        benchStream("bench");
+        return 0;
+    }
+
+    g_port = startServer();
+    if(!g_port){ printf("server.py did not start\n"); return 1; }
+    int nTitles = g_stream.size() / 8192;
+    ok &= run("/icy",      "Test Station",    nTitles);
+    ok &= run("/chunked",  "Chunked Station", nTitles, "localhost");
+    ok &= run("/redir",    "Test Station",    nTitles, "127.0.0.1", 2);
+    ok &= run("/list.m3u", "Test Station",    nTitles, "127.0.0.1", 2);
+    ok &= run("/list.pls", "Chunked Station", nTitles, "127.0.0.1", 2);
+    printf("  %ld asynchronous DNS lookups\n", g_dnsAsync);
+    stopServer();
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
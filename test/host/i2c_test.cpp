@@ -0,0 +1,89 @@
+/*
+ * i2c_test.cpp
+ * tas5753md.cpp and LCD rows through the I2C queue (i2c.cpp), 2 ms per transaction so that a backlog builds up
+ *
+ * Five LCD rows and 20 encoder steps are queued, then the amplifiers are muted. Checked: both mutes go out
+ * right behind the transaction on the bus and tas5753md_mute() returns when they are done, the volume steps
+ * reach each amplifier as one write of the last value, the LCD transfers keep their order, a read returns the
+ * byte read.
+ ************************************************************************************/
+
+#include "board.h"
+#include "i2c.h"
+#include "tas5753md.h"
+
+static const uint8_t LCD = 0x3E;
+
+static bool check(bool ok, const char *what){
+    printf("  %-66s %s\n", what, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+static long find(const std::vector<BusTx> &bus, const char *text){
+    for(size_t i = 0; i < bus.size(); i++) if(busText(bus[i]) == text) return i;
+    return -1;
+}
+
+int main(int argc, char **){
+    bool ok = true;
+    std::vector<BusTx> bus;
+    I2C_STATS st[I2C_MAX_DEVICES];
+    uint8_t row[16];
+
+    g_verbose = argc > 1;
+    i2c_begin(0, 0);
+    ok &= check(i2c_readByte(TAS5753MD_I2C_ADDR_0, TAS5753MD_REG_DEVICE_ID) == 0x41, "a read returns the byte read");
+    bus = busTake();
+    ok &= check(bus.size() == 1 && busText(bus[0]) == "2A? 01", "as one transaction");
+    tas5753md_powerUp();
+    ok &= check(tas5753md_configDevice(0) == 1 && tas5753md_configDevice(1) == 1, "both amplifiers configured");
+    busTake();
+
+    g_busUs = 2000;
+    for(int i = 0; i < 16; i++) row[i] = 'a' + i;
+    for(int i = 0; i < 5; i++){                    // the queue holds 16, 10 LCD + 2 volume + 2 mute fit
+        uint8_t cmd = 0x80 + i;
+        row[0] = '0' + i;
+        i2c_post(I2C_PRIO_LCD, LCD, 0x80, &cmd, 1, 0);
+        if(i == 0) sleepMs(1);                     // the first address is on the bus
+        i2c_post(I2C_PRIO_LCD, LCD, 0x40, row, 16, 0);
+    }
+    for(int i = 0; i < 20; i++) tas5753md_adjustVolume(1);    // 0x180 -> 0x130
+    unsigned long t = micros();
+    tas5753md_mute();
+    t = micros() - t;
+    bus = busTake();
+    size_t doneAtMute = bus.size();
+    sleepMs(100);
+    std::vector<BusTx> rest = busTake();
+    bus.insert(bus.end(), rest.begin(), rest.end());
+    for(const BusTx &b : bus) if(g_verbose) printf("     %s\n", busText(b).c_str());
+
+    printf("  mute returned after %lu us, %zu transactions on the bus by then\n", t, doneAtMute);
+    ok &= check(doneAtMute == 3, "tas5753md_mute() returns when both mutes are done");
+    ok &= check(find(bus, "2A: 05 40") == 1 && find(bus, "2B: 05 40") == 2,
+                "both mutes go out right behind the LCD transfer on the bus");
+    ok &= check(find(bus, "2A: 07 01 30") == 3 && find(bus, "2B: 07 01 30") == 4,
+                "then one volume write per amplifier, the last value");
+
+    std::vector<std::string> lcd, posted;
+    for(const BusTx &b : bus) if(b.dev == LCD) lcd.push_back(busText(b).substr(0, 9));
+    for(int i = 0; i < 5; i++){
+        char a[16], d[16];
+        snprintf(a, sizeof(a), "3E: 80 %02X", 0x80 + i);
+        snprintf(d, sizeof(d), "3E: 40 %02X", '0' + i);
+        posted.push_back(a);
+        posted.push_back(d);
+    }
+    ok &= check(lcd == posted && find(bus, "3E: 40 30 62 63 64 65 66 67 68 69 6A 6B 6C 6D 6E 6F 70") == 5,
+                "the LCD transfers keep their order, each address before its row");
+
+    i2c_getStats(st);
+    for(int i = 0; i < I2C_MAX_DEVICES; i++){
+        if(st[i].addr == TAS5753MD_I2C_ADDR_0) ok &= check(st[i].coalesced == 19, "19 of the 20 volume steps were coalesced");
+    }
+    if(g_verbose) i2c_report([](const char *l){ puts(l); });
+
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
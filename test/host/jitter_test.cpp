@@ -0,0 +1,83 @@
+/*
+ * jitter_test.cpp
+ * web streams in real time: the stand-in server sends at the stream rate, the DMA model plays at the sample rate
+ * and counts the silence when it runs dry
+ *
+ *   jitter_test          input buffer in RAM
+ *   jitter_test psram    input buffer in PSRAM
+ *
+ * /smooth and /burst must play without underrun, /jitter (stalls of up to 2 s) too if the buffer is in PSRAM.
+ * With the small RAM buffer the underruns of /jitter are reported only. What plays has to be the decoded stream
+ * bit exact, apart from the periods stretched in while the buffer fills.
+ ************************************************************************************/
+
+#include "harness.h"
+
+static Audio *audio;
+static int g_port;
+static std::vector<Frame> g_ref;
+
+void audio_info(const char *i){ if(g_verbose) printf("     %6lu %s\n", millis(), i); }
+
+// plays path until the server has sent the whole stream and the buffer has run empty, returns the underruns,
+// *exact whether the output is the stream
+static uint16_t runPaced(const char *path, bool *exact){
+    std::string url = "http://127.0.0.1:" + std::to_string(g_port) + path;
+    auto     t0 = std::chrono::steady_clock::now();
+    double   tFirst = -1;
+    uint16_t lastU = 0;
+    long     c0 = g_connects;
+
+    g_speaker.clear(); g_dma.clear(); g_starved = g_starveEvents = 0; g_rtRunning = false;
+    audio->connecttohost(url.c_str());
+    while(true){
+        audio->loop();
+        rtDrain();
+        usleep(20);                                    // about 40000 loop passes per second like the ESP32
+        double t = secondsSince(t0);
+        if(tFirst < 0 && g_rtRunning) tFirst = t;
+        if(audio->getUnderruns() != lastU){
+            lastU = audio->getUnderruns();
+            printf("     %5.2f s underrun %u\n", t, lastU);
+        }
+        if(g_peerClosed && audio->inBufferFilled() < 1700) break;
+        if(g_connects - c0 > 1) break;                 // reconnect behind the end of the stream
+        if(t > 60) break;
+    }
+    printf("  %-8s first sample %4.0f ms, start latency %4u ms, %u underruns, %ld output gaps, %.0f ms of silence, %zu frames played\n",
+           path, tFirst * 1e3, audio->getStartLatency(), audio->getUnderruns(), g_starveEvents, g_starved * 1000.0 / g_rate,
+           g_speaker.size());
+    lastU = audio->getUnderruns();
+    audio->stopSong();
+
+    // the silence of an underrun is no part of the stream, the last frames stay in the input buffer or are lost
+    // with the reconnect behind the end of the stream
+    std::vector<Frame> out, want(g_ref.begin(), g_ref.end() - 24 * 1152);
+    for(const Frame &f : g_speaker) if(f.first != 0x7fffffff) out.push_back(f);
+    long p = findSeq(out, std::vector<Frame>(want.begin(), want.begin() + 1152), 0), ins = 0;
+    size_t same = p >= 0 ? matchStretched(out, p, want, &ins) : 0;
+    *exact = p >= 0 && (same == want.size() || p + ins + same == out.size());     // the stream or what of it played
+    printf("           audio %s, %ld frames (%.0f ms) stretched in\n", *exact ? "bit exact" : "DIFFERS", ins, ins * 1000.0 / g_rate);
+    if(!*exact && p >= 0) printf("           first difference at frame %zu of %zu\n", same, want.size());
+    return lastU;
+}
+
+int main(int argc, char **argv){
+    bool ok = true, exact;
+
+    g_psram = argc > 1 && !strcmp(argv[1], "psram");
+    g_verbose = argc > 2;
+    g_realtime = true;
+    g_ref = decodeMp3(makeStream(800));                // 21 s
+    audio = new Audio();
+    g_port = startServer();
+    if(!g_port){ printf("server.py did not start\n"); return 1; }
+    printf("input buffer in %s:\n", g_psram ? "PSRAM" : "RAM");
+    ok &= runPaced("/smooth", &exact) == 0 && exact;
+    if(runPaced("/jitter", &exact) && g_psram) ok = false;
+    ok &= exact;
+    ok &= runPaced("/burst", &exact) == 0 && exact;
+    stopServer();
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
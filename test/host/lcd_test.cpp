@@ -0,0 +1,96 @@
+/*
+ * lcd_test.cpp
+ * lcdST7032.cpp through the I2C queue (i2c.cpp) to the bus model of board.cpp, the ST7032 DDRAM rebuilt from
+ * the transactions
+ *
+ * Checked: what the display shows after the splash, a new title, a changed cell and while scrolling, and the
+ * transactions it takes: two per changed row, none for a frame that did not change.
+ ************************************************************************************/
+
+#include "board.h"
+#include "i2c.h"
+#include "lcdST7032.h"
+
+static char s_ddram[128];
+static int  s_ac = 0;                              // address counter
+
+// apply the LCD transactions since the last call to the DDRAM, returns their number
+static int lcdTake(){
+    int n = 0;
+    for(const BusTx &t : busTake()){
+        if(t.dev != Write_Address || t.bytes.size() < 2) continue;
+        n++;
+        if(t.bytes[0] == CNTRBIT_CO){
+            uint8_t c = t.bytes[1];
+            if(c & SET_DDRAM_ADDRESS) s_ac = c & 0x7F;
+            else if(c == CLEAR_DISPLAY){ memset(s_ddram, ' ', sizeof(s_ddram)); s_ac = 0; }
+        }
+        else if(t.bytes[0] == CNTRBIT_RS){
+            for(size_t i = 1; i < t.bytes.size(); i++) s_ddram[s_ac++ & 0x7F] = t.bytes[i];
+        }
+    }
+    return n;
+}
+
+// both rows as one string
+static std::string shows(){
+    return std::string(s_ddram, LCD_COLS) + std::string(s_ddram + (LINE_2_ADR & 0x7F), LCD_COLS);
+}
+
+static bool check(bool ok, const char *what){
+    printf("  %-66s %s\n", what, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+int main(int argc, char **){
+    bool ok = true;
+    const std::string title = "A very long artist name - and an even longer title.mp3";
+    int n;
+
+    g_verbose = argc > 1;
+    i2c_begin(0, 0);
+    lcd_begin();
+    lcdTake();
+
+    lcd_printf(0, 0, (char*)"ESP32 FPGA-xover");
+    lcd_printf(1, 0, (char*)"Audio I2S player");
+    sleepMs(120);
+    n = lcdTake();
+    printf("  splash: |%s| %d transactions\n", shows().c_str(), n);
+    ok &= check(shows() == "ESP32 FPGA-xoverAudio I2S player" && n == 4, "the splash, two transactions per row");
+
+    lcd_printScreen((char*)"%s", "Short song.mp3");
+    sleepMs(120);
+    n = lcdTake();
+    ok &= check(shows() == "Short song.mp3                  " && n == 4, "a new title replaces both rows");
+
+    lcd_printf(1, 12, (char*)"x");
+    sleepMs(120);
+    n = lcdTake();
+    ok &= check(shows() == "Short song.mp3              x   " && n == 2, "one changed cell takes two transactions");
+
+    sleepMs(200);
+    ok &= check(lcdTake() == 0, "a frame that did not change sends nothing");
+
+    // LCD_SCROLL_HOLD steps stand still, the next one moves by a character
+    unsigned long t0 = millis();
+    lcd_printScreen((char*)"%s", title.c_str());
+    sleepMs(LCD_SCROLL_HOLD*LCD_SCROLL_MS + LCD_SCROLL_MS/2 - (millis() - t0));
+    lcdTake();
+    ok &= check(shows() == title.substr(0, 32), "a long title starts at its first character and holds");
+    sleepMs(LCD_SCROLL_MS);
+    n = lcdTake();
+    printf("  scroll: |%s| %d transactions\n", shows().c_str(), n);
+    ok &= check(shows() == title.substr(1, 32) && n == 4, "then it scrolls by one character");
+    sleepMs(2*LCD_SCROLL_MS);
+    lcdTake();
+    ok &= check(shows() == title.substr(3, 32), "and one more every LCD_SCROLL_MS");
+
+    lcd_printScreen((char*)"%s", "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789");
+    sleepMs(120);
+    lcdTake();
+    ok &= check(shows() == "0123456789abcdefghijklmnopqrstuv", "a title longer than LCD_TEXT_MAX is cut, not overrun");
+
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
@@ -0,0 +1,146 @@
+/*
+ * mp3_snr.cpp
+ * the MP3 synthesis (FDCT32 + polyphase window, Subband()) with 16 bit and Q28 output against a double precision
+ * model of the same filterbank
+ *
+ * The model is the filterbank as a linear system: the impulse response of every subband is measured through the
+ * Q28 path with a large impulse (relative error about 1e-9) and the input blocks are superposed in double. The
+ * subband samples come from a cosine modulated analysis of the test signal, scaled so that the output peaks at
+ * the level of the signal. mp3_decoder.cpp is included for Subband() and the decoder state.
+ *
+ * Checked: the SNR of both outputs is not below the table of the Q28 change, mono and stereo output agree
+ ************************************************************************************/
+
+#include "mp3_decoder.cpp"
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+static const int SCALE_BITS = 8;                   // subband samples in outBuf: PCM units << SCALE_BITS
+static double H[2][32][512];                       // impulse responses of the even and the odd block
+
+// the signals of the table, 16 bit full scale = 32768
+static std::vector<double> signal(int kind, int n){
+    std::vector<double> x(n);
+    for(int i = 0; i < n; i++){
+        double t = i / 44100.0;
+        switch(kind){
+        case 0: x[i] = 0.89 * 32768 * (0.4 * sin(2 * M_PI * 220 * t) + 0.3 * sin(2 * M_PI * 1870 * t + 1) +
+                                       0.2 * sin(2 * M_PI * 5300 * t + 2) + 0.1 * sin(2 * M_PI * 11000 * t + 3)); break;
+        case 1: x[i] = 32768 * pow(10, -40 / 20.0) * sin(2 * M_PI * 1000 * t); break;
+        case 2: x[i] = 32768 * pow(10, -70 / 20.0) * sin(2 * M_PI * 1000 * t); break;
+        case 3: x[i] = 32768 * pow(10, 2 / 20.0) * sin(2 * M_PI * 440 * t); break;     // overshoots full scale
+        }
+    }
+    return x;
+}
+
+// Subband() on every granule of sb, out = channel 0 * scale, returns the time per granule
+template <typename pcm_t> static double runDec(const std::vector<int> &sb, int nChans, std::vector<double> &out, double scale){
+    static pcm_t pcm[2 * 576];
+    int nGr = sb.size() / 576;
+    double t = 0;
+    MP3Decoder_AllocateBuffers();
+    MP3Decoder_ClearBuffer();
+    m_MP3DecInfo->nChans = nChans;
+    for(int g = 0; g < nGr; g++){
+        int m = 0;
+        for(int b = 0; b < 18; b++) for(int k = 0; k < 32; k++){
+            int v = sb[g * 576 + b * 32 + k];
+            m |= abs(v);
+            for(int ch = 0; ch < nChans; ch++) m_IMDCTInfo->outBuf[ch][b][k] = v;
+        }
+        for(int ch = 0; ch < nChans; ch++) m_IMDCTInfo->gb[ch] = m ? __builtin_clz(m) - 1 : 31;
+        auto t0 = std::chrono::steady_clock::now();
+        Subband(pcm);
+        t += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        for(int i = 0; i < 576; i++) out.push_back(pcm[i * nChans] * scale);
+        if(nChans == 2) for(int i = 0; i < 576; i++) if(pcm[2 * i] != pcm[2 * i + 1]) out[out.size() - 576 + i] = NAN;
+    }
+    MP3Decoder_FreeBuffers();
+    return t / nGr;
+}
+
+static void impulseResponses(){
+    const int A = 1 << 22;
+    for(int par = 0; par < 2; par++) for(int k = 0; k < 32; k++){
+        std::vector<int> sb(3 * 576, 0);
+        std::vector<double> y;
+        sb[par * 32 + k] = A;
+        runDec<int32_t>(sb, 1, y, 1.0 / (1 << 13));
+        for(int n = 0; n < 512; n++) H[par][k][n] = y[par * 32 + n] / ((double)A / (1 << SCALE_BITS));
+    }
+}
+
+static void synthRef(const std::vector<int> &sb, std::vector<double> &ref){
+    int nBlk = sb.size() / 32;
+    ref.assign(nBlk * 32, 0);
+    for(int b = 0; b < nBlk; b++) for(int k = 0; k < 32; k++){
+        double v = (double)sb[b * 32 + k] / (1 << SCALE_BITS);
+        if(!v) continue;
+        for(int n = 0; n < 512 && b * 32 + n < nBlk * 32; n++) ref[b * 32 + n] += v * H[0][k][n];
+    }
+}
+
+// 32 new samples in, 32 subband samples out: cosine modulated, 512 tap sine window
+struct Analysis {
+    double X[512] = {0};
+    void run(const double *in, double *S){
+        memmove(X + 32, X, 480 * sizeof(double));
+        for(int i = 0; i < 32; i++) X[i] = in[31 - i];
+        for(int k = 0; k < 32; k++){
+            double s = 0;
+            for(int i = 0; i < 512; i++) s += X[i] * sin(M_PI * (i + 0.5) / 512) * cos((2 * k + 1) * (i - 16) * M_PI / 64);
+            S[k] = s / 128;
+        }
+    }
+};
+
+static double snr(const std::vector<double> &ref, const std::vector<double> &y){
+    double s = 0, e = 0;
+    for(size_t i = 1152; i < ref.size(); i++){ s += ref[i] * ref[i]; e += (y[i] - ref[i]) * (y[i] - ref[i]); }
+    return 10 * log10(s / e);
+}
+
+int main(){
+    struct { const char *name; double snr16, snr28; } table[] = {   // dB, the table of the Q28 change
+        {"multitone -1 dBFS", 92.3, 106.0}, {"1 kHz -40 dBFS", 57.8, 72.4},
+        {"1 kHz -70 dBFS",    28.2,  43.2}, {"440 Hz +2 dBFS", 18.0, 107.7}};
+    const int nGr = 80;
+    bool ok = true;
+
+    impulseResponses();
+    printf("MP3 synthesis                16 bit       Q28   Subband() per stereo granule\n");
+    for(int kind = 0; kind < 4; kind++){
+        std::vector<double> x = signal(kind, nGr * 576), S(nGr * 576), ref;
+        std::vector<int> sb(nGr * 576);
+        Analysis an;
+        for(int blk = 0; blk < nGr * 18; blk++) an.run(&x[blk * 32], &S[blk * 32]);
+        double gain = 1;
+        for(int it = 0; it < 2; it++){
+            double px = 0, pr = 0;
+            for(size_t i = 0; i < S.size(); i++) sb[i] = (int)lrint(S[i] * gain * (1 << SCALE_BITS));
+            synthRef(sb, ref);
+            for(size_t i = 1152; i < ref.size(); i++){ px = std::max(px, fabs(x[i])); pr = std::max(pr, fabs(ref[i])); }
+            gain *= px / pr;
+        }
+        std::vector<double> y16, y32, y16s, y32s, d;
+        runDec<short>(sb, 1, y16, 1.0);
+        runDec<int32_t>(sb, 1, y32, 1.0 / (1 << 13));
+        double t16 = runDec<short>(sb, 2, y16s, 1.0), t32 = runDec<int32_t>(sb, 2, y32s, 1.0 / (1 << 13));
+        for(int r = 0; r < 30; r++){                   // best of 30
+            d.clear(); t16 = std::min(t16, runDec<short>(sb, 2, d, 1.0));
+            d.clear(); t32 = std::min(t32, runDec<int32_t>(sb, 2, d, 1.0));
+        }
+        double s16 = snr(ref, y16), s32 = snr(ref, y32);
+        bool same = y16 == y16s && y32 == y32s;
+        bool good = same && s16 >= table[kind].snr16 - 0.1 && s32 >= table[kind].snr28 - 0.1;
+        printf("  %-22s %6.1f dB %6.1f dB   %5.2f / %5.2f us  %s\n", table[kind].name, s16, s32, t16 * 1e6, t32 * 1e6,
+               good ? "ok" : same ? "WRONG" : "WRONG, mono and stereo differ");
+        ok &= good;
+    }
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
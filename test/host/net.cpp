@@ -0,0 +1,161 @@
+/*
+ * net.cpp
+ * WiFiClient and the lwIP resolver on Linux
+ *
+ * A client is a non-blocking TCP socket to the local stand-in server (server.py), or, while g_mem is set, a
+ * memory buffer that is read in pieces of g_memChunk bytes like TCP segments (benchmarks). Names other than
+ * address literals are resolved after 30 ms from another thread like the lwIP tcpip thread does, "localhost"
+ * is found, every other name is not.
+ ************************************************************************************/
+
+#include "harness.h"
+#include "WiFiClientSecure.h"
+#include "lwip/dns.h"
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <map>
+#include <thread>
+
+static const int MEM_SOCKET = -2;
+
+struct Sock { int fd; bool closed; };
+static std::map<const void*, Sock> g_socks;        // client -> socket, closed: the peer has closed it
+const uint8_t *g_mem = nullptr;
+size_t g_memLen = 0, g_memPos = 0, g_memChunk = 1460;
+long   g_reads = 0, g_readBytes = 0, g_connects = 0, g_dnsAsync = 0;
+bool   g_peerClosed = false;
+
+int WiFiClient::connect(const char *host, uint16_t port){
+    sockaddr_in a{};
+    int fd;
+
+    g_connects++;
+    g_peerClosed = false;
+    if(g_mem){ g_memPos = 0; g_socks[this] = {MEM_SOCKET, false}; return 1; }
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    inet_pton(AF_INET, strcmp(host, "localhost") ? host : "127.0.0.1", &a.sin_addr);
+    if(::connect(fd, (sockaddr*)&a, sizeof(a))){ ::close(fd); return 0; }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    g_socks[this] = {fd, false};
+    return 1;
+}
+int WiFiClient::connect(IPAddress, uint16_t){ return 0; }
+
+// the socket of a non-blocking connect is handed to the client, operator= takes it over from the temporary
+WiFiClient::WiFiClient(int fd){
+    g_connects++;
+    g_peerClosed = false;
+    if(g_mem){ ::close(fd); g_memPos = 0; g_socks[this] = {MEM_SOCKET, false}; return; }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    g_socks[this] = {fd, false};
+}
+WiFiClient &WiFiClient::operator=(const WiFiClient &o){
+    if(&o == this) return *this;
+    stop();
+    auto it = g_socks.find(&o);
+    if(it != g_socks.end()){
+        g_socks[this] = it->second;
+        g_socks.erase(it);
+    }
+    return *this;
+}
+
+void WiFiClient::stop(){
+    auto it = g_socks.find(this);
+    if(it == g_socks.end()) return;
+    if(it->second.fd >= 0) ::close(it->second.fd);
+    g_socks.erase(it);
+}
+void WiFiClient::flush(){}
+void WiFiClient::setNoDelay(bool){}
+bool WiFiClient::connected(){
+    auto it = g_socks.find(this);
+    return it != g_socks.end() && !it->second.closed;
+}
+
+int WiFiClient::available(){
+    auto it = g_socks.find(this);
+    int n = 0;
+    if(it == g_socks.end()) return 0;
+    if(it->second.fd == MEM_SOCKET) return std::min(g_memLen - g_memPos, g_memChunk);
+    ioctl(it->second.fd, FIONREAD, &n);
+    return n;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size){
+    auto it = g_socks.find(this);
+    if(it == g_socks.end()) return -1;
+    g_reads++;
+    if(it->second.fd == MEM_SOCKET){
+        size_t r = std::min(std::min(g_memLen - g_memPos, g_memChunk), size);
+        memcpy(buf, g_mem + g_memPos, r);
+        g_memPos += r;
+        g_readBytes += r;
+        return r;
+    }
+    ssize_t n = recv(it->second.fd, buf, size, MSG_DONTWAIT);
+    if(n == 0 && size) it->second.closed = g_peerClosed = true;   // recv() of 0 bytes returns 0 too
+    if(n <= 0) return 0;
+    g_readBytes += n;
+    return n;
+}
+int WiFiClient::read(){
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+size_t WiFiClient::write(const uint8_t *b, size_t n){
+    auto it = g_socks.find(this);
+    if(it == g_socks.end() || it->second.fd < 0) return 0;
+    return send(it->second.fd, b, n, 0);
+}
+size_t Print::print(const String &s){
+    auto it = g_socks.find(this);
+    if(it != g_socks.end() && it->second.fd >= 0) return send(it->second.fd, s.c_str(), s.length(), 0);
+    if(g_verbose) fputs(s.c_str(), stdout);
+    return s.length();
+}
+
+err_t dns_gethostbyname(const char *name, ip_addr_t *addr, dns_found_callback cb, void *arg){
+    in_addr a;
+    if(inet_pton(AF_INET, name, &a) == 1){ addr->addr = a.s_addr; return ERR_OK; }
+    std::string n = name;
+    g_dnsAsync++;
+    std::thread([n, cb, arg]{
+        ip_addr_t ip;
+        usleep(30000);
+        inet_pton(AF_INET, "127.0.0.1", &ip.addr);
+        cb(n.c_str(), n == "localhost" ? &ip : nullptr, arg);
+    }).detach();
+    return ERR_INPROGRESS;
+}
+
+// listening socket for the memory streams, the kernel completes the connect, nobody reads from it
+int memListener(){
+    static int port = 0;
+    sockaddr_in a{};
+    socklen_t l = sizeof(a);
+    int fd;
+
+    if(port) return port;
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    a.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &a.sin_addr);
+    bind(fd, (sockaddr*)&a, sizeof(a));
+    listen(fd, 128);
+    getsockname(fd, (sockaddr*)&a, &l);
+    port = ntohs(a.sin_port);
+    std::thread([fd]{
+        while(true){
+            int c = accept(fd, nullptr, nullptr);
+            if(c >= 0) ::close(c);
+        }
+    }).detach();
+    return port;
+}
@@ -0,0 +1,87 @@
+/*
+ * reconnect_test.cpp
+ * connections that fail: a live stream that is cut three times and then is down, a port that refuses
+ * and a host name that is not found
+ *
+ *   reconnect_test          input buffer in RAM
+ *   reconnect_test psram    input buffer in PSRAM
+ *
+ * /drop must reconnect every time and play again at the end; with PSRAM it must play on from the input buffer
+ * without underrun. Refused and unknown hosts must be given up after the retries, and no loop() pass may block
+ * while the connection is tried.
+ ************************************************************************************/
+
+#include "harness.h"
+
+static Audio *audio;
+static int g_port;
+
+void audio_info(const char *i){
+    if(g_verbose || strstr(i, "try") || strstr(i, "lost") || strstr(i, "failed")) printf("     %6lu %s\n", millis(), i);
+}
+
+// the live stream for 24 s in real time, the last second must be played from the stream
+static bool runDrop(){
+    std::string url = "http://127.0.0.1:" + std::to_string(g_port) + "/drop";
+    auto t0 = std::chrono::steady_clock::now();
+    long c0 = g_connects, gapsAtStart = -1;
+
+    g_speaker.clear(); g_dma.clear(); g_starved = g_starveEvents = 0; g_rtRunning = false;
+    audio->connecttohost(url.c_str());
+    while(secondsSince(t0) < 24){
+        audio->loop();
+        rtDrain();
+        usleep(20);                                    // about 40000 loop passes per second like the ESP32
+        if(gapsAtStart < 0 && audio->getStartLatency()) gapsAtStart = g_starveEvents;
+    }
+    long connects = g_connects - c0;
+    uint16_t underruns = audio->getUnderruns();
+    bool playing = g_speaker.size() > g_rate, sound = false;
+    for(size_t i = g_speaker.size() - g_rate; playing && i < g_speaker.size(); i++){
+        if(g_speaker[i].first == 0x7fffffff) playing = false;  // the DMA ran empty
+        if(g_speaker[i].first || g_speaker[i].second) sound = true;
+    }
+    printf("  /drop    %ld connects, start latency %u ms, %u underruns, %ld output gaps while playing, %.0f ms of silence, %s at the end\n",
+           connects, audio->getStartLatency(), underruns, g_starveEvents - gapsAtStart, g_starved * 1000.0 / g_rate,
+           playing && sound ? "playing" : "NOT PLAYING");
+    audio->stopSong();
+    if(connects < 7 || !playing || !sound) return false;   // 3 cuts, 3 refused, playing again
+    return underruns == 0 || !g_psram;                 // the RAM buffer does not bridge the time the server is down
+}
+
+// until the client gives up, the longest loop() pass
+static bool runFail(const char *url){
+    auto   t0 = std::chrono::steady_clock::now();
+    double worst = 0;
+    long   loops = 0;
+
+    audio->connecttohost(url);
+    while(audio->isRunning() && secondsSince(t0) < 30){
+        auto a = std::chrono::steady_clock::now();
+        audio->loop();
+        worst = std::max(worst, secondsSince(a));
+        loops++;
+    }
+    double secs = secondsSince(t0);
+    printf("  %-22s given up after %.2f s, %ld loop passes, longest %.2f ms\n", url, secs, loops, worst * 1e3);
+    return !audio->isRunning() && worst < 0.05;
+}
+
+int main(int argc, char **argv){
+    bool ok = true;
+
+    g_psram = argc > 1 && !strcmp(argv[1], "psram");
+    g_verbose = argc > 2;
+    makeStream(1000);                                  // 26 s
+    audio = new Audio();
+    g_port = startServer();
+    if(!g_port){ printf("server.py did not start\n"); return 1; }
+    printf("input buffer in %s:\n", g_psram ? "PSRAM" : "RAM");
+    ok &= runFail("http://127.0.0.1:1/x");             // nobody listens on port 1
+    ok &= runFail("http://nosuch.host/x");             // net.cpp finds localhost only
+    g_realtime = true;
+    ok &= runDrop();
+    stopServer();
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
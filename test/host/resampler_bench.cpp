@@ -0,0 +1,114 @@
+/*
+ * resampler_bench.cpp
+ * the sample rate converter (resampler.cpp) with tones across the passband, every preset and rate pair
+ *
+ * The tones lie on a 10 Hz grid and the output is taken over one period of it (outRate / 10 frames, settled), so
+ * the DFT of that period is exact: the tone bin gives the gain, every other bin is error. The images of a tone at
+ * f lie at k * inRate +- f folded into the output band, on the grid of gcd(inRate, outRate); the worst of them
+ * relative to the tone over the passband is the image figure. SNR is the tone against all the rest.
+ *
+ * Checked: at 44.1 -> 48 kHz taps, passband (-0.1 dB), images and coefficient memory as the presets of
+ * resampler.h state, every pair flat within 0.1 dB up to its edge
+ ************************************************************************************/
+
+#include "resampler.h"
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+static const double A = (1 << 28) * 0.5;            // -6 dBFS
+static bool g_verbose;
+
+struct Tone { double gain, snr, image; };
+
+// a tone at f through the SRC, the DFT of one settled period of the output; images only when asked for
+static Tone tone(int f, int in, int out, bool images){
+    const int N = out / 10, skip = out / 4, nIn = (int)((int64_t)(skip + N + 8) * in / out) + 1;
+    static std::vector<double> y, c, s;
+    int32_t x[2], o[2 * SRC_MAX_OUT];
+    Tone t = {0, 0, 0};
+
+    y.clear();
+    SRCClearHistory();
+    for(int i = 0; i < nIn; i++){
+        x[0] = x[1] = (int32_t)lrint(A * sin(2 * M_PI * (double)((int64_t)f * i % in) / in));
+        int k = SRCProcess(x, o);
+        for(int j = 0; j < k; j++) y.push_back(o[2 * j]);
+    }
+    y.erase(y.begin(), y.begin() + skip);
+    y.resize(N);
+    if((int)c.size() != N){
+        c.resize(N); s.resize(N);
+        for(int n = 0; n < N; n++){ c[n] = cos(2 * M_PI * n / N); s[n] = sin(2 * M_PI * n / N); }
+    }
+    auto power = [&](int hz){                         // |X|^2 of the bin at hz, hz a multiple of 10
+        int k = hz / 10;
+        double re = 0, im = 0;
+        for(int n = 0, p = 0; n < N; n++, p = (p + k) % N){ re += y[n] * c[p]; im += y[n] * s[p]; }
+        return (re * re + im * im) * (k == 0 || 2 * k == N ? 1 : 2) / N / N;
+    };
+    double total = 0, pt = power(f);
+    for(double v : y) total += v * v;
+    t.gain = sqrt(2 * pt) / A;
+    t.snr = 10 * log10(pt / (total / N - pt));
+    if(images){
+        int g = in, r = out, worst = 0;
+        while(r){ int m = g % r; g = r; r = m; }
+        double pw = 0;
+        for(int j = 0; j <= out / g; j++) for(int sgn = -1; sgn <= 1; sgn += 2){
+            int hz = ((j * g + sgn * f) % out + out) % out;
+            if(hz > out / 2) hz = out - hz;
+            if(hz == f) continue;
+            double p = power(hz);
+            if(p > pw){ pw = p; worst = hz; }
+        }
+        t.image = pw > 0 ? 10 * log10(pw / pt) : -200;
+        if(g_verbose) printf("    %5d Hz: gain %+.4f dB, SNR %5.1f dB, worst image %6.1f dB at %5d Hz\n", f,
+                             20 * log10(t.gain), t.snr, t.image, worst);
+    }
+    return t;
+}
+
+int main(int argc, char **){
+    const char *name[] = {"LOW", "MEDIUM", "HIGH"};
+    struct { int taps; double edge, image, kb; } preset[] = {   // the presets of resampler.h at 44.1 -> 48 kHz
+        {24, 16.5, -69, 15}, {48, 18.8, -89, 30}, {64, 19.5, -100, 40}};
+    int pairs[][2] = {{44100, 48000}, {48000, 44100}, {22050, 48000}, {32000, 48000}};
+    bool ok = true;
+
+    g_verbose = argc > 1;
+    printf("  rate pair      preset taps    KB    -0.1 dB  ripple (dB)         images  1 kHz SNR   MAC/s  host per s\n");
+    for(auto &pr : pairs) for(int q = 0; q < 3; q++){
+        int in = pr[0], out = pr[1];
+        if(!SRCInit(in, out, q)){ printf("  %5d -> %5d %-6s not supported  WRONG\n", in, out, name[q]); ok = false; continue; }
+        int edge = 0;
+        for(int f = in / 4 / 10 * 10; f < std::min(in, out) / 2; f += 50) if(tone(f, in, out, false).gain < pow(10, -0.1 / 20)){ edge = f; break; }
+        double gmin = 1e9, gmax = 0, image = -200;
+        for(double fd = 20; fd < edge; fd *= 1.1){
+            Tone t = tone((int)fd / 10 * 10, in, out, true);
+            gmin = std::min(gmin, t.gain); gmax = std::max(gmax, t.gain); image = std::max(image, t.image);
+        }
+        double snr = tone(1000, in, out, false).snr, kb = SRCGetL() * SRCGetTaps() * sizeof(float) / 1024.0;
+
+        // speed: 20 s of a ramp
+        int32_t x[2], o[2 * SRC_MAX_OUT];
+        volatile int32_t sink = 0;
+        SRCClearHistory();
+        auto t0 = std::chrono::steady_clock::now();
+        for(int i = 0; i < in * 20; i++){ x[0] = i; x[1] = -i; if(SRCProcess(x, o)) sink = sink + o[0]; }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / 20;
+
+        bool good = edge && 20 * log10(gmin) > -0.1;
+        if(in == 44100 && out == 48000) good &= SRCGetTaps() == preset[q].taps && edge >= preset[q].edge * 1000 - 50 &&
+                                                image <= preset[q].image && kb <= preset[q].kb;
+        printf("  %5d -> %5d %-6s %3d %5.1f %6.1f kHz  %+.4f/%+.4f  %6.1f dB  %5.1f dB  %4.1f M  %5.0f us  %s\n", in, out,
+               name[q], SRCGetTaps(), kb, edge / 1000.0, 20 * log10(gmin), 20 * log10(gmax), image, snr,
+               2.0 * SRCGetTaps() * out / 1e6, us, good ? "ok" : "WRONG");
+        ok &= good;
+        SRCFree();
+    }
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
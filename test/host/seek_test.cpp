@@ -0,0 +1,49 @@
+/*
+ * seek_test.cpp
+ * setAudioPlayPosition() on a long mp3 file: with 40000 frames the seek index has doubled its interval to 128
+ * frames, a seek has to walk up to 127 frame headers from the entry before the wanted frame
+ *
+ * After every seek the output has to start with the first frame of the wanted second. That frame itself is not
+ * bit exact, the filterbank still holds the end of the frame played before the seek, so the next frames are
+ * compared: they must follow as the second output frame, and the frame before the wanted one must not appear.
+ ************************************************************************************/
+
+#include "harness.h"
+
+static Audio *audio;
+
+void audio_info(const char *i){ if(g_verbose) printf("     %6lu %s\n", millis(), i); }
+
+int main(int argc, char **){
+    const int frames = 40000;                          // 17 min, index interval 128 frames
+    bool ok = true;
+
+    g_verbose = argc > 1;
+    SD.root = ".";
+    std::vector<Frame> ref = decodeMp3(makeStream(frames));
+    audio = new Audio();
+    audio->setMP3PreScan(true);
+    audio->connecttoFS(SD, "/stream.mp3");
+    for(int i = 0; i < 2000; i++) audio->loop();       // playing
+
+    for(uint16_t sec : {3, 400, 11, 777, 1001}){       // the last one runs into the end of the file
+        uint32_t frame = (uint64_t)sec * 44100 / 1152;
+        std::vector<Frame> want(ref.begin() + (frame + 1) * 1152, ref.begin() + (frame + 5) * 1152);
+        std::vector<Frame> before(ref.begin() + (frame - 1) * 1152, ref.begin() + frame * 1152);
+
+        bool seeked = audio->setAudioPlayPosition(sec);
+        dmaFlush();
+        g_speaker.clear();
+        for(int i = 0; i < 2000; i++) audio->loop();
+        dmaFlush();
+        long at = findSeq(g_speaker, want, 0);
+        bool early = findSeq(g_speaker, before, 0) >= 0;
+        bool pass = seeked && at == 1152 && !early;
+        printf("  %4u s = frame %5u: %s, next frame at output sample %ld, frame before %s, %s\n", sec, frame,
+               seeked ? "seeked" : "seek failed", at, early ? "played" : "not played", pass ? "ok" : "WRONG");
+        ok &= pass;
+    }
+    audio->stopSong();
+    printf("%s\n", ok ? "ALL OK" : "FAILURES");
+    return !ok;
+}
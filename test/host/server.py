@@ -0,0 +1,120 @@
+# stand-in for an Icecast/Shoutcast server on 127.0.0.1, serves the mp3 file given as argument
+#   /icy        ICY response, metadata every METAINT bytes
+#   /chunked    HTTP/1.1 response, the ICY body in chunks of random size, with and without chunk extensions
+#   /redir      302 to /icy
+#   /list.m3u   playlist with /icy
+#   /list.pls   playlist with /chunked
+#   /smooth     ICY at the stream rate (real time)
+#   /jitter     the same with stalls of 0.3 to 2 s, the data of a stall follows at once
+#   /burst      the same as /smooth, the first 4 s are sent at once (server side buffer)
+#   /drop       live stream at the stream rate, the first three connections are cut after 3 s, the next
+#               three are closed at once (server down), a new connection starts 2 s behind live
+# the responses that are not paced are sent in pieces of random size (1 byte up to a few TCP segments)
+# prints "ready <port>" once it listens
+import socket, threading, random, sys, time
+
+MP3 = open(sys.argv[1], 'rb').read()
+METAINT = 8192
+FRAMEBYTES = 417
+DROP_T0 = None; DROP_N = 0                         # /drop: start of the live stream, connections
+
+def titles():
+    # every second block has a title, block 4 a long one (1.2 KB with the StreamUrl)
+    out = []
+    for k in range(len(MP3) // METAINT + 1):
+        if k % 2 == 0:
+            t = "StreamTitle='Artist %d - Song %d';StreamUrl='http://example.com/%d';" % (k, k, k)
+            if k == 4: t = "StreamTitle='Long %s';StreamUrl='%s';" % ('x' * 300, 'y' * 900)
+            b = t.encode(); b += b'\0' * (-len(b) % 16)
+            out.append(bytes([len(b) // 16]) + b)
+        else:
+            out.append(b'\0')
+    return out
+
+def icyBody():
+    body = b''; meta = titles()
+    for k in range(0, len(MP3), METAINT):
+        body += MP3[k:k + METAINT]
+        if k + METAINT <= len(MP3): body += meta[k // METAINT]
+    return body
+
+def chunked(b):
+    out = b''; i = 0; rnd = random.Random(7)
+    while i < len(b):
+        n = min(rnd.choice([1, 2, 17, 500, 1460, 3000, 7000]), len(b) - i)
+        ext = ';name=v' if rnd.random() < 0.2 else ''
+        out += (('%X' if rnd.random() < 0.5 else '%x') % n).encode() + ext.encode() + b'\r\n' + b[i:i + n] + b'\r\n'
+        i += n
+    return out + b'0\r\n\r\n'
+
+def send(c, data, seed):
+    rnd = random.Random(seed); i = 0
+    while i < len(data):
+        n = rnd.choice([1, 3, 64, 700, 1460, 4000])
+        c.sendall(data[i:i + n]); i += n
+        if rnd.random() < 0.02: time.sleep(0.001)
+
+def serve(c, port):
+    req = b''
+    while b'\r\n\r\n' not in req:
+        d = c.recv(4096)
+        if not d: return
+        req += d
+    path = req.split(b' ')[1].decode(); host = '127.0.0.1:%d' % port
+    junk = 'X-Junk: ' + 'z' * 2000 + '\r\n'               # longer than the arena, must be skipped
+    if path == '/icy':
+        hdr = 'ICY 200 OK\r\nicy-notice1: <BR>This stream requires Winamp<BR>\r\nicy-name: Test Station  \r\nicy-genre: Test\r\n' + junk + \
+              'Content-Type: audio/mpeg\r\nicy-br:128\r\nicy-metaint:%d\r\nicy-url: http://example.com\r\n\r\n' % METAINT
+        send(c, hdr.encode() + icyBody(), 1)
+    elif path == '/chunked':
+        hdr = 'HTTP/1.1 200 OK\r\ncontent-type: audio/mpeg\r\nTransfer-Encoding: chunked\r\nicy-metaint: %d\r\nicy-name: Chunked Station\r\n\r\n' % METAINT
+        send(c, hdr.encode() + chunked(icyBody()), 2)
+    elif path in ('/smooth', '/jitter', '/burst'):
+        hdr = 'ICY 200 OK\r\nicy-name: Paced Station\r\nContent-Type: audio/mpeg\r\nicy-br:128\r\nicy-metaint:%d\r\n\r\n' % METAINT
+        data = hdr.encode() + icyBody(); rate = 16000 * (1 + 1.0 / METAINT)
+        stalls = [(3, 0.6), (6, 1.2), (9.5, 0.3), (10.5, 0.3), (13, 2.0), (17, 0.8)] if path == '/jitter' else []
+        t0 = time.time() - (65536 / rate if path == '/burst' else 0); i = 0
+        while i < len(data):
+            t = time.time() - t0
+            for s0, d in stalls:
+                if s0 <= t < s0 + d: time.sleep(s0 + d - t); t = time.time() - t0
+            due = int(len(hdr) + rate * t) - i
+            if due <= 0: time.sleep(0.005); continue
+            n = min(due, 1460, len(data) - i); c.sendall(data[i:i + n]); i += n
+    elif path == '/drop':
+        global DROP_T0, DROP_N
+        if DROP_T0 is None: DROP_T0 = time.time()
+        DROP_N += 1; k = DROP_N
+        if 3 < k <= 6: return                         # down
+        hdr = 'ICY 200 OK\r\nicy-name: Live Station\r\nContent-Type: audio/mpeg\r\nicy-br:128\r\nicy-metaint:%d\r\n\r\n' % METAINT
+        rate = 16000; c.sendall(hdr.encode())
+        pos = max(0, int((time.time() - DROP_T0) * rate) - 32768); pos -= pos % FRAMEBYTES
+        tc = time.time(); m = 0
+        life = 3.0 if k <= 3 else 1e9
+        while pos < len(MP3) and time.time() - tc < life:
+            due = int((time.time() - DROP_T0) * rate) - pos
+            if due <= 0: time.sleep(0.005); continue
+            n = min(due, 1460, len(MP3) - pos, METAINT - m); c.sendall(MP3[pos:pos + n]); pos += n; m += n
+            if m == METAINT: c.sendall(b'\0'); m = 0
+    elif path == '/redir':
+        send(c, ('HTTP/1.1 302 Found\r\nLocation: http://%s/icy\r\nContent-Length: 0\r\n\r\n' % host).encode(), 3)
+    elif path == '/list.m3u':
+        body = '#EXTM3U\r\n#EXTINF:-1,Test Station from m3u\r\nhttp://%s/icy\r\n' % host
+        send(c, ('HTTP/1.0 200 OK\r\nContent-Type: audio/x-mpegurl\r\n\r\n' + body).encode(), 4)
+    elif path == '/list.pls':
+        body = '[playlist]\nNumberOfEntries=1\nFile1=http://%s/chunked\nTitle1=Test Station from pls\nLength1=-1\n' % host
+        send(c, ('HTTP/1.0 200 OK\r\nContent-Type: audio/x-scpls\r\n\r\n' + body).encode(), 5)
+    c.close()
+
+def quiet(c, port):
+    try: serve(c, port)
+    except (BrokenPipeError, ConnectionResetError): pass   # the client has closed, stopSong()
+    finally: c.close()
+
+s = socket.socket(); s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+s.bind(('127.0.0.1', 0)); s.listen(8)
+port = s.getsockname()[1]
+sys.stdout.write('ready %d\n' % port); sys.stdout.flush()
+while True:
+    c, _ = s.accept()
+    threading.Thread(target=quiet, args=(c, port), daemon=True).start()
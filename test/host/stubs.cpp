@@ -0,0 +1,208 @@
+/*
+ * stubs.cpp
+ * Arduino and ESP-IDF functions the audio library calls, working on Linux
+ *
+ * I2S writes go through a model of the DMA buffers to the "speaker", g_speaker holds every frame that has been
+ * played. Two timings:
+ *   as fast as possible (default): a blocking write pushes the oldest frames out of the DMA, a non-blocking
+ *   one finds room every g_speed-th time, the decoder runs at g_speed x real time
+ *   real time (g_realtime): the DMA drains at g_rate frames per second of wall clock, frames that are due
+ *   while it is empty are played as silence and counted in g_starved
+ ************************************************************************************/
+
+#include "harness.h"
+#include "driver/i2s.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <pthread.h>
+#include <unistd.h>
+
+static auto t0 = std::chrono::steady_clock::now();
+static double nowS(){ return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); }
+
+unsigned long millis(){ return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count(); }
+unsigned long micros(){ return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count(); }
+void delay(unsigned long){}
+void delayMicroseconds(unsigned int){}
+void pinMode(int, int){}
+void digitalWrite(int, int){}
+int  digitalRead(int){ return 0; }
+long random(long n){ return rand() % n; }
+void randomSeed(unsigned long s){ srand(s); }
+
+bool g_psram = false;
+void *ps_malloc(size_t n){ return malloc(n); }
+void *ps_calloc(size_t a, size_t b){ return calloc(a, b); }
+bool psramInit(){ return g_psram; }
+bool psramFound(){ return g_psram; }
+uint32_t EspClass::getFreeHeap(){ return 100000; }
+uint32_t EspClass::getCycleCount(){     // 240 MHz of host time, fine enough for the kernel profiles
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count() * 240 / 1000;
+}
+uint32_t EspClass::getCpuFreqMHz(){ return 240; }
+uint32_t EspClass::getFreePsram(){ return 0; }
+uint32_t EspClass::getPsramSize(){ return 0; }
+EspClass ESP;
+HardwareSerial Serial;
+SDFS SD;
+
+bool g_verbose = false;
+size_t Print::print(const char *s){ if(g_verbose) fputs(s, stdout); return 0; }
+size_t Print::println(const char *s){ if(g_verbose) puts(s); return 0; }
+size_t Print::println(const String &s){ return println(s.c_str()); }
+size_t Print::printf(const char*, ...){ return 0; }
+size_t Print::println(int){ return 0; }
+size_t Print::print(int){ return 0; }
+void HardwareSerial::begin(int){}
+int    Stream::available(){ return 0; }
+int    Stream::read(){ return -1; }
+size_t Stream::readBytes(char*, size_t){ return 0; }
+size_t Stream::readBytes(uint8_t*, size_t){ return 0; }
+String Stream::readStringUntil(char){ return String(); }
+
+//---------------------------------------------------------------------------------------------------------------------
+// I2S, I2S_32BIT: [right, left] per frame
+size_t   g_dmaFrames = 4096;                       // dma_buf_count * dma_buf_len
+std::deque<Frame>  g_dma;
+std::vector<Frame> g_speaker;
+std::vector<Event> g_events;
+uint32_t g_rate = 16000;
+int      g_speed = 3, g_nbTry = 0, g_nbFail = 0;
+bool     g_realtime = false, g_rtRunning = false;
+long     g_starved = 0, g_starveEvents = 0;
+static double g_rtClock = 0;
+
+static void ev(const std::string &s){ g_events.push_back({g_speaker.size() + g_dma.size(), s}); }
+
+esp_err_t i2s_driver_install(i2s_port_t, const i2s_config_t *c, int, void*){
+    g_dmaFrames = c->dma_buf_count * c->dma_buf_len;
+    return 0;
+}
+esp_err_t i2s_set_pin(i2s_port_t, const i2s_pin_config_t*){ return 0; }
+esp_err_t i2s_start(i2s_port_t){ ev("i2s_start"); return 0; }
+esp_err_t i2s_stop(i2s_port_t){ ev("i2s_stop"); return 0; }
+esp_err_t i2s_zero_dma_buffer(i2s_port_t){
+    for(auto &f : g_dma) f = {0, 0};
+    ev("zero_dma");
+    return 0;
+}
+esp_err_t i2s_set_sample_rates(i2s_port_t, uint32_t r){ g_rate = r; ev("set_rate " + std::to_string(r)); return 0; }
+esp_err_t i2s_set_clk(i2s_port_t, uint32_t r, i2s_bits_per_sample_t, i2s_channel_t){ g_rate = r; ev("set_clk"); return 0; }
+
+void rtDrain(){
+    double t = nowS();
+    if(!g_rtRunning){ g_rtClock = t; return; }
+    long due = (long)((t - g_rtClock) * g_rate);
+    if(due <= 0) return;
+    g_rtClock += (double)due / g_rate;
+    long k = 0;
+    while(k < due && !g_dma.empty()){
+        g_speaker.push_back(g_dma.front());
+        g_dma.pop_front();
+        k++;
+    }
+    if(k < due){                                   // the DMA ran empty, the codec plays silence
+        g_starved += due - k;
+        g_starveEvents++;
+        for(long i = k; i < due; i++) g_speaker.push_back({0x7fffffff, 0x7fffffff});
+    }
+}
+
+esp_err_t i2s_write(i2s_port_t, const void *src, size_t n, size_t *w, uint32_t ticks){
+    const int32_t *s = (const int32_t*)src;
+    if(g_realtime){
+        if(!g_rtRunning){ g_rtRunning = true; g_rtClock = nowS(); }
+        rtDrain();
+        while(g_dma.size() + n / 8 > g_dmaFrames){
+            if(!ticks){ *w = 0; return 0; }
+            usleep(500);
+            rtDrain();
+        }
+        for(size_t i = 0; i + 8 <= n; i += 8) g_dma.push_back({s[i / 4 + 1], s[i / 4]});
+        *w = n;
+        return 0;
+    }
+    if(!ticks && (++g_nbTry % g_speed)){ g_nbFail++; *w = 0; return 0; }
+    for(size_t i = 0; i + 8 <= n; i += 8){
+        g_dma.push_back({s[i / 4 + 1], s[i / 4]});
+        if(g_dma.size() > g_dmaFrames){
+            g_speaker.push_back(g_dma.front());
+            g_dma.pop_front();
+        }
+    }
+    *w = n;
+    return 0;
+}
+
+void dmaFlush(){
+    while(!g_dma.empty()){
+        g_speaker.push_back(g_dma.front());
+        g_dma.pop_front();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// amplifier and crossover of the board
+int  tas5753md_config(void){ return 0; }
+void tas5753md_mute(void){ ev("mute"); }
+void tas5753md_unmute(void){ ev("unmute"); }
+void tas5753md_adjustVolume(int){}
+void tas5753md_setVolume(uint16_t){}
+int  biquad_loadCoeffs_LR(double fs){ ev("biquad " + std::to_string((int)fs)); return 0; }
+
+//---------------------------------------------------------------------------------------------------------------------
+// FreeRTOS on threads: a task is a detached thread, a queue a deque under a mutex
+struct StubQueue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> q;
+    size_t len, item;
+};
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item){
+    StubQueue *q = new StubQueue;
+    q->len = len;
+    q->item = item;
+    return q;
+}
+BaseType_t xQueueSend(QueueHandle_t h, const void *p, TickType_t){
+    StubQueue *q = (StubQueue*)h;
+    std::lock_guard<std::mutex> l(q->m);
+    if(q->q.size() >= q->len) return pdFALSE;
+    q->q.emplace_back((const uint8_t*)p, (const uint8_t*)p + q->item);
+    q->cv.notify_one();
+    return pdTRUE;
+}
+BaseType_t xQueueReceive(QueueHandle_t h, void *p, TickType_t){
+    StubQueue *q = (StubQueue*)h;
+    std::unique_lock<std::mutex> l(q->m);
+    q->cv.wait(l, [q]{ return !q->q.empty(); });
+    memcpy(p, q->q.front().data(), q->item);
+    q->q.pop_front();
+    return pdTRUE;
+}
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t f, const char*, uint32_t, void *a, UBaseType_t, TaskHandle_t*, BaseType_t){
+    std::thread(f, a).detach();
+    return pdPASS;
+}
+void vTaskDelete(TaskHandle_t){ pthread_exit(nullptr); }
+void vTaskDelay(TickType_t t){ usleep(t * 1000); }
+
+void  *heap_caps_malloc(size_t n, uint32_t){ return aligned_alloc(4, (n + 3) & ~3); }
+void   heap_caps_free(void *p){ free(p); }
+size_t heap_caps_get_free_size(uint32_t){ return 100000; }
+
+//---------------------------------------------------------------------------------------------------------------------
+// SD card: g_sdUsPerKB per KB, every g_sdStallEvery-th write takes g_sdStallMs longer (erase, wear levelling)
+int  g_sdUsPerKB = 0, g_sdStallEvery = 0, g_sdStallMs = 0;
+static long g_sdWrites = 0;
+void sdDelay(size_t n){
+    long us = (long)g_sdUsPerKB * n / 1024;
+    g_sdWrites++;
+    if(g_sdStallEvery && g_sdWrites % g_sdStallEvery == 0) us += g_sdStallMs * 1000L;
+    if(us) usleep(us);
+}
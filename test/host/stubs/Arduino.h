@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+using std::min; using std::max;
+#define PROGMEM
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define log_i(...) do{printf(__VA_ARGS__);printf("\n");}while(0)
+#define log_e(...) do{printf(__VA_ARGS__);printf("\n");}while(0)
+#define log_w(...) do{printf(__VA_ARGS__);printf("\n");}while(0)
+#define log_d(...) do{}while(0)
+typedef bool boolean;
+typedef unsigned int uint;
+typedef int esp_err_t;
+#define ESP_OK 0
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define MSBFIRST 1
+#define SPI_MODE1 1
+unsigned long millis(); unsigned long micros(); void delay(unsigned long); void delayMicroseconds(unsigned int);
+void pinMode(int,int); void digitalWrite(int,int); int digitalRead(int);
+void* ps_malloc(size_t); void* ps_calloc(size_t,size_t); bool psramInit(); bool psramFound();
+struct EspClass { uint32_t getFreeHeap(); uint32_t getCycleCount(); uint32_t getCpuFreqMHz(); uint32_t getFreePsram(); uint32_t getPsramSize(); };
+extern EspClass ESP;
+#include "WString.h"
+struct Print { size_t print(const char*); size_t print(const String&); size_t println(const char* s=""); size_t println(const String&); size_t printf(const char*, ...); size_t println(int); size_t print(int); };
+struct HardwareSerial : Print { void begin(int); };
+extern HardwareSerial Serial;
+struct Stream : Print { int available(); int read(); size_t readBytes(char*, size_t); size_t readBytes(uint8_t*, size_t); String readStringUntil(char); };
+#define PIN_CTRL 0
+#define PERIPHS_IO_MUX_GPIO0_U 0
+#define FUNC_GPIO0_CLK_OUT1 0
+#define REG_WRITE(a,b) ((void)(a),(void)(b))
+#define PIN_FUNC_SELECT(a,b) ((void)(a),(void)(b))
+#define BIT(i) (1u<<(i))
+#include "driver/gpio.h"
+long random(long); void randomSeed(unsigned long); int analogRead(int); void adcAttachPin(int);
@@ -0,0 +1,33 @@
+#pragma once
+#include "Arduino.h"
+#include <memory>
+#include <string>
+void sdDelay(size_t);
+namespace fs {
+struct FileImpl { FILE *f = nullptr; std::string name; ~FileImpl(){ if(f) fclose(f); } };
+struct File : Stream {
+    std::shared_ptr<FileImpl> p;
+    operator bool() const { return p && p->f; }
+    size_t read(uint8_t *b, size_t n){ return (p && p->f) ? fread(b, 1, n, p->f) : 0; }
+    int read(){ uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+    size_t readBytes(char *b, size_t n){ return read((uint8_t*)b, n); }
+    size_t readBytes(uint8_t *b, size_t n){ return read(b, n); }
+    bool seek(uint32_t pos){ return p && p->f && fseek(p->f, pos, SEEK_SET) == 0; }
+    uint32_t position(){ return (p && p->f) ? ftell(p->f) : 0; }
+    uint32_t size(){ if(!p || !p->f) return 0; long c = ftell(p->f); fseek(p->f, 0, SEEK_END); long s = ftell(p->f); fseek(p->f, c, SEEK_SET); return s; }
+    const char* name(){ return p ? p->name.c_str() : ""; }
+    void close(){ if(p && p->f){ fclose(p->f); p->f = nullptr; } p.reset(); }
+    int available(){ return size() - position(); }
+    bool isDirectory(){ return false; } File openNextFile(){ return File(); } void rewindDirectory(){}
+    size_t write(const uint8_t *b, size_t n){ ::sdDelay(n); return (p && p->f) ? fwrite(b, 1, n, p->f) : 0; } void flush(){}
+};
+struct FS {
+    std::string root;
+    File open(const char *path, const char *m = "r"){ File f; FILE *h = fopen((root + path).c_str(), m[0]=='w' ? "wb" : "rb");
+        if(h){ f.p = std::make_shared<FileImpl>(); f.p->f = h; f.p->name = path; } return f; }
+    File open(const String &s, const char *m = "r"){ return open(s.c_str(), m); }
+    bool exists(const char *p){ File f = open(p); return (bool)f; } bool mkdir(const char*){ return true; } bool remove(const char *p){ return ::remove((root+p).c_str()) == 0; }
+};
+}
+#define FILE_WRITE "w"
+using fs::File;
@@ -0,0 +1,3 @@
+#pragma once
+#include "FS.h"
+struct SDFS : fs::FS { bool begin(int){ return true; } }; extern SDFS SD;
@@ -0,0 +1,3 @@
+#pragma once
+#include "Arduino.h"
+struct SPISettings{SPISettings(int,int,int){}}; struct SPIClass{void begin(int,int,int); void setFrequency(int); void beginTransaction(SPISettings); void endTransaction(); uint8_t transfer(uint8_t);}; extern SPIClass SPI;
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+class String {
+ public:
+  std::string s;
+  String(const char* c=""):s(c?c:""){} String(const std::string& x):s(x){} String(char c):s(1,c){} String(int v):s(std::to_string(v)){} String(unsigned v):s(std::to_string(v)){} String(long v):s(std::to_string(v)){} String(unsigned long v):s(std::to_string(v)){}
+  const char* c_str() const {return s.c_str();} unsigned length() const {return s.size();}
+  int indexOf(const char* x, unsigned from=0) const {auto p=s.find(x,from); return p==std::string::npos?-1:(int)p;}
+  int indexOf(char x, unsigned from=0) const {auto p=s.find(x,from); return p==std::string::npos?-1:(int)p;}
+  int indexOf(const String& x) const {return indexOf(x.c_str());}
+  int lastIndexOf(const char* x) const {auto p=s.rfind(x); return p==std::string::npos?-1:(int)p;}
+  int lastIndexOf(char x) const {auto p=s.rfind(x); return p==std::string::npos?-1:(int)p;}
+  String substring(unsigned a) const {return String(s.substr(a));} String substring(unsigned a, unsigned b) const {return String(s.substr(a,b-a));}
+  bool startsWith(const char* x) const {return s.rfind(x,0)==0;} bool endsWith(const char* x) const {std::string t(x); return s.size()>=t.size() && s.compare(s.size()-t.size(),t.size(),t)==0;}
+  bool startsWith(const String& x) const {return startsWith(x.c_str());} bool endsWith(const String& x) const {return endsWith(x.c_str());}
+  void toLowerCase(){ for(auto &c : s) c = tolower((unsigned char)c); } void trim(){ size_t a = s.find_first_not_of(" \t\r\n"); size_t b = s.find_last_not_of(" \t\r\n"); s = a == std::string::npos ? "" : s.substr(a, b - a + 1); } long toInt() const {return atol(s.c_str());}
+  void replace(const char*, const char*){} void remove(unsigned, unsigned){}
+  char operator[](unsigned i) const {return s[i];} char& operator[](unsigned i){return s[i];} char charAt(unsigned i) const {return s[i];}
+  String& operator+=(const String& o){s+=o.s; return *this;} String& operator+=(const char* o){s+=o; return *this;} String& operator+=(char c){s+=c; return *this;}
+  friend String operator+(const String& a, const String& b){return String(a.s+b.s);} friend String operator+(const String& a, const char* b){return String(a.s+b);} friend String operator+(const char* a, const String& b){return String(std::string(a)+b.s);} friend String operator+(const String& a, char b){return String(a.s+b);}
+  bool operator==(const String& o) const {return s==o.s;} bool operator!=(const String& o) const {return s!=o.s;} bool operator==(const char* o) const {return s==o;} bool operator!=(const char* o) const {return s!=o;}
+  explicit operator bool() const {return true;}
+};
@@ -0,0 +1,4 @@
+#pragma once
+#include "Arduino.h"
+struct IPAddress{ IPAddress(){} IPAddress(uint32_t){} }; struct WiFiClient : Stream { WiFiClient(){} WiFiClient(int fd); WiFiClient &operator=(const WiFiClient &o); int connect(const char*, uint16_t); int connect(IPAddress, uint16_t); void stop(); void flush(); int available(); int read(); int read(uint8_t*, size_t); bool connected(); size_t write(const uint8_t*, size_t); void setNoDelay(bool);};
+struct WiFiClientSecure : WiFiClient {};
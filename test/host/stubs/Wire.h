@@ -0,0 +1,5 @@
+#pragma once
+#include "Arduino.h"
+struct TwoWire { void begin(int, int); void beginTransmission(uint8_t); size_t write(uint8_t); size_t write(const uint8_t*, size_t);
+                 uint8_t endTransmission(bool stop = true); uint8_t requestFrom(uint8_t, uint8_t); int read(); void setClock(uint32_t); };
+extern TwoWire Wire;
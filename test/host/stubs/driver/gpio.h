@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+typedef int gpio_num_t; typedef int esp_err_t;
+typedef enum {GPIO_FLOATING=0, GPIO_PULLUP_ONLY} gpio_pull_mode_t;
+esp_err_t gpio_set_pull_mode(gpio_num_t, gpio_pull_mode_t); esp_err_t gpio_pullup_en(gpio_num_t); esp_err_t gpio_pulldown_dis(gpio_num_t);
+struct gpio_dev_t { struct { uint32_t val; } in1; };
+extern gpio_dev_t GPIO;
+#define GPIO_NUM_0 0
@@ -0,0 +1,10 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#define MALLOC_CAP_32BIT (1<<1)
+#define MALLOC_CAP_8BIT  (1<<2)
+#define MALLOC_CAP_DMA   (1<<3)
+#define MALLOC_CAP_SPIRAM (1<<10)
+#define MALLOC_CAP_INTERNAL (1<<11)
+void *heap_caps_malloc(size_t, uint32_t); void heap_caps_free(void*);
+size_t heap_caps_get_free_size(uint32_t);
@@ -0,0 +1,7 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+typedef void *SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
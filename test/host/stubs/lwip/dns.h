@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+typedef int8_t err_t;
+typedef struct { uint32_t addr; } ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+#define ERR_OK          0
+#define ERR_INPROGRESS -5
+#define ERR_ARG       -16
+#define ip_2_ip4(a)          (a)
+#define ip4_addr_get_u32(a)  ((a)->addr)
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg);